@@ -32,10 +32,27 @@ static constexpr int INVALID_TXN_ID = -1;      // invalid transaction id
 static constexpr int INVALID_TIMESTAMP = -1;   // invalid transaction timestamp
 static constexpr int INVALID_LSN = -1;         // invalid log sequence number
 static constexpr int HEADER_PAGE_ID = 0;       // the header page id
-static constexpr int PAGE_SIZE = 4096;         // size of a data page in byte  4KB
+static constexpr int PAGE_SIZE = 4096;         // default size of a data page in byte 4KB, also the O_DIRECT alignment
+static constexpr int MAX_PAGE_SIZE = 32768;    // largest page size a database can be created with 32KB
 static constexpr int BUFFER_POOL_SIZE = 65536; // size of buffer pool 256MB
 // static constexpr int BUFFER_POOL_SIZE = 262144;                                // size of buffer pool 1GB
-static constexpr int LOG_BUFFER_SIZE = (1024 * PAGE_SIZE); // size of a log buffer in byte
+static constexpr int BUFFER_POOL_SHARDS = 16;              // default number of buffer pool shards
+static constexpr int RING_BULK_READ_FRAMES = 256;          // ring size of the bulk read access strategy 1MB
+static constexpr int RING_BULK_WRITE_FRAMES = 1024;        // ring size of the bulk write access strategy 4MB
+static constexpr int BGWRITER_DELAY_MS = 200;              // interval between background writer rounds, 0 disables it
+static constexpr int BGWRITER_MAX_PAGES = 100;             // max pages written by the background writer per round
+static constexpr int BGWRITER_CLEAN_TARGET = 4096;         // clean frames kept ahead of the victim cursor 16MB
+static constexpr int AUTOVACUUM_DELAY_MS = 0;              // interval between background vacuum rounds, 0 disables it
+static constexpr double AUTOVACUUM_FREE_RATIO = 0.5;       // free-space ratio at which a table is vacuumed in background
+static constexpr int AUTOVACUUM_MIN_PAGES = 16;            // tables smaller than this are never vacuumed in background
+static constexpr int READ_AHEAD_PAGES = 32;                // pages prefetched ahead of a sequential scan 128KB
+static constexpr int READ_AHEAD_TRIGGER = 4;               // sequential misses on a file before read-ahead starts
+static constexpr int IO_QUEUE_DEPTH = 64;                  // max asynchronous page I/Os in flight per IoContext
+static constexpr int IO_THREADS = 4;                       // worker threads of the thread_pool I/O backend
+static constexpr int HUGE_PAGE_SIZE = 2 * 1024 * 1024;     // huge page size used for the frame arena 2MB
+static constexpr int EXTENT_MIN_PAGES = 256;               // smallest extent preallocated for a growing file 1MB
+static constexpr int EXTENT_MAX_PAGES = 16384;             // largest extent preallocated for a growing file 64MB
+static constexpr int LOG_BUFFER_SIZE = 4 * 1024 * 1024;   // size of a log buffer in byte 4MB
 static constexpr int BUCKET_SIZE = 50;                     // size of extendible hash bucket
 
 using frame_id_t = int32_t;   // frame id type, 帧页ID, 页在BufferPool中的存储单元称为帧,一帧对应一页
@@ -50,6 +67,13 @@ using timestamp_t = int32_t; // timestamp type, used for transaction concurrency
 static const std::string LOG_FILE_NAME = "db.log";
 
 // replacer
-static const std::string REPLACER_TYPE = "LRU";
+static const std::string REPLACER_TYPE = "LRU"; // default replacement policy: LRU, LRU_ARRAY, CLOCK or 2Q
+
+// disk I/O
+static const std::string IO_BACKEND = "io_uring";            // asynchronous I/O backend: io_uring or thread_pool
+static const std::string FREE_PAGE_MAP_SUFFIX = ".fpm";       // suffix of the free-page bitmap stored next to a file
+static const std::string COMPRESSED_PAGE_MAP_SUFFIX = ".zpm"; // suffix of the page map of a compressed file
+static const std::string FREE_SPACE_MAP_SUFFIX = ".fsm";      // suffix of the free-space map of a table file
+static const std::string DICTIONARY_SUFFIX = ".dict";         // suffix of the string dictionary of a table file
 
 static const std::string DB_META_NAME = "db.meta";
@@ -24,15 +24,19 @@ const char *help_info = "Supported SQL syntax:\n"
                         "  command ;\n"
                         "command:\n"
                         "  CREATE TABLE table_name (column_name type [, column_name type ...])\n"
+                        "    [WITH (option [, option ...])]\n"
                         "  DROP TABLE table_name\n"
                         "  CREATE INDEX table_name (column_name)\n"
                         "  DROP INDEX table_name (column_name)\n"
+                        "  VACUUM table_name\n"
                         "  INSERT INTO table_name VALUES (value [, value ...])\n"
                         "  DELETE FROM table_name [WHERE where_clause]\n"
                         "  UPDATE table_name SET column_name = value [, column_name = value ...] [WHERE where_clause]\n"
                         "  SELECT selector FROM table_name [WHERE where_clause]\n"
+                        "option:\n"
+                        "  layout = {row | pax} | dictionary = column_name\n"
                         "type:\n"
-                        "  {INT | FLOAT | CHAR(n)}\n"
+                        "  {INT | FLOAT | CHAR(n) | VARCHAR(n)}\n"
                         "where_clause:\n"
                         "  condition [AND condition ...]\n"
                         "condition:\n"
@@ -44,12 +48,12 @@ const char *help_info = "Supported SQL syntax:\n"
                         "selector:\n"
                         "  {* | column [, column ...]}\n";
 
-// 主要负责执行DDL语句
+// 主要负责执行DDL语句，调用者排他持有sm_manager_->ddl_latch_
 void QlManager::run_mutli_query(std::shared_ptr<Plan> plan, Context *context) {
     if (auto x = std::dynamic_pointer_cast<DDLPlan>(plan)) {
         switch (x->tag) {
         case T_CreateTable: {
-            sm_manager_->create_table(x->tab_name_, x->cols_, context);
+            sm_manager_->create_table(x->tab_name_, x->cols_, context, x->pax_);
             break;
         }
         case T_DropTable: {
@@ -68,6 +72,14 @@ void QlManager::run_mutli_query(std::shared_ptr<Plan> plan, Context *context) {
             sm_manager_->show_index(x->tab_name_, context);
             break;
         }
+        case T_VacuumTable: {
+            // 未提交的事务回滚时按原来的记录号恢复记录，不能移动它们修改过的表中的记录
+            if (txn_mgr_->has_uncommitted_writes(x->tab_name_)) {
+                throw InternalError("Cannot vacuum table " + x->tab_name_ + " with uncommitted writes");
+            }
+            sm_manager_->vacuum_table(x->tab_name_, context);
+            break;
+        }
         default:
             throw InternalError("Unexpected field type");
             break;
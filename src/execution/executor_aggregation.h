@@ -12,6 +12,7 @@ See the Mulan PSL v2 for more details. */
 #include "execution_defs.h"
 #include "execution_manager.h"
 #include "executor_abstract.h"
+#include "executor_seq_scan.h"
 #include "index/ix.h"
 #include "system/sm.h"
 
@@ -34,6 +35,9 @@ class AggregationExecutor : public AbstractExecutor {
 
     bool empty_table_aggr_ = false;
 
+    bool column_aggr_ = false;          // 是否在列批次上直接算出了聚合值，此时只有一行结果
+    std::vector<Value> column_values_; // 列批次上算出的每个sel_cols_initial_的值
+
   public:
     AggregationExecutor(std::unique_ptr<AbstractExecutor> prev, const std::vector<TabCol> &sel_cols,
                         const std::vector<TabCol> &group_cols, const std::vector<Condition> &having_conds) {
@@ -99,6 +103,11 @@ class AggregationExecutor : public AbstractExecutor {
     }
 
     void beginTuple() override {
+        if (aggregate_column_batches()) {
+            column_aggr_ = true;
+            curr_idx = 0;
+            return;
+        }
         for (prev_->beginTuple(); !prev_->is_end(); prev_->nextTuple()) {
             auto record = prev_->Next();
             store_group(std::move(record));
@@ -107,6 +116,10 @@ class AggregationExecutor : public AbstractExecutor {
     }
 
     void nextTuple() override {
+        if (column_aggr_) {
+            ++curr_idx;
+            return;
+        }
         do {
             if (grouped_records_.empty() && group_cols_.empty()) {
                 if (!empty_table_aggr_) {
@@ -160,6 +173,97 @@ class AggregationExecutor : public AbstractExecutor {
         return true;
     }
 
+    /**
+     * @description: 没有GROUP BY和HAVING、子算子是无条件的PAX表扫描、选择列都是COUNT或INT/FLOAT列上的SUM/MIN/MAX时，
+     * 直接在RmColumnScan返回的列数组上累加，不为每行构造RmRecord。结果与逐行计算相同（包括空表时的NULL）
+     * @return {bool} 是否算出了聚合值，不满足条件时返回false，改为逐行计算
+     */
+    bool aggregate_column_batches() {
+        if (!group_cols_.empty() || !having_conds_.empty() || prev_->getType() != SEQ_SCAN_EXECUTOR) {
+            return false;
+        }
+        std::vector<RmColumn> cols;
+        std::vector<int> col_nos; // 每个选择列在cols中的位置，COUNT不需要读取列，为-1
+        for (auto &col : sel_cols_initial_) {
+            if (col.aggr == ast::AGGR_TYPE_COUNT) {
+                col_nos.push_back(-1);
+                continue;
+            }
+            bool numeric = col.type == TYPE_INT || col.type == TYPE_FLOAT;
+            if (!numeric || (col.aggr != ast::AGGR_TYPE_SUM && col.aggr != ast::AGGR_TYPE_MIN &&
+                             col.aggr != ast::AGGR_TYPE_MAX)) {
+                return false;
+            }
+            col_nos.push_back(static_cast<int>(cols.size()));
+            cols.push_back(RmColumn{col.offset, col.len});
+        }
+        auto scan = static_cast<SeqScanExecutor *>(prev_.get())->column_scan(std::move(cols));
+        if (scan == nullptr) {
+            return false;
+        }
+
+        // 整数的和与逐行计算一样按int回绕；浮点数按扫描顺序累加，与逐行计算的舍入相同
+        std::vector<int> int_vals(sel_cols_initial_.size());
+        std::vector<float> float_vals(sel_cols_initial_.size());
+        size_t num_rows = 0;
+        while (scan->next_batch()) {
+            int n = scan->get_num_rows();
+            for (size_t i = 0; i < sel_cols_initial_.size(); i++) {
+                if (col_nos[i] < 0) {
+                    continue;
+                }
+                auto &col = sel_cols_initial_[i];
+                const char *data = scan->get_column(col_nos[i]);
+                for (int row = 0; row < n; row++) {
+                    bool first = num_rows == 0 && row == 0;
+                    if (col.type == TYPE_INT) {
+                        int val;
+                        memcpy(&val, data + static_cast<size_t>(row) * sizeof(int), sizeof(int));
+                        int &acc = int_vals[i];
+                        if (col.aggr == ast::AGGR_TYPE_SUM) {
+                            acc = static_cast<int>(static_cast<unsigned>(acc) + static_cast<unsigned>(val));
+                        } else if (first || (col.aggr == ast::AGGR_TYPE_MIN ? val < acc : val > acc)) {
+                            acc = val;
+                        }
+                    } else {
+                        float val;
+                        memcpy(&val, data + static_cast<size_t>(row) * sizeof(float), sizeof(float));
+                        float &acc = float_vals[i];
+                        if (col.aggr == ast::AGGR_TYPE_SUM) {
+                            acc += val;
+                        } else if (first || (col.aggr == ast::AGGR_TYPE_MIN ? val < acc : val > acc)) {
+                            acc = val;
+                        }
+                    }
+                }
+            }
+            num_rows += n;
+        }
+
+        column_values_.clear();
+        for (size_t i = 0; i < sel_cols_initial_.size(); i++) {
+            auto &col = sel_cols_initial_[i];
+            Value val;
+            if (num_rows == 0) {
+                // 与aggregate_value相同，空表时每个值都是NULL
+                val.type = col.type;
+                val.init_raw(col.len);
+                val.type = TYPE_NULL;
+            } else if (col.aggr == ast::AGGR_TYPE_COUNT) {
+                val.set_int(static_cast<int>(num_rows));
+                val.init_raw(sizeof(int));
+            } else if (col.type == TYPE_INT) {
+                val.set_int(int_vals[i]);
+                val.init_raw(sizeof(int));
+            } else {
+                val.set_float(float_vals[i]);
+                val.init_raw(sizeof(float));
+            }
+            column_values_.push_back(val);
+        }
+        return true;
+    }
+
     ColMeta make_count_star_col(TabCol c) {
         ColMeta col;
         col.name = "*";
@@ -271,6 +375,9 @@ class AggregationExecutor : public AbstractExecutor {
     }
 
     [[nodiscard]] bool is_end() const override {
+        if (column_aggr_) {
+            return curr_idx >= 1;
+        }
         return curr_idx >= (int)grouped_records_.size();
     }
 
@@ -283,7 +390,7 @@ class AggregationExecutor : public AbstractExecutor {
 
         int idx = 0;
         for (auto sel_col : sel_cols_initial_) {
-            Value val = aggregate_value(sel_col);
+            Value val = column_aggr_ ? column_values_[idx] : aggregate_value(sel_col);
             if (val.type == TYPE_NULL) {
                 // 将 sel_cols 中对应的TYPE改成NULl
                 sel_cols_[idx].type = TYPE_NULL; // 为了能够正常识别到。
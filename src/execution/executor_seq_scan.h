@@ -24,9 +24,10 @@ class SeqScanExecutor : public AbstractExecutor {
     std::vector<ColMeta> cols_;        // scan后生成的记录的字段
     size_t len_;                       // scan后生成的每条记录的长度
     std::vector<Condition> fed_conds_; // 同conds_，两个字段相同
+    std::vector<Condition> row_conds_; // conds_中没有交给scan_按字典编号判断、要在展开的记录上判断的条件
 
     Rid rid_{};
-    std::unique_ptr<RecScan> scan_; // table_iterator
+    std::unique_ptr<RmScan> scan_; // table_iterator，条件直接在scan_ pin住的页面上判断
 
     SmManager *sm_manager_;
 
@@ -54,7 +55,7 @@ class SeqScanExecutor : public AbstractExecutor {
     };
 
     void beginTuple() override {
-        scan_ = std::make_unique<RmScan>(fh_);
+        scan_ = std::make_unique<RmScan>(fh_, push_down_conditions());
         // 当前记录未消费，可能需要
         while (!is_end() && !evalConditions()) { // 滑过不满足条件的记录
             scan_->next();
@@ -69,15 +70,51 @@ class SeqScanExecutor : public AbstractExecutor {
     }
 
     bool evalConditions() {
-        auto handle = fh_->get_record(scan_->rid(), context_);
-        char *base = handle->data;
+        const char *base = scan_->record();
         // 逻辑不短路，目前只实现逻辑与
-        return std::all_of(conds_.begin(), conds_.end(), [base, this](const Condition &cond) {
+        return std::all_of(row_conds_.begin(), row_conds_.end(), [base, this](const Condition &cond) {
             auto value = Value::col2Value(base, get_col_offset(cond.lhs_col));
             return cond.eval_with_rvalue(value);
         });
     }
 
+    /**
+     * @description: 字典编码字段与字符串常量的=和<>条件交给scan_，在展开记录之前比较编号，
+     * 不在字典中的常量不会等于任何记录。其余条件留在row_conds_中。
+     * 编号按出现的先后分配，与字符串的大小无关，所以范围比较、投影和GROUP BY仍然使用解码后的记录
+     * @return {vector<RmCodeFilter>} 交给scan_的条件
+     */
+    std::vector<RmCodeFilter> push_down_conditions() {
+        std::vector<RmCodeFilter> filters;
+        row_conds_.clear();
+        for (auto &cond : conds_) {
+            int dict_col_no = -1;
+            if (cond.is_rhs_val && (cond.op == OP_EQ || cond.op == OP_NE) && cond.rhs_val.type == TYPE_STRING) {
+                dict_col_no = fh_->get_dict_col_no(get_col_offset(cond.lhs_col).offset);
+            }
+            if (dict_col_no < 0) {
+                row_conds_.push_back(cond);
+                continue;
+            }
+            auto &str = cond.rhs_val.str_val;
+            int code = fh_->get_dictionary()->lookup(dict_col_no, str.data(), static_cast<int>(str.size()));
+            filters.push_back(RmCodeFilter{dict_col_no, code, cond.op == OP_EQ});
+        }
+        return filters;
+    }
+
+    /**
+     * @description: 没有扫描条件的PAX表可以按列批次读取，聚合直接在列数组上计算，不逐行拼出记录
+     * @return {unique_ptr<RmColumnScan>} 按列的扫描，不是PAX表或有扫描条件时返回nullptr
+     * @param {vector<RmColumn>} cols 要读取的列
+     */
+    std::unique_ptr<RmColumnScan> column_scan(std::vector<RmColumn> cols) const {
+        if (!fh_->is_pax() || !conds_.empty()) {
+            return nullptr;
+        }
+        return std::make_unique<RmColumnScan>(fh_, std::move(cols));
+    }
+
     ColMeta get_col_offset(const TabCol &target) override {
         auto it = std::find_if(cols_.begin(), cols_.end(),
                                [&target](const ColMeta &col) { return col.name == target.col_name; });
@@ -90,7 +127,8 @@ class SeqScanExecutor : public AbstractExecutor {
     }
 
     std::unique_ptr<RmRecord> Next() override {
-        return fh_->get_record(scan_->rid(), context_);
+        // 只有满足条件的记录才复制出页面
+        return std::make_unique<RmRecord>(fh_->get_file_hdr().record_size, scan_->record());
     }
 
     Rid &rid() override {
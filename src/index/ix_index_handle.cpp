@@ -10,6 +10,7 @@ See the Mulan PSL v2 for more details. */
 
 #include "ix_index_handle.h"
 #include "ix_scan.h"
+#include <algorithm>
 #include <cstring>
 #include <mutex>
 
@@ -209,15 +210,17 @@ IxIndexHandle::IxIndexHandle(DiskManager *disk_manager, BufferPoolManager *buffe
     : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager), fd_(fd) {
     // init file_hdr_
     disk_manager_->read_page(fd, IX_FILE_HDR_PAGE, (char *)&file_hdr_, sizeof(file_hdr_));
-    char *buf = new char[PAGE_SIZE];
-    memset(buf, 0, PAGE_SIZE);
-    disk_manager_->read_page(fd, IX_FILE_HDR_PAGE, buf, PAGE_SIZE);
+    int page_size = disk_manager_->get_page_size();
+    char *buf = new char[page_size];
+    memset(buf, 0, page_size);
+    disk_manager_->read_page(fd, IX_FILE_HDR_PAGE, buf, page_size);
     file_hdr_ = new IxFileHdr();
     file_hdr_->deserialize(buf);
 
-    // disk_manager管理的fd对应的文件中，设置从file_hdr_->num_pages开始分配page_no
-    int now_page_no = disk_manager_->get_fd2pageno(fd);
-    disk_manager_->set_fd2pageno(fd, now_page_no + 1);
+    // disk_manager管理的fd对应的文件中，从文件末尾开始分配page_no。
+    // num_pages_是仍在使用的页面个数，释放过页面的文件中它小于文件的页面个数，不能作为分配的起点
+    int num_file_pages = static_cast<int>(disk_manager_->get_file_size(disk_manager_->get_file_name(fd)) / page_size);
+    disk_manager_->set_fd2pageno(fd, std::max(num_file_pages, IX_INIT_NUM_PAGES));
 }
 
 /**
@@ -367,6 +370,7 @@ void IxIndexHandle::insert_into_parent(IxNodeHandle *old_node, const char *key,
 
         old_node->page_hdr->parent = root->get_page_no();
         new_node->page_hdr->parent = root->get_page_no();
+        buffer_pool_manager_->unpin_page(root->get_page_id(), true);
     } else {
         // 递归更新
         IxNodeHandle *parent;
@@ -383,7 +387,9 @@ void IxIndexHandle::insert_into_parent(IxNodeHandle *old_node, const char *key,
         if (parent->get_size() >= parent->get_max_size()) { // 达到这个就换，而不是大于
             auto new_node = split(parent);                  // we split the parent node.
             insert_into_parent(parent, new_node->get_key(0), new_node, transaction);
+            buffer_pool_manager_->unpin_page(new_node->get_page_id(), true);
         }
+        buffer_pool_manager_->unpin_page(parent->get_page_id(), true);
     }
 }
 
@@ -441,12 +447,12 @@ bool IxIndexHandle::delete_entry(const char *key, Transaction *transaction) {
     int num = tar->get_size();
     bool ok = num != tar->remove(key);
     if (ok) {
-        bool need_delete = coalesce_or_redistribute(tar, transaction); // 是否需要删除结点
-        if (need_delete) {
-        }
+        // 合并释放的结点在coalesce_or_redistribute中记录到released_pages_，结点都unpin之后再真正释放
+        coalesce_or_redistribute(tar, transaction);
     }
 
     buffer_pool_manager_->unpin_page(tar->get_page_id(), ok);
+    free_released_pages();
 
     return ok;
 }
@@ -485,19 +491,22 @@ bool IxIndexHandle::coalesce_or_redistribute(IxNodeHandle *node, Transaction *tr
     auto node_parent = fetch_node(node->page_hdr->parent);               // 找到父节点
     int node_pos = node_parent->find_child(node);                        // 找到 node 在 parent 中的位置
     int siblings_pos = node_pos - 1 == -1 ? node_pos + 1 : node_pos - 1; // 优先选取前驱结点进行合并
-    if (siblings_pos > node_parent->get_size()) {
+    if (siblings_pos >= node_parent->get_size()) {
         throw RMDBError("coalesce_or_redistribute: No siblings found!");
     }
     auto sibling = fetch_node(node_parent->get_rid(siblings_pos)->page_no); // 获取兄弟结点
+    // coalesce可能交换sibling和node，node由调用者unpin，这里只unpin自己fetch的兄弟结点
+    PageId sibling_page_id = sibling->get_page_id();
 
     bool need_delete = false;
+    // redistribute和coalesce的index是node在parent中的位置，index == 0时兄弟结点是node的后继
     if (node->get_size() + sibling->get_size() >= node->get_min_size() * 2) {
         // 如果node结点和兄弟结点的键值对数量之和，能够支撑两个B+树结点，则只需要重新分配键值对。（够用）
-        redistribute(sibling, node, node_parent, siblings_pos);
+        redistribute(sibling, node, node_parent, node_pos);
     } else {
-        need_delete = coalesce(&sibling, &node, &node_parent, siblings_pos, transaction, root_is_latched);
+        need_delete = coalesce(&sibling, &node, &node_parent, node_pos, transaction, root_is_latched);
     }
-    buffer_pool_manager_->unpin_page(sibling->get_page_id(), true);
+    buffer_pool_manager_->unpin_page(sibling_page_id, true);
     buffer_pool_manager_->unpin_page(node_parent->get_page_id(), true);
 
     return need_delete;
@@ -516,18 +525,17 @@ bool IxIndexHandle::adjust_root(IxNodeHandle *old_root_node) {
     // 3. 除了上述两种情况，不需要进行操作
 
     if (old_root_node->is_leaf_page()) {
-        // 这里的情况是：根节点是叶子结点（整个b+树只有一个节点）
-        if (old_root_node->get_size() == 0) {
-            release_node_handle(*old_root_node);
-            update_root_page_no(2);
-            return true;
-        }
+        // 这里的情况是：根节点是叶子结点（整个b+树只有一个节点）。
+        // 空树仍然保留这个空的叶子结点作为根，它同时是叶子链表中唯一的结点，不能释放
+        return false;
     } else {
         if (old_root_node->get_size() == 1) {
-            auto new_root = fetch_node(file_hdr_->root_page_);
-            new_root->page_hdr->parent = 0;
+            // 唯一的孩子成为新的根结点，释放原来的根结点
+            auto new_root = fetch_node(old_root_node->remove_and_return_only_child());
+            new_root->page_hdr->parent = IX_NO_PAGE;
             update_root_page_no(new_root->get_page_no());
             buffer_pool_manager_->unpin_page(new_root->get_page_id(), true);
+            release_node_handle(*old_root_node);
             return true;
         }
     }
@@ -601,14 +609,18 @@ bool IxIndexHandle::coalesce(IxNodeHandle **neighbor_node, IxNodeHandle **node,
     }
 
     // 把node结点的键值对移动到neighbor_node中，并更新node结点孩子结点的父节点信息
-    (*neighbor_node)
-        ->insert_pairs((*neighbor_node)->get_size(), (*node)->get_key(0), (*node)->get_rid(0), (*node)->get_size());
+    int neighbor_size = (*neighbor_node)->get_size();
+    (*neighbor_node)->insert_pairs(neighbor_size, (*node)->get_key(0), (*node)->get_rid(0), (*node)->get_size());
     for (int i = 0; i < (*node)->get_size(); ++i) {
-        maintain_child(*neighbor_node, i + (*neighbor_node)->get_size());
+        maintain_child(*neighbor_node, i + neighbor_size);
     }
 
+    if ((*node)->is_leaf_page()) {
+        erase_leaf(*node); // 从叶子链表中摘除，释放后页面会被重新分配
+    }
     release_node_handle(**node); // 释放node结点
-    (*parent)->erase_pair(index);
+    // 交换后node是parent中位置1的孩子
+    (*parent)->erase_pair(index == 0 ? 1 : index);
 
     if ((*node)->is_leaf_page() && (*node)->get_page_no() == file_hdr_->last_leaf_) {
         file_hdr_->last_leaf_ = (*neighbor_node)->get_page_no();
@@ -770,12 +782,27 @@ void IxIndexHandle::erase_leaf(IxNodeHandle *leaf) {
 }
 
 /**
- * @brief 删除node时，更新file_hdr_.num_pages
+ * @brief 删除node时，更新file_hdr_.num_pages，并记录要释放的页面。
+ * node此时仍被pin住，要等到delete_entry结束、所有结点都unpin之后才在free_released_pages中释放
  *
  * @param node
  */
 void IxIndexHandle::release_node_handle(IxNodeHandle &node) {
     file_hdr_->num_pages_--;
+    released_pages_.push_back(node.get_page_no());
+}
+
+/**
+ * @brief 把release_node_handle记录的页面从缓冲池中删除，并归还到文件的空闲页面位图，之后create_node会优先复用它们。
+ * 页面仍被pin住（说明还有人在使用）时不能释放，留在文件中不再使用
+ */
+void IxIndexHandle::free_released_pages() {
+    for (page_id_t page_no : released_pages_) {
+        if (buffer_pool_manager_->delete_page({fd_, page_no})) {
+            disk_manager_->deallocate_page(fd_, page_no);
+        }
+    }
+    released_pages_.clear();
 }
 
 /**
@@ -10,8 +10,10 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include <algorithm>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "ix_defs.h"
 #include "ix_index_handle.h"
@@ -63,9 +65,9 @@ class IxManager {
         int fd = disk_manager_->open_file(ix_name);
 
         // Create file header and write to file
-        // Theoretically we have: |page_hdr| + (|attr| + |rid|) * n <= PAGE_SIZE
+        // Theoretically we have: |page_hdr| + (|attr| + |rid|) * n <= page_size
         // but we reserve one slot for convenient inserting and deleting, i.e.
-        // |page_hdr| + (|attr| + |rid|) * (n + 1) <= PAGE_SIZE
+        // |page_hdr| + (|attr| + |rid|) * (n + 1) <= page_size
         int col_tot_len = 0;
         int col_num = index_cols.size();
         for (auto &col : index_cols) {
@@ -74,9 +76,11 @@ class IxManager {
         if (col_tot_len > IX_MAX_COL_LEN) {
             throw InvalidColLengthError(col_tot_len);
         }
-        // 根据 |page_hdr| + (|attr| + |rid|) * (n + 1) <= PAGE_SIZE 求得n的最大值btree_order
+        // 根据 |page_hdr| + (|attr| + |rid|) * (n + 1) <= page_size 求得n的最大值btree_order
         // 即 n <= btree_order，那么btree_order就是每个结点最多可插入的键值对数量（实际还多留了一个空位，但其不可插入）
-        int btree_order = static_cast<int>((PAGE_SIZE - sizeof(IxPageHdr)) / (col_tot_len + sizeof(Rid)) - 1);
+        // 页面越大，每个结点容纳的键越多，树的高度越低
+        int page_size = disk_manager_->get_page_size();
+        int btree_order = static_cast<int>((page_size - sizeof(IxPageHdr)) / (col_tot_len + sizeof(Rid)) - 1);
         assert(btree_order > 2);
 
         // Create file header and write to file
@@ -94,13 +98,12 @@ class IxManager {
 
         disk_manager_->write_page(fd, IX_FILE_HDR_PAGE, data, fhdr->tot_len_);
 
-        char page_buf[PAGE_SIZE]; // 在内存中初始化page_buf中的内容，然后将其写入磁盘
-        memset(page_buf, 0, PAGE_SIZE);
+        std::vector<char> page_buf(page_size); // 在内存中初始化page_buf中的内容，然后将其写入磁盘
         // 注意leaf header页号为1，也标记为叶子结点，其前一个/后一个叶子均指向root node
         // Create leaf list header page and write to file
         {
-            memset(page_buf, 0, PAGE_SIZE);
-            auto phdr = reinterpret_cast<IxPageHdr *>(page_buf);
+            std::fill(page_buf.begin(), page_buf.end(), 0);
+            auto phdr = reinterpret_cast<IxPageHdr *>(page_buf.data());
             *phdr = {
                 .next_free_page_no = IX_NO_PAGE,
                 .parent = IX_NO_PAGE,
@@ -109,13 +112,13 @@ class IxManager {
                 .prev_leaf = IX_INIT_ROOT_PAGE,
                 .next_leaf = IX_INIT_ROOT_PAGE,
             };
-            disk_manager_->write_page(fd, IX_LEAF_HEADER_PAGE, page_buf, PAGE_SIZE);
+            disk_manager_->write_page(fd, IX_LEAF_HEADER_PAGE, page_buf.data(), page_size);
         }
         // 注意root node页号为2，也标记为叶子结点，其前一个/后一个叶子均指向leaf header
         // Create root node and write to file
         {
-            memset(page_buf, 0, PAGE_SIZE);
-            auto phdr = reinterpret_cast<IxPageHdr *>(page_buf);
+            std::fill(page_buf.begin(), page_buf.end(), 0);
+            auto phdr = reinterpret_cast<IxPageHdr *>(page_buf.data());
             *phdr = {
                 .next_free_page_no = IX_NO_PAGE,
                 .parent = IX_NO_PAGE,
@@ -124,8 +127,8 @@ class IxManager {
                 .prev_leaf = IX_LEAF_HEADER_PAGE,
                 .next_leaf = IX_LEAF_HEADER_PAGE,
             };
-            // Must write PAGE_SIZE here in case of future fetch_node()
-            disk_manager_->write_page(fd, IX_INIT_ROOT_PAGE, page_buf, PAGE_SIZE);
+            // Must write page_size here in case of future fetch_node()
+            disk_manager_->write_page(fd, IX_INIT_ROOT_PAGE, page_buf.data(), page_size);
         }
 
         disk_manager_->set_fd2pageno(fd, IX_INIT_NUM_PAGES - 1); // DEBUG
@@ -165,4 +168,15 @@ class IxManager {
         buffer_pool_manager_->flush_all_pages(ih->fd_);
         disk_manager_->close_file(ih->fd_);
     }
+
+    /**
+     * @description: 把索引的文件头和缓冲池中的脏页写回磁盘并fsync，索引保持打开
+     */
+    void sync_index(const IxIndexHandle *ih) {
+        std::vector<char> data(ih->file_hdr_->tot_len_);
+        ih->file_hdr_->serialize(data.data());
+        disk_manager_->write_page(ih->fd_, IX_FILE_HDR_PAGE, data.data(), ih->file_hdr_->tot_len_);
+        buffer_pool_manager_->flush_all_pages(ih->fd_);
+        disk_manager_->sync_file(ih->fd_);
+    }
 };
\ No newline at end of file
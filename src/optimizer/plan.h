@@ -29,6 +29,7 @@ typedef enum PlanTag {
     T_CreateIndex,
     T_DropIndex,
     T_ShowIndex,
+    T_VacuumTable,
     T_SetKnob,
     T_Insert,
     T_Update,
@@ -181,6 +182,7 @@ class DDLPlan : public Plan {
     std::string tab_name_;
     std::vector<std::string> tab_col_names_;
     std::vector<ColDef> cols_;
+    bool pax_ = false; // CREATE TABLE ... WITH (layout = pax)
 };
 
 // help; show tables; desc tables; begin; abort; commit; rollback语句对应的plan
@@ -10,6 +10,8 @@ See the Mulan PSL v2 for more details. */
 
 #include "planner.h"
 
+#include <strings.h>
+
 #include <memory>
 #include <unordered_map>
 
@@ -444,13 +446,38 @@ std::shared_ptr<Plan> Planner::do_planner(std::shared_ptr<Query> query, Context
             if (auto sv_col_def = std::dynamic_pointer_cast<ast::ColDef>(field)) {
                 ColDef col_def = {.name = sv_col_def->col_name,
                                   .type = interp_sv_type(sv_col_def->type_len->type),
-                                  .len = sv_col_def->type_len->len};
+                                  .len = sv_col_def->type_len->len,
+                                  .varlen = sv_col_def->type_len->type == ast::SV_TYPE_VARCHAR};
                 col_defs.push_back(col_def);
             } else {
                 throw InternalError("Unexpected field type");
             }
         }
-        plannerRoot = std::make_shared<DDLPlan>(T_CreateTable, x->tab_name, std::vector<std::string>(), col_defs);
+        auto create_plan = std::make_shared<DDLPlan>(T_CreateTable, x->tab_name, std::vector<std::string>(), col_defs);
+        for (auto &[name, value] : x->options) {
+            if (strcasecmp(name.c_str(), "dictionary") == 0) {
+                // 字典编码的字段只能是字符串
+                auto col_def = std::find_if(create_plan->cols_.begin(), create_plan->cols_.end(),
+                                            [&](const ColDef &col_def) { return col_def.name == value; });
+                if (col_def == create_plan->cols_.end()) {
+                    throw ColumnNotFoundError(value);
+                }
+                if (col_def->type != TYPE_STRING) {
+                    throw InternalError("Dictionary column " + value + " must be a string column");
+                }
+                col_def->dictionary = true;
+                continue;
+            }
+            if (strcasecmp(name.c_str(), "layout") != 0) {
+                throw InternalError("Unknown table option " + name);
+            }
+            if (strcasecmp(value.c_str(), "pax") == 0) {
+                create_plan->pax_ = true;
+            } else if (strcasecmp(value.c_str(), "row") != 0) {
+                throw InternalError("Unknown table layout " + value);
+            }
+        }
+        plannerRoot = create_plan;
     } else if (auto x = std::dynamic_pointer_cast<ast::DropTable>(query->parse)) {
         // drop table;
         plannerRoot =
@@ -465,6 +492,10 @@ std::shared_ptr<Plan> Planner::do_planner(std::shared_ptr<Query> query, Context
         // show index
         plannerRoot =
             std::make_shared<DDLPlan>(T_ShowIndex, x->tab_name, std::vector<std::string>(), std::vector<ColDef>());
+    } else if (auto x = std::dynamic_pointer_cast<ast::VacuumTable>(query->parse)) {
+        // vacuum
+        plannerRoot =
+            std::make_shared<DDLPlan>(T_VacuumTable, x->tab_name, std::vector<std::string>(), std::vector<ColDef>());
     } else if (auto x = std::dynamic_pointer_cast<ast::InsertStmt>(query->parse)) {
         // insert;
         plannerRoot = std::make_shared<DMLPlan>(T_Insert, std::shared_ptr<Plan>(), x->tab_name, query->values,
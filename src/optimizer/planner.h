@@ -67,6 +67,7 @@ class Planner {
         std::map<ast::SvType, ColType> m = {{ast::SV_TYPE_INT, TYPE_INT},
                                             {ast::SV_TYPE_FLOAT, TYPE_FLOAT},
                                             {ast::SV_TYPE_STRING, TYPE_STRING},
+                                            {ast::SV_TYPE_VARCHAR, TYPE_STRING},
                                             {ast::SV_TYPE_DATE, TYPE_DATE}};
         return m.at(sv_type);
     }
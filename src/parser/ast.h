@@ -16,7 +16,7 @@ See the Mulan PSL v2 for more details. */
 enum JoinType { INNER_JOIN, LEFT_JOIN, RIGHT_JOIN, FULL_JOIN };
 namespace ast {
 
-enum SvType { SV_TYPE_INT, SV_TYPE_FLOAT, SV_TYPE_STRING, SV_TYPE_BOOL, SV_TYPE_DATE };
+enum SvType { SV_TYPE_INT, SV_TYPE_FLOAT, SV_TYPE_STRING, SV_TYPE_BOOL, SV_TYPE_DATE, SV_TYPE_VARCHAR };
 
 enum SvCompOp { SV_OP_EQ, SV_OP_NE, SV_OP_LT, SV_OP_GT, SV_OP_LE, SV_OP_GE };
 
@@ -65,6 +65,7 @@ struct ColDef : public Field {
 struct CreateTable : public TreeNode {
     std::string tab_name;
     std::vector<std::shared_ptr<Field>> fields;
+    std::vector<std::pair<std::string, std::string>> options; // WITH (name = value)
 
     CreateTable(std::string tab_name_, std::vector<std::shared_ptr<Field>> fields_)
         : tab_name(std::move(tab_name_)), fields(std::move(fields_)) {
@@ -110,6 +111,13 @@ struct ShowIndex : public TreeNode {
     }
 };
 
+struct VacuumTable : public TreeNode {
+    std::string tab_name;
+
+    VacuumTable(std::string tab_name_) : tab_name(std::move(tab_name_)) {
+    }
+};
+
 struct Expr : public TreeNode {};
 
 struct Value : public Expr {};
@@ -278,6 +286,7 @@ struct SemValue {
     AggregationType sv_aggr_type;
 
     std::vector<std::string> sv_strs;
+    std::vector<std::pair<std::string, std::string>> sv_options;
 
     std::shared_ptr<TreeNode> sv_node;
 
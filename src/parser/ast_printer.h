@@ -42,7 +42,7 @@ class TreePrinter {
     static std::string type2str(SvType type) {
         static std::map<SvType, std::string> m{
             {SV_TYPE_INT, "INT"},   {SV_TYPE_FLOAT, "FLOAT"}, {SV_TYPE_STRING, "STRING"},
-            {SV_TYPE_BOOL, "BOOL"}, {SV_TYPE_DATE, "DATE"},
+            {SV_TYPE_BOOL, "BOOL"}, {SV_TYPE_DATE, "DATE"},   {SV_TYPE_VARCHAR, "VARCHAR"},
         };
         return m.at(type);
     }
@@ -21,8 +21,8 @@ using namespace ast;
 %define parse.error verbose
 
 // keywords
-%token SHOW TABLES CREATE TABLE DROP DESC INSERT INTO VALUES DELETE FROM ASC ORDER GROUP BY HAVING
-WHERE UPDATE SET SELECT MAX MIN SUM COUNT AS INT CHAR FLOAT DATE INDEX AND JOIN EXIT HELP TXN_BEGIN TXN_COMMIT TXN_ABORT TXN_ROLLBACK ORDER_BY ENABLE_NESTLOOP ENABLE_SORTMERGE
+%token SHOW TABLES CREATE TABLE DROP DESC VACUUM INSERT INTO VALUES DELETE FROM ASC ORDER GROUP BY HAVING
+WHERE UPDATE SET SELECT MAX MIN SUM COUNT AS INT CHAR VARCHAR FLOAT DATE INDEX WITH AND JOIN EXIT HELP TXN_BEGIN TXN_COMMIT TXN_ABORT TXN_ROLLBACK ORDER_BY ENABLE_NESTLOOP ENABLE_SORTMERGE
 // non-keywords
 %token LEQ NEQ GEQ T_EOF
 
@@ -44,6 +44,7 @@ WHERE UPDATE SET SELECT MAX MIN SUM COUNT AS INT CHAR FLOAT DATE INDEX AND JOIN
 %type <sv_vals> valueList
 %type <sv_str> tbName colName alias
 %type <sv_strs> tableList colNameList
+%type <sv_options> optionList
 %type <sv_col> col
 %type <sv_cols> colList selector
 %type <sv_set_clause> setClause
@@ -126,6 +127,12 @@ ddl:
     {
         $$ = std::make_shared<CreateTable>($3, $5);
     }
+    |   CREATE TABLE tbName '(' fieldList ')' WITH '(' optionList ')'
+    {
+        auto create_table = std::make_shared<CreateTable>($3, $5);
+        create_table->options = $9;
+        $$ = create_table;
+    }
     |   DROP TABLE tbName
     {
         $$ = std::make_shared<DropTable>($3);
@@ -146,6 +153,10 @@ ddl:
     {
         $$ = std::make_shared<ShowIndex>($4);
     }
+    |   VACUUM tbName
+    {
+        $$ = std::make_shared<VacuumTable>($2);
+    }
     ;
 
 dml:
@@ -189,6 +200,17 @@ colNameList:
     }
     ;
 
+optionList:
+        IDENTIFIER '=' IDENTIFIER
+    {
+        $$ = std::vector<std::pair<std::string, std::string>>{{$1, $3}};
+    }
+    |   optionList ',' IDENTIFIER '=' IDENTIFIER
+    {
+        $$.emplace_back($3, $5);
+    }
+    ;
+
 field:
         colName type
     {
@@ -205,6 +227,10 @@ type:
     {
         $$ = std::make_shared<TypeLen>(SV_TYPE_STRING, $3);
     }
+    |   VARCHAR '(' VALUE_INT ')'
+    {
+        $$ = std::make_shared<TypeLen>(SV_TYPE_VARCHAR, $3);
+    }
     |   FLOAT
     {
         $$ = std::make_shared<TypeLen>(SV_TYPE_FLOAT, sizeof(float));
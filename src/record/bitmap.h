@@ -13,9 +13,18 @@ See the Mulan PSL v2 for more details. */
 #include <cinttypes>
 #include <cstring>
 
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
 static constexpr int BITMAP_WIDTH = 8;
 static constexpr unsigned BITMAP_HIGHEST_BIT = 0x80u; // 128 (2^7)
 
+/**
+ * 页面中记录的bitmap，第pos位是第pos/8个字节中从高到低的第pos%8位。
+ * 查找和计数按64位字进行：把8个字节按大端序读成一个字，第pos位即字中从高到低的第pos%64位，用clz/popcount一次处理64位；
+ * bitmap较宽（大页面、小记录）且遇到较长的全0或全1区域时，用AVX2一次跳过32字节
+ */
 class Bitmap {
   public:
     // 从地址bm开始的size个字节全部置0
@@ -47,12 +56,41 @@ class Bitmap {
      * @return 找到了就返回偏移位置，没找到就返回max_n
      */
     static int next_bit(bool bit, const char *bm, int max_n, int curr) {
-        for (int i = curr + 1; i < max_n; i++) {
-            if (is_set(bm, i) == bit) {
-                return i;
+        return next_bit(bit, bm, max_n, curr, has_avx2());
+    }
+
+    /**
+     * @brief 同next_bit，use_avx2为false时只使用64位字，用于测试和比较两种实现
+     */
+    static int next_bit(bool bit, const char *bm, int max_n, int curr, bool use_avx2) {
+        int pos = curr + 1;
+        if (pos >= max_n) {
+            return max_n;
+        }
+        int num_bytes = (max_n + BITMAP_WIDTH - 1) / BITMAP_WIDTH;
+        int num_words = (num_bytes + WORD_BYTES - 1) / WORD_BYTES;
+        uint64_t flip = bit ? 0 : ~static_cast<uint64_t>(0); // 找0时取反，统一为找1
+        int word_no = pos / WORD_BITS;
+        // 第一个字中去掉pos之前的位
+        uint64_t word = (load_word(bm, word_no, num_bytes) ^ flip) & (~static_cast<uint64_t>(0) >> (pos % WORD_BITS));
+        int num_empty = 0; // 连续跳过的字数，记录稀疏时才值得使用AVX2
+        while (word == 0) {
+            if (++word_no >= num_words) {
+                return max_n;
+            }
+#if defined(__x86_64__)
+            if (use_avx2 && ++num_empty >= AVX2_MIN_EMPTY_WORDS && num_words - word_no >= AVX2_MIN_WORDS) {
+                word_no = skip_uniform_avx2(bm, word_no * WORD_BYTES, num_bytes, bit) / WORD_BYTES;
+                if (word_no >= num_words) {
+                    return max_n;
+                }
             }
+#endif
+            word = load_word(bm, word_no, num_bytes) ^ flip;
         }
-        return max_n;
+        // 最后一个字中max_n之后的位：找1时为0，找0时取反后为1，找到的位置不小于max_n
+        int found = word_no * WORD_BITS + __builtin_clzll(word);
+        return found < max_n ? found : max_n;
     }
 
     // 找第一个为0 or 1的位
@@ -60,11 +98,43 @@ class Bitmap {
         return next_bit(bit, bm, max_n, -1);
     }
 
+    /**
+     * @brief 统计前max_n位中1的个数
+     */
+    static int count(const char *bm, int max_n) {
+        int num_bytes = (max_n + BITMAP_WIDTH - 1) / BITMAP_WIDTH;
+        int num_words = (num_bytes + WORD_BYTES - 1) / WORD_BYTES;
+        int num = 0;
+        for (int word_no = 0; word_no < num_words; word_no++) {
+            uint64_t word = load_word(bm, word_no, num_bytes);
+            int num_tail = (word_no + 1) * WORD_BITS - max_n; // 最后一个字中max_n之后的位
+            if (num_tail > 0) {
+                word &= ~static_cast<uint64_t>(0) << num_tail;
+            }
+            num += __builtin_popcountll(word);
+        }
+        return num;
+    }
+
     // for example:
     // rid_.slot_no = Bitmap::next_bit(true, page_handle.bitmap, file_handle_->file_hdr_.num_records_per_page,
     // rid_.slot_no); int slot_no = Bitmap::first_bit(false, page_handle.bitmap, file_hdr_.num_records_per_page);
 
+    static bool has_avx2() {
+#if defined(__x86_64__)
+        static const bool supported = __builtin_cpu_supports("avx2");
+        return supported;
+#else
+        return false;
+#endif
+    }
+
   private:
+    static constexpr int WORD_BYTES = 8;
+    static constexpr int WORD_BITS = 64;
+    static constexpr int AVX2_MIN_WORDS = 8;       // 剩余不少于8个字（512位）时才使用AVX2
+    static constexpr int AVX2_MIN_EMPTY_WORDS = 8; // 已经连续跳过8个字之后才使用AVX2
+
     static int get_bucket(int pos) {
         return pos / BITMAP_WIDTH;
     }
@@ -72,4 +142,38 @@ class Bitmap {
     static char get_bit(int pos) {
         return BITMAP_HIGHEST_BIT >> static_cast<char>(pos % BITMAP_WIDTH);
     }
+
+    /**
+     * @brief 按大端序读取第word_no个字，bitmap末尾不足8个字节的部分补0
+     * @param num_bytes bitmap的字节数
+     */
+    static uint64_t load_word(const char *bm, int word_no, int num_bytes) {
+        int offset = word_no * WORD_BYTES;
+        uint64_t word = 0;
+        if (offset + WORD_BYTES <= num_bytes) {
+            memcpy(&word, bm + offset, WORD_BYTES);
+        } else {
+            memcpy(&word, bm + offset, num_bytes - offset);
+        }
+        return __builtin_bswap64(word);
+    }
+
+#if defined(__x86_64__)
+    /**
+     * @brief 从第byte_no个字节开始，每次检查32个字节，跳过全0（找1时）或全1（找0时）的区域
+     * @return 第一个不能跳过的32字节区域的起始位置，或剩余不足32字节的位置，与byte_no相差32的整数倍
+     */
+    __attribute__((target("avx2"))) static int skip_uniform_avx2(const char *bm, int byte_no, int num_bytes,
+                                                                  bool bit) {
+        const __m256i ones = _mm256_set1_epi8(-1);
+        for (; byte_no + 32 <= num_bytes; byte_no += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(bm + byte_no));
+            bool uniform = bit ? _mm256_testz_si256(v, v) : _mm256_testc_si256(v, ones);
+            if (!uniform) {
+                break;
+            }
+        }
+        return byte_no;
+    }
+#endif
 };
@@ -17,19 +17,49 @@ constexpr int RM_NO_PAGE = -1;
 constexpr int RM_FILE_HDR_PAGE = 0;
 constexpr int RM_FIRST_RECORD_PAGE = 1;
 constexpr int RM_MAX_RECORD_SIZE = 512;
+constexpr int RM_MAX_VAR_RECORD_SIZE = 2048;                                       // 含变长字段的记录展开后的最大长度
+constexpr int RM_MAX_VAR_COLS = 64;                                                // 一个表中变长字段的最大个数
+constexpr int RM_MAX_PAX_COLS = 64;                                                // PAX表的最大列数
+constexpr int RM_MAX_DICT_COLS = 64;                                               // 一个表中字典编码字段的最大个数
+// 变长记录编码后的最大长度，每个变长字段和字典编码字段最多增加2字节
+constexpr int RM_MAX_VAR_TUPLE_LEN = RM_MAX_VAR_RECORD_SIZE + (RM_MAX_VAR_COLS + RM_MAX_DICT_COLS) * 2;
 
 /* 文件头，记录表数据文件的元信息，写入磁盘中文件的第0号页面 */
 struct RmFileHdr {
-    int record_size; // 表中每条记录的大小，由于不包含变长字段，因此当前字段初始化后保持不变
+    int record_size; // 表中每条记录的大小，变长记录文件中为展开后的大小，初始化后保持不变
     int num_pages;            // 文件中分配的页面个数（初始化为1）因为RmFileHdr占据了第一页
     int num_records_per_page; // 每个页面最多能存储的元组个数
-    int first_free_page_no;   // 文件中当前第一个包含空闲空间的页面号（初始化为-1）
+    int first_free_page_no;   // unused，有空闲空间的页面由RmFreeSpaceMap记录
     int bitmap_size;          // 每个页面bitmap大小
 };
 
+/* 一列在展开的记录中的位置 */
+struct RmColumn {
+    int offset; // 字段在记录中的偏移量
+    int len;    // 字段的宽度，变长字段为最大长度
+};
+
+/**
+ * 记录格式，写入第0号页面中文件头之后。没有变长字段的文件使用bitmap加定长槽位的页面；
+ * 有变长字段时使用槽位目录的页面（见rm_slotted_page.h），页面中的记录只存放变长字段的实际长度，
+ * 读出时展开为record_size字节的定长记录，上层看到的记录格式不变。
+ * PAX表（CREATE TABLE ... WITH (layout=pax)）的页面与定长记录相同，只是槽位区按列划分为若干minipage，
+ * 每列在自己的minipage中连续存放，按列扫描时不需要读取其他列。
+ * 字典编码字段（WITH (dictionary=列名)）在页面中只存放2字节的编号，值保存在RmDictionary中，
+ * 有字典编码字段的文件与变长记录文件一样使用槽位目录的页面
+ */
+struct RmRecordLayout {
+    int num_var_cols;                     // 变长字段个数，为0时是定长记录文件
+    RmColumn var_cols[RM_MAX_VAR_COLS];   // 按offset升序排列
+    int num_pax_cols;                     // PAX页面的列数，为0时按行存放
+    RmColumn pax_cols[RM_MAX_PAX_COLS];   // 按offset升序排列，首尾相接覆盖整条记录
+    int num_dict_cols;                    // 字典编码字段个数
+    RmColumn dict_cols[RM_MAX_DICT_COLS]; // 按offset升序排列，与变长字段不重叠
+};
+
 /* 表数据文件中每个页面的页头，记录每个页面的元信息 */
 struct RmPageHdr {
-    int next_free_page_no; // 当前页面满了之后，下一个包含空闲空间的页面号（初始化为-1）
+    int next_free_page_no; // unused
     int num_records;       // 当前页面中当前已经存储的记录个数（初始化为0）
 };
 
@@ -62,7 +92,7 @@ struct RmRecord {
         allocated_ = true;
     }
 
-    RmRecord(int size_, char *data_) {
+    RmRecord(int size_, const char *data_) {
         size = size_;
         data = new char[size_];
         memcpy(data, data_, size_);
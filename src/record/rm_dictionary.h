@@ -0,0 +1,190 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "errors.h"
+
+/**
+ * @description: 表文件中字典编码字段的字典。每个字段的不同取值按出现的先后编号，页面中只存放2字节的编号。
+ * 字典保存在表文件旁的.dict文件中，每个条目为 字段序号(2字节) | 长度(2字节) | 值，新的值在返回编号之前追加写入，
+ * 并且fsync，所以引用它的页面写回磁盘时字典中一定已经有它；条目只增不删，编号一经分配就不会改变。
+ * 值按去掉末尾'\0'之后的字节比较，与Value::col2Value读出的字符串一致。
+ * 因为只增不删，按编号解码不加锁：值放在不会移动的块中，写完后才发布新的个数
+ */
+class RmDictionary {
+  public:
+    static constexpr int MAX_CODES = 65536; // 编号用uint16_t存放
+    static constexpr int NOT_FOUND = -1;
+
+    /**
+     * @param {string} path 字典文件的路径，文件不存在时创建
+     * @param {int} num_cols 字典编码字段的个数
+     */
+    RmDictionary(std::string path, int num_cols) : path_(std::move(path)), cols_(num_cols) {
+        load();
+        fd_ = open(path_.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0600);
+        if (fd_ < 0) {
+            throw InternalError("RmDictionary: failed to open " + path_);
+        }
+    }
+
+    ~RmDictionary() {
+        close(fd_);
+    }
+
+    RmDictionary(const RmDictionary &) = delete;
+    RmDictionary &operator=(const RmDictionary &) = delete;
+
+    /**
+     * @description: 查找值的编号
+     * @return {int} 编号，值不在字典中时返回NOT_FOUND
+     * @param {int} col_no 字典编码字段的序号
+     * @param {char*} data 值，末尾的'\0'不计入
+     * @param {int} len 值的长度
+     */
+    int lookup(int col_no, const char *data, int len) const {
+        std::scoped_lock lock{latch_};
+        auto &codes = cols_[col_no].codes;
+        auto it = codes.find(std::string(data, trim(data, len)));
+        return it == codes.end() ? NOT_FOUND : it->second;
+    }
+
+    /**
+     * @description: 查找值的编号，值不在字典中时分配新的编号并写入字典文件
+     * @return {uint16_t} 编号
+     */
+    uint16_t get_or_add(int col_no, const char *data, int len) {
+        std::scoped_lock lock{latch_};
+        Column &col = cols_[col_no];
+        std::string value(data, trim(data, len));
+        auto it = col.codes.find(value);
+        if (it != col.codes.end()) {
+            return it->second;
+        }
+        int num_values = col.num_values.load(std::memory_order_relaxed);
+        if (num_values >= MAX_CODES) {
+            throw InternalError("RmDictionary: too many distinct values in a dictionary column");
+        }
+        // 条目一次写入，fsync之后编号才会被写进页面
+        uint16_t entry_hdr[2] = {static_cast<uint16_t>(col_no), static_cast<uint16_t>(value.size())};
+        std::string entry(reinterpret_cast<const char *>(entry_hdr), sizeof(entry_hdr));
+        entry += value;
+        if (write(fd_, entry.data(), entry.size()) != static_cast<ssize_t>(entry.size()) || fsync(fd_) != 0) {
+            throw InternalError("RmDictionary: failed to write " + path_);
+        }
+        auto code = static_cast<uint16_t>(num_values);
+        col.codes.emplace(value, code);
+        col.append(std::move(value));
+        return code;
+    }
+
+    /**
+     * @description: 把编号对应的值写入out，不足len字节的部分填充'\0'
+     */
+    void decode(int col_no, uint16_t code, char *out, int len) const {
+        const Column &col = cols_[col_no];
+        if (code >= col.num_values.load(std::memory_order_acquire)) {
+            throw InternalError("RmDictionary: unknown code in " + path_);
+        }
+        const std::string &value = col.value(code);
+        memcpy(out, value.data(), value.size());
+        memset(out + value.size(), 0, len - value.size());
+    }
+
+    /**
+     * @description: 字段中不同取值的个数
+     */
+    int get_num_codes(int col_no) const {
+        return cols_[col_no].num_values.load(std::memory_order_acquire);
+    }
+
+  private:
+    static constexpr int CHUNK_SIZE = 256; // 每块存放的值的个数
+
+    struct Column {
+        // 编号i的值在chunks[i / CHUNK_SIZE]中，块分配后不再移动
+        std::unique_ptr<std::string[]> chunks[MAX_CODES / CHUNK_SIZE];
+        std::atomic<int> num_values{0};                  // 已经发布的值的个数，只在latch_下增加
+        std::unordered_map<std::string, uint16_t> codes; // 值到编号的映射，由latch_保护
+
+        const std::string &value(int code) const {
+            return chunks[code / CHUNK_SIZE][code % CHUNK_SIZE];
+        }
+
+        /**
+         * @description: 追加一个值，先写入值再用release发布个数，decode读到新的个数时一定能看到这个值
+         */
+        void append(std::string value) {
+            int code = num_values.load(std::memory_order_relaxed);
+            auto &chunk = chunks[code / CHUNK_SIZE];
+            if (chunk == nullptr) {
+                chunk = std::make_unique<std::string[]>(CHUNK_SIZE);
+            }
+            chunk[code % CHUNK_SIZE] = std::move(value);
+            num_values.store(code + 1, std::memory_order_release);
+        }
+    };
+
+    static int trim(const char *data, int len) {
+        while (len > 0 && data[len - 1] == '\0') {
+            len--;
+        }
+        return len;
+    }
+
+    /**
+     * @description: 读入字典文件。写入条目时崩溃可能留下不完整的条目，截掉它，之后的条目接在完整的条目后面
+     */
+    void load() {
+        std::ifstream ifs(path_, std::ios::binary);
+        if (!ifs) {
+            return;
+        }
+        std::streamoff valid_len = 0;
+        uint16_t entry_hdr[2];
+        std::string value;
+        while (ifs.read(reinterpret_cast<char *>(entry_hdr), sizeof(entry_hdr))) {
+            value.resize(entry_hdr[1]);
+            if (entry_hdr[0] >= cols_.size() || !ifs.read(value.data(), value.size())) {
+                break;
+            }
+            Column &col = cols_[entry_hdr[0]];
+            if (col.num_values.load(std::memory_order_relaxed) >= MAX_CODES) {
+                break;
+            }
+            col.codes.emplace(value, static_cast<uint16_t>(col.num_values.load(std::memory_order_relaxed)));
+            col.append(value);
+            valid_len += sizeof(entry_hdr) + value.size();
+        }
+        ifs.clear();
+        ifs.seekg(0, std::ios::end);
+        if (ifs.tellg() > valid_len && truncate(path_.c_str(), valid_len) != 0) {
+            throw UnixError();
+        }
+    }
+
+    std::string path_;
+    std::vector<Column> cols_; // 每个字典编码字段的字典
+    int fd_ = -1;              // 以追加方式打开的字典文件
+    mutable std::mutex latch_; // 保护codes、值的追加和fd_上的写入，decode和get_num_codes不加锁
+};
@@ -20,56 +20,165 @@ std::unique_ptr<RmRecord> RmFileHandle::get_record(const Rid &rid, Context *cont
     // Todo:
     // 1. 获取指定记录所在的page handle
     // 2. 初始化一个指向RmRecord的指针（赋值其内部的data和size）
+    if (is_slotted()) {
+        auto record = std::make_unique<RmRecord>(file_hdr_.record_size);
+        read_slotted_record(rid, record->data);
+        return record;
+    }
     auto page_handle = fetch_page_handle(rid.page_no);
     auto record_size = page_handle.file_hdr->record_size;
     assert(Bitmap::is_set(page_handle.bitmap, rid.slot_no)); // 此记录必须有效
-    auto ptr = std::make_unique<RmRecord>(record_size, page_handle.get_slot(rid.slot_no));
+    auto ptr = std::make_unique<RmRecord>(record_size);
+    read_slot(page_handle, rid.slot_no, ptr->data);
     buffer_pool_manager_->unpin_page({fd_, rid.page_no}, false);
     return ptr;
 }
 
+/**
+ * @description: 判断指定位置上是否已经存在一条记录，定长记录文件通过Bitmap来判断。
+ * 变长记录文件中被转发的记录只能通过原来的记录号访问，不算作记录
+ */
+bool RmFileHandle::is_record(const Rid &rid) const {
+    RmPageHandle page_handle = fetch_page_handle(rid.page_no);
+    bool retval;
+    if (is_slotted()) {
+        std::scoped_lock page_lock{get_page_latch(rid.page_no)};
+        auto page = get_slotted_page(page_handle);
+        retval = page.is_used(rid.slot_no) && page.get_kind(rid.slot_no) != RM_TUPLE_MOVED;
+    } else {
+        retval = Bitmap::is_set(page_handle.bitmap, rid.slot_no); // page的slot_no位置上是否有record
+    }
+    buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
+    return retval;
+}
+
 /**
  * @description: 在当前表中插入一条记录，不指定插入位置
  * @param {char*} buf 要插入的记录的数据
  * @param {Context*} context
+ * @param {BufferAccessStrategy*} strategy 缓冲池访问策略，批量插入时使用BULK_WRITE策略，避免冲掉缓冲池中的热页面
  * @return {Rid} 插入的记录的记录号（位置）
  */
-Rid RmFileHandle::insert_record(char *buf, Context *context) {
+Rid RmFileHandle::insert_record(char *buf, Context *context, BufferAccessStrategy *strategy) {
     // Todo:
     // 1. 获取当前未满的page handle
     // 2. 在page handle中找到空闲slot位置
     // 3. 将buf复制到空闲slot位置
     // 4. 更新page_handle.page_hdr中的数据结构
-    // 注意考虑插入一条记录后页面已满的情况，需要更新file_hdr_.first_free_page_no
-    auto page_handle = create_page_handle();
-    int record_size = page_handle.file_hdr->record_size;
-    int num_slot = file_hdr_.num_records_per_page;
-    // 找到第一个0
-    int first_zero = Bitmap::first_bit(false, page_handle.bitmap, num_slot);
-    assert(first_zero < num_slot); // 因为此页未满所以一定能找到
-    memcpy(page_handle.get_slot(first_zero), buf, record_size);
-    Bitmap::set(page_handle.bitmap, first_zero);
-    page_handle.page_hdr->num_records++;
-    if (page_handle.page_hdr->num_records == file_hdr_.num_records_per_page) { // 刚好用完这一页
-        // 在插入前这一页在链表中，所以`next_free_page_no`有效
-        file_hdr_.first_free_page_no = page_handle.page_hdr->next_free_page_no;
+    // 每个线程插入自己独占的页面，页面满了之后交还给空闲空间映射，再独占下一个页面
+    if (is_slotted()) {
+        char tuple[RM_MAX_VAR_TUPLE_LEN];
+        int len = encode_record(buf, tuple);
+        return insert_slotted_record(RM_TUPLE_NORMAL, tuple, len, strategy);
     }
+    InsertTarget &target = get_insert_target();
+    std::scoped_lock target_lock{target.latch};
+    auto page_handle = fetch_target_page(target, 1, strategy);
+    int num_slot = file_hdr_.num_records_per_page;
     page_id_t page_no = page_handle.page->get_page_id().page_no;
+    int first_zero;
+    int num_free;
+    {
+        // 其他线程可能同时删除这个页面中的记录
+        std::scoped_lock page_lock{get_page_latch(page_no)};
+        // 找到第一个0
+        first_zero = Bitmap::first_bit(false, page_handle.bitmap, num_slot);
+        assert(first_zero < num_slot); // 页面被独占，只会有更多的空闲槽位，所以一定能找到
+        write_slot(page_handle, first_zero, buf);
+        Bitmap::set(page_handle.bitmap, first_zero);
+        page_handle.page_hdr->num_records++;
+        num_free = num_slot - page_handle.page_hdr->num_records;
+        fsm_->update(page_no, num_free);
+    }
+    if (num_free == 0) {
+        fsm_->release(page_no);
+        target.page_no = INVALID_PAGE_ID;
+    } else {
+        target.page_no = page_no;
+    }
     buffer_pool_manager_->unpin_page({fd_, page_no}, true);
     return Rid{page_no, first_zero};
 }
 
+/**
+ * @description: 在当前表中批量插入记录，不指定插入位置。每个页面只pin一次、加一次页面锁，
+ * 在bitmap中依次找空闲槽位填入尽量多的记录，页头和空闲空间映射每个页面只更新一次
+ * @param {vector<const char*>&} bufs 要插入的各条记录的数据
+ * @param {Context*} context
+ * @param {BufferAccessStrategy*} strategy 缓冲池访问策略，大批量装载时应使用BULK_WRITE策略
+ * @return {vector<Rid>} 各条记录的记录号，与bufs一一对应
+ */
+std::vector<Rid> RmFileHandle::insert_records(const std::vector<const char *> &bufs, Context *context,
+                                              BufferAccessStrategy *strategy) {
+    if (is_slotted()) {
+        return insert_slotted_records(bufs, strategy);
+    }
+    std::vector<Rid> rids;
+    rids.reserve(bufs.size());
+    InsertTarget &target = get_insert_target();
+    std::scoped_lock target_lock{target.latch};
+    int num_slot = file_hdr_.num_records_per_page;
+    while (rids.size() < bufs.size()) {
+        auto page_handle = fetch_target_page(target, 1, strategy);
+        page_id_t page_no = page_handle.page->get_page_id().page_no;
+        int num_free;
+        {
+            std::scoped_lock page_lock{get_page_latch(page_no)};
+            int slot_no = -1;
+            num_free = num_slot - page_handle.page_hdr->num_records;
+            for (; num_free > 0 && rids.size() < bufs.size(); num_free--) {
+                slot_no = Bitmap::next_bit(false, page_handle.bitmap, num_slot, slot_no);
+                assert(slot_no < num_slot);
+                write_slot(page_handle, slot_no, bufs[rids.size()]);
+                Bitmap::set(page_handle.bitmap, slot_no);
+                rids.push_back(Rid{page_no, slot_no});
+            }
+            page_handle.page_hdr->num_records = num_slot - num_free;
+            fsm_->update(page_no, num_free);
+        }
+        if (num_free == 0) {
+            fsm_->release(page_no);
+            target.page_no = INVALID_PAGE_ID;
+        } else {
+            target.page_no = page_no;
+        }
+        buffer_pool_manager_->unpin_page({fd_, page_no}, true);
+    }
+    return rids;
+}
+
 /**
  * @description: 在当前表中的指定位置插入一条记录
  * @param {Rid&} rid 要插入记录的位置
  * @param {char*} buf 要插入记录的数据
  */
 void RmFileHandle::insert_record(const Rid &rid, char *buf) {
+    if (is_slotted()) {
+        char tuple[RM_MAX_VAR_TUPLE_LEN];
+        int len = encode_record(buf, tuple);
+        put_slotted_record(rid, tuple, len, true);
+        return;
+    }
+    // 事务中的删除不释放变空的页面，没有事务的删除（如恢复）可能已经释放了页面，回滚时重新占用
+    std::scoped_lock page_lock{get_page_latch(rid.page_no)};
+    disk_manager_->reclaim_page(fd_, rid.page_no);
     auto page_handle = fetch_page_handle(rid.page_no);
-    auto record_size = page_handle.file_hdr->record_size;
-    memcpy(page_handle.get_slot(rid.slot_no), buf, record_size);
-    Bitmap::set(page_handle.bitmap, rid.slot_no);
-    // page_handle.page_hdr->num_records++; // TODO： 是否自增？
+    if (Bitmap::is_set(page_handle.bitmap, rid.slot_no)) {
+        // 重复回滚时槽位中是同一条记录；否则槽位已经被其他记录占用，不能覆盖
+        std::vector<char> slot(file_hdr_.record_size);
+        read_slot(page_handle, rid.slot_no, slot.data());
+        if (memcmp(slot.data(), buf, file_hdr_.record_size) != 0) {
+            buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
+            throw InternalError("RmFileHandle: slot " + std::to_string(rid.slot_no) + " in page " +
+                                std::to_string(rid.page_no) + " is used by another record");
+        }
+    }
+    write_slot(page_handle, rid.slot_no, buf);
+    if (!Bitmap::is_set(page_handle.bitmap, rid.slot_no)) {
+        Bitmap::set(page_handle.bitmap, rid.slot_no);
+        page_handle.page_hdr->num_records++;
+    }
+    fsm_->update(rid.page_no, file_hdr_.num_records_per_page - page_handle.page_hdr->num_records);
     buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), true);
 }
 
@@ -82,17 +191,51 @@ void RmFileHandle::delete_record(const Rid &rid, Context *context) {
     // Todo:
     // 1. 获取指定记录所在的page handle
     // 2. 更新page_handle.page_hdr中的数据结构
-    // 注意考虑删除一条记录后页面未满的情况，需要调用release_page_handle()
+    // 删除后页面有了空闲槽位，更新空闲空间映射；页面变空时释放页面。
+    // 显式事务中的删除可能被回滚，回滚会把记录插回rid，页面要等事务提交时由release_deleted_page释放，
+    // 否则页面可能在提交前被释放并分配给其他插入者，回滚时覆盖其他事务的记录
+    bool defer_free = context != nullptr && context->txn_ != nullptr && context->txn_->get_txn_mode();
+    if (is_slotted()) {
+        Rid forward = erase_slotted_record(rid, !defer_free);
+        if (forward.page_no != INVALID_PAGE_ID) {
+            // 回滚时记录重新写到rid，不会回到被转发的位置
+            erase_slotted_record(forward);
+        }
+        return;
+    }
 
+    std::scoped_lock page_lock{get_page_latch(rid.page_no)};
     auto page_handle = fetch_page_handle(rid.page_no);
     int num_slot = file_hdr_.num_records_per_page;
-    if (page_handle.page_hdr->num_records == num_slot) {
-        // 全满 -> 半满
-        release_page_handle(page_handle);
+    // num_records始终等于bitmap中1的个数，扫描据此跳过全满和全空页面的bitmap，重复删除（如重复回滚）时不能再减
+    if (Bitmap::is_set(page_handle.bitmap, rid.slot_no)) {
+        Bitmap::reset(page_handle.bitmap, rid.slot_no);
+        page_handle.page_hdr->num_records--;
     }
-    Bitmap::reset(page_handle.bitmap, rid.slot_no);
-    page_handle.page_hdr->num_records--;
+    int num_records = page_handle.page_hdr->num_records;
+    fsm_->update(rid.page_no, num_slot - num_records);
     buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), true);
+    if (num_records == 0 && !defer_free) {
+        free_empty_page(rid.page_no);
+    }
+}
+
+/**
+ * @description: 事务提交后释放它的删除留下的空页面，删除时为了能够回滚而没有释放。
+ * 提交前页面可能又被插入了记录，此时不释放
+ * @param {page_id_t} page_no 事务删除过记录的页面
+ */
+void RmFileHandle::release_deleted_page(page_id_t page_no) {
+    std::scoped_lock page_lock{get_page_latch(page_no)};
+    if (disk_manager_->is_page_free(fd_, page_no)) {
+        return;
+    }
+    auto page_handle = fetch_page_handle(page_no);
+    int num_records = page_handle.page_hdr->num_records;
+    buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
+    if (num_records == 0) {
+        free_empty_page(page_no);
+    }
 }
 
 /**
@@ -105,9 +248,15 @@ void RmFileHandle::update_record(const Rid &rid, char *buf, Context *context) {
     // Todo:
     // 1. 获取指定记录所在的page handle
     // 2. 更新记录
+    if (is_slotted()) {
+        char tuple[RM_MAX_VAR_TUPLE_LEN];
+        int len = encode_record(buf, tuple);
+        put_slotted_record(rid, tuple, len, false);
+        return;
+    }
 
     auto page_handle = fetch_page_handle(rid.page_no);
-    memcpy(page_handle.get_slot(rid.slot_no), buf, page_handle.file_hdr->record_size);
+    write_slot(page_handle, rid.slot_no, buf);
     buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), true);
 }
 
@@ -117,13 +266,14 @@ void RmFileHandle::update_record(const Rid &rid, char *buf, Context *context) {
 /**
  * @description: 获取指定页面的页面句柄
  * @param {int} page_no 页面号
+ * @param {BufferAccessStrategy*} strategy 缓冲池访问策略，为nullptr时使用共享的replacer
  * @return {RmPageHandle} 指定页面的句柄
  */
-RmPageHandle RmFileHandle::fetch_page_handle(int page_no) const {
+RmPageHandle RmFileHandle::fetch_page_handle(int page_no, BufferAccessStrategy *strategy) const {
     // Todo:
     // 使用缓冲池获取指定页面，并生成page_handle返回给上层
     // if page_no is invalid, throw PageNotExistError exception
-    Page *page = buffer_pool_manager_->fetch_page({fd_, page_no});
+    Page *page = buffer_pool_manager_->fetch_page({fd_, page_no}, strategy);
     if (page == nullptr) {
         // TODO: 确定表名
         throw PageNotExistError("TODO: 确定表名", page_no);
@@ -132,79 +282,609 @@ RmPageHandle RmFileHandle::fetch_page_handle(int page_no) const {
 }
 
 /**
- * @description: 创建一个新的page handle
+ * @description: 创建一个新的page handle，新页面由调用者独占
+ * @param {BufferAccessStrategy*} strategy 缓冲池访问策略，为nullptr时使用共享的replacer
  * @return {RmPageHandle} 新的PageHandle
  */
-RmPageHandle RmFileHandle::create_new_page_handle() {
+RmPageHandle RmFileHandle::create_new_page_handle(BufferAccessStrategy *strategy) {
     // Todo:
     // 1.使用缓冲池来创建一个新page
     // 2.更新page handle中的相关信息
     // 3.更新file_hdr_
+    // 新页面优先复用文件中已经释放的页面，此时文件的页面个数不变
     PageId page_id = {fd_, INVALID_PAGE_ID};
-    Page *page = buffer_pool_manager_->new_page(&page_id);
-    file_hdr_.first_free_page_no = page_id.page_no;
-    file_hdr_.num_pages++;
-    return RmPageHandle(&file_hdr_, page);
+    Page *page = buffer_pool_manager_->new_page(&page_id, strategy);
+    RmPageHandle page_handle(&file_hdr_, page);
+    if (is_slotted()) {
+        get_slotted_page(page_handle).init();
+    }
+    fsm_->claim(page_id.page_no, get_page_capacity());
+    std::scoped_lock lock{file_hdr_latch_};
+    file_hdr_.num_pages = std::max(file_hdr_.num_pages, page_id.page_no + 1);
+    return page_handle;
 }
 
 /**
- * @brief 创建或获取一个空闲的page handle
+ * @brief 创建或获取一个空闲的page handle，页面在空闲空间映射中由调用者独占，插入满之后调用者负责release
  *
+ * @param space_needed 页面至少要有的空闲空间，单位与空闲空间映射相同
+ * @param strategy 缓冲池访问策略，为nullptr时使用共享的replacer
  * @return RmPageHandle 返回生成的空闲page handle
  * @note pin the page, remember to unpin it outside!
  */
-RmPageHandle RmFileHandle::create_page_handle() {
-    // Todo:
-    // 1. 判断file_hdr_中是否还有空闲页
-    //     1.1 没有空闲页：使用缓冲池来创建一个新page；可直接调用create_new_page_handle()
-    //     1.2 有空闲页：直接获取第一个空闲页
-    // 2. 生成page handle并返回给上层
-    auto no = file_hdr_.first_free_page_no;
-    // -1是非法值，说明此文件连一页也没有分配给记录（file_handler占据了第0页）
-    if (no == file_hdr_.num_pages || no == -1) {
-        auto page_handle = create_new_page_handle();
-        page_handle.page_hdr->next_free_page_no = file_hdr_.num_pages; // free page链表末尾
-        return page_handle;
+RmPageHandle RmFileHandle::create_page_handle(int space_needed, BufferAccessStrategy *strategy) {
+    // 从空闲空间映射中独占空闲槽位最少的页面，没有空闲页面时创建新页面
+    page_id_t no = fsm_->claim_page(space_needed);
+    if (no == INVALID_PAGE_ID) {
+        return create_new_page_handle(strategy);
     }
     assert(no != 0 && no < file_hdr_.num_pages);
-    Page *page = buffer_pool_manager_->fetch_page({fd_, no});
+    Page *page = buffer_pool_manager_->fetch_page({fd_, no}, strategy);
     return RmPageHandle(&file_hdr_, page);
 }
 
 /**
- * @description: 当一个页面从没有空闲空间的状态变为有空闲空间状态时，更新文件头和页头中空闲页面相关的元数据
+ * @description: 获取插入目标独占的页面，页面的空闲空间不足space_needed时交还给空闲空间映射，改为独占另一个页面。
+ * 调用者持有target.latch
+ * @param {InsertTarget&} target 当前线程的插入目标
+ * @param {int} space_needed 要插入的记录需要的空闲空间，单位与空闲空间映射相同
+ * @param {BufferAccessStrategy*} strategy 缓冲池访问策略
+ * @return {RmPageHandle} 插入目标的页面，已经pin住
  */
-void RmFileHandle::release_page_handle(RmPageHandle &page_handle) {
-    // Todo:
-    // 当page从已满变成未满，考虑如何更新：
-    // 1. page_handle.page_hdr->next_free_page_no
-    // 2. file_hdr_.first_free_page_no
+RmPageHandle RmFileHandle::fetch_target_page(InsertTarget &target, int space_needed, BufferAccessStrategy *strategy) {
+    if (target.page_no != INVALID_PAGE_ID && fsm_->get_num_free(target.page_no) < space_needed) {
+        fsm_->release(target.page_no);
+        target.page_no = INVALID_PAGE_ID;
+    }
+    if (target.page_no == INVALID_PAGE_ID) {
+        auto page_handle = create_page_handle(space_needed, strategy);
+        target.page_no = page_handle.page->get_page_id().page_no;
+        return page_handle;
+    }
+    return fetch_page_handle(target.page_no, strategy);
+}
+
+/**
+ * @description: 释放一个全空的页面：从空闲空间映射和缓冲池中删除，归还到文件的空闲页面位图，
+ * 之后create_new_page_handle会优先复用它。页面被插入者独占或仍被pin住（如正在被扫描）时不释放，留在映射中继续使用。
+ * 调用者持有页面锁
+ * @param {page_id_t} page_no 全空的页面
+ */
+void RmFileHandle::free_empty_page(page_id_t page_no) {
+    if (!fsm_->try_remove(page_no)) {
+        return;
+    }
+    if (!buffer_pool_manager_->delete_page({fd_, page_no})) {
+        fsm_->update(page_no, get_page_capacity());
+        return;
+    }
+    disk_manager_->deallocate_page(fd_, page_no);
+}
+
+/**
+ * @description: 打开文件时读入空闲空间映射并删除磁盘上的映射文件，之后异常退出时映射文件不存在，
+ * 下次打开时读取每个页面的页头重建映射，并按bitmap修正定长记录页面的记录个数。映射文件的页面个数多于文件时同样重建
+ */
+void RmFileHandle::load_free_space_map() {
+    fsm_ = std::make_unique<RmFreeSpaceMap>(get_page_capacity());
+    std::string map_path = get_free_space_map_path();
+    if (disk_manager_->is_file(map_path)) {
+        std::vector<int> counts(disk_manager_->get_file_size(map_path) / sizeof(int));
+        std::ifstream ifs(map_path, std::ios::binary);
+        bool ok = ifs.read(reinterpret_cast<char *>(counts.data()), counts.size() * sizeof(int)) &&
+                  counts.size() <= static_cast<size_t>(file_hdr_.num_pages);
+        unlink(map_path.c_str());
+        if (ok) {
+            for (page_id_t page_no = 1; page_no < static_cast<page_id_t>(counts.size()); page_no++) {
+                if (counts[page_no] != RmFreeSpaceMap::NOT_TRACKED) {
+                    fsm_->update(page_no, counts[page_no]);
+                }
+            }
+            return;
+        }
+    }
+    // 重建时顺序读取全部页面，使用BULK_READ策略，避免冲掉缓冲池中的热页面
+    BufferAccessStrategy strategy(BufferAccessStrategy::Type::BULK_READ);
+    for (page_id_t page_no = 1; page_no < file_hdr_.num_pages; page_no++) {
+        if (disk_manager_->is_page_free(fd_, page_no)) {
+            continue;
+        }
+        auto page_handle = fetch_page_handle(page_no, &strategy);
+        // 早期版本回滚删除时不增加页头中的记录个数，没有映射文件的旧文件中它可能小于bitmap中1的个数。
+        // 扫描和映射都依赖它，重建时以bitmap为准修正
+        bool repaired = false;
+        if (!is_slotted()) {
+            int num_records = Bitmap::count(page_handle.bitmap, file_hdr_.num_records_per_page);
+            repaired = num_records != page_handle.page_hdr->num_records;
+            page_handle.page_hdr->num_records = num_records;
+        }
+        fsm_->update(page_no, get_num_free(page_handle));
+        buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), repaired);
+    }
+}
 
-    // 单向链表组织空闲page，链表头为`page_handle.page_hdr->next_free_page_no`
-    // 将新的空闲page插入到链表中，同时保证链表降序
+/**
+ * @description: 关闭文件时把空闲空间映射写入磁盘，第i个int为第i页的空闲槽位个数（变长记录文件为字节数），
+ * 分配过的页面都在映射中，最后一个分配过的页面之后的页面不写入
+ */
+void RmFileHandle::save_free_space_map() const {
+    std::vector<int> counts = fsm_->get_free_counts();
+    std::string map_path = get_free_space_map_path();
+    std::ofstream ofs(map_path, std::ios::binary | std::ios::trunc);
+    if (!ofs.write(reinterpret_cast<const char *>(counts.data()), counts.size() * sizeof(int))) {
+        throw InternalError("RmFileHandle: failed to write free space map " + map_path);
+    }
+}
 
+/**
+ * @description: 把定长记录文件中第slot_no个槽位的记录复制到buf，PAX页面从各列的minipage中拼出整条记录
+ */
+void RmFileHandle::read_slot(const RmPageHandle &page_handle, int slot_no, char *buf) const {
+    if (!is_pax()) {
+        memcpy(buf, page_handle.get_slot(slot_no), file_hdr_.record_size);
+        return;
+    }
+    for (int i = 0; i < layout_.num_pax_cols; i++) {
+        const RmColumn &col = layout_.pax_cols[i];
+        memcpy(buf + col.offset, page_handle.get_minipage(col) + static_cast<size_t>(slot_no) * col.len, col.len);
+    }
+}
+
+/**
+ * @description: 把buf中的记录写入定长记录文件的第slot_no个槽位，PAX页面把各列分别写入自己的minipage
+ */
+void RmFileHandle::write_slot(const RmPageHandle &page_handle, int slot_no, const char *buf) const {
+    if (!is_pax()) {
+        memcpy(page_handle.get_slot(slot_no), buf, file_hdr_.record_size);
+        return;
+    }
+    for (int i = 0; i < layout_.num_pax_cols; i++) {
+        const RmColumn &col = layout_.pax_cols[i];
+        memcpy(page_handle.get_minipage(col) + static_cast<size_t>(slot_no) * col.len, buf + col.offset, col.len);
+    }
+}
+
+/**
+ * @description: 编码一条展开的记录。编码结果至少与Rid一样长，更新后原来的页面放不下时总能原地改为转发记录
+ * @return {int} 编码结果的长度
+ * @param {char*} buf record_size字节的记录
+ * @param {char*} tuple 存放编码结果，至少RM_MAX_VAR_TUPLE_LEN字节
+ */
+int RmFileHandle::encode_record(const char *buf, char *tuple) const {
+    int len = codec_->encode(buf, tuple);
+    if (len < static_cast<int>(sizeof(Rid))) {
+        memset(tuple + len, 0, sizeof(Rid) - len);
+        len = sizeof(Rid);
+    }
+    return len;
+}
+
+/**
+ * @description: 复制变长记录文件中记录号为rid的编码后的记录。rid的槽位是转发记录时复制转发的目标
+ * @return {int} 编码后的长度
+ * @param {Rid&} rid 记录号
+ * @param {char*} tuple 存放编码后的记录，至少RM_MAX_VAR_TUPLE_LEN字节
+ */
+int RmFileHandle::copy_slotted_tuple(const Rid &rid, char *tuple) const {
+    Rid forward{INVALID_PAGE_ID, -1};
+    int len = 0;
+    auto page_handle = fetch_page_handle(rid.page_no);
+    {
+        std::scoped_lock page_lock{get_page_latch(rid.page_no)};
+        auto page = get_slotted_page(page_handle);
+        assert(page.is_used(rid.slot_no)); // 此记录必须有效
+        if (page.get_kind(rid.slot_no) == RM_TUPLE_FORWARD) {
+            memcpy(&forward, page.get_data(rid.slot_no), sizeof(Rid));
+        } else {
+            len = page.get_len(rid.slot_no);
+            memcpy(tuple, page.get_data(rid.slot_no), len);
+        }
+    }
+    buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
+    // 不同时持有两个页面锁，页面锁按编号共用，同时持有可能与自己死锁
+    if (forward.page_no != INVALID_PAGE_ID) {
+        return copy_slotted_tuple(forward, tuple);
+    }
+    return len;
+}
+
+/**
+ * @description: 读出变长记录文件中记录号为rid的记录，展开为record_size字节。rid的槽位是转发记录时读取转发的目标
+ * @param {Rid&} rid 记录号
+ * @param {char*} buf 存放展开的记录
+ */
+void RmFileHandle::read_slotted_record(const Rid &rid, char *buf) const {
+    char tuple[RM_MAX_VAR_TUPLE_LEN];
+    copy_slotted_tuple(rid, tuple);
+    codec_->decode(tuple, buf);
+}
+
+/**
+ * @description: 在变长记录文件中插入一条编码后的记录，不指定插入位置
+ * @param {RmTupleKind} kind 普通记录，或更新时移到其他页面的被转发的记录
+ * @param {char*} tuple 编码后的记录
+ * @param {int} len 编码后的长度
+ * @param {BufferAccessStrategy*} strategy 缓冲池访问策略
+ * @return {Rid} 插入的位置
+ */
+Rid RmFileHandle::insert_slotted_record(RmTupleKind kind, const char *tuple, int len, BufferAccessStrategy *strategy) {
+    InsertTarget &target = get_insert_target();
+    std::scoped_lock target_lock{target.latch};
+    auto page_handle = fetch_target_page(target, RmSlottedPage::get_space_needed(len), strategy);
     page_id_t page_no = page_handle.page->get_page_id().page_no;
-    assert(page_no != file_hdr_.first_free_page_no); // 不能释放一个已经空闲的页
-    if (page_no > file_hdr_.first_free_page_no) {
-        // ... -> 4 -> 插入5 -> 6 -> ...
-        // ... -> 3 -> 插入5 -> 6 -> ...
-        // 找到第一个大于page_no的节点，在其前面插入
-        RmPageHandle prev = fetch_page_handle(file_hdr_.first_free_page_no);
-        while (prev.page_hdr->next_free_page_no != -1 && prev.page_hdr->next_free_page_no < page_no) {
-            int next_no = prev.page_hdr->next_free_page_no;
-            buffer_pool_manager_->unpin_page(prev.page->get_page_id(), false);
-            prev = fetch_page_handle(next_no);
-        }
-        assert(prev.page_hdr->next_free_page_no != page_no); // 不能释放一个已经空闲的页
-        assert(prev.page_hdr->next_free_page_no != -1);      // 链表中不存在这一页
-        page_handle.page_hdr->next_free_page_no = prev.page_hdr->next_free_page_no;
-        prev.page_hdr->next_free_page_no = page_no;
-        buffer_pool_manager_->unpin_page(prev.page->get_page_id(), true);
-    } else if (page_no < file_hdr_.first_free_page_no) {
-        // 插入在头部 -> item -> item -> ...
-        page_handle.page_hdr->next_free_page_no = file_hdr_.first_free_page_no;
-        file_hdr_.first_free_page_no = page_handle.page->get_page_id().page_no;
+    int slot_no;
+    {
+        std::scoped_lock page_lock{get_page_latch(page_no)};
+        auto page = get_slotted_page(page_handle);
+        slot_no = page.insert(kind, tuple, len);
+        assert(slot_no >= 0); // 页面被独占，可用空间只会增加，所以一定放得下
+        page_handle.page_hdr->num_records++;
+        fsm_->update(page_no, page.get_free_space());
+    }
+    buffer_pool_manager_->unpin_page({fd_, page_no}, true);
+    return Rid{page_no, slot_no};
+}
+
+/**
+ * @description: 变长记录文件的批量插入，与定长记录文件相同，每个页面只pin一次、加一次页面锁
+ */
+std::vector<Rid> RmFileHandle::insert_slotted_records(const std::vector<const char *> &bufs,
+                                                      BufferAccessStrategy *strategy) {
+    std::vector<Rid> rids;
+    rids.reserve(bufs.size());
+    InsertTarget &target = get_insert_target();
+    std::scoped_lock target_lock{target.latch};
+    char tuple[RM_MAX_VAR_TUPLE_LEN];
+    int len = bufs.empty() ? 0 : encode_record(bufs[0], tuple);
+    while (rids.size() < bufs.size()) {
+        // 放不下下一条记录时fetch_target_page换一个页面
+        auto page_handle = fetch_target_page(target, RmSlottedPage::get_space_needed(len), strategy);
+        page_id_t page_no = page_handle.page->get_page_id().page_no;
+        {
+            std::scoped_lock page_lock{get_page_latch(page_no)};
+            auto page = get_slotted_page(page_handle);
+            int slot_no;
+            while (rids.size() < bufs.size() && (slot_no = page.insert(RM_TUPLE_NORMAL, tuple, len)) >= 0) {
+                page_handle.page_hdr->num_records++;
+                rids.push_back(Rid{page_no, slot_no});
+                if (rids.size() < bufs.size()) {
+                    len = encode_record(bufs[rids.size()], tuple);
+                }
+            }
+            fsm_->update(page_no, page.get_free_space());
+        }
+        buffer_pool_manager_->unpin_page({fd_, page_no}, true);
     }
+    return rids;
+}
+
+/**
+ * @description: 把编码后的记录写到rid的槽位：槽位为空时插入，否则替换。rid所在的页面放不下时，
+ * 把记录作为被转发的记录插入其他页面，rid的槽位改为指向它的转发记录，记录号保持不变，索引不需要修改。
+ * 原来的转发目标在写入完成之后删除
+ * @param {Rid&} rid 记录号
+ * @param {char*} tuple 编码后的记录
+ * @param {int} len 编码后的长度
+ * @param {bool} reclaim 回滚删除时为true，页面可能已经因为变空而被释放，需要重新占用
+ */
+void RmFileHandle::put_slotted_record(const Rid &rid, const char *tuple, int len, bool reclaim) {
+    Rid old_forward{INVALID_PAGE_ID, -1};
+    auto put_home = [&](RmTupleKind kind, const char *data, int data_len) {
+        std::scoped_lock page_lock{get_page_latch(rid.page_no)};
+        bool reclaimed = reclaim && disk_manager_->reclaim_page(fd_, rid.page_no);
+        auto page_handle = fetch_page_handle(rid.page_no);
+        auto page = get_slotted_page(page_handle);
+        if (reclaimed) {
+            // 释放时页面已经没有记录，磁盘上可能是更早写回的内容
+            page.init();
+            page_handle.page_hdr->num_records = 0;
+        }
+        bool used = page.is_used(rid.slot_no);
+        if (reclaim && used && page.get_kind(rid.slot_no) != RM_TUPLE_FORWARD &&
+            (page.get_len(rid.slot_no) != data_len || memcmp(page.get_data(rid.slot_no), data, data_len) != 0)) {
+            // 回滚删除时槽位已经被其他记录占用，不能覆盖
+            buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), reclaimed);
+            throw InternalError("RmFileHandle: slot " + std::to_string(rid.slot_no) + " in page " +
+                                std::to_string(rid.page_no) + " is used by another record");
+        }
+        if (used && page.get_kind(rid.slot_no) == RM_TUPLE_FORWARD) {
+            memcpy(&old_forward, page.get_data(rid.slot_no), sizeof(Rid));
+        }
+        bool ok = used ? page.update(rid.slot_no, kind, data, data_len)
+                       : page.insert_at(rid.slot_no, kind, data, data_len);
+        if (ok) {
+            page_handle.page_hdr->num_records += used ? 0 : 1;
+            fsm_->update(rid.page_no, page.get_free_space());
+        }
+        buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), ok || reclaimed);
+        return ok;
+    };
+
+    if (!put_home(RM_TUPLE_NORMAL, tuple, len)) {
+        Rid moved = insert_slotted_record(RM_TUPLE_MOVED, tuple, len, nullptr);
+        if (!put_home(RM_TUPLE_FORWARD, reinterpret_cast<const char *>(&moved), sizeof(Rid))) {
+            // 只有回滚删除时槽位为空，才可能连转发记录也放不下
+            erase_slotted_record(moved);
+            throw InternalError("RmFileHandle: no space for record in page " + std::to_string(rid.page_no));
+        }
+    }
+    if (old_forward.page_no != INVALID_PAGE_ID) {
+        erase_slotted_record(old_forward);
+    }
+}
+
+/**
+ * @description: 删除变长记录文件中rid槽位的记录（普通、转发或被转发的记录），页面变空时释放页面
+ * @param {Rid&} rid 记录号
+ * @param {bool} free_page 页面变空时是否释放，删除可能被回滚时为false
+ * @return {Rid} 删除的是转发记录时返回它指向的记录号，由调用者随后删除，否则返回page_no为INVALID_PAGE_ID的Rid
+ */
+Rid RmFileHandle::erase_slotted_record(const Rid &rid, bool free_page) {
+    Rid forward{INVALID_PAGE_ID, -1};
+    std::scoped_lock page_lock{get_page_latch(rid.page_no)};
+    auto page_handle = fetch_page_handle(rid.page_no);
+    auto page = get_slotted_page(page_handle);
+    // 重复删除（如重复回滚）时不能再减
+    if (page.is_used(rid.slot_no)) {
+        if (page.get_kind(rid.slot_no) == RM_TUPLE_FORWARD) {
+            memcpy(&forward, page.get_data(rid.slot_no), sizeof(Rid));
+        }
+        page.erase(rid.slot_no);
+        page_handle.page_hdr->num_records--;
+    }
+    int num_records = page_handle.page_hdr->num_records;
+    fsm_->update(rid.page_no, page.get_free_space());
     buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), true);
-    //    file_hdr_.num_pages--;    // 此文件分配了页后就不会收回
+    if (num_records == 0 && free_page) {
+        free_empty_page(rid.page_no);
+    }
+    return forward;
+}
+
+/**
+ * @description: 文件中空闲空间所占的比例，已经释放的页面整页算作空闲，用于判断是否值得整理
+ * @return {double} 0到1之间，文件中还没有数据页面时为0
+ */
+double RmFileHandle::get_free_ratio() const {
+    page_id_t num_pages = file_hdr_.num_pages;
+    if (num_pages <= 1) {
+        return 0;
+    }
+    std::vector<int> counts = fsm_->get_free_counts();
+    int capacity = get_page_capacity();
+    int64_t num_free = 0;
+    for (page_id_t page_no = 1; page_no < num_pages; page_no++) {
+        int count = static_cast<size_t>(page_no) < counts.size() ? counts[page_no] : RmFreeSpaceMap::NOT_TRACKED;
+        num_free += count == RmFreeSpaceMap::NOT_TRACKED ? capacity : count;
+    }
+    return static_cast<double>(num_free) / (static_cast<double>(num_pages - 1) * capacity);
+}
+
+/**
+ * @description: 整理表文件（VACUUM）：把编号大的页面中的记录移到编号小的页面的空闲空间中，移空的页面被释放，
+ * 最后截掉文件末尾连续的空闲页面。目标页面从编号最小的开始依次填满，两端相遇或者放不下下一条记录时停止。
+ * 每条记录先写入新位置，调用on_move更新索引，再删除旧位置上的记录；
+ * 变长记录文件中被转发的记录按原来的记录号整条移到新位置，不再转发。
+ * 记录号会改变，调用者需持有表的排他锁，整理期间不能有其他事务访问这张表。
+ * 移动不写日志，截断文件之前先把数据页面写回并fsync，再落盘缩小后的文件头，截断后崩溃时记录只存在于新位置
+ * @param {RmMoveCallback&} on_move 每移动一条记录调用一次
+ * @param {function<void()>&} before_truncate 截断文件之前调用，调用者在这里把on_move中修改过的索引写回磁盘
+ * @return {RmCompactStats} 整理的结果
+ */
+RmCompactStats RmFileHandle::compact(const RmMoveCallback &on_move, const std::function<void()> &before_truncate) {
+    RmCompactStats stats{0, 0, file_hdr_.num_pages, file_hdr_.num_pages};
+    // 插入目标独占的页面回到空闲空间映射中，之后可以作为移动的目标或来源
+    for (auto &target : insert_targets_) {
+        std::scoped_lock target_lock{target.latch};
+        if (target.page_no != INVALID_PAGE_ID) {
+            fsm_->release(target.page_no);
+            target.page_no = INVALID_PAGE_ID;
+        }
+    }
+
+    // 按编号升序收集仍在使用的页面。变长记录文件同时记下每条被转发的记录属于哪个记录号，
+    // 它所在的页面被移空时要按原来的记录号移动
+    std::vector<page_id_t> pages;
+    std::map<std::pair<page_id_t, int>, Rid> forwards;
+    BufferAccessStrategy strategy(BufferAccessStrategy::Type::BULK_READ);
+    for (page_id_t page_no = 1; page_no < file_hdr_.num_pages; page_no++) {
+        if (fsm_->get_num_free(page_no) == RmFreeSpaceMap::NOT_TRACKED) {
+            continue;
+        }
+        pages.push_back(page_no);
+        if (!is_slotted()) {
+            continue;
+        }
+        auto page_handle = fetch_page_handle(page_no, &strategy);
+        {
+            std::scoped_lock page_lock{get_page_latch(page_no)};
+            auto page = get_slotted_page(page_handle);
+            for (int slot_no = 0; slot_no < page.get_num_slots(); slot_no++) {
+                if (page.is_used(slot_no) && page.get_kind(slot_no) == RM_TUPLE_FORWARD) {
+                    Rid moved;
+                    memcpy(&moved, page.get_data(slot_no), sizeof(Rid));
+                    forwards[{moved.page_no, moved.slot_no}] = Rid{page_no, slot_no};
+                }
+            }
+        }
+        buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
+    }
+
+    size_t dst = 0; // 移动的目标从pages[dst]开始找，之前的页面已经放不下任何记录
+    size_t src = pages.size();
+    bool stuck = false;
+    while (!stuck && src > dst + 1) {
+        page_id_t page_no = pages[--src];
+        for (auto &rid : get_page_records(page_no, forwards)) {
+            if (!move_record(rid, pages, &dst, src, on_move)) {
+                stuck = true;
+                break;
+            }
+            stats.num_moved++;
+        }
+        // 页面在删除最后一条记录时已经释放；之前变空时仍被pin住而没有释放的页面在这里释放
+        if (!stuck && !disk_manager_->is_page_free(fd_, page_no)) {
+            auto page_handle = fetch_page_handle(page_no);
+            std::scoped_lock page_lock{get_page_latch(page_no)};
+            bool empty = page_handle.page_hdr->num_records == 0;
+            buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
+            if (empty) {
+                free_empty_page(page_no);
+            }
+        }
+    }
+    for (page_id_t page_no : pages) {
+        stats.num_freed_pages += disk_manager_->is_page_free(fd_, page_no) ? 1 : 0;
+    }
+
+    // 截掉文件末尾连续的空闲页面，包括整理之前就已经释放的页面
+    page_id_t num_pages = file_hdr_.num_pages;
+    while (num_pages > 1 && disk_manager_->is_page_free(fd_, num_pages - 1)) {
+        num_pages--;
+    }
+    if (num_pages < file_hdr_.num_pages) {
+        fsm_->truncate(num_pages);
+        {
+            std::scoped_lock lock{file_hdr_latch_};
+            file_hdr_.num_pages = num_pages;
+        }
+        // 移动后的记录和索引先落盘，再落盘缩小后的文件头，截断之后崩溃时文件头不会指向已经不存在的页面
+        buffer_pool_manager_->flush_all_pages(fd_);
+        if (before_truncate) {
+            before_truncate();
+        }
+        disk_manager_->sync_file(fd_);
+        disk_manager_->write_page(fd_, RM_FILE_HDR_PAGE, reinterpret_cast<const char *>(&file_hdr_),
+                                  sizeof(file_hdr_));
+        disk_manager_->sync_file(fd_);
+        disk_manager_->truncate_file(fd_, num_pages);
+    }
+    stats.new_num_pages = num_pages;
+    return stats;
+}
+
+/**
+ * @description: 页面中各条记录的记录号。变长记录文件中被转发的记录换成它原来的记录号，
+ * 转发记录和它指向的被转发的记录在同一个页面中时只出现一次
+ * @param {page_id_t} page_no 页面编号
+ * @param {map&} forwards 被转发的记录到原来的记录号的映射
+ * @return {vector<Rid>} 记录号
+ */
+std::vector<Rid> RmFileHandle::get_page_records(page_id_t page_no,
+                                                const std::map<std::pair<page_id_t, int>, Rid> &forwards) const {
+    std::vector<Rid> rids;
+    auto page_handle = fetch_page_handle(page_no);
+    {
+        std::scoped_lock page_lock{get_page_latch(page_no)};
+        if (is_slotted()) {
+            auto page = get_slotted_page(page_handle);
+            for (int slot_no = 0; slot_no < page.get_num_slots(); slot_no++) {
+                if (!page.is_used(slot_no)) {
+                    continue;
+                }
+                if (page.get_kind(slot_no) != RM_TUPLE_MOVED) {
+                    rids.push_back(Rid{page_no, slot_no});
+                } else if (auto it = forwards.find({page_no, slot_no}); it != forwards.end()) {
+                    rids.push_back(it->second);
+                }
+            }
+        } else {
+            int num_slot = file_hdr_.num_records_per_page;
+            for (int slot_no = Bitmap::first_bit(true, page_handle.bitmap, num_slot); slot_no < num_slot;
+                 slot_no = Bitmap::next_bit(true, page_handle.bitmap, num_slot, slot_no)) {
+                rids.push_back(Rid{page_no, slot_no});
+            }
+        }
+    }
+    buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
+    auto less = [](const Rid &a, const Rid &b) {
+        return std::make_pair(a.page_no, a.slot_no) < std::make_pair(b.page_no, b.slot_no);
+    };
+    std::sort(rids.begin(), rids.end(), less);
+    rids.erase(std::unique(rids.begin(), rids.end()), rids.end());
+    return rids;
+}
+
+/**
+ * @description: 把记录写入指定页面的空闲位置：定长记录文件写入第一个空闲槽位，变长记录文件插入编码后的记录
+ * @param {page_id_t} page_no 页面编号
+ * @param {char*} data 定长记录文件为记录，变长记录文件为编码后的记录
+ * @param {int} len data的长度
+ * @return {int} 写入的槽位，页面放不下时返回-1
+ */
+int RmFileHandle::place_record(page_id_t page_no, const char *data, int len) {
+    auto page_handle = fetch_page_handle(page_no);
+    int slot_no;
+    {
+        std::scoped_lock page_lock{get_page_latch(page_no)};
+        if (is_slotted()) {
+            auto page = get_slotted_page(page_handle);
+            slot_no = page.insert(RM_TUPLE_NORMAL, data, len);
+            page_handle.page_hdr->num_records += slot_no >= 0 ? 1 : 0;
+            fsm_->update(page_no, page.get_free_space());
+        } else {
+            int num_slot = file_hdr_.num_records_per_page;
+            slot_no = Bitmap::first_bit(false, page_handle.bitmap, num_slot);
+            if (slot_no < num_slot) {
+                write_slot(page_handle, slot_no, data);
+                Bitmap::set(page_handle.bitmap, slot_no);
+                page_handle.page_hdr->num_records++;
+            } else {
+                slot_no = -1;
+            }
+            fsm_->update(page_no, num_slot - page_handle.page_hdr->num_records);
+        }
+    }
+    buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), slot_no >= 0);
+    return slot_no;
+}
+
+/**
+ * @description: 把记录号为rid的记录移到pages[*dst, src)中第一个放得下它的页面，*dst跳过已经放不下任何记录的页面
+ * @param {Rid&} rid 要移动的记录
+ * @param {vector<page_id_t>&} pages 仍在使用的页面，按编号升序排列
+ * @param {size_t*} dst 目标页面的起始位置
+ * @param {size_t} src 记录所在页面在pages中的位置，只移到它之前的页面
+ * @param {RmMoveCallback&} on_move 写入新位置之后、删除旧位置之前调用
+ * @return {bool} 是否移动了记录，目标页面都放不下时返回false
+ */
+bool RmFileHandle::move_record(const Rid &rid, const std::vector<page_id_t> &pages, size_t *dst, size_t src,
+                               const RmMoveCallback &on_move) {
+    std::vector<char> record(file_hdr_.record_size);
+    char tuple[RM_MAX_VAR_TUPLE_LEN];
+    const char *data = record.data();
+    int len = file_hdr_.record_size;
+    int space_needed = 1; // 放下这条记录需要的空闲空间，单位与空闲空间映射相同
+    int min_space = 1;    // 放下任何一条记录需要的空闲空间
+    if (is_slotted()) {
+        len = copy_slotted_tuple(rid, tuple);
+        codec_->decode(tuple, record.data());
+        data = tuple;
+        space_needed = RmSlottedPage::get_space_needed(len);
+        min_space = RmSlottedPage::get_space_needed(sizeof(Rid));
+    } else {
+        auto page_handle = fetch_page_handle(rid.page_no);
+        {
+            std::scoped_lock page_lock{get_page_latch(rid.page_no)};
+            read_slot(page_handle, rid.slot_no, record.data());
+        }
+        buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
+    }
+
+    while (*dst < src && fsm_->get_num_free(pages[*dst]) < min_space) {
+        (*dst)++;
+    }
+    for (size_t i = *dst; i < src; i++) {
+        if (fsm_->get_num_free(pages[i]) < space_needed) {
+            continue;
+        }
+        int slot_no = place_record(pages[i], data, len);
+        if (slot_no < 0) {
+            continue;
+        }
+        on_move(rid, Rid{pages[i], slot_no}, record.data());
+        delete_record(rid, nullptr);
+        return true;
+    }
+    return false;
 }
\ No newline at end of file
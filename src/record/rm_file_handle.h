@@ -10,16 +10,38 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cassert>
-
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "bitmap.h"
 #include "common/context.h"
 #include "rm_defs.h"
+#include "rm_free_space_map.h"
+#include "rm_slotted_page.h"
 
 class RmManager;
 
+/* 一次整理（VACUUM）的结果 */
+struct RmCompactStats {
+    int num_moved;           // 移动的记录个数
+    int num_freed_pages;     // 移空后释放的页面个数
+    page_id_t old_num_pages; // 整理前文件的页面个数
+    page_id_t new_num_pages; // 截掉末尾的空闲页面后文件的页面个数
+};
+
+/**
+ * 整理时记录从old_rid移动到new_rid之后调用，record为展开的记录，调用者据此更新索引。
+ * 调用时新位置上已经写入记录，旧位置上的记录还没有删除
+ */
+using RmMoveCallback = std::function<void(const Rid &old_rid, const Rid &new_rid, const char *record)>;
+
 /* 对表数据文件中的页面进行封装 */
 struct RmPageHandle {
     const RmFileHdr *file_hdr; // 当前页面所在文件的文件头指针
@@ -27,6 +49,7 @@ struct RmPageHandle {
     RmPageHdr *page_hdr; // page->data的第一部分，存储页面元信息，指针指向首地址，长度为sizeof(RmPageHdr)
     char *bitmap; // page->data的第二部分，存储页面的bitmap，指针指向首地址，长度为file_hdr->bitmap_size
     char *slots; // page->data的第三部分，存储表的记录，指针指向首地址，每个slot的长度为file_hdr->record_size
+                 // 变长记录文件的bitmap_size为0，slots指向RmSlottedPageHdr
 
     RmPageHandle(const RmFileHdr *fhdr_, Page *page_) : file_hdr(fhdr_), page(page_) {
         page_hdr = reinterpret_cast<RmPageHdr *>(page->get_data() + Page::OFFSET_PAGE_HDR);
@@ -34,6 +57,14 @@ struct RmPageHandle {
         slots = bitmap + file_hdr->bitmap_size;
     }
 
+    /**
+     * @description: PAX页面中一列的minipage的首地址，第i条记录的这一列位于minipage + i * col.len。
+     * 各列的minipage依次排列，大小为每页记录数乘以列宽，总大小与按行存放时相同
+     */
+    char *get_minipage(const RmColumn &col) const {
+        return slots + static_cast<size_t>(file_hdr->num_records_per_page) * col.offset;
+    }
+
     // 返回指定slot_no的slot存储收地址
     char *get_slot(int slot_no) const {
         return slots + slot_no * file_hdr->record_size; // slots的首地址 + slot个数 * 每个slot的大小(每个record的大小)
@@ -43,13 +74,34 @@ struct RmPageHandle {
 /* 每个RmFileHandle对应一个表的数据文件，里面有多个page，每个page的数据封装在RmPageHandle中 */
 class RmFileHandle {
     friend class RmScan;
+    friend class RmColumnScan;
     friend class RmManager;
 
+  public:
+    static constexpr int NUM_INSERT_TARGETS = 16; // 插入目标的个数，不同线程的插入按线程哈希到不同的目标
+    static constexpr int NUM_PAGE_LATCHES = 64;   // 页面锁的个数，页面按编号共用
+
   private:
+    /**
+     * @description: 插入目标，一个线程（会话）独占一个页面并一直插入到它满为止，并发插入的会话互不干扰
+     */
+    struct InsertTarget {
+        std::mutex latch;                    // 哈希到同一目标的线程依次插入
+        page_id_t page_no = INVALID_PAGE_ID; // 独占的页面，INVALID_PAGE_ID表示还没有
+    };
+
     DiskManager *disk_manager_;
     BufferPoolManager *buffer_pool_manager_;
-    int fd_;             // 打开文件后产生的文件句柄
-    RmFileHdr file_hdr_; // 文件头，维护当前表文件的元数据
+    int fd_;                                                      // 打开文件后产生的文件句柄
+    RmFileHdr file_hdr_;                                          // 文件头，维护当前表文件的元数据
+    RmRecordLayout layout_;                                       // 记录格式
+    std::unique_ptr<RmDictionary> dict_;                          // 字典编码字段的字典，没有字典编码字段时为nullptr
+    std::unique_ptr<RmRecordCodec> codec_;                        // 变长记录的编解码，定长记录文件为nullptr
+    std::unique_ptr<RmFreeSpaceMap> fsm_;                         // 每个页面的空闲槽位，插入时从中选择页面
+    std::array<InsertTarget, NUM_INSERT_TARGETS> insert_targets_; // 各个线程的插入目标
+    // 保护页头和bitmap：修改页面中记录的插入、删除互斥。记录内容由事务的记录锁保护
+    mutable std::array<std::mutex, NUM_PAGE_LATCHES> page_latches_;
+    std::mutex file_hdr_latch_; // 保护file_hdr_.num_pages
 
   public:
     RmFileHandle(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, int fd)
@@ -57,9 +109,28 @@ class RmFileHandle {
         // 注意：这里从磁盘中读出文件描述符为fd的文件的file_hdr，读到内存中
         // 这里实际就是初始化file_hdr，只不过是从磁盘中读出进行初始化
         // init file_hdr_
-        disk_manager_->read_page(fd, RM_FILE_HDR_PAGE, (char *)&file_hdr_, sizeof(file_hdr_));
+        // 早期版本的文件头页面只写入file_hdr_，没有插入过记录的表文件只有sizeof(RmFileHdr)字节，
+        // 这时没有记录格式，按全零的layout_（定长记录文件）处理
+        char hdr_page[sizeof(RmFileHdr) + sizeof(RmRecordLayout)];
+        int hdr_len = sizeof(hdr_page);
+        if (!disk_manager_->is_compressed_file(fd) &&
+            disk_manager_->get_file_size(disk_manager_->get_file_name(fd)) < static_cast<off_t>(sizeof(hdr_page))) {
+            hdr_len = sizeof(RmFileHdr);
+        }
+        memset(hdr_page, 0, sizeof(hdr_page));
+        disk_manager_->read_page(fd, RM_FILE_HDR_PAGE, hdr_page, hdr_len);
+        memcpy(&file_hdr_, hdr_page, sizeof(file_hdr_));
+        memcpy(&layout_, hdr_page + sizeof(file_hdr_), sizeof(layout_));
+        if (layout_.num_dict_cols > 0) {
+            dict_ = std::make_unique<RmDictionary>(disk_manager_->get_file_name(fd_) + DICTIONARY_SUFFIX,
+                                                   layout_.num_dict_cols);
+        }
+        if (layout_.num_var_cols > 0 || layout_.num_dict_cols > 0) {
+            codec_ = std::make_unique<RmRecordCodec>(layout_, file_hdr_.record_size, dict_.get());
+        }
         // disk_manager管理的fd对应的文件中，设置从file_hdr_.num_pages开始分配page_no
         disk_manager_->set_fd2pageno(fd, file_hdr_.num_pages);
+        load_free_space_map();
     }
 
     RmFileHdr get_file_hdr() const {
@@ -70,29 +141,128 @@ class RmFileHandle {
     }
 
     /* 判断指定位置上是否已经存在一条记录，通过Bitmap来判断 */
-    bool is_record(const Rid &rid) const {
-        RmPageHandle page_handle = fetch_page_handle(rid.page_no);
-        bool retval = Bitmap::is_set(page_handle.bitmap, rid.slot_no); // page的slot_no位置上是否有record
-        buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
-        return retval;
+    bool is_record(const Rid &rid) const;
+
+    /* 是否为变长记录文件 */
+    bool is_slotted() const {
+        return codec_ != nullptr;
+    }
+
+    /* 是否为按列划分页面的PAX文件 */
+    bool is_pax() const {
+        return layout_.num_pax_cols > 0;
+    }
+
+    /**
+     * @description: 在记录中偏移量为offset的字段是第几个字典编码字段
+     * @return {int} 字典编码字段的序号，不是字典编码字段时返回-1
+     */
+    int get_dict_col_no(int offset) const {
+        for (int i = 0; i < layout_.num_dict_cols; i++) {
+            if (layout_.dict_cols[i].offset == offset) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    /* 字典编码字段的字典，没有字典编码字段时为nullptr */
+    const RmDictionary *get_dictionary() const {
+        return dict_.get();
     }
 
     std::unique_ptr<RmRecord> get_record(const Rid &rid, Context *context) const;
 
-    Rid insert_record(char *buf, Context *context);
+    Rid insert_record(char *buf, Context *context, BufferAccessStrategy *strategy = nullptr);
+
+    std::vector<Rid> insert_records(const std::vector<const char *> &bufs, Context *context,
+                                    BufferAccessStrategy *strategy = nullptr);
 
     void insert_record(const Rid &rid, char *buf);
 
     void delete_record(const Rid &rid, Context *context);
 
+    void release_deleted_page(page_id_t page_no);
+
     void update_record(const Rid &rid, char *buf, Context *context);
 
-    RmPageHandle create_new_page_handle();
+    RmPageHandle create_new_page_handle(BufferAccessStrategy *strategy = nullptr);
+
+    RmPageHandle fetch_page_handle(int page_no, BufferAccessStrategy *strategy = nullptr) const;
 
-    RmPageHandle fetch_page_handle(int page_no) const;
+    const RmFreeSpaceMap &get_free_space_map() const {
+        return *fsm_;
+    }
+
+    void save_free_space_map() const;
+
+    double get_free_ratio() const;
+
+    RmCompactStats compact(const RmMoveCallback &on_move, const std::function<void()> &before_truncate = nullptr);
 
   private:
-    RmPageHandle create_page_handle();
+    RmPageHandle create_page_handle(int space_needed, BufferAccessStrategy *strategy = nullptr);
+
+    RmPageHandle fetch_target_page(InsertTarget &target, int space_needed, BufferAccessStrategy *strategy);
+
+    /**
+     * @description: 空页面的可用空间，即空闲空间映射的单位：定长记录文件为槽位个数，变长记录文件为字节数
+     */
+    int get_page_capacity() const {
+        return is_slotted() ? RmSlottedPage::get_capacity(get_slotted_area_size()) : file_hdr_.num_records_per_page;
+    }
+
+    int get_num_free(const RmPageHandle &page_handle) const {
+        return is_slotted() ? get_slotted_page(page_handle).get_free_space()
+                            : file_hdr_.num_records_per_page - page_handle.page_hdr->num_records;
+    }
+
+    int get_slotted_area_size() const {
+        return disk_manager_->get_page_size() - Page::OFFSET_PAGE_HDR - static_cast<int>(sizeof(RmPageHdr));
+    }
+
+    RmSlottedPage get_slotted_page(const RmPageHandle &page_handle) const {
+        return RmSlottedPage(page_handle.slots, get_slotted_area_size());
+    }
+
+    void read_slot(const RmPageHandle &page_handle, int slot_no, char *buf) const;
+
+    void write_slot(const RmPageHandle &page_handle, int slot_no, const char *buf) const;
+
+    int encode_record(const char *buf, char *tuple) const;
+
+    int copy_slotted_tuple(const Rid &rid, char *tuple) const;
+
+    void read_slotted_record(const Rid &rid, char *buf) const;
+
+    Rid insert_slotted_record(RmTupleKind kind, const char *tuple, int len, BufferAccessStrategy *strategy);
+
+    std::vector<Rid> insert_slotted_records(const std::vector<const char *> &bufs, BufferAccessStrategy *strategy);
+
+    void put_slotted_record(const Rid &rid, const char *tuple, int len, bool reclaim);
+
+    Rid erase_slotted_record(const Rid &rid, bool free_page = true);
+
+    InsertTarget &get_insert_target() {
+        return insert_targets_[std::hash<std::thread::id>{}(std::this_thread::get_id()) % NUM_INSERT_TARGETS];
+    }
+
+    std::mutex &get_page_latch(page_id_t page_no) const {
+        return page_latches_[page_no % NUM_PAGE_LATCHES];
+    }
+
+    void free_empty_page(page_id_t page_no);
+
+    std::vector<Rid> get_page_records(page_id_t page_no, const std::map<std::pair<page_id_t, int>, Rid> &forwards) const;
+
+    int place_record(page_id_t page_no, const char *data, int len);
+
+    bool move_record(const Rid &rid, const std::vector<page_id_t> &pages, size_t *dst, size_t src,
+                     const RmMoveCallback &on_move);
+
+    std::string get_free_space_map_path() const {
+        return disk_manager_->get_file_name(fd_) + FREE_SPACE_MAP_SUFFIX;
+    }
 
-    void release_page_handle(RmPageHandle &page_handle);
+    void load_free_space_map();
 };
\ No newline at end of file
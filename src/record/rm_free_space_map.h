@@ -0,0 +1,229 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <mutex>
+#include <vector>
+
+#include "common/config.h"
+
+/**
+ * @description: 表文件的空闲空间映射（FSM），记录每个页面的空闲槽位个数，
+ * 并把有空闲槽位的页面按空闲槽位个数分到NUM_BUCKETS个桶中。桶内的页面放在数组中，页面记住自己在数组中的位置，
+ * 插入、删除记录后从原来的桶中交换删除、追加到新的桶，都是O(1)，不需要读取其他页面。
+ * 插入时从空闲槽位最少的桶开始选择页面，尽量先填满已经半满的页面。
+ * 插入者用claim_page独占一个页面并一直插入到它满为止，被独占的页面不在桶中，其他插入者不会选中它，也不会被释放。
+ * 变长记录文件（slotted page）中空闲空间的单位是字节而不是槽位，以下“槽位”对它来说都指字节
+ */
+class RmFreeSpaceMap {
+  public:
+    static constexpr int NUM_BUCKETS = 16;
+    static constexpr int NOT_TRACKED = -1; // 不在映射中的页面：文件头页面、已经释放的页面
+
+    /**
+     * @param {int} num_slots 每个页面的槽位个数，变长记录文件为空页面的可用字节数
+     */
+    explicit RmFreeSpaceMap(int num_slots) : num_slots_(num_slots), buckets_(NUM_BUCKETS) {
+    }
+
+    /**
+     * @description: 更新页面的空闲槽位个数
+     * @param {page_id_t} page_no 页面编号
+     * @param {int} num_free 空闲槽位个数，为NOT_TRACKED时从映射中删除页面
+     */
+    void update(page_id_t page_no, int num_free) {
+        std::scoped_lock lock{latch_};
+        Entry &entry = get_entry(page_no);
+        entry.num_free = num_free;
+        move_to_bucket(page_no, entry.claimed ? NO_BUCKET : get_bucket(num_free));
+    }
+
+    /**
+     * @description: 独占至少有min_free个空闲槽位的页面中空闲槽位最少的一个，之后只有调用者向其中插入记录，直到release。
+     * min_free所在的桶中只查看前几个页面，更高的桶中的页面都满足要求
+     * @param {int} min_free 需要的空闲槽位个数
+     * @return {page_id_t} 页面编号，没有可用的页面时返回INVALID_PAGE_ID，调用者应分配新页面并用claim独占
+     */
+    page_id_t claim_page(int min_free = 1) {
+        static constexpr size_t MAX_PROBES = 8;
+        std::scoped_lock lock{latch_};
+        int first_bucket = get_bucket(min_free);
+        if (first_bucket == NO_BUCKET) {
+            first_bucket = 0;
+        }
+        for (int b = first_bucket; b < NUM_BUCKETS; b++) {
+            auto &bucket = buckets_[b];
+            for (size_t i = 0; i < bucket.size() && (b > first_bucket || i < MAX_PROBES); i++) {
+                page_id_t page_no = bucket[i];
+                if (entries_[page_no].num_free >= min_free) {
+                    entries_[page_no].claimed = true;
+                    move_to_bucket(page_no, NO_BUCKET);
+                    return page_no;
+                }
+            }
+        }
+        return INVALID_PAGE_ID;
+    }
+
+    /**
+     * @description: 独占新分配的页面
+     * @param {page_id_t} page_no 页面编号
+     * @param {int} num_free 空闲槽位个数
+     */
+    void claim(page_id_t page_no, int num_free) {
+        std::scoped_lock lock{latch_};
+        Entry &entry = get_entry(page_no);
+        entry.num_free = num_free;
+        entry.claimed = true;
+        move_to_bucket(page_no, NO_BUCKET);
+    }
+
+    /**
+     * @description: 结束独占，页面按当前的空闲槽位个数回到桶中
+     */
+    void release(page_id_t page_no) {
+        std::scoped_lock lock{latch_};
+        Entry &entry = get_entry(page_no);
+        entry.claimed = false;
+        move_to_bucket(page_no, get_bucket(entry.num_free));
+    }
+
+    /**
+     * @description: 页面变空要被释放时从映射中删除页面，被独占的页面还会被插入，不删除
+     * @return {bool} 是否删除了页面
+     */
+    bool try_remove(page_id_t page_no) {
+        std::scoped_lock lock{latch_};
+        Entry &entry = get_entry(page_no);
+        if (entry.claimed) {
+            return false;
+        }
+        entry.num_free = NOT_TRACKED;
+        move_to_bucket(page_no, NO_BUCKET);
+        return true;
+    }
+
+    /**
+     * @description: 文件截断到num_pages个页面时删除之后的页面，这些页面都已经释放，不在任何桶中
+     * @param {page_id_t} num_pages 截断后的页面个数
+     */
+    void truncate(page_id_t num_pages) {
+        std::scoped_lock lock{latch_};
+        for (size_t i = num_pages; i < entries_.size(); i++) {
+            assert(entries_[i].num_free == NOT_TRACKED && entries_[i].bucket == NO_BUCKET);
+        }
+        entries_.resize(std::min(entries_.size(), static_cast<size_t>(num_pages)));
+    }
+
+    /**
+     * @return {int} 页面的空闲槽位个数，不在映射中时返回NOT_TRACKED
+     */
+    int get_num_free(page_id_t page_no) const {
+        std::scoped_lock lock{latch_};
+        return static_cast<size_t>(page_no) < entries_.size() ? entries_[page_no].num_free : NOT_TRACKED;
+    }
+
+    /**
+     * @description: 查看桶中的页面，按空闲槽位从少到多的顺序取第k个，不独占页面
+     * @return {page_id_t} 页面编号，桶中的页面不足k+1个时返回INVALID_PAGE_ID
+     * @param {size_t} k 候选页面的序号
+     */
+    page_id_t find_page(size_t k = 0) const {
+        std::scoped_lock lock{latch_};
+        if (k >= num_candidates_) {
+            return INVALID_PAGE_ID;
+        }
+        for (auto &bucket : buckets_) {
+            if (k < bucket.size()) {
+                return bucket[k];
+            }
+            k -= bucket.size();
+        }
+        return INVALID_PAGE_ID;
+    }
+
+    /**
+     * @description: 有空闲槽位且没有被独占的页面个数
+     */
+    size_t get_num_candidates() const {
+        std::scoped_lock lock{latch_};
+        return num_candidates_;
+    }
+
+    /**
+     * @description: 每个页面的空闲槽位个数，第i项为第i页，用于写入磁盘
+     */
+    std::vector<int> get_free_counts() const {
+        std::scoped_lock lock{latch_};
+        std::vector<int> counts(entries_.size());
+        for (size_t i = 0; i < entries_.size(); i++) {
+            counts[i] = entries_[i].num_free;
+        }
+        return counts;
+    }
+
+  private:
+    static constexpr int NO_BUCKET = -1; // 全满或不在映射中的页面不属于任何桶
+
+    struct Entry {
+        int num_free = NOT_TRACKED; // 空闲槽位个数
+        int bucket = NO_BUCKET;     // 所在的桶
+        int pos = 0;                // 在桶中的位置
+        bool claimed = false;       // 是否被插入者独占
+    };
+
+    Entry &get_entry(page_id_t page_no) {
+        if (static_cast<size_t>(page_no) >= entries_.size()) {
+            entries_.resize(page_no + 1);
+        }
+        return entries_[page_no];
+    }
+
+    /**
+     * @description: 把页面从原来的桶中交换删除，追加到新的桶
+     */
+    void move_to_bucket(page_id_t page_no, int bucket) {
+        Entry &entry = entries_[page_no];
+        if (bucket == entry.bucket) {
+            return;
+        }
+        if (entry.bucket != NO_BUCKET) {
+            // 用桶中最后一个页面填补空位
+            auto &old_bucket = buckets_[entry.bucket];
+            page_id_t last = old_bucket.back();
+            old_bucket[entry.pos] = last;
+            entries_[last].pos = entry.pos;
+            old_bucket.pop_back();
+            num_candidates_--;
+        }
+        entry.bucket = bucket;
+        if (bucket != NO_BUCKET) {
+            entry.pos = static_cast<int>(buckets_[bucket].size());
+            buckets_[bucket].push_back(page_no);
+            num_candidates_++;
+        }
+    }
+
+    int get_bucket(int num_free) const {
+        if (num_free <= 0) {
+            return NO_BUCKET;
+        }
+        return std::min(num_free - 1, num_slots_ - 1) * NUM_BUCKETS / num_slots_;
+    }
+
+    int num_slots_;                               // 每个页面的槽位个数
+    std::vector<Entry> entries_;                  // 每个页面的空闲空间
+    std::vector<std::vector<page_id_t>> buckets_; // 按空闲槽位个数从少到多划分的桶，全满和被独占的页面不在桶中
+    size_t num_candidates_ = 0;                   // 桶中的页面个数
+    mutable std::mutex latch_;
+};
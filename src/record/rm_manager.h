@@ -21,22 +21,67 @@ class RmManager {
   private:
     DiskManager *disk_manager_;
     BufferPoolManager *buffer_pool_manager_;
+    bool compress_files_ = false; // 新建的表文件是否以压缩格式存放页面
 
   public:
     RmManager(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager)
         : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager) {
     }
 
+    /**
+     * @description: 设置之后创建的表文件是否压缩页面，已经存在的文件保持创建时的格式
+     * @param {bool} compress 是否压缩
+     */
+    void set_compress_files(bool compress) {
+        compress_files_ = compress;
+    }
+
     /**
      * @description: 创建表的数据文件并初始化相关信息
      * @param {string&} filename 要创建的文件名称
-     * @param {int} record_size 表中记录的大小
+     * @param {int} record_size 表中记录的大小，有变长字段时为展开后的大小
+     * @param {vector<RmColumn>&} var_cols 变长字段在记录中的位置，按offset升序排列，为空时创建定长记录文件
+     * @param {vector<RmColumn>&} pax_cols 不为空时创建PAX文件，为各列在记录中的位置，按offset升序排列并覆盖整条记录，
+     * 不能与变长字段同时使用
+     * @param {vector<RmColumn>&} dict_cols 字典编码字段在记录中的位置，按offset升序排列，不能与PAX同时使用
      */
-    void create_file(const std::string &filename, int record_size) {
-        if (record_size < 1 || record_size > RM_MAX_RECORD_SIZE) {
+    void create_file(const std::string &filename, int record_size, const std::vector<RmColumn> &var_cols = {},
+                     const std::vector<RmColumn> &pax_cols = {}, const std::vector<RmColumn> &dict_cols = {}) {
+        bool slotted = !var_cols.empty() || !dict_cols.empty();
+        int max_record_size = slotted ? RM_MAX_VAR_RECORD_SIZE : RM_MAX_RECORD_SIZE;
+        if (record_size < 1 || record_size > max_record_size || var_cols.size() > RM_MAX_VAR_COLS) {
             throw InvalidRecordSizeError(record_size);
         }
-        disk_manager_->create_file(filename);
+        if (!dict_cols.empty()) {
+            // 变长字段和字典编码字段一起按offset排序后不能重叠
+            std::vector<RmColumn> cols(var_cols);
+            cols.insert(cols.end(), dict_cols.begin(), dict_cols.end());
+            std::sort(cols.begin(), cols.end(),
+                      [](const RmColumn &a, const RmColumn &b) { return a.offset < b.offset; });
+            int end = 0;
+            for (auto &col : cols) {
+                if (col.offset < end || col.len < 1 || col.offset + col.len > record_size) {
+                    throw InternalError("RmManager: invalid dictionary columns");
+                }
+                end = col.offset + col.len;
+            }
+            if (dict_cols.size() > RM_MAX_DICT_COLS || !pax_cols.empty()) {
+                throw InternalError("RmManager: invalid dictionary columns");
+            }
+        }
+        if (!pax_cols.empty()) {
+            int offset = 0;
+            for (auto &col : pax_cols) {
+                if (col.offset != offset || col.len < 1) {
+                    throw InternalError("RmManager: PAX columns must cover the record in order");
+                }
+                offset += col.len;
+            }
+            if (offset != record_size || pax_cols.size() > RM_MAX_PAX_COLS || !var_cols.empty()) {
+                throw InternalError("RmManager: invalid PAX layout");
+            }
+        }
+        disk_manager_->create_file(filename, compress_files_);
         int fd = disk_manager_->open_file(filename);
 
         // 初始化file header
@@ -44,15 +89,36 @@ class RmManager {
         file_hdr.record_size = record_size;
         file_hdr.num_pages = 1;
         file_hdr.first_free_page_no = RM_NO_PAGE;
-        // We have: sizeof(hdr) + (n + 7) / 8 + n * record_size <= PAGE_SIZE
-        file_hdr.num_records_per_page =
-            (BITMAP_WIDTH * (PAGE_SIZE - 1 - (int)sizeof(RmFileHdr)) + 1) / (1 + record_size * BITMAP_WIDTH);
-        file_hdr.bitmap_size = (file_hdr.num_records_per_page + BITMAP_WIDTH - 1) / BITMAP_WIDTH;
+        int page_size = disk_manager_->get_page_size();
+        if (!slotted) {
+            // We have: sizeof(hdr) + (n + 7) / 8 + n * record_size <= page_size
+            file_hdr.num_records_per_page =
+                (BITMAP_WIDTH * (page_size - 1 - (int)sizeof(RmFileHdr)) + 1) / (1 + record_size * BITMAP_WIDTH);
+            file_hdr.bitmap_size = (file_hdr.num_records_per_page + BITMAP_WIDTH - 1) / BITMAP_WIDTH;
+        } else {
+            // slotted page没有bitmap，记录个数的上限是每条记录只有类型字节时的槽位个数
+            int capacity = RmSlottedPage::get_capacity(page_size - Page::OFFSET_PAGE_HDR - (int)sizeof(RmPageHdr));
+            file_hdr.num_records_per_page = capacity / (1 + (int)sizeof(RmSlot));
+            file_hdr.bitmap_size = 0;
+        }
+        RmRecordLayout layout{};
+        layout.num_var_cols = static_cast<int>(var_cols.size());
+        std::copy(var_cols.begin(), var_cols.end(), layout.var_cols);
+        layout.num_pax_cols = static_cast<int>(pax_cols.size());
+        std::copy(pax_cols.begin(), pax_cols.end(), layout.pax_cols);
+        layout.num_dict_cols = static_cast<int>(dict_cols.size());
+        std::copy(dict_cols.begin(), dict_cols.end(), layout.dict_cols);
 
         // 将file header写入磁盘文件（名为file name，文件描述符为fd）中的第0页
         // head page直接写入磁盘，没有经过缓冲区的NewPage，那么也就不需要FlushPage
-        disk_manager_->write_page(fd, RM_FILE_HDR_PAGE, (char *)&file_hdr, sizeof(file_hdr));
+        char hdr_page[sizeof(RmFileHdr) + sizeof(RmRecordLayout)];
+        memcpy(hdr_page, &file_hdr, sizeof(file_hdr));
+        memcpy(hdr_page + sizeof(file_hdr), &layout, sizeof(layout));
+        disk_manager_->write_page(fd, RM_FILE_HDR_PAGE, hdr_page, sizeof(hdr_page));
         disk_manager_->close_file(fd);
+        // 同名文件直接通过DiskManager删除时可能留下空闲空间映射和字典，不能用于新文件
+        unlink((filename + FREE_SPACE_MAP_SUFFIX).c_str());
+        unlink((filename + DICTIONARY_SUFFIX).c_str());
     }
 
     /**
@@ -61,6 +127,8 @@ class RmManager {
      */
     void destroy_file(const std::string &filename) {
         disk_manager_->destroy_file(filename);
+        unlink((filename + FREE_SPACE_MAP_SUFFIX).c_str());
+        unlink((filename + DICTIONARY_SUFFIX).c_str());
     }
 
     // 注意这里打开文件，创建并返回了record file handle的指针
@@ -78,6 +146,7 @@ class RmManager {
      * @param {RmFileHandle*} file_handle 要关闭文件的句柄
      */
     void close_file(const RmFileHandle *file_handle) {
+        file_handle->save_free_space_map();
         disk_manager_->write_page(file_handle->fd_, RM_FILE_HDR_PAGE, (char *)&file_handle->file_hdr_,
                                   sizeof(file_handle->file_hdr_));
         // 缓冲区的所有页刷到磁盘，注意这句话必须写在close_file前面
@@ -14,9 +14,11 @@ See the Mulan PSL v2 for more details. */
 
 /**
  * @brief 初始化file_handle和rid
- * @param file_handle
+ * @param {RmFileHandle*} file_handle 要扫描的表文件
+ * @param {vector<RmCodeFilter>} filters 字典编码字段上的条件，只返回满足全部条件的记录
  */
-RmScan::RmScan(const RmFileHandle *file_handle) : file_handle_(file_handle) {
+RmScan::RmScan(const RmFileHandle *file_handle, std::vector<RmCodeFilter> filters)
+    : file_handle_(file_handle), filters_(std::move(filters)) {
     // Todo:
     // 初始化file_handle和rid（指向第一个存放了记录的位置）
 
@@ -28,25 +30,27 @@ RmScan::RmScan(const RmFileHandle *file_handle) : file_handle_(file_handle) {
     //    ^ first_free_page_no
     // 3. □ ■ ◧ ■
     //    ^ first_free_page_no
-    auto hdr = file_handle_->file_hdr_;
-    page_id_t page_no = -1;
-    int slot_no = -1;
 
-    // 链表对寻找非全空无帮助，遍历page
-    int num_slot = hdr.num_records_per_page;
-    for (page_no = 1; page_no < hdr.num_pages; ++page_no) {
-        auto page_handle = file_handle->fetch_page_handle(page_no);
-        int first_one = Bitmap::first_bit(true, page_handle.bitmap, num_slot);
-        file_handle_->buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
-        if (first_one < num_slot) { // 此页非全空
-            slot_no = first_one;
-            break;
-        }
+    // 大于缓冲池四分之一的表使用私有的环形帧扫描，不冲掉缓冲池中的其他页面；
+    // 小表仍然使用共享的replacer，以便反复扫描（如嵌套循环连接的内表）时命中缓冲池
+    auto bpm = file_handle_->buffer_pool_manager_;
+    if (static_cast<size_t>(file_handle_->file_hdr_.num_pages) > bpm->get_pool_size() / 4) {
+        strategy_ = std::make_unique<BufferAccessStrategy>(BufferAccessStrategy::Type::BULK_READ);
     }
-    if (slot_no == -1) { // 所有页面全空，到达终点
-        page_no = -1;
+
+    // 顺序扫描从第1页开始，先预读，之后由缓冲池在未命中时推进预读窗口
+    bpm->hint_sequential(file_handle_->fd_, 1);
+
+    if (file_handle_->is_slotted() || file_handle_->is_pax()) {
+        record_buf_.resize(file_handle_->file_hdr_.record_size);
     }
-    rid_ = Rid{page_no, slot_no};
+
+    // 链表对寻找非全空无帮助，遍历page
+    seek(1, 0);
+}
+
+RmScan::~RmScan() {
+    release_page();
 }
 
 /**
@@ -58,24 +62,8 @@ void RmScan::next() {
 
     // 1. page内部查bitmap找到下一个记录
     // 2. 整个page内后面为空(或已经在page末尾），前往下一个非全空页
-    auto hdr = file_handle_->file_hdr_;
-    int num_slot = hdr.num_records_per_page;
-    int curr = rid_.slot_no;
     assert(!is_end()); // 迭代器失效后不能再迭代
-
-    for (int page_no = rid_.page_no; page_no < hdr.num_pages; ++page_no) {
-        // 找到此page内第一个记录
-        auto page_handle = file_handle_->fetch_page_handle(page_no);
-        int first_one = Bitmap::next_bit(true, page_handle.bitmap, num_slot, curr);
-        curr = -1; // 先搜索当前页后面，再搜索后面的页的全部
-        file_handle_->buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
-        if (first_one < num_slot) {
-            rid_ = {page_no, first_one};
-            return;
-        }
-    }
-    rid_ = {-1, -1};
-    // 到达终点
+    seek(rid_.page_no, rid_.slot_no + 1);
 }
 
 /**
@@ -91,4 +79,259 @@ bool RmScan::is_end() const {
  */
 Rid RmScan::rid() const {
     return rid_;
-}
\ No newline at end of file
+}
+
+/**
+ * @description: 当前记录在缓冲池页面中的数据，不复制。调用next()或析构之后失效
+ * @return {const char*} 记录的首地址，长度为文件头中的record_size
+ */
+const char *RmScan::record() const {
+    assert(!is_end());
+    if (!record_buf_.empty()) {
+        return record_buf_.data();
+    }
+    return slots_ + static_cast<size_t>(rid_.slot_no) * file_handle_->file_hdr_.record_size;
+}
+
+/**
+ * @description: 从page_no页的第slot_no个槽位开始找到第一条记录，移动到rid_。
+ * 仍在当前页面中时直接查已经pin住的bitmap，换页时才unpin当前页面并fetch下一个页面
+ * @param {page_id_t} page_no 开始查找的页面
+ * @param {int} slot_no 在page_no页中开始查找的槽位
+ */
+void RmScan::seek(page_id_t page_no, int slot_no) {
+    auto &hdr = file_handle_->file_hdr_; // 扫描期间可能有插入，每次读取最新的页面个数
+    int num_slot = hdr.num_records_per_page;
+    auto disk_manager = file_handle_->disk_manager_;
+    for (; page_no < hdr.num_pages; ++page_no, slot_no = 0) {
+        if (page_ == nullptr || page_->get_page_id().page_no != page_no) {
+            release_page();
+            if (disk_manager->is_page_free(file_handle_->fd_, page_no)) {
+                continue; // 已经释放的页面中没有记录，不需要读入
+            }
+            auto page_handle = file_handle_->fetch_page_handle(page_no, strategy_.get());
+            page_ = page_handle.page;
+            page_hdr_ = page_handle.page_hdr;
+            bitmap_ = page_handle.bitmap;
+            slots_ = page_handle.slots;
+        }
+        // 页头中的记录个数等于bitmap中1的个数：全空的页面不查bitmap，全满的页面每个槽位都是记录
+        int num_records = page_hdr_->num_records;
+        if (num_records == 0) {
+            continue;
+        }
+        if (file_handle_->is_slotted()) {
+            if (seek_slotted(page_no, slot_no)) {
+                return;
+            }
+            continue;
+        }
+        if (num_records == num_slot) {
+            if (slot_no < num_slot) {
+                set_rid(page_no, slot_no);
+                return;
+            }
+            continue;
+        }
+        int first_one = Bitmap::next_bit(true, bitmap_, num_slot, slot_no - 1);
+        if (first_one < num_slot) {
+            set_rid(page_no, first_one);
+            return;
+        }
+    }
+    // 到达终点
+    release_page();
+    rid_ = {-1, -1};
+}
+
+/**
+ * @description: 在已经pin住的变长记录页面中从第slot_no个槽位开始找到第一条满足filters_的记录，展开到record_buf_。
+ * 被转发的记录跳过，在转发记录的位置上通过原来的记录号读出。页面整理会移动记录，读取时持有页面锁
+ * @return {bool} 找到时返回true，rid_指向这条记录
+ */
+bool RmScan::seek_slotted(page_id_t page_no, int slot_no) {
+    for (;; slot_no++) {
+        Rid forward{INVALID_PAGE_ID, -1};
+        {
+            std::scoped_lock page_lock{file_handle_->get_page_latch(page_no)};
+            auto page = file_handle_->get_slotted_page(RmPageHandle(&file_handle_->file_hdr_, page_));
+            int num_slots = page.get_num_slots();
+            // 不满足条件的记录只读出编号，不展开
+            while (slot_no < num_slots &&
+                   (!page.is_used(slot_no) || page.get_kind(slot_no) == RM_TUPLE_MOVED ||
+                    (page.get_kind(slot_no) == RM_TUPLE_NORMAL && !match_filters(page.get_data(slot_no))))) {
+                slot_no++;
+            }
+            if (slot_no >= num_slots) {
+                return false;
+            }
+            if (page.get_kind(slot_no) == RM_TUPLE_FORWARD) {
+                memcpy(&forward, page.get_data(slot_no), sizeof(Rid));
+            } else {
+                file_handle_->codec_->decode(page.get_data(slot_no), record_buf_.data());
+            }
+        }
+        if (forward.page_no != INVALID_PAGE_ID) {
+            char tuple[RM_MAX_VAR_TUPLE_LEN];
+            file_handle_->copy_slotted_tuple(forward, tuple);
+            if (!match_filters(tuple)) {
+                continue;
+            }
+            file_handle_->codec_->decode(tuple, record_buf_.data());
+        }
+        rid_ = {page_no, slot_no};
+        return true;
+    }
+}
+
+/**
+ * @description: 编码后的记录是否满足filters_
+ */
+bool RmScan::match_filters(const char *tuple) const {
+    for (auto &filter : filters_) {
+        int code = file_handle_->codec_->get_code(tuple, filter.dict_col_no);
+        if ((code == filter.code) != filter.equal) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @description: 定长记录文件中移动到已经pin住的页面中的一条记录，PAX页面同时把记录拼到record_buf_中
+ */
+void RmScan::set_rid(page_id_t page_no, int slot_no) {
+    rid_ = {page_no, slot_no};
+    if (file_handle_->is_pax()) {
+        file_handle_->read_slot(RmPageHandle(&file_handle_->file_hdr_, page_), slot_no, record_buf_.data());
+    }
+}
+
+/**
+ * @description: unpin当前页面
+ */
+void RmScan::release_page() {
+    if (page_ != nullptr) {
+        file_handle_->buffer_pool_manager_->unpin_page(page_->get_page_id(), false);
+        page_ = nullptr;
+    }
+}
+
+/**
+ * @param {RmFileHandle*} file_handle 要扫描的表文件
+ * @param {vector<RmColumn>} cols 要读取的列在记录中的位置，PAX文件中必须是建表时的列
+ */
+RmColumnScan::RmColumnScan(const RmFileHandle *file_handle, std::vector<RmColumn> cols)
+    : file_handle_(file_handle), cols_(std::move(cols)), columns_(cols_.size()), col_bufs_(cols_.size()) {
+    if (!file_handle_->is_pax()) {
+        row_scan_ = std::make_unique<RmScan>(file_handle_);
+        return;
+    }
+    auto &layout = file_handle_->layout_;
+    for (auto &col : cols_) {
+        auto end = layout.pax_cols + layout.num_pax_cols;
+        if (std::find_if(layout.pax_cols, end, [&col](const RmColumn &pax_col) {
+                return pax_col.offset == col.offset && pax_col.len == col.len;
+            }) == end) {
+            throw InternalError("RmColumnScan: offset " + std::to_string(col.offset) + " is not a PAX column");
+        }
+    }
+    auto bpm = file_handle_->buffer_pool_manager_;
+    if (static_cast<size_t>(file_handle_->file_hdr_.num_pages) > bpm->get_pool_size() / 4) {
+        strategy_ = std::make_unique<BufferAccessStrategy>(BufferAccessStrategy::Type::BULK_READ);
+    }
+    bpm->hint_sequential(file_handle_->fd_, 1);
+}
+
+RmColumnScan::~RmColumnScan() {
+    release_page();
+}
+
+/**
+ * @description: 前进到下一个有记录的页面
+ * @return {bool} 到达文件末尾时返回false
+ */
+bool RmColumnScan::next_batch() {
+    return row_scan_ != nullptr ? next_row_batch() : next_pax_batch();
+}
+
+/**
+ * @description: PAX文件的下一批：全满的页面直接指向各列的minipage，否则按bitmap复制有记录的槽位
+ */
+bool RmColumnScan::next_pax_batch() {
+    auto &hdr = file_handle_->file_hdr_;
+    int num_slot = hdr.num_records_per_page;
+    for (page_id_t page_no = page_no_ + 1; page_no < hdr.num_pages; page_no++) {
+        release_page();
+        if (file_handle_->disk_manager_->is_page_free(file_handle_->fd_, page_no)) {
+            continue;
+        }
+        auto page_handle = file_handle_->fetch_page_handle(page_no, strategy_.get());
+        page_ = page_handle.page;
+        page_no_ = page_no;
+        num_rows_ = page_handle.page_hdr->num_records;
+        if (num_rows_ == 0) {
+            continue;
+        }
+        slot_nos_.clear();
+        if (num_rows_ < num_slot) {
+            for (int slot_no = Bitmap::next_bit(true, page_handle.bitmap, num_slot, -1); slot_no < num_slot;
+                 slot_no = Bitmap::next_bit(true, page_handle.bitmap, num_slot, slot_no)) {
+                slot_nos_.push_back(slot_no);
+            }
+            num_rows_ = static_cast<int>(slot_nos_.size());
+        }
+        for (size_t i = 0; i < cols_.size(); i++) {
+            const RmColumn &col = cols_[i];
+            const char *src = page_handle.get_minipage(col);
+            if (slot_nos_.empty()) {
+                columns_[i] = src;
+                continue;
+            }
+            col_bufs_[i].resize(static_cast<size_t>(num_rows_) * col.len);
+            for (int row = 0; row < num_rows_; row++) {
+                memcpy(col_bufs_[i].data() + static_cast<size_t>(row) * col.len,
+                       src + static_cast<size_t>(slot_nos_[row]) * col.len, col.len);
+            }
+            columns_[i] = col_bufs_[i].data();
+        }
+        return true;
+    }
+    release_page();
+    num_rows_ = 0;
+    return false;
+}
+
+/**
+ * @description: 按行存放的表的下一批：复制RmScan在同一个页面中读到的全部记录的各列
+ */
+bool RmColumnScan::next_row_batch() {
+    if (row_scan_->is_end()) {
+        num_rows_ = 0;
+        return false;
+    }
+    page_no_ = row_scan_->rid().page_no;
+    slot_nos_.clear();
+    for (auto &buf : col_bufs_) {
+        buf.clear();
+    }
+    for (; !row_scan_->is_end() && row_scan_->rid().page_no == page_no_; row_scan_->next()) {
+        slot_nos_.push_back(row_scan_->rid().slot_no);
+        const char *record = row_scan_->record();
+        for (size_t i = 0; i < cols_.size(); i++) {
+            col_bufs_[i].insert(col_bufs_[i].end(), record + cols_[i].offset, record + cols_[i].offset + cols_[i].len);
+        }
+    }
+    num_rows_ = static_cast<int>(slot_nos_.size());
+    for (size_t i = 0; i < cols_.size(); i++) {
+        columns_[i] = col_bufs_[i].data();
+    }
+    return true;
+}
+
+void RmColumnScan::release_page() {
+    if (page_ != nullptr) {
+        file_handle_->buffer_pool_manager_->unpin_page(page_->get_page_id(), false);
+        page_ = nullptr;
+    }
+}
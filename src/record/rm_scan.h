@@ -10,20 +10,115 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include "rm_defs.h"
 
 class RmFileHandle;
 
+/**
+ * @description: 扫描时在字典编码字段上按编号判断的条件：字段等于（equal为false时不等于）编号为code的值。
+ * code为RmDictionary::NOT_FOUND表示常量不在字典中，此时等于总不成立，不等于总成立
+ */
+struct RmCodeFilter {
+    int dict_col_no; // 字典编码字段的序号
+    int code;        // 常量的编号
+    bool equal;      // 等于还是不等于
+};
+
+/**
+ * 表的顺序扫描。扫描一次pin住一个页面，在内存中遍历它的bitmap，离开页面时才unpin，
+ * 每个页面只经过一次缓冲池。record()直接返回页面中的记录，调用者在页面内存上判断条件，只复制需要的记录。
+ * 变长记录文件的记录在页面中是编码后的格式，PAX页面中一条记录的各列分散在各个minipage中，
+ * record()返回展开到record_buf_中的记录。
+ * 字典编码字段上的条件可以交给扫描，在展开记录之前比较编号，不满足条件的记录不展开也不返回
+ */
 class RmScan : public RecScan {
     const RmFileHandle *file_handle_;
     Rid rid_;
+    std::unique_ptr<BufferAccessStrategy> strategy_; // 扫描大表时使用BULK_READ策略，小表为nullptr
+    Page *page_ = nullptr;                           // rid_所在的页面，扫描期间保持pin
+    const RmPageHdr *page_hdr_ = nullptr;            // page_的页头，其中的记录个数用于跳过全满和全空的页面
+    const char *bitmap_ = nullptr;                   // page_中的bitmap
+    const char *slots_ = nullptr;                    // page_中的记录
+    std::vector<char> record_buf_;                   // 变长记录文件和PAX文件中展开的当前记录
+    std::vector<RmCodeFilter> filters_;              // 字典编码字段上的条件
 
   public:
-    RmScan(const RmFileHandle *file_handle);
+    RmScan(const RmFileHandle *file_handle, std::vector<RmCodeFilter> filters = {});
+
+    ~RmScan() override;
+
+    RmScan(const RmScan &) = delete;
+    RmScan &operator=(const RmScan &) = delete;
 
     void next() override;
 
     bool is_end() const override;
 
     Rid rid() const override;
+
+    const char *record() const;
+
+  private:
+    void seek(page_id_t page_no, int slot_no);
+
+    bool seek_slotted(page_id_t page_no, int slot_no);
+
+    bool match_filters(const char *tuple) const;
+
+    void set_rid(page_id_t page_no, int slot_no);
+
+    void release_page();
+};
+
+/**
+ * 按列的表扫描：每次前进一个页面，返回其中全部记录的若干列，每列是连续的定长数组，
+ * 可以直接交给向量化的谓词和聚合计算。PAX页面中每列本来就连续存放，全满的页面直接返回页面中的minipage，不复制；
+ * 有空槽位的PAX页面按bitmap把记录复制到内部的数组。按行存放的表通过RmScan逐行复制
+ */
+class RmColumnScan {
+    const RmFileHandle *file_handle_;
+    std::vector<RmColumn> cols_;                     // 要读取的列
+    std::unique_ptr<RmScan> row_scan_;               // 非PAX文件的逐行扫描
+    std::unique_ptr<BufferAccessStrategy> strategy_; // 与RmScan相同，扫描大表时使用BULK_READ策略
+    page_id_t page_no_ = 0;                          // 当前批次所在的页面
+    Page *page_ = nullptr;                           // PAX文件中当前的页面，扫描期间保持pin
+    std::vector<const char *> columns_;              // 当前批次中每列的数组
+    std::vector<std::vector<char>> col_bufs_;        // 需要复制时每列的数组
+    std::vector<int> slot_nos_;                      // 当前批次中每条记录的槽位，为空时是整个页面
+    int num_rows_ = 0;                               // 当前批次的记录个数
+
+  public:
+    RmColumnScan(const RmFileHandle *file_handle, std::vector<RmColumn> cols);
+
+    ~RmColumnScan();
+
+    RmColumnScan(const RmColumnScan &) = delete;
+    RmColumnScan &operator=(const RmColumnScan &) = delete;
+
+    bool next_batch();
+
+    int get_num_rows() const {
+        return num_rows_;
+    }
+
+    /**
+     * @description: 当前批次中第i个请求的列，共get_num_rows()个值，每个值的宽度为cols[i].len。调用next_batch()之后失效
+     */
+    const char *get_column(int i) const {
+        return columns_[i];
+    }
+
+    Rid get_rid(int row) const {
+        return Rid{page_no_, slot_nos_.empty() ? row : slot_nos_[row]};
+    }
+
+  private:
+    bool next_pax_batch();
+
+    bool next_row_batch();
+
+    void release_page();
 };
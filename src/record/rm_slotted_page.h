@@ -0,0 +1,355 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "rm_defs.h"
+#include "rm_dictionary.h"
+
+/**
+ * 变长记录文件的页面格式（slotted page），位于RmPageHdr之后：
+ *   RmSlottedPageHdr | 槽位目录（RmSlot数组，向后增长） | 空隙 | 记录数据（从页面末尾向前增长）
+ * 记录号中的slot_no是槽位目录的下标，页面整理（compact）只移动记录数据，不改变槽位，记录号保持不变。
+ * 每条记录以1字节的类型开头：普通记录；转发记录，内容是更新后放不下而移到其他页面的记录号；
+ * 被转发的记录，只能通过原来的记录号访问，扫描时跳过
+ */
+enum RmTupleKind : char {
+    RM_TUPLE_NORMAL = 0,  // 普通记录
+    RM_TUPLE_FORWARD = 1, // 转发记录，内容是一个Rid
+    RM_TUPLE_MOVED = 2,   // 被转发的记录
+};
+
+/* slotted page的页头 */
+struct RmSlottedPageHdr {
+    int num_slots;  // 槽位目录的项数，末尾的空槽位会被回收
+    int data_begin; // 记录数据区的起点
+    int free_space; // 可用的字节数：目录和数据之间的空隙，加上删除、缩短记录留下的碎片
+};
+
+/* 槽位目录的一项，offset为0表示空槽位 */
+struct RmSlot {
+    uint16_t offset; // 记录相对于RmSlottedPageHdr的偏移量，页面不超过32KB
+    uint16_t len;    // 记录的长度，包括类型字节
+};
+
+/**
+ * @description: 对页面中slotted page区域的封装，不拥有内存。调用者持有页面锁
+ */
+class RmSlottedPage {
+  public:
+    RmSlottedPage(char *area, int area_size) : area_(area), area_size_(area_size) {
+    }
+
+    /**
+     * @description: 空页面中可以存放记录和槽位目录的字节数
+     */
+    static int get_capacity(int area_size) {
+        return area_size - static_cast<int>(sizeof(RmSlottedPageHdr));
+    }
+
+    /**
+     * @description: 插入长度为len的记录最多需要的可用空间，包括类型字节和一个新槽位
+     */
+    static int get_space_needed(int len) {
+        return len + 1 + static_cast<int>(sizeof(RmSlot));
+    }
+
+    /**
+     * @description: 初始化新分配的页面
+     */
+    void init() {
+        hdr()->num_slots = 0;
+        hdr()->data_begin = area_size_;
+        hdr()->free_space = get_capacity(area_size_);
+    }
+
+    int get_num_slots() const {
+        return hdr()->num_slots;
+    }
+
+    int get_free_space() const {
+        return hdr()->free_space;
+    }
+
+    bool is_used(int slot_no) const {
+        return slot_no < get_num_slots() && slot(slot_no).offset != 0;
+    }
+
+    RmTupleKind get_kind(int slot_no) const {
+        return static_cast<RmTupleKind>(area_[slot(slot_no).offset]);
+    }
+
+    /**
+     * @description: 记录的内容，不包括类型字节
+     */
+    const char *get_data(int slot_no) const {
+        return area_ + slot(slot_no).offset + 1;
+    }
+
+    int get_len(int slot_no) const {
+        return slot(slot_no).len - 1;
+    }
+
+    /**
+     * @description: 插入一条记录，优先使用空槽位
+     * @return {int} 记录的槽位，空间不足时返回-1
+     */
+    int insert(RmTupleKind kind, const char *data, int len) {
+        int slot_no = 0;
+        while (slot_no < get_num_slots() && slot(slot_no).offset != 0) {
+            slot_no++;
+        }
+        return insert_at(slot_no, kind, data, len) ? slot_no : -1;
+    }
+
+    /**
+     * @description: 在指定的空槽位插入一条记录，槽位超出目录时扩展目录
+     * @return {bool} 空间不足时返回false，页面不变
+     */
+    bool insert_at(int slot_no, RmTupleKind kind, const char *data, int len) {
+        assert(!is_used(slot_no));
+        int num_new_slots = std::max(0, slot_no + 1 - get_num_slots());
+        int dir_size = num_new_slots * static_cast<int>(sizeof(RmSlot));
+        if (get_free_space() < dir_size + len + 1) {
+            return false;
+        }
+        reserve(dir_size + len + 1);
+        for (int i = get_num_slots(); i <= slot_no; i++) {
+            slot(i) = RmSlot{0, 0};
+        }
+        hdr()->num_slots += num_new_slots;
+        hdr()->free_space -= dir_size;
+        put(slot_no, kind, data, len);
+        return true;
+    }
+
+    /**
+     * @description: 替换一条记录，不比原来长时原地覆盖，否则需要时整理页面
+     * @return {bool} 空间不足时返回false，页面不变
+     */
+    bool update(int slot_no, RmTupleKind kind, const char *data, int len) {
+        assert(is_used(slot_no));
+        RmSlot &old = slot(slot_no);
+        if (len + 1 <= old.len) {
+            area_[old.offset] = kind;
+            memcpy(area_ + old.offset + 1, data, len);
+            hdr()->free_space += old.len - (len + 1);
+            old.len = static_cast<uint16_t>(len + 1);
+            return true;
+        }
+        if (get_free_space() + old.len < len + 1) {
+            return false;
+        }
+        release(slot_no);
+        reserve(len + 1);
+        put(slot_no, kind, data, len);
+        return true;
+    }
+
+    /**
+     * @description: 删除一条记录，回收末尾的空槽位
+     */
+    void erase(int slot_no) {
+        assert(is_used(slot_no));
+        release(slot_no);
+        while (get_num_slots() > 0 && slot(get_num_slots() - 1).offset == 0) {
+            hdr()->num_slots--;
+            hdr()->free_space += static_cast<int>(sizeof(RmSlot));
+        }
+    }
+
+  private:
+    RmSlottedPageHdr *hdr() const {
+        return reinterpret_cast<RmSlottedPageHdr *>(area_);
+    }
+
+    RmSlot &slot(int slot_no) const {
+        return reinterpret_cast<RmSlot *>(area_ + sizeof(RmSlottedPageHdr))[slot_no];
+    }
+
+    /**
+     * @description: 目录和数据之间的空隙
+     */
+    int get_gap() const {
+        return hdr()->data_begin - static_cast<int>(sizeof(RmSlottedPageHdr) + get_num_slots() * sizeof(RmSlot));
+    }
+
+    /**
+     * @description: 保证空隙至少有size个字节，不够时整理页面，把所有记录移到页面末尾。调用者已经确认可用空间足够
+     */
+    void reserve(int size) {
+        if (get_gap() >= size) {
+            return;
+        }
+        std::vector<char> copy(area_, area_ + area_size_);
+        int data_begin = area_size_;
+        for (int i = 0; i < get_num_slots(); i++) {
+            RmSlot &s = slot(i);
+            if (s.offset != 0) {
+                data_begin -= s.len;
+                memcpy(area_ + data_begin, copy.data() + s.offset, s.len);
+                s.offset = static_cast<uint16_t>(data_begin);
+            }
+        }
+        hdr()->data_begin = data_begin;
+        assert(get_gap() == get_free_space() && get_gap() >= size);
+    }
+
+    /**
+     * @description: 在空隙中写入记录，调用者已经用reserve保证空间
+     */
+    void put(int slot_no, RmTupleKind kind, const char *data, int len) {
+        hdr()->data_begin -= len + 1;
+        area_[hdr()->data_begin] = kind;
+        memcpy(area_ + hdr()->data_begin + 1, data, len);
+        slot(slot_no) = RmSlot{static_cast<uint16_t>(hdr()->data_begin), static_cast<uint16_t>(len + 1)};
+        hdr()->free_space -= len + 1;
+    }
+
+    /**
+     * @description: 释放记录占用的空间，槽位变为空槽位
+     */
+    void release(int slot_no) {
+        RmSlot &s = slot(slot_no);
+        if (s.offset == hdr()->data_begin) {
+            hdr()->data_begin += s.len; // 最靠前的记录直接并入空隙
+        }
+        hdr()->free_space += s.len;
+        s = RmSlot{0, 0};
+    }
+
+    char *area_;    // RmSlottedPageHdr的首地址
+    int area_size_; // 从RmSlottedPageHdr到页面末尾的字节数
+};
+
+/**
+ * @description: 变长记录的编码：定长部分原样存放，每个变长字段存放2字节的长度和去掉末尾'\0'之后的内容，
+ * 每个字典编码字段存放2字节的编号。字符串字段写入记录时末尾用'\0'填充，因此解码时补回'\0'即可还原
+ */
+class RmRecordCodec {
+  public:
+    /**
+     * @param {RmDictionary*} dict 字典编码字段的字典，没有字典编码字段时为nullptr
+     */
+    RmRecordCodec(const RmRecordLayout &layout, int record_size, RmDictionary *dict)
+        : record_size_(record_size), dict_(dict) {
+        for (int i = 0; i < layout.num_var_cols; i++) {
+            cols_.push_back({layout.var_cols[i], NOT_DICT});
+        }
+        for (int i = 0; i < layout.num_dict_cols; i++) {
+            cols_.push_back({layout.dict_cols[i], i});
+        }
+        std::sort(cols_.begin(), cols_.end(),
+                  [](const Column &a, const Column &b) { return a.col.offset < b.col.offset; });
+    }
+
+    /**
+     * @description: 编码结果的最大长度
+     */
+    int get_max_len() const {
+        return record_size_ + static_cast<int>(cols_.size() * sizeof(uint16_t));
+    }
+
+    /**
+     * @description: 编码一条展开的记录，字典编码字段中新的值加入字典
+     * @return {int} 编码结果的长度
+     * @param {char*} record record_size字节的记录
+     * @param {char*} out 存放编码结果，至少get_max_len()字节
+     */
+    int encode(const char *record, char *out) const {
+        char *op = out;
+        int pos = 0;
+        for (auto &[col, dict_no] : cols_) {
+            memcpy(op, record + pos, col.offset - pos);
+            op += col.offset - pos;
+            if (dict_no != NOT_DICT) {
+                uint16_t code = dict_->get_or_add(dict_no, record + col.offset, col.len);
+                memcpy(op, &code, sizeof(code));
+                op += sizeof(code);
+                pos = col.offset + col.len;
+                continue;
+            }
+            uint16_t len = static_cast<uint16_t>(col.len);
+            while (len > 0 && record[col.offset + len - 1] == '\0') {
+                len--;
+            }
+            memcpy(op, &len, sizeof(len));
+            memcpy(op + sizeof(len), record + col.offset, len);
+            op += sizeof(len) + len;
+            pos = col.offset + col.len;
+        }
+        memcpy(op, record + pos, record_size_ - pos);
+        op += record_size_ - pos;
+        return static_cast<int>(op - out);
+    }
+
+    /**
+     * @description: 把编码结果展开为record_size字节的记录，编码结果之后多余的字节被忽略
+     */
+    void decode(const char *data, char *record) const {
+        const char *ip = data;
+        int pos = 0;
+        for (auto &[col, dict_no] : cols_) {
+            memcpy(record + pos, ip, col.offset - pos);
+            ip += col.offset - pos;
+            uint16_t len;
+            memcpy(&len, ip, sizeof(len));
+            ip += sizeof(len);
+            if (dict_no != NOT_DICT) {
+                dict_->decode(dict_no, len, record + col.offset, col.len);
+            } else {
+                memcpy(record + col.offset, ip, len);
+                memset(record + col.offset + len, 0, col.len - len);
+                ip += len;
+            }
+            pos = col.offset + col.len;
+        }
+        memcpy(record + pos, ip, record_size_ - pos);
+    }
+
+    /**
+     * @description: 不解码记录，直接读出字典编码字段的编号，用于在展开记录之前按编号过滤
+     * @param {char*} data 编码结果
+     * @param {int} dict_no 字典编码字段的序号
+     */
+    uint16_t get_code(const char *data, int dict_no) const {
+        const char *ip = data;
+        int pos = 0;
+        for (auto &[col, col_dict_no] : cols_) {
+            ip += col.offset - pos;
+            uint16_t len;
+            memcpy(&len, ip, sizeof(len));
+            if (col_dict_no == dict_no) {
+                return len;
+            }
+            ip += sizeof(len) + (col_dict_no == NOT_DICT ? len : 0);
+            pos = col.offset + col.len;
+        }
+        throw InternalError("RmRecordCodec: not a dictionary column");
+    }
+
+  private:
+    static constexpr int NOT_DICT = -1;
+
+    struct Column {
+        RmColumn col; // 字段在展开的记录中的位置
+        int dict_no;  // 字典编码字段的序号，变长字段为NOT_DICT
+    };
+
+    std::vector<Column> cols_; // 变长字段和字典编码字段，按offset升序排列
+    int record_size_;          // 展开后的记录长度
+    RmDictionary *dict_;       // 字典编码字段的字典
+};
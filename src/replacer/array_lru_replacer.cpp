@@ -0,0 +1,111 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "replacer/array_lru_replacer.h"
+
+ArrayLRUReplacer::ArrayLRUReplacer(size_t num_pages)
+    : prev_(num_pages + 1, INVALID_FRAME_ID), next_(num_pages + 1, INVALID_FRAME_ID),
+      head_(static_cast<frame_id_t>(num_pages)), max_size_(num_pages) {
+    // 空链表：哨兵节点指向自己
+    prev_[head_] = head_;
+    next_[head_] = head_;
+}
+
+ArrayLRUReplacer::~ArrayLRUReplacer() = default;
+
+/**
+ * @description: 检查frame_id是否合法，非法时抛出异常
+ */
+void ArrayLRUReplacer::check_frame_id(frame_id_t frame_id, const char *func) {
+    if (frame_id < 0 || static_cast<size_t>(frame_id) >= max_size_) {
+        char msg[80];
+        std::snprintf(msg, 80, "ArrayLRUReplacer::%s invalid frame_id: %d", func, frame_id);
+        throw InternalError(std::string(msg));
+    }
+}
+
+/**
+ * @description: 将帧从链表中摘除，调用者需保证帧在链表中
+ */
+void ArrayLRUReplacer::remove(frame_id_t frame_id) {
+    next_[prev_[frame_id]] = next_[frame_id];
+    prev_[next_[frame_id]] = prev_[frame_id];
+    prev_[frame_id] = INVALID_FRAME_ID;
+    next_[frame_id] = INVALID_FRAME_ID;
+    size_--;
+}
+
+/**
+ * @description: 使用LRU策略删除一个victim frame，并返回该frame的id
+ * @param {frame_id_t*} frame_id 被移除的frame的id
+ * @return {bool} 如果成功淘汰了一个页面则返回true，否则返回false
+ */
+bool ArrayLRUReplacer::victim(frame_id_t *frame_id) {
+    std::scoped_lock lock{latch_};
+    if (size_ == 0) {
+        return false;
+    }
+    *frame_id = prev_[head_]; // 链表尾部为最久未被访问的帧
+    remove(*frame_id);
+    return true;
+}
+
+/**
+ * @description: 固定指定的frame，即该页面无法被淘汰
+ * @param {frame_id_t} 需要固定的frame的id
+ */
+void ArrayLRUReplacer::pin(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+    check_frame_id(frame_id, "pin");
+    if (prev_[frame_id] != INVALID_FRAME_ID) {
+        remove(frame_id);
+    }
+}
+
+/**
+ * @description: 取消固定一个frame，代表该页面可以被淘汰
+ * @param {frame_id_t} frame_id 取消固定的frame的id
+ */
+void ArrayLRUReplacer::unpin(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+    check_frame_id(frame_id, "unpin");
+    if (prev_[frame_id] != INVALID_FRAME_ID) { // 第二次unpin无效果
+        return;
+    }
+    // 插入至链表头部
+    prev_[frame_id] = head_;
+    next_[frame_id] = next_[head_];
+    prev_[next_[head_]] = frame_id;
+    next_[head_] = frame_id;
+    size_++;
+}
+
+/**
+ * @description: 获取当前replacer中可以被淘汰的页面数量
+ */
+size_t ArrayLRUReplacer::Size() {
+    std::scoped_lock lock{latch_};
+    return size_;
+}
+
+/**
+ * @description: 按淘汰顺序列出接下来会被淘汰的帧，不将其移除
+ * @param {frame_id_t*} frame_ids 接下来会被淘汰的帧
+ * @param {size_t} max_num 最多列出的帧的个数
+ * @return {size_t} 列出的帧的个数
+ */
+size_t ArrayLRUReplacer::candidates(frame_id_t *frame_ids, size_t max_num) {
+    std::scoped_lock lock{latch_};
+    size_t num = 0;
+    for (frame_id_t frame_id = prev_[head_]; frame_id != head_ && num < max_num; frame_id = prev_[frame_id]) {
+        frame_ids[num++] = frame_id;
+    }
+    return num;
+}
@@ -0,0 +1,55 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "common/config.h"
+#include "errors.h"
+#include "replacer/replacer.h"
+
+/*
+ArrayLRUReplacer实现了与LRUReplacer相同的LRU替换策略
+LRU链表是建立在定长数组上的侵入式双向链表，以frame id作为下标，pin/unpin不需要分配内存
+*/
+class ArrayLRUReplacer : public Replacer {
+  public:
+    /**
+     * @description: 创建一个新的ArrayLRUReplacer
+     * @param {size_t} num_pages ArrayLRUReplacer最多需要存储的page数量
+     */
+    explicit ArrayLRUReplacer(size_t num_pages);
+
+    ~ArrayLRUReplacer() override;
+
+    bool victim(frame_id_t *frame_id) override;
+
+    void pin(frame_id_t frame_id) override;
+
+    void unpin(frame_id_t frame_id) override;
+
+    size_t Size() override;
+
+    size_t candidates(frame_id_t *frame_ids, size_t max_num) override;
+
+  private:
+    void check_frame_id(frame_id_t frame_id, const char *func);
+
+    void remove(frame_id_t frame_id);
+
+    std::mutex latch_;             // 互斥锁
+    std::vector<frame_id_t> prev_; // 链表中前一个(更近被访问的)帧，不在链表中时为INVALID_FRAME_ID
+    std::vector<frame_id_t> next_; // 链表中后一个(更久未被访问的)帧
+    frame_id_t head_;              // 哨兵节点的下标(max_size_)，next_[head_]为最近被访问的帧，prev_[head_]为victim
+    size_t size_ = 0;              // 链表中帧的个数
+    size_t max_size_;              // 最大容量（与缓冲池的容量相同）
+};
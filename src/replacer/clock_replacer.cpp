@@ -0,0 +1,108 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "replacer/clock_replacer.h"
+
+ClockReplacer::ClockReplacer(size_t num_pages) : frames_(num_pages, PINNED) {}
+
+ClockReplacer::~ClockReplacer() = default;
+
+/**
+ * @description: 检查frame_id是否合法，非法时抛出异常
+ */
+void ClockReplacer::check_frame_id(frame_id_t frame_id, const char *func) {
+    if (frame_id < 0 || static_cast<size_t>(frame_id) >= frames_.size()) {
+        char msg[80];
+        std::snprintf(msg, 80, "ClockReplacer::%s invalid frame_id: %d", func, frame_id);
+        throw InternalError(std::string(msg));
+    }
+}
+
+/**
+ * @description: 使用CLOCK策略删除一个victim frame，并返回该frame的id
+ * 时钟指针从上次停下的位置开始扫描，清除经过的帧的访问位，选择第一个访问位为0的可淘汰帧
+ * @param {frame_id_t*} frame_id 被移除的frame的id
+ * @return {bool} 如果成功淘汰了一个页面则返回true，否则返回false
+ */
+bool ClockReplacer::victim(frame_id_t *frame_id) {
+    std::scoped_lock lock{latch_};
+    if (size_ == 0) {
+        return false;
+    }
+    // 最多扫描两圈：第一圈清除访问位，第二圈一定能找到访问位为0的帧
+    while (true) {
+        auto &state = frames_[hand_];
+        size_t cur = hand_;
+        hand_ = hand_ + 1 == frames_.size() ? 0 : hand_ + 1;
+        if (state == REFERENCED) {
+            state = UNREFERENCED;
+        } else if (state == UNREFERENCED) {
+            state = PINNED;
+            size_--;
+            *frame_id = static_cast<frame_id_t>(cur);
+            return true;
+        }
+    }
+}
+
+/**
+ * @description: 固定指定的frame，即该页面无法被淘汰
+ * @param {frame_id_t} 需要固定的frame的id
+ */
+void ClockReplacer::pin(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+    check_frame_id(frame_id, "pin");
+    if (frames_[frame_id] != PINNED) {
+        frames_[frame_id] = PINNED;
+        size_--;
+    }
+}
+
+/**
+ * @description: 取消固定一个frame，代表该页面可以被淘汰，同时设置其访问位
+ * @param {frame_id_t} frame_id 取消固定的frame的id
+ */
+void ClockReplacer::unpin(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+    check_frame_id(frame_id, "unpin");
+    if (frames_[frame_id] == PINNED) {
+        size_++;
+    }
+    frames_[frame_id] = REFERENCED;
+}
+
+/**
+ * @description: 获取当前replacer中可以被淘汰的页面数量
+ */
+size_t ClockReplacer::Size() {
+    std::scoped_lock lock{latch_};
+    return size_;
+}
+
+/**
+ * @description: 按淘汰顺序列出接下来会被淘汰的帧，不将其移除
+ * 从时钟指针开始，先列出访问位为0的帧，再列出访问位为1的帧，与时钟指针扫描两圈的淘汰顺序一致
+ * @param {frame_id_t*} frame_ids 接下来会被淘汰的帧
+ * @param {size_t} max_num 最多列出的帧的个数
+ * @return {size_t} 列出的帧的个数
+ */
+size_t ClockReplacer::candidates(frame_id_t *frame_ids, size_t max_num) {
+    std::scoped_lock lock{latch_};
+    size_t num = 0;
+    for (FrameState state : {UNREFERENCED, REFERENCED}) {
+        for (size_t i = 0, cur = hand_; i < frames_.size() && num < max_num; i++) {
+            if (frames_[cur] == state) {
+                frame_ids[num++] = static_cast<frame_id_t>(cur);
+            }
+            cur = cur + 1 == frames_.size() ? 0 : cur + 1;
+        }
+    }
+    return num;
+}
@@ -0,0 +1,59 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "common/config.h"
+#include "errors.h"
+#include "replacer/replacer.h"
+
+/*
+ClockReplacer实现了CLOCK(clock-sweep)替换策略
+每一帧在一个定长数组中记录是否可以被淘汰以及访问位，pin/unpin不需要分配内存
+*/
+class ClockReplacer : public Replacer {
+  public:
+    /**
+     * @description: 创建一个新的ClockReplacer
+     * @param {size_t} num_pages ClockReplacer最多需要存储的page数量
+     */
+    explicit ClockReplacer(size_t num_pages);
+
+    ~ClockReplacer() override;
+
+    bool victim(frame_id_t *frame_id) override;
+
+    void pin(frame_id_t frame_id) override;
+
+    void unpin(frame_id_t frame_id) override;
+
+    size_t Size() override;
+
+    size_t candidates(frame_id_t *frame_ids, size_t max_num) override;
+
+  private:
+    // 帧在ClockReplacer中的状态
+    enum FrameState : uint8_t {
+        PINNED = 0,   // 不在replacer中，不能被淘汰
+        UNREFERENCED, // 可以被淘汰，访问位为0
+        REFERENCED,   // 可以被淘汰，访问位为1，时钟指针经过时先清除访问位
+    };
+
+    void check_frame_id(frame_id_t frame_id, const char *func);
+
+    std::mutex latch_;               // 互斥锁
+    std::vector<FrameState> frames_; // 每一帧的状态
+    size_t hand_ = 0;                // 时钟指针，指向下一个检查的帧
+    size_t size_ = 0;                // 可以被淘汰的帧的个数
+};
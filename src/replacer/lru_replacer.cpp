@@ -89,3 +89,18 @@ void LRUReplacer::unpin(frame_id_t frame_id) {
 size_t LRUReplacer::Size() {
     return LRUlist_.size();
 }
+
+/**
+ * @description: 按淘汰顺序列出接下来会被淘汰的帧，不将其移除
+ * @param {frame_id_t*} frame_ids 接下来会被淘汰的帧
+ * @param {size_t} max_num 最多列出的帧的个数
+ * @return {size_t} 列出的帧的个数
+ */
+size_t LRUReplacer::candidates(frame_id_t *frame_ids, size_t max_num) {
+    std::scoped_lock lock{latch_};
+    size_t num = 0;
+    for (auto it = LRUlist_.rbegin(); it != LRUlist_.rend() && num < max_num; ++it) {
+        frame_ids[num++] = *it;
+    }
+    return num;
+}
@@ -40,6 +40,8 @@ class LRUReplacer : public Replacer {
 
     size_t Size() override;
 
+    size_t candidates(frame_id_t *frame_ids, size_t max_num) override;
+
   private:
     std::mutex latch_;              // 互斥锁
     std::list<frame_id_t> LRUlist_; // 按加入的时间顺序存放unpinned pages的frame id，首部表示最近被访问
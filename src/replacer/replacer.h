@@ -39,6 +39,22 @@ class Replacer {
      */
     virtual void unpin(frame_id_t frame_id) = 0;
 
+    /**
+     * Forgets the access history of a frame that now holds a different page, so the new page does not
+     * inherit the old page's history. The frame must be pinned. Policies without per-frame history ignore it.
+     * @param frame_id the id of the frame that received a new page
+     */
+    virtual void reset(frame_id_t frame_id) {}
+
     /** @return the number of elements in the replacer that can be victimized */
     virtual size_t Size() = 0;
+
+    /**
+     * Lists the frames that are going to be victimized next, without removing them.
+     * The background writer cleans these frames ahead of the victim cursor.
+     * @param[out] frame_ids the upcoming victims, the first one is evicted first
+     * @param max_num the maximum number of frames to list
+     * @return the number of frames written to frame_ids
+     */
+    virtual size_t candidates(frame_id_t *frame_ids, size_t max_num) = 0;
 };
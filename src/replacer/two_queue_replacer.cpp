@@ -0,0 +1,151 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "replacer/two_queue_replacer.h"
+
+#include <algorithm>
+
+TwoQueueReplacer::TwoQueueReplacer(size_t num_pages)
+    : prev_(num_pages + 2, INVALID_FRAME_ID), next_(num_pages + 2, INVALID_FRAME_ID), hot_(num_pages, 0),
+      first_seen_(num_pages, 0), cold_head_(static_cast<frame_id_t>(num_pages)),
+      hot_head_(static_cast<frame_id_t>(num_pages + 1)), max_size_(num_pages) {
+    // 冷队列占四分之一的帧，页面在冷队列中停留的时间与相关访问的间隔相当
+    cold_target_ = std::max<size_t>(num_pages / 4, 1);
+    correlated_period_ = cold_target_;
+    // 空链表：哨兵节点指向自己
+    for (frame_id_t head : {cold_head_, hot_head_}) {
+        prev_[head] = head;
+        next_[head] = head;
+    }
+}
+
+TwoQueueReplacer::~TwoQueueReplacer() = default;
+
+/**
+ * @description: 检查frame_id是否合法，非法时抛出异常
+ */
+void TwoQueueReplacer::check_frame_id(frame_id_t frame_id, const char *func) {
+    if (frame_id < 0 || static_cast<size_t>(frame_id) >= max_size_) {
+        char msg[80];
+        std::snprintf(msg, 80, "TwoQueueReplacer::%s invalid frame_id: %d", func, frame_id);
+        throw InternalError(std::string(msg));
+    }
+}
+
+/**
+ * @description: 将帧插入到head对应队列的头部
+ */
+void TwoQueueReplacer::push_front(frame_id_t head, frame_id_t frame_id) {
+    prev_[frame_id] = head;
+    next_[frame_id] = next_[head];
+    prev_[next_[head]] = frame_id;
+    next_[head] = frame_id;
+    (head == hot_head_ ? hot_size_ : cold_size_)++;
+}
+
+/**
+ * @description: 将帧从所在队列中摘除，调用者需保证帧在队列中
+ */
+void TwoQueueReplacer::remove(frame_id_t frame_id) {
+    next_[prev_[frame_id]] = next_[frame_id];
+    prev_[next_[frame_id]] = prev_[frame_id];
+    prev_[frame_id] = INVALID_FRAME_ID;
+    next_[frame_id] = INVALID_FRAME_ID;
+    (hot_[frame_id] ? hot_size_ : cold_size_)--;
+}
+
+/**
+ * @description: 使用2Q策略删除一个victim frame，并返回该frame的id
+ * 冷队列达到目标帧数或热队列为空时淘汰冷队列中最久未被访问的帧，否则淘汰热队列中最久未被访问的帧
+ * @param {frame_id_t*} frame_id 被移除的frame的id
+ * @return {bool} 如果成功淘汰了一个页面则返回true，否则返回false
+ */
+bool TwoQueueReplacer::victim(frame_id_t *frame_id) {
+    std::scoped_lock lock{latch_};
+    if (cold_size_ + hot_size_ == 0) {
+        return false;
+    }
+    bool from_cold = cold_size_ > 0 && (cold_size_ >= cold_target_ || hot_size_ == 0);
+    *frame_id = prev_[from_cold ? cold_head_ : hot_head_];
+    remove(*frame_id);
+    // 帧将用于新的页面，清除访问历史
+    hot_[*frame_id] = 0;
+    first_seen_[*frame_id] = 0;
+    return true;
+}
+
+/**
+ * @description: 固定指定的frame，即该页面无法被淘汰，页面的访问历史保留
+ * @param {frame_id_t} 需要固定的frame的id
+ */
+void TwoQueueReplacer::pin(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+    check_frame_id(frame_id, "pin");
+    if (prev_[frame_id] != INVALID_FRAME_ID) {
+        remove(frame_id);
+    }
+}
+
+/**
+ * @description: 取消固定一个frame，代表该页面可以被淘汰，同时记录一次访问
+ * @param {frame_id_t} frame_id 取消固定的frame的id
+ */
+void TwoQueueReplacer::unpin(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+    check_frame_id(frame_id, "unpin");
+    if (prev_[frame_id] != INVALID_FRAME_ID) { // 第二次unpin无效果
+        return;
+    }
+    tick_++;
+    if (first_seen_[frame_id] == 0) {
+        first_seen_[frame_id] = tick_;
+    } else if (tick_ - first_seen_[frame_id] > correlated_period_) {
+        hot_[frame_id] = 1; // 非相关的第二次访问
+    }
+    push_front(hot_[frame_id] ? hot_head_ : cold_head_, frame_id);
+}
+
+/**
+ * @description: 帧被用于新的页面时清除访问历史。victim取出的帧已经清除过，
+ * 访问策略的环复用帧和delete_page之后从free_list取出帧时不经过victim，需要在这里清除
+ * @param {frame_id_t} frame_id 放入了新页面的帧的id，调用者已经pin住它
+ */
+void TwoQueueReplacer::reset(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+    check_frame_id(frame_id, "reset");
+    hot_[frame_id] = 0;
+    first_seen_[frame_id] = 0;
+}
+
+/**
+ * @description: 获取当前replacer中可以被淘汰的页面数量
+ */
+size_t TwoQueueReplacer::Size() {
+    std::scoped_lock lock{latch_};
+    return cold_size_ + hot_size_;
+}
+
+/**
+ * @description: 按淘汰顺序列出接下来会被淘汰的帧，不将其移除
+ * 冷队列中的帧总是比热队列中的帧先被淘汰（近似：冷队列低于目标帧数时实际会先淘汰热队列）
+ * @param {frame_id_t*} frame_ids 接下来会被淘汰的帧
+ * @param {size_t} max_num 最多列出的帧的个数
+ * @return {size_t} 列出的帧的个数
+ */
+size_t TwoQueueReplacer::candidates(frame_id_t *frame_ids, size_t max_num) {
+    std::scoped_lock lock{latch_};
+    size_t num = 0;
+    for (frame_id_t head : {cold_head_, hot_head_}) {
+        for (frame_id_t frame_id = prev_[head]; frame_id != head && num < max_num; frame_id = prev_[frame_id]) {
+            frame_ids[num++] = frame_id;
+        }
+    }
+    return num;
+}
@@ -0,0 +1,72 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "common/config.h"
+#include "errors.h"
+#include "replacer/replacer.h"
+
+/*
+TwoQueueReplacer实现了抗扫描的2Q替换策略
+只被访问过一次的帧放在冷队列中，再次被访问后才进入热队列；冷队列的帧数超过目标值时优先淘汰冷队列，
+因此一次全表扫描读入的页面只会在冷队列中流过，不会挤出热队列中的B+树内部节点和小表页面。
+两个队列都是建立在定长数组上的侵入式LRU链表，pin/unpin不需要分配内存。
+
+访问以unpin计数。顺序扫描会对同一页面连续fetch/unpin多次（每条记录一次），这些相关访问不应使页面变热：
+只有距离首次访问超过correlated_period次unpin之后的再次访问才会把帧移入热队列(LRU-K中的Correlated Reference Period)。
+*/
+class TwoQueueReplacer : public Replacer {
+  public:
+    /**
+     * @description: 创建一个新的TwoQueueReplacer
+     * @param {size_t} num_pages TwoQueueReplacer最多需要存储的page数量
+     */
+    explicit TwoQueueReplacer(size_t num_pages);
+
+    ~TwoQueueReplacer() override;
+
+    bool victim(frame_id_t *frame_id) override;
+
+    void pin(frame_id_t frame_id) override;
+
+    void unpin(frame_id_t frame_id) override;
+
+    void reset(frame_id_t frame_id) override;
+
+    size_t Size() override;
+
+    size_t candidates(frame_id_t *frame_ids, size_t max_num) override;
+
+  private:
+    void check_frame_id(frame_id_t frame_id, const char *func);
+
+    void push_front(frame_id_t head, frame_id_t frame_id);
+
+    void remove(frame_id_t frame_id);
+
+    std::mutex latch_;                 // 互斥锁
+    std::vector<frame_id_t> prev_;     // 链表中前一个帧，不在链表中时为INVALID_FRAME_ID
+    std::vector<frame_id_t> next_;     // 链表中后一个帧
+    std::vector<uint8_t> hot_;         // 帧中的页面是否已经进入热队列，pin期间保留
+    std::vector<uint64_t> first_seen_; // 帧中的页面首次被访问时的tick_，0表示读入后尚未被访问
+    frame_id_t cold_head_;             // 冷队列的哨兵节点，next_为最近被访问的帧，prev_为冷队列的victim
+    frame_id_t hot_head_;              // 热队列的哨兵节点
+    size_t cold_size_ = 0;             // 冷队列中帧的个数
+    size_t hot_size_ = 0;              // 热队列中帧的个数
+    size_t cold_target_;               // 冷队列的目标帧数，超过后优先淘汰冷队列
+    uint64_t correlated_period_;       // 相关访问的间隔，以unpin次数计
+    uint64_t tick_ = 0;                // unpin的次数，作为逻辑时钟
+    size_t max_size_;                  // 最大容量（与缓冲池的容量相同）
+};
@@ -11,9 +11,11 @@ See the Mulan PSL v2 for more details. */
 #include <csetjmp>
 #include <csignal>
 #include <cstdio>
+#include <getopt.h>
 #include <netinet/in.h>
 #include <readline/history.h>
 #include <readline/readline.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include "analyze/analyze.h"
@@ -29,25 +31,284 @@ See the Mulan PSL v2 for more details. */
 
 static bool should_exit = false;
 
-// 构建全局所需的管理器对象
-auto disk_manager = std::make_unique<DiskManager>();
-auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
-auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
-auto ix_manager = std::make_unique<IxManager>(disk_manager.get(), buffer_pool_manager.get());
-auto sm_manager =
-    std::make_unique<SmManager>(disk_manager.get(), buffer_pool_manager.get(), rm_manager.get(), ix_manager.get());
-auto lock_manager = std::make_unique<LockManager>();
-auto txn_manager = std::make_unique<TransactionManager>(lock_manager.get(), sm_manager.get());
-auto planner = std::make_unique<Planner>(sm_manager.get());
-auto optimizer = std::make_unique<Optimizer>(sm_manager.get(), planner.get());
-auto ql_manager = std::make_unique<QlManager>(sm_manager.get(), txn_manager.get(), planner.get());
-auto log_manager = std::make_unique<LogManager>(disk_manager.get());
-auto recovery = std::make_unique<RecoveryManager>(disk_manager.get(), buffer_pool_manager.get(), sm_manager.get());
-auto portal = std::make_unique<Portal>(sm_manager.get());
-auto analyze = std::make_unique<Analyze>(sm_manager.get());
+/* rmdb的启动参数 */
+struct StartupOptions {
+    std::string db_name;                                  // 数据库名称
+    int page_size = PAGE_SIZE;                            // 新建数据库的页面大小，已有的数据库沿用db.meta中的大小
+    size_t buffer_pool_shards = BUFFER_POOL_SHARDS;       // 缓冲池分片个数
+    std::string replacer_type = REPLACER_TYPE;            // 缓冲池置换策略
+    int bgwriter_delay_ms = BGWRITER_DELAY_MS;            // 后台写线程两轮之间的间隔，0表示不启动
+    size_t bgwriter_max_pages = BGWRITER_MAX_PAGES;       // 后台写线程每轮最多写回的页面数
+    size_t bgwriter_clean_target = BGWRITER_CLEAN_TARGET; // 后台写线程保持的干净帧个数
+    int read_ahead_pages = READ_AHEAD_PAGES;              // 顺序扫描每次预读的页面个数，0表示关闭预读
+    std::string io_backend = IO_BACKEND;                  // 异步I/O的后端
+    bool direct_io = false;                               // 表文件和索引文件是否使用O_DIRECT
+    int extent_min_pages = EXTENT_MIN_PAGES;              // 扩展文件时预留的最小区段
+    int extent_max_pages = EXTENT_MAX_PAGES;              // 扩展文件时预留的最大区段，0表示不预留
+    bool huge_pages = false;                              // 缓冲池的帧内存是否使用大页
+    bool compress_tables = false;                         // 新建的表文件是否压缩页面
+    int autovacuum_delay_ms = AUTOVACUUM_DELAY_MS;        // 后台整理线程两轮之间的间隔，0表示不启动
+    double autovacuum_free_ratio = AUTOVACUUM_FREE_RATIO; // 空闲空间比例超过它的表会被后台整理
+};
+
+// 全局所需的管理器对象，在main中根据启动参数构建
+std::unique_ptr<DiskManager> disk_manager;
+std::unique_ptr<BufferPoolManager> buffer_pool_manager;
+std::unique_ptr<RmManager> rm_manager;
+std::unique_ptr<IxManager> ix_manager;
+std::unique_ptr<SmManager> sm_manager;
+std::unique_ptr<LockManager> lock_manager;
+std::unique_ptr<TransactionManager> txn_manager;
+std::unique_ptr<Planner> planner;
+std::unique_ptr<Optimizer> optimizer;
+std::unique_ptr<QlManager> ql_manager;
+std::unique_ptr<LogManager> log_manager;
+std::unique_ptr<RecoveryManager> recovery;
+std::unique_ptr<Portal> portal;
+std::unique_ptr<Analyze> analyze;
 pthread_mutex_t *buffer_mutex;
 pthread_mutex_t *sockfd_mutex;
 
+// 构建全局所需的管理器对象
+void init_managers(const StartupOptions &options) {
+    disk_manager = std::make_unique<DiskManager>();
+    disk_manager->set_page_size(options.page_size);
+    disk_manager->set_io_backend(options.io_backend);
+    if (disk_manager->get_io_backend() != options.io_backend) {
+        std::cerr << "io_uring is not supported, using " << disk_manager->get_io_backend() << std::endl;
+    }
+    disk_manager->set_direct_io(options.direct_io);
+    disk_manager->set_extent_size(options.extent_min_pages, options.extent_max_pages);
+    // 页面更大时减少帧的个数，缓冲池占用的内存保持不变
+    size_t pool_size = static_cast<size_t>(BUFFER_POOL_SIZE) * PAGE_SIZE / options.page_size;
+    buffer_pool_manager = std::make_unique<BufferPoolManager>(pool_size, disk_manager.get(), options.buffer_pool_shards,
+                                                              options.replacer_type, options.huge_pages);
+    if (options.huge_pages && !buffer_pool_manager->is_huge_pages()) {
+        std::cerr << "no huge pages reserved, using transparent huge pages" << std::endl;
+    }
+    // 预读通过操作系统的缓存完成，O_DIRECT时没有作用
+    buffer_pool_manager->set_read_ahead_pages(options.direct_io ? 0 : options.read_ahead_pages);
+    if (options.bgwriter_delay_ms > 0) {
+        buffer_pool_manager->start_background_writer(options.bgwriter_delay_ms, options.bgwriter_max_pages,
+                                                     options.bgwriter_clean_target);
+    }
+    rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+    rm_manager->set_compress_files(options.compress_tables);
+    ix_manager = std::make_unique<IxManager>(disk_manager.get(), buffer_pool_manager.get());
+    sm_manager =
+        std::make_unique<SmManager>(disk_manager.get(), buffer_pool_manager.get(), rm_manager.get(), ix_manager.get());
+    lock_manager = std::make_unique<LockManager>();
+    txn_manager = std::make_unique<TransactionManager>(lock_manager.get(), sm_manager.get());
+    planner = std::make_unique<Planner>(sm_manager.get());
+    optimizer = std::make_unique<Optimizer>(sm_manager.get(), planner.get());
+    ql_manager = std::make_unique<QlManager>(sm_manager.get(), txn_manager.get(), planner.get());
+    log_manager = std::make_unique<LogManager>(disk_manager.get());
+    recovery = std::make_unique<RecoveryManager>(disk_manager.get(), buffer_pool_manager.get(), sm_manager.get());
+    portal = std::make_unique<Portal>(sm_manager.get());
+    analyze = std::make_unique<Analyze>(sm_manager.get());
+}
+
+void print_usage(const char *prog) {
+    std::cerr << "Usage: " << prog << " [options] <database>\n"
+              << "Options:\n"
+              << "  --page-size=N              page size in bytes of a new database, a power of two from " << PAGE_SIZE
+              << " to " << MAX_PAGE_SIZE << " (default " << PAGE_SIZE << ")\n"
+              << "  --buffer-pool-shards=N     number of buffer pool shards (default " << BUFFER_POOL_SHARDS << ")\n"
+              << "  --replacer=NAME            buffer pool replacement policy: LRU, LRU_ARRAY, CLOCK or 2Q (default "
+              << REPLACER_TYPE << ")\n"
+              << "  --bgwriter-delay=MS        interval between background writer rounds, 0 disables it (default "
+              << BGWRITER_DELAY_MS << ")\n"
+              << "  --bgwriter-max-pages=N     max pages written by the background writer per round (default "
+              << BGWRITER_MAX_PAGES << ")\n"
+              << "  --bgwriter-clean-target=N  clean frames kept ahead of the replacer's victims (default "
+              << BGWRITER_CLEAN_TARGET << ")\n"
+              << "  --read-ahead-pages=N       pages prefetched ahead of sequential scans, 0 disables it (default "
+              << READ_AHEAD_PAGES << ")\n"
+              << "  --io-backend=NAME          asynchronous I/O backend: io_uring or thread_pool (default "
+              << IO_BACKEND << ")\n"
+              << "  --direct-io                open table and index files with O_DIRECT, bypassing the page cache\n"
+              << "  --extent-min-pages=N       smallest extent preallocated when a file grows (default "
+              << EXTENT_MIN_PAGES << ")\n"
+              << "  --extent-max-pages=N       largest extent preallocated when a file grows, 0 disables it (default "
+              << EXTENT_MAX_PAGES << ")\n"
+              << "  --huge-pages               back the buffer pool frames with huge pages\n"
+              << "  --compress-tables          store the pages of newly created tables compressed\n"
+              << "  --autovacuum-delay=MS      interval between background vacuum rounds, 0 disables it (default "
+              << AUTOVACUUM_DELAY_MS << ")\n"
+              << "  --autovacuum-free-ratio=R  free space ratio above which a table is vacuumed (default "
+              << AUTOVACUUM_FREE_RATIO << ")\n";
+}
+
+/**
+ * @description: 解析命令行参数
+ * @return {bool} 参数合法则返回true
+ */
+bool parse_options(int argc, char **argv, StartupOptions *options) {
+    enum {
+        OPT_PAGE_SIZE = 256,
+        OPT_BUFFER_POOL_SHARDS,
+        OPT_REPLACER,
+        OPT_BGWRITER_DELAY,
+        OPT_BGWRITER_MAX_PAGES,
+        OPT_BGWRITER_CLEAN_TARGET,
+        OPT_READ_AHEAD_PAGES,
+        OPT_IO_BACKEND,
+        OPT_DIRECT_IO,
+        OPT_EXTENT_MIN_PAGES,
+        OPT_EXTENT_MAX_PAGES,
+        OPT_HUGE_PAGES,
+        OPT_COMPRESS_TABLES,
+        OPT_AUTOVACUUM_DELAY,
+        OPT_AUTOVACUUM_FREE_RATIO,
+    };
+    static const struct option long_options[] = {
+        {"page-size", required_argument, nullptr, OPT_PAGE_SIZE},
+        {"buffer-pool-shards", required_argument, nullptr, OPT_BUFFER_POOL_SHARDS},
+        {"replacer", required_argument, nullptr, OPT_REPLACER},
+        {"bgwriter-delay", required_argument, nullptr, OPT_BGWRITER_DELAY},
+        {"bgwriter-max-pages", required_argument, nullptr, OPT_BGWRITER_MAX_PAGES},
+        {"bgwriter-clean-target", required_argument, nullptr, OPT_BGWRITER_CLEAN_TARGET},
+        {"read-ahead-pages", required_argument, nullptr, OPT_READ_AHEAD_PAGES},
+        {"io-backend", required_argument, nullptr, OPT_IO_BACKEND},
+        {"direct-io", no_argument, nullptr, OPT_DIRECT_IO},
+        {"extent-min-pages", required_argument, nullptr, OPT_EXTENT_MIN_PAGES},
+        {"extent-max-pages", required_argument, nullptr, OPT_EXTENT_MAX_PAGES},
+        {"huge-pages", no_argument, nullptr, OPT_HUGE_PAGES},
+        {"compress-tables", no_argument, nullptr, OPT_COMPRESS_TABLES},
+        {"autovacuum-delay", required_argument, nullptr, OPT_AUTOVACUUM_DELAY},
+        {"autovacuum-free-ratio", required_argument, nullptr, OPT_AUTOVACUUM_FREE_RATIO},
+        {nullptr, 0, nullptr, 0},
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", long_options, nullptr)) != -1) {
+        switch (opt) {
+        case OPT_PAGE_SIZE: {
+            int page_size = atoi(optarg);
+            if (!DiskManager::is_valid_page_size(page_size)) {
+                std::cerr << "invalid page size: " << optarg << std::endl;
+                return false;
+            }
+            options->page_size = page_size;
+            break;
+        }
+        case OPT_BUFFER_POOL_SHARDS: {
+            int shards = atoi(optarg);
+            if (shards < 1 || shards > BUFFER_POOL_SIZE) {
+                std::cerr << "invalid buffer pool shards: " << optarg << std::endl;
+                return false;
+            }
+            options->buffer_pool_shards = shards;
+            break;
+        }
+        case OPT_REPLACER: {
+            if (BufferPoolManager::create_replacer(optarg, 1) == nullptr) {
+                std::cerr << "invalid replacer: " << optarg << std::endl;
+                return false;
+            }
+            options->replacer_type = optarg;
+            break;
+        }
+        case OPT_BGWRITER_DELAY: {
+            int delay_ms = atoi(optarg);
+            if (delay_ms < 0) {
+                std::cerr << "invalid bgwriter delay: " << optarg << std::endl;
+                return false;
+            }
+            options->bgwriter_delay_ms = delay_ms;
+            break;
+        }
+        case OPT_BGWRITER_MAX_PAGES: {
+            int max_pages = atoi(optarg);
+            if (max_pages < 1) {
+                std::cerr << "invalid bgwriter max pages: " << optarg << std::endl;
+                return false;
+            }
+            options->bgwriter_max_pages = max_pages;
+            break;
+        }
+        case OPT_BGWRITER_CLEAN_TARGET: {
+            int clean_target = atoi(optarg);
+            if (clean_target < 0 || clean_target > BUFFER_POOL_SIZE) {
+                std::cerr << "invalid bgwriter clean target: " << optarg << std::endl;
+                return false;
+            }
+            options->bgwriter_clean_target = clean_target;
+            break;
+        }
+        case OPT_READ_AHEAD_PAGES: {
+            int read_ahead_pages = atoi(optarg);
+            if (read_ahead_pages < 0) {
+                std::cerr << "invalid read ahead pages: " << optarg << std::endl;
+                return false;
+            }
+            options->read_ahead_pages = read_ahead_pages;
+            break;
+        }
+        case OPT_IO_BACKEND: {
+            if (create_io_context(optarg, 1) == nullptr) {
+                std::cerr << "invalid io backend: " << optarg << std::endl;
+                return false;
+            }
+            options->io_backend = optarg;
+            break;
+        }
+        case OPT_DIRECT_IO:
+            options->direct_io = true;
+            break;
+        case OPT_EXTENT_MIN_PAGES: {
+            int extent_min_pages = atoi(optarg);
+            if (extent_min_pages < 1) {
+                std::cerr << "invalid extent min pages: " << optarg << std::endl;
+                return false;
+            }
+            options->extent_min_pages = extent_min_pages;
+            break;
+        }
+        case OPT_EXTENT_MAX_PAGES: {
+            int extent_max_pages = atoi(optarg);
+            if (extent_max_pages < 0) {
+                std::cerr << "invalid extent max pages: " << optarg << std::endl;
+                return false;
+            }
+            options->extent_max_pages = extent_max_pages;
+            break;
+        }
+        case OPT_HUGE_PAGES:
+            options->huge_pages = true;
+            break;
+        case OPT_COMPRESS_TABLES:
+            options->compress_tables = true;
+            break;
+        case OPT_AUTOVACUUM_DELAY: {
+            int delay_ms = atoi(optarg);
+            if (delay_ms < 0) {
+                std::cerr << "invalid autovacuum delay: " << optarg << std::endl;
+                return false;
+            }
+            options->autovacuum_delay_ms = delay_ms;
+            break;
+        }
+        case OPT_AUTOVACUUM_FREE_RATIO: {
+            double free_ratio = atof(optarg);
+            if (free_ratio <= 0 || free_ratio > 1) {
+                std::cerr << "invalid autovacuum free ratio: " << optarg << std::endl;
+                return false;
+            }
+            options->autovacuum_free_ratio = free_ratio;
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    // 需要指定数据库名称
+    if (optind != argc - 1) {
+        return false;
+    }
+    options->db_name = argv[optind];
+    return true;
+}
+
 static jmp_buf jmpbuf;
 void sigint_handler(int signo) {
     should_exit = true;
@@ -119,6 +380,10 @@ void *client_handler(void *sock_fd) {
         Context *context = new Context(lock_manager.get(), log_manager.get(), nullptr, data_send, &offset);
         SetTransaction(&txn_id, context); // 暂时注释掉，否则会SIGSEGV
 
+        // DDL语句排他持有ddl_latch_，其他语句从生成执行器到自动提交共享持有，后台整理表时不会有语句在读写表
+        std::unique_lock<std::shared_mutex> ddl_lock{sm_manager->ddl_latch_, std::defer_lock};
+        std::shared_lock<std::shared_mutex> stmt_lock{sm_manager->ddl_latch_, std::defer_lock};
+
         // 用于判断是否已经调用了yy_delete_buffer来删除buf
         bool finish_analyze = false;
         pthread_mutex_lock(buffer_mutex);
@@ -133,6 +398,11 @@ void *client_handler(void *sock_fd) {
                     pthread_mutex_unlock(buffer_mutex);
                     // 优化器
                     std::shared_ptr<Plan> plan = optimizer->plan_query(query, context);
+                    if (std::dynamic_pointer_cast<DDLPlan>(plan) != nullptr) {
+                        ddl_lock.lock();
+                    } else {
+                        stmt_lock.lock();
+                    }
                     // portal
                     std::shared_ptr<PortalStmt> portalStmt = portal->start(plan, context);
                     portal->run(portalStmt, ql_manager.get(), &txn_id, context);
@@ -258,17 +528,50 @@ void start_server() {
         printf("%s\n", strerror(errno));
     }
     //    assert(ret != -1);
+    sm_manager->stop_auto_vacuum();
     sm_manager->close_db();
     std::cout << " DB has been closed.\n";
+    auto write_stats = buffer_pool_manager->get_write_stats();
+    std::cout << " Buffer pool writes: background " << write_stats.background_writes << ", foreground "
+              << write_stats.foreground_writes << ", flush " << write_stats.flush_writes << " in "
+              << write_stats.flush_batches << " batches\n";
+    // 文件大小与仍在使用的页面个数，空闲页面会被之后的插入复用
+    auto print_page_stats = [](const std::string &name, int fd) {
+        auto page_stats = disk_manager->get_page_stats(fd);
+        std::cout << " File " << name << ": " << page_stats.num_pages << " pages, "
+                  << page_stats.num_pages - page_stats.num_free_pages << " live, " << page_stats.num_free_pages
+                  << " free\n";
+    };
+    for (auto &[name, file_handle] : sm_manager->fhs_) {
+        print_page_stats(name, file_handle->GetFd());
+    }
+    for (auto &[name, index_handle] : sm_manager->ihs_) {
+        print_page_stats(name, index_handle->get_fd());
+    }
     std::cout << "Server shuts down." << std::endl;
 }
 
 int main(int argc, char **argv) {
-    if (argc != 2) {
-        // 需要指定数据库名称
-        std::cerr << "Usage: " << argv[0] << " <database>" << std::endl;
+    StartupOptions options;
+    if (!parse_options(argc, argv, &options)) {
+        print_usage(argv[0]);
         exit(1);
     }
+    // 已有的数据库沿用创建时的页面大小，缓冲池的帧按这个大小分配，所以要在构建管理器之前读出
+    struct stat st;
+    if (stat(options.db_name.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        try {
+            int page_size = SmManager::read_page_size(options.db_name);
+            if (page_size != options.page_size) {
+                std::cerr << "database " << options.db_name << " uses " << page_size << "-byte pages" << std::endl;
+                options.page_size = page_size;
+            }
+        } catch (RMDBError &e) {
+            std::cerr << e.what() << std::endl;
+            exit(1);
+        }
+    }
+    init_managers(options);
 
     signal(SIGINT, sigint_handler);
     try {
@@ -284,7 +587,7 @@ int main(int argc, char **argv) {
                      "Type 'help;' for help.\n"
                      "\n";
         // Database name is passed by args
-        std::string db_name = argv[1];
+        std::string db_name = options.db_name;
         if (!sm_manager->is_dir(db_name)) {
             // Database not found, create a new one
             sm_manager->create_db(db_name);
@@ -297,6 +600,12 @@ int main(int argc, char **argv) {
         recovery->redo();
         recovery->undo();
 
+        // 恢复完成后再开始后台整理，整理会移动记录
+        if (options.autovacuum_delay_ms > 0) {
+            sm_manager->start_auto_vacuum(txn_manager.get(), options.autovacuum_delay_ms,
+                                          options.autovacuum_free_ratio);
+        }
+
         // 开启服务端，开始接受客户端连接
         start_server();
     } catch (RMDBError &e) {
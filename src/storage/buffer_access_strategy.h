@@ -0,0 +1,62 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <vector>
+
+#include "common/config.h"
+
+/**
+ * @description: 缓冲池访问策略。批量扫描、建索引时的回填和批量插入会访问大量只用一次的页面，
+ * 它们通过访问策略向BufferPoolManager申请一个私有的环形帧集合：未命中时优先复用环中上一轮使用过的帧，
+ * 而不是从共享的replacer中淘汰页面，从而不会冲掉缓冲池中其他查询的热页面。
+ * @note 一个访问策略对象只能在一个线程中、配合同一个BufferPoolManager使用
+ */
+class BufferAccessStrategy {
+    friend class BufferPoolManager;
+
+  public:
+    enum class Type {
+        BULK_READ,  // 批量读，如全表扫描
+        BULK_WRITE, // 批量写，如批量插入
+    };
+
+    explicit BufferAccessStrategy(Type type)
+        : type_(type), ring_size_(type == Type::BULK_READ ? RING_BULK_READ_FRAMES : RING_BULK_WRITE_FRAMES) {
+    }
+
+    /**
+     * @param {Type} type 访问模式
+     * @param {size_t} ring_size 环中帧的个数，在缓冲池的各个分片间平均分配
+     */
+    BufferAccessStrategy(Type type, size_t ring_size) : type_(type), ring_size_(ring_size) {
+    }
+
+    Type get_type() const {
+        return type_;
+    }
+
+    size_t get_ring_size() const {
+        return ring_size_;
+    }
+
+    /** @return 复用环中的帧的次数 */
+    size_t get_num_reused() const {
+        return num_reused_;
+    }
+
+  private:
+    Type type_;
+    size_t ring_size_;
+    std::vector<std::vector<frame_id_t>> rings_; // 每个分片一个环，存放分片内帧号，INVALID_FRAME_ID表示该位置尚未使用
+    std::vector<size_t> cursors_;                // 每个环当前使用的位置
+    size_t num_reused_ = 0;
+};
@@ -9,53 +9,240 @@ MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
 See the Mulan PSL v2 for more details. */
 
 #include "buffer_pool_manager.h"
+#include <limits.h>
+#include <sys/mman.h>
+
 #include <algorithm>
+#include <cerrno>
+#include <exception>
 
 /**
- * @description: 从free_list或replacer中得到可淘汰帧页的 *frame_id
+ * @description: 映射所有帧的页面数据。mmap得到的内存按页对齐，O_DIRECT读写可以直接使用帧内存；
+ * huge_pages为true时先尝试MAP_HUGETLB，系统没有预留大页时退回普通页面并建议内核使用透明大页
+ * @param {bool} huge_pages 是否尝试使用大页
+ */
+void BufferPoolManager::allocate_frame_data(bool huge_pages) {
+    frame_data_size_ = std::max<size_t>(pool_size_, 1) * page_size_;
+    void *data = MAP_FAILED;
+    if (huge_pages) {
+        size_t huge_size = (frame_data_size_ + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+        data = mmap(nullptr, huge_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data != MAP_FAILED) {
+            frame_data_size_ = huge_size;
+            huge_pages_ = true;
+        }
+    }
+    if (data == MAP_FAILED) {
+        data = mmap(nullptr, frame_data_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (data == MAP_FAILED) {
+            throw UnixError();
+        }
+        if (huge_pages) {
+            madvise(data, frame_data_size_, MADV_HUGEPAGE);
+        }
+    }
+    frame_data_ = static_cast<char *>(data);
+}
+
+void BufferPoolManager::free_frame_data() {
+    munmap(frame_data_, frame_data_size_);
+}
+
+/**
+ * @description: 根据页面键的哈希值选择页面所在的分片，同一个页面总是映射到同一个分片
+ * @return {BufferPoolShard&} 页面所在的分片
+ * @param {page_key_t} key 页面键，见get_page_key
+ */
+BufferPoolManager::BufferPoolShard &BufferPoolManager::get_shard(page_key_t key) {
+    if (shards_.size() == 1) {
+        return shards_[0];
+    }
+    // 页表用哈希值的低位定位槽位，分片用高位，避免同一分片中的页面在页表里聚集
+    return shards_[(hash_page_key(key) >> 32) % shards_.size()];
+}
+
+/**
+ * @description: 从分片的free_list或replacer中得到可淘汰帧页的 *frame_id，调用者需持有分片的latch。
+ * 如果victim是脏页，则在释放latch的情况下将其写回磁盘，写回期间旧页面仍然可以被其他线程命中。
  * @return {bool} true: 可替换帧查找成功 , false: 可替换帧查找失败
- * @param {frame_id_t*} frame_id 帧页id指针,返回成功找到的可替换帧id
+ * @param {BufferPoolShard&} shard 查找的分片
+ * @param {unique_lock<mutex>&} lock 持有的分片latch，写回脏页时会暂时释放
+ * @param {frame_id_t*} frame_id 帧页id指针,返回成功找到的可替换帧id（分片内编号）
+ * @note 返回的帧是干净的，且既不在free_list中也不在replacer中；帧中旧页面的页表映射仍然保留
  */
-bool BufferPoolManager::find_victim_page(frame_id_t *frame_id) {
+bool BufferPoolManager::find_victim_page(BufferPoolShard &shard, std::unique_lock<std::mutex> &lock,
+                                         frame_id_t *frame_id) {
     // Todo:
-    // 1 使用BufferPoolManager::free_list_判断缓冲池是否已满需要淘汰页面
+    // 1 使用BufferPoolShard::free_list判断分片是否已满需要淘汰页面
     // 1.1 未满获得frame
-    // 1.2 已满使用lru_replacer中的方法选择淘汰页面
+    // 1.2 已满使用replacer中的方法选择淘汰页面
 
-    if (free_list_.empty()) {
-        return replacer_->victim(frame_id);
+    while (true) {
+        if (!shard.free_list.empty()) {
+            *frame_id = shard.free_list.front();
+            shard.free_list.pop_front();
+            return true;
+        }
+        if (!shard.replacer->victim(frame_id)) {
+            return false;
+        }
+        if (write_back_victim(shard, lock, *frame_id)) {
+            return true;
+        }
+        // 写回期间页面又被使用或被删除了，放弃这一帧，由最后一次unpin或delete_page负责将其放回
+    }
+}
+
+/**
+ * @description: 按照访问策略得到可淘汰帧页的 *frame_id，调用者需持有分片的latch。
+ * 优先复用策略的环中当前位置上一轮使用过的帧，该帧已被其他线程pin住或正在进行I/O时，
+ * 改为调用find_victim_page从共享的free_list或replacer中获取，并将得到的帧记录到环中
+ * @return {bool} true: 可替换帧查找成功 , false: 可替换帧查找失败
+ * @param {BufferPoolShard&} shard 查找的分片
+ * @param {unique_lock<mutex>&} lock 持有的分片latch，写回脏页时会暂时释放
+ * @param {BufferAccessStrategy*} strategy 访问策略，为nullptr时等同于find_victim_page
+ * @param {frame_id_t*} frame_id 帧页id指针,返回成功找到的可替换帧id（分片内编号）
+ */
+bool BufferPoolManager::find_victim_page(BufferPoolShard &shard, std::unique_lock<std::mutex> &lock,
+                                         BufferAccessStrategy *strategy, frame_id_t *frame_id) {
+    if (strategy == nullptr) {
+        return find_victim_page(shard, lock, frame_id);
+    }
+    if (strategy->rings_.empty()) {
+        // 首次使用时为每个分片分配一个环
+        size_t ring_size = std::max<size_t>((strategy->ring_size_ + shards_.size() - 1) / shards_.size(), 1);
+        strategy->rings_.assign(shards_.size(), std::vector<frame_id_t>(ring_size, INVALID_FRAME_ID));
+        strategy->cursors_.assign(shards_.size(), 0);
+    }
+    size_t shard_no = &shard - shards_.data();
+    auto &ring = strategy->rings_[shard_no];
+    auto &cursor = strategy->cursors_[shard_no];
+    cursor = cursor + 1 == ring.size() ? 0 : cursor + 1;
+
+    frame_id_t slot = ring[cursor];
+    if (slot != INVALID_FRAME_ID) {
+        Page *page = &shard.pages[slot];
+        // 帧仍然缓存着页面且没有被使用，说明它在replacer中，可以直接取出复用
+        if (page->pin_count_ == 0 && page->io_state_ == FrameIoState::READY &&
+            shard.page_table.find(page->key_) == slot) {
+            shard.replacer->pin(slot);
+            if (write_back_victim(shard, lock, slot)) {
+                *frame_id = slot;
+                strategy->num_reused_++;
+                return true;
+            }
+        }
+    }
+    if (!find_victim_page(shard, lock, frame_id)) {
+        return false;
+    }
+    ring[cursor] = *frame_id;
+    return true;
+}
+
+/**
+ * @description: 准备淘汰一个刚从replacer中取出的帧，调用者需持有分片的latch。
+ * 如果帧中是脏页，则在释放latch的情况下将其写回磁盘，写回期间旧页面仍然可以被其他线程命中。
+ * @return {bool} true: 帧可以使用，已经从replacer中移除；false: 帧又被使用或被其他线程取走了，需要放弃这一帧
+ * @param {BufferPoolShard&} shard 帧所在的分片
+ * @param {unique_lock<mutex>&} lock 持有的分片latch
+ * @param {frame_id_t} frame_id 帧id（分片内编号）
+ */
+bool BufferPoolManager::write_back_victim(BufferPoolShard &shard, std::unique_lock<std::mutex> &lock,
+                                          frame_id_t frame_id) {
+    Page *page = &shard.pages[frame_id];
+    // 后台写线程或另一个淘汰者正在写回这一帧，等待写回结束后重新判断
+    wait_io(shard, lock, frame_id);
+    while (page->is_dirty_ && page->pin_count_ == 0) {
+        shard.replacer->pin(frame_id);
+        // 先清除脏标记，写回期间页面再次被修改时可以发现
+        auto page_id = page->id_;
+        page->is_dirty_ = false;
+        page->io_state_ = FrameIoState::WRITING_BACK;
+        lock.unlock();
+        try {
+            disk_manager_->write_page(page_id.fd, page_id.page_no, page->get_data(), page_size_);
+        } catch (...) {
+            lock.lock();
+            page->is_dirty_ = true;
+            page->io_state_ = FrameIoState::READY;
+            shard.io_done[frame_id].notify_all();
+            if (page->pin_count_ == 0) {
+                shard.replacer->unpin(frame_id);
+            }
+            throw;
+        }
+        lock.lock();
+        num_foreground_writes_++;
+        page->io_state_ = FrameIoState::READY;
+        remove_dirty_frame(shard, frame_id);
+        shard.io_done[frame_id].notify_all();
+        if (!(page->id_ == page_id)) {
+            // 写回期间页面被delete_page删除，帧已经回到free_list
+            return false;
+        }
+    }
+    // 等待期间帧可能被其他线程取走，或者被删除后回到了free_list
+    if (page->pin_count_ != 0 || page->io_state_ != FrameIoState::READY ||
+        shard.page_table.find(page->key_) != frame_id) {
+        return false;
+    }
+    // 写回期间页面可能被pin后又unpin，重新回到了replacer中
+    shard.replacer->pin(frame_id);
+    return true;
+}
+
+/**
+ * @description: 归还find_victim_page得到但没有使用的帧，调用者需持有分片的latch
+ * @param {BufferPoolShard&} shard 帧所在的分片
+ * @param {frame_id_t} frame_id 帧id（分片内编号）
+ */
+void BufferPoolManager::return_victim_page(BufferPoolShard &shard, frame_id_t frame_id) {
+    if (shard.page_table.find(shard.pages[frame_id].key_) == frame_id) {
+        // 帧中仍然缓存着旧页面，重新允许其被淘汰
+        shard.replacer->unpin(frame_id);
     } else {
-        *frame_id = free_list_.front();
-        free_list_.pop_front();
-        return true;
+        shard.free_list.push_back(frame_id);
     }
 }
 
 /**
- * @description: 更新页面数据, 如果为脏页则需写入磁盘，再更新为新页面，更新page元数据(data, is_dirty, page_id)和page
- * table
- * @param {Page*} page 写回页指针
+ * @description: 将帧更新为新页面，更新page元数据(is_dirty, page_id)和page table，调用者需持有分片的latch。
+ * 帧中的旧页面已经由find_victim_page写回磁盘
+ * @param {BufferPoolShard&} shard 页面所在的分片
+ * @param {Page*} page 帧对应的页指针
  * @param {PageId} new_page_id 新的page_id
- * @param {frame_id_t} new_frame_id 新的帧frame_id
+ * @param {frame_id_t} new_frame_id 新的帧frame_id（分片内编号）
  */
-void BufferPoolManager::update_page(Page *page, PageId new_page_id, frame_id_t new_frame_id) {
+void BufferPoolManager::update_page(BufferPoolShard &shard, Page *page, PageId new_page_id, frame_id_t new_frame_id) {
     // Todo:
-    // 1 如果是脏页，写回磁盘，并且把dirty置为false
-    // 2 更新page table
-    // 3 重置page的data，更新page id
-    auto page_id = page->get_page_id();
-    if (page->is_dirty()) {
-        disk_manager_->write_page(page_id.fd, page_id.page_no, page->get_data(), PAGE_SIZE);
-        page->is_dirty_ = false;
+    // 1 更新page table
+    // 2 重置page的data，更新page id
+    if (shard.page_table.find(page->key_) == new_frame_id) {
+        shard.page_table.erase(page->key_);
     }
-    page_table_.erase(page_id);
 
-    page_table_[new_page_id] = new_frame_id;
+    page_key_t new_key = get_page_key(new_page_id);
+    shard.page_table.insert(new_key, new_frame_id);
 
-    Page *ptr = &pages_[new_frame_id];
+    Page *ptr = &shard.pages[new_frame_id];
     ptr->is_dirty_ = false;
     //    disk_manager_->read_page(new_page_id.fd, new_page_id.page_no, ptr->data_, PAGE_SIZE);
     ptr->id_ = new_page_id;
+    ptr->key_ = new_key;
+    // 新页面不继承帧中旧页面的访问历史
+    shard.replacer->reset(new_frame_id);
+}
+
+/**
+ * @description: 等待帧上进行中的I/O完成，调用者需持有分片的latch，等待期间latch被释放
+ * @param {BufferPoolShard&} shard 帧所在的分片
+ * @param {unique_lock<mutex>&} lock 持有的分片latch
+ * @param {frame_id_t} frame_id 帧id（分片内编号）
+ */
+void BufferPoolManager::wait_io(BufferPoolShard &shard, std::unique_lock<std::mutex> &lock, frame_id_t frame_id) {
+    Page *page = &shard.pages[frame_id];
+    shard.io_done[frame_id].wait(lock, [page] { return page->io_state_ == FrameIoState::READY; });
 }
 
 /**
@@ -63,35 +250,89 @@ void BufferPoolManager::update_page(Page *page, PageId new_page_id, frame_id_t n
  *              如果页表中存在page_id（说明该page在缓冲池中），并且pin_count++。
  *              如果页表不存在page_id（说明该page在磁盘中），则找缓冲池victim
  * page，将其替换为磁盘中读取的page，pin_count置1。
+ *              磁盘读写时不持有分片的latch，请求同一页面的其他线程只等待这一帧的I/O完成。
  * @return {Page*} 若获得了需要的页则将其返回，否则返回nullptr
  * @param {PageId} page_id 需要获取的页的PageId
  */
 Page *BufferPoolManager::fetch_page(PageId page_id) {
+    return fetch_page(page_id, nullptr);
+}
+
+/**
+ * @description: 按照访问策略从buffer pool获取需要的页，未命中时优先复用策略的环中的帧，其余与fetch_page(PageId)相同
+ * @return {Page*} 若获得了需要的页则将其返回，否则返回nullptr
+ * @param {PageId} page_id 需要获取的页的PageId
+ * @param {BufferAccessStrategy*} strategy 访问策略，为nullptr时使用共享的replacer
+ */
+Page *BufferPoolManager::fetch_page(PageId page_id, BufferAccessStrategy *strategy) {
     // Todo:
     // 1.     从page_table_中搜寻目标页
-    // 1.1    若目标页有被page_table_记录，则将其所在frame固定(pin)，并返回目标页。
+    // 1.1    若目标页有被page_table_记录，则将其所在frame固定(pin)，若正在读入则等待读入完成，返回目标页。
     // 1.2    否则，尝试调用find_victim_page获得一个可用的frame，若失败则返回nullptr
-    // 2.     若获得的可用frame存储的为dirty page，则须调用updata_page将page写回到磁盘
-    // 3.     调用disk_manager_的read_page读取目标页到frame
+    // 2.     若获得的可用frame存储的为dirty page，find_victim_page会在锁外将其写回磁盘
+    // 3.     将frame标记为LOADING，在锁外调用disk_manager_的read_page读取目标页到frame
     // 4.     固定目标页，更新pin_count_
     // 5.     返回目标页
-    std::scoped_lock lock{latch_};
-    if (page_table_.find(page_id) != page_table_.end()) { // 在buffer pool中
-        Page *p = &pages_[page_table_[page_id]];
-        // pin_cout_ == 0时此页还能留在buffer_pool中，可能已经unpinned，确保已经pin
-        replacer_->pin(page_table_[page_id]);
-        p->pin_count_++;
-        return p;
-    }
-    frame_id_t victim;
-    if (!find_victim_page(&victim)) {
-        return nullptr; // 没有可淘汰页或空闲页，无法加载到buffer pool中
+    page_key_t key = get_page_key(page_id);
+    auto &shard = get_shard(key);
+    std::unique_lock lock{shard.latch};
+    while (true) {
+        frame_id_t frame_id = shard.page_table.find(key);
+        if (frame_id != INVALID_FRAME_ID) { // 在buffer pool中
+            Page *p = &shard.pages[frame_id];
+            // pin_cout_ == 0时此页还能留在buffer_pool中，可能已经unpinned，确保已经pin
+            shard.replacer->pin(frame_id);
+            p->pin_count_++;
+            if (p->io_state_ == FrameIoState::LOADING) {
+                shard.io_done[frame_id].wait(lock, [p] { return p->io_state_ != FrameIoState::LOADING; });
+                if (p->key_ != key) {
+                    // 读入失败，帧已经从页表中移除，由最后一个使用者归还到free_list
+                    if (--p->pin_count_ == 0) {
+                        shard.free_list.push_back(frame_id);
+                    }
+                    continue;
+                }
+            }
+            if (p->id_.fd != page_id.fd) {
+                rebind_page_fd(shard, lock, frame_id, page_id.fd);
+            }
+            return p;
+        }
+        frame_id_t victim;
+        if (!find_victim_page(shard, lock, strategy, &victim)) {
+            return nullptr; // 没有可淘汰页或空闲页，无法加载到buffer pool中
+        }
+        if (shard.page_table.find(key) != INVALID_FRAME_ID) {
+            // 写回脏页期间其他线程已经读入了目标页
+            return_victim_page(shard, victim);
+            continue;
+        }
+        Page *page = &shard.pages[victim];
+        update_page(shard, page, page_id, victim);
+        page->pin_count_ = 1;
+        page->io_state_ = FrameIoState::LOADING;
+        shard.replacer->pin(victim); // 该页首次pin
+        lock.unlock();
+        read_ahead(page_id);
+        try {
+            disk_manager_->read_page(page_id.fd, page_id.page_no, page->get_data(), page_size_);
+        } catch (...) {
+            lock.lock();
+            shard.page_table.erase(key);
+            page->id_ = PageId{-1, INVALID_PAGE_ID};
+            page->key_ = 0;
+            page->io_state_ = FrameIoState::READY;
+            if (--page->pin_count_ == 0) {
+                shard.free_list.push_back(victim);
+            }
+            shard.io_done[victim].notify_all();
+            throw;
+        }
+        lock.lock();
+        page->io_state_ = FrameIoState::READY;
+        shard.io_done[victim].notify_all();
+        return page;
     }
-    update_page(&pages_[victim], page_id, victim);
-    disk_manager_->read_page(page_id.fd, page_id.page_no, pages_[victim].get_data(), PAGE_SIZE);
-    pages_[victim].pin_count_ = 1;
-    replacer_->pin(victim); // 该页首次pin
-    return &pages_[victim];
 }
 
 /**
@@ -110,11 +351,14 @@ bool BufferPoolManager::unpin_page(PageId page_id, bool is_dirty) {
     // 2.2 若pin_count_大于0，则pin_count_自减一
     // 2.2.1 若自减后等于0，则调用replacer_的Unpin
     // 3 根据参数is_dirty，更改P的is_dirty_
-    std::scoped_lock lock{latch_};
-    if (page_table_.find(page_id) == page_table_.end()) {
+    page_key_t key = get_page_key(page_id);
+    auto &shard = get_shard(key);
+    std::scoped_lock lock{shard.latch};
+    frame_id_t frame_id = shard.page_table.find(key);
+    if (frame_id == INVALID_FRAME_ID) {
         return false;
     }
-    Page *p = &pages_[page_table_[page_id]];
+    Page *p = &shard.pages[frame_id];
     bool retval = p->pin_count_ > 0;
     if (p->pin_count_ == 0) {
         return false;
@@ -122,10 +366,10 @@ bool BufferPoolManager::unpin_page(PageId page_id, bool is_dirty) {
         p->pin_count_--;
     }
     if (p->pin_count_ == 0) {
-        replacer_->unpin(page_table_[page_id]);
+        shard.replacer->unpin(frame_id);
     }
     if (is_dirty) {
-        p->is_dirty_ = true; // 避免`p->is_dirty_`被`false`覆盖
+        add_dirty_frame(shard, frame_id); // 避免`p->is_dirty_`被`false`覆盖
     }
     return retval;
 }
@@ -142,14 +386,22 @@ bool BufferPoolManager::flush_page(PageId page_id) {
     // 1.1 目标页P没有被page_table_记录 ，返回false
     // 2. 无论P是否为脏都将其写回磁盘。
     // 3. 更新P的is_dirty_
-    std::scoped_lock lock{latch_};
-    auto it = page_table_.find(page_id);
-    if (it == page_table_.end()) {
+    page_key_t key = get_page_key(page_id);
+    auto &shard = get_shard(key);
+    std::unique_lock lock{shard.latch};
+    frame_id_t frame_id = shard.page_table.find(key);
+    while (frame_id != INVALID_FRAME_ID && shard.pages[frame_id].io_state_ != FrameIoState::READY) {
+        wait_io(shard, lock, frame_id);
+        frame_id = shard.page_table.find(key);
+    }
+    if (frame_id == INVALID_FRAME_ID) {
         return false;
     }
-    Page *p = &pages_[it->second];
-    disk_manager_->write_page(page_id.fd, page_id.page_no, p->data_, PAGE_SIZE);
+    Page *p = &shard.pages[frame_id];
+    disk_manager_->write_page(page_id.fd, page_id.page_no, p->data_, page_size_);
+    num_flush_writes_++;
     p->is_dirty_ = false;
+    remove_dirty_frame(shard, frame_id);
     return true;
 }
 
@@ -157,23 +409,42 @@ bool BufferPoolManager::flush_page(PageId page_id) {
  * @description: 创建一个新的page，即从磁盘中移动一个新建的空page到缓冲池某个位置。
  * @return {Page*} 返回新创建的page，若创建失败则返回nullptr
  * @param {PageId*} page_id 当成功创建一个新的page时存储其page_id
+ * @note 页面所在的分片由页号决定，因此需要先分配页号再获取帧
  */
 Page *BufferPoolManager::new_page(PageId *page_id) {
-    // 1.   获得一个可用的frame，若无法获得则返回nullptr
-    // 2.   在fd对应的文件分配一个新的page_id
+    return new_page(page_id, nullptr);
+}
+
+/**
+ * @description: 按照访问策略创建一个新的page，获取帧时优先复用策略的环中的帧，其余与new_page(PageId*)相同
+ * @return {Page*} 返回新创建的page，若创建失败则返回nullptr
+ * @param {PageId*} page_id 当成功创建一个新的page时存储其page_id
+ * @param {BufferAccessStrategy*} strategy 访问策略，为nullptr时使用共享的replacer
+ */
+Page *BufferPoolManager::new_page(PageId *page_id, BufferAccessStrategy *strategy) {
+    // 1.   在fd对应的文件分配一个新的page_id
+    // 2.   获得页面所在分片中一个可用的frame，若无法获得则返回nullptr
     // 3.   将frame的数据写回磁盘
     // 4.   固定frame，更新pin_count_
     // 5.   返回获得的page
-    std::scoped_lock lock{latch_};
+    page_id->page_no = disk_manager_->allocate_page(page_id->fd);
+    auto &shard = get_shard(get_page_key(*page_id));
+    std::unique_lock lock{shard.latch};
     frame_id_t victim;
-    if (!find_victim_page(&victim)) {
+    if (!find_victim_page(shard, lock, strategy, &victim)) {
+        // 没有可用的帧，归还已经分配的页面
+        lock.unlock();
+        disk_manager_->deallocate_page(page_id->fd, page_id->page_no);
         return nullptr;
     }
-    page_id->page_no = disk_manager_->allocate_page(page_id->fd);
-    update_page(&pages_[victim], *page_id, victim);
-    replacer_->pin(victim);
-    pages_[victim].pin_count_ = 1;
-    return &pages_[victim];
+    update_page(shard, &shard.pages[victim], *page_id, victim);
+    // 复用的帧中还是被淘汰页面的数据，新页面与文件中新分配的空间一样全为0。
+    // 新页面还没有写入文件，即使调用者没有修改也是脏页
+    shard.pages[victim].reset_memory(page_size_);
+    add_dirty_frame(shard, victim);
+    shard.replacer->pin(victim);
+    shard.pages[victim].pin_count_ = 1;
+    return &shard.pages[victim];
 }
 
 /**
@@ -186,35 +457,361 @@ bool BufferPoolManager::delete_page(PageId page_id) {
     // 2.   若目标页的pin_count不为0，则返回false
     // 3.   将目标页数据写回磁盘，从页表中删除目标页，重置其元数据，将其加入free_list_，返回true
 
-    std::scoped_lock lock{latch_};
-    auto it = page_table_.find(page_id);
-    if (it == page_table_.end()) {
+    page_key_t key = get_page_key(page_id);
+    auto &shard = get_shard(key);
+    std::unique_lock lock{shard.latch};
+    frame_id_t frame_id = shard.page_table.find(key);
+    while (frame_id != INVALID_FRAME_ID && shard.pages[frame_id].io_state_ != FrameIoState::READY) {
+        wait_io(shard, lock, frame_id);
+        frame_id = shard.page_table.find(key);
+    }
+    if (frame_id == INVALID_FRAME_ID) {
         return true;
     }
-    if (pages_[it->second].pin_count_ != 0) {
+    if (shard.pages[frame_id].pin_count_ != 0) {
         return false;
     }
-    Page *page = &pages_[it->second];
+    Page *page = &shard.pages[frame_id];
     if (page->is_dirty_) {
-        disk_manager_->write_page(page_id.fd, page_id.page_no, page->data_, PAGE_SIZE);
-        //        page->is_dirty_ = false;  // no need
+        disk_manager_->write_page(page_id.fd, page_id.page_no, page->data_, page_size_);
+        num_flush_writes_++;
+        page->is_dirty_ = false;
+        remove_dirty_frame(shard, frame_id);
     }
-    memset(page, 0, sizeof(Page)); // 填充零
-    free_list_.push_back(it->second);
-    page_table_.erase(it);
+    // 重置帧的元数据和页面数据，data_指向的帧内存不变
+    page->reset_memory(page_size_);
+    page->id_ = PageId{0, 0};
+    page->key_ = 0;
+    // 帧回到free_list后不能再被replacer选为victim
+    shard.replacer->pin(frame_id);
+    shard.free_list.push_back(frame_id);
+    shard.page_table.erase(key);
     return true;
 }
 
 /**
- * @description: 将buffer_pool中的所有页写回到磁盘
+ * @description: 将buffer_pool中文件fd的所有脏页写回到磁盘。只检查记录在各分片dirty_frames中的帧，
+ * 代价与脏页个数成正比而与缓冲池大小无关；脏页按页面编号排序，连续的页面合并为一次pwritev
  * @param {int} fd 文件句柄
  */
 void BufferPoolManager::flush_all_pages(int fd) {
-    std::scoped_lock lock{latch_};
-    for (frame_id_t i = 0; i < pool_size_; i++) {
-        auto page_id = pages_[i].get_page_id();
-        if (page_id.fd == fd) {
-            disk_manager_->write_page(fd, page_id.page_no, pages_[i].data_, PAGE_SIZE);
+    {
+        // 文件关闭后fd可能被复用，丢弃这个文件的预读状态
+        std::scoped_lock lock{read_ahead_latch_};
+        read_ahead_.erase(fd);
+    }
+    // 1. 在各分片中取出文件的脏帧，标记为WRITING_BACK，写回期间不持有latch，帧不会被淘汰或删除
+    struct FlushEntry {
+        page_id_t page_no;
+        BufferPoolShard *shard;
+        frame_id_t frame_id;
+    };
+    std::vector<FlushEntry> entries;
+    for (auto &shard : shards_) {
+        std::unique_lock lock{shard.latch};
+        auto it = shard.dirty_frames.find(fd);
+        if (it == shard.dirty_frames.end()) {
+            continue;
+        }
+        std::vector<frame_id_t> frames(it->second.begin(), it->second.end());
+        for (frame_id_t frame_id : frames) {
+            // 正在写回的页面需要等待写回结束，否则关闭文件时可能仍有写操作
+            wait_io(shard, lock, frame_id);
+            Page *page = &shard.pages[frame_id];
+            if (!page->is_dirty_ || page->id_.fd != fd) {
+                continue;
+            }
+            page->is_dirty_ = false;
+            page->io_state_ = FrameIoState::WRITING_BACK;
+            entries.push_back({page->id_.page_no, &shard, frame_id});
+        }
+    }
+    // 2. 按页面编号排序，每一段连续的页面用一次pwritev写回
+    std::sort(entries.begin(), entries.end(),
+              [](const FlushEntry &x, const FlushEntry &y) { return x.page_no < y.page_no; });
+    std::vector<char *> bufs;
+    size_t num_written = 0;
+    std::exception_ptr error;
+    try {
+        while (num_written < entries.size()) {
+            size_t end = num_written + 1;
+            while (end < entries.size() && end - num_written < IOV_MAX &&
+                   entries[end].page_no == entries[end - 1].page_no + 1) {
+                end++;
+            }
+            bufs.clear();
+            for (size_t i = num_written; i < end; i++) {
+                bufs.push_back(entries[i].shard->pages[entries[i].frame_id].get_data());
+            }
+            disk_manager_->write_pages(fd, entries[num_written].page_no, bufs.data(), bufs.size());
+            num_flush_writes_ += end - num_written;
+            num_flush_batches_++;
+            num_written = end;
+        }
+    } catch (...) {
+        error = std::current_exception();
+    }
+    // 3. 恢复帧的状态，没有写回的页面仍是脏页
+    for (size_t i = 0; i < entries.size(); i++) {
+        auto &shard = *entries[i].shard;
+        std::scoped_lock lock{shard.latch};
+        Page *page = &shard.pages[entries[i].frame_id];
+        if (i < num_written) {
+            remove_dirty_frame(shard, entries[i].frame_id);
+        } else {
+            page->is_dirty_ = true;
+        }
+        page->io_state_ = FrameIoState::READY;
+        shard.io_done[entries[i].frame_id].notify_all();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+/**
+ * @description: 标记帧中的页面为脏页，并记录到所在文件的脏帧集合中，调用者需持有分片的latch
+ * @param {BufferPoolShard&} shard 帧所在的分片
+ * @param {frame_id_t} frame_id 帧id（分片内编号）
+ */
+void BufferPoolManager::add_dirty_frame(BufferPoolShard &shard, frame_id_t frame_id) {
+    Page *page = &shard.pages[frame_id];
+    page->is_dirty_ = true;
+    shard.dirty_frames[page->id_.fd].insert(frame_id);
+}
+
+/**
+ * @description: 页面写回磁盘后，若写回期间没有被再次修改，则从所在文件的脏帧集合中移除，调用者需持有分片的latch
+ * @param {BufferPoolShard&} shard 帧所在的分片
+ * @param {frame_id_t} frame_id 帧id（分片内编号）
+ */
+void BufferPoolManager::remove_dirty_frame(BufferPoolShard &shard, frame_id_t frame_id) {
+    Page *page = &shard.pages[frame_id];
+    if (page->is_dirty_) {
+        return;
+    }
+    auto it = shard.dirty_frames.find(page->id_.fd);
+    if (it != shard.dirty_frames.end()) {
+        it->second.erase(frame_id);
+        if (it->second.empty()) {
+            shard.dirty_frames.erase(it);
+        }
+    }
+}
+
+/**
+ * @description: 文件关闭后重新打开时文件编号不变，缓冲池中留下的页面仍然命中，但帧中记录的还是关闭前的fd，
+ * 这个fd可能已经分配给了其他文件。命中时换成调用者的fd，之后的写回、flush_all_pages和unpin都使用新的fd。
+ * 调用者需持有分片的latch并已经pin住帧
+ * @param {BufferPoolShard&} shard 帧所在的分片
+ * @param {unique_lock<mutex>&} lock 分片的latch，等待写回结束时释放
+ * @param {frame_id_t} frame_id 帧id（分片内编号）
+ * @param {int} fd 文件现在的句柄
+ */
+void BufferPoolManager::rebind_page_fd(BufferPoolShard &shard, std::unique_lock<std::mutex> &lock,
+                                       frame_id_t frame_id, int fd) {
+    // 关闭文件前已经写回了所有脏页，这里只是防御：仍是脏页时把它移到新fd的脏帧集合中
+    wait_io(shard, lock, frame_id);
+    Page *page = &shard.pages[frame_id];
+    if (page->id_.fd == fd) {
+        return;
+    }
+    bool is_dirty = page->is_dirty_;
+    page->is_dirty_ = false;
+    remove_dirty_frame(shard, frame_id);
+    page->id_.fd = fd;
+    if (is_dirty) {
+        add_dirty_frame(shard, frame_id);
+    }
+}
+
+/**
+ * @description: 启动后台写线程，每隔delay_ms毫秒执行一轮background_write_round
+ * @param {int} delay_ms 两轮之间的间隔
+ * @param {size_t} max_pages 每一轮最多写回的页面数，限制后台写线程的I/O速率
+ * @param {size_t} clean_target 希望在replacer的淘汰位置之前保持的干净帧的个数，在分片间平均分配
+ */
+void BufferPoolManager::start_background_writer(int delay_ms, size_t max_pages, size_t clean_target) {
+    stop_background_writer();
+    bg_writer_stop_ = false;
+    bg_writer_ = std::thread([this, delay_ms, max_pages, clean_target]() {
+        std::unique_lock lock{bg_writer_latch_};
+        while (!bg_writer_cv_.wait_for(lock, std::chrono::milliseconds(delay_ms), [this] { return bg_writer_stop_; })) {
+            lock.unlock();
+            background_write_round(max_pages, clean_target);
+            lock.lock();
+        }
+    });
+}
+
+/**
+ * @description: 停止后台写线程，等待正在进行的一轮结束
+ */
+void BufferPoolManager::stop_background_writer() {
+    if (!bg_writer_.joinable()) {
+        return;
+    }
+    {
+        std::scoped_lock lock{bg_writer_latch_};
+        bg_writer_stop_ = true;
+    }
+    bg_writer_cv_.notify_all();
+    bg_writer_.join();
+}
+
+/**
+ * @description: 后台写线程的一轮：检查每个分片中replacer接下来要淘汰的帧，提前将其中未被pin的脏页写回磁盘，
+ * 使查询线程淘汰页面时几乎不需要等待写磁盘。一个分片中要写回的页面通过IoContext一起提交，同时进行写回；
+ * 写回期间不持有分片的latch，帧仍然留在replacer中，此时被选为victim的帧会在write_back_victim中等待写回结束。
+ * 同一时刻只能有一个线程执行background_write_round
+ * @return {size_t} 本轮写回的页面数
+ * @param {size_t} max_pages 本轮最多写回的页面数
+ * @param {size_t} clean_target 希望在replacer的淘汰位置之前保持的干净帧（包括空闲帧）的个数
+ */
+size_t BufferPoolManager::background_write_round(size_t max_pages, size_t clean_target) {
+    if (bg_writer_io_ == nullptr) {
+        bg_writer_io_ = disk_manager_->create_io_context();
+    }
+    size_t shard_target = (clean_target + shards_.size() - 1) / shards_.size();
+    size_t num_written = 0;
+    std::vector<frame_id_t> candidates(shard_target);
+    std::vector<IoRequest> requests;
+    std::vector<IoRequest *> async_requests;
+    std::vector<IoRequest *> submitted;
+    std::vector<IoRequest *> completed(bg_writer_io_->get_depth());
+    size_t first_shard = bg_writer_next_shard_++ % shards_.size();
+    for (size_t i = 0; i < shards_.size() && num_written < max_pages; i++) {
+        auto &shard = shards_[(first_shard + i) % shards_.size()];
+        std::unique_lock lock{shard.latch};
+        if (shard.free_list.size() >= shard_target) {
+            continue;
+        }
+        size_t num = shard.replacer->candidates(candidates.data(), shard_target - shard.free_list.size());
+        requests.clear();
+        for (size_t j = 0; j < num && num_written + requests.size() < max_pages; j++) {
+            frame_id_t frame_id = candidates[j];
+            Page *page = &shard.pages[frame_id];
+            if (!page->is_dirty_ || page->pin_count_ != 0 || page->io_state_ != FrameIoState::READY) {
+                continue;
+            }
+            page->is_dirty_ = false;
+            page->io_state_ = FrameIoState::WRITING_BACK;
+            // 完成前result保持为失败，提交出错时没有提交的请求按写回失败处理
+            requests.push_back({IoOpType::WRITE, page->id_.fd, page->id_.page_no, page->get_data(), page_size_,
+                                reinterpret_cast<void *>(static_cast<intptr_t>(frame_id)), -EIO});
+        }
+        if (requests.empty()) {
+            continue;
+        }
+        lock.unlock();
+        // 压缩文件的页面写入位置在压缩之后才确定，由DiskManager同步写入，其余的请求异步提交
+        async_requests.clear();
+        for (auto &request : requests) {
+            if (!disk_manager_->is_compressed_file(request.fd)) {
+                async_requests.push_back(&request);
+                continue;
+            }
+            try {
+                disk_manager_->write_page(request.fd, request.page_no, request.buf, request.num_bytes);
+                request.result = request.num_bytes;
+            } catch (...) {
+                // result保持为失败，与异步写失败一样保留脏页
+            }
+        }
+        // 保持队列中有尽量多的写请求，完成一个补充一个
+        size_t depth = bg_writer_io_->get_depth();
+        size_t next = 0;
+        try {
+            while (next < async_requests.size() || bg_writer_io_->get_num_in_flight() > 0) {
+                submitted.clear();
+                while (next < async_requests.size() && bg_writer_io_->get_num_in_flight() + submitted.size() < depth) {
+                    submitted.push_back(async_requests[next++]);
+                }
+                bg_writer_io_->submit(submitted.data(), submitted.size());
+                bg_writer_io_->wait(completed.data(), completed.size(), 1);
+            }
+        } catch (...) {
+            // 恢复帧的状态之前必须等待已经提交的请求完成
+            while (bg_writer_io_->get_num_in_flight() > 0) {
+                bg_writer_io_->wait(completed.data(), completed.size(), bg_writer_io_->get_num_in_flight());
+            }
+        }
+        lock.lock();
+        for (auto &request : requests) {
+            frame_id_t frame_id = static_cast<frame_id_t>(reinterpret_cast<intptr_t>(request.user_data));
+            Page *page = &shard.pages[frame_id];
+            if (request.result == request.num_bytes) {
+                num_written++;
+                num_background_writes_++;
+                remove_dirty_frame(shard, frame_id);
+            } else {
+                // 后台写失败时保留脏页，由淘汰或flush时在前台重试并报告错误
+                page->is_dirty_ = true;
+            }
+            page->io_state_ = FrameIoState::READY;
+            shard.io_done[frame_id].notify_all();
         }
     }
-}
\ No newline at end of file
+    return num_written;
+}
+
+/**
+ * @description: 在未命中时检测文件上的顺序访问。连续READ_AHEAD_TRIGGER次未命中都落在上一次未命中之后的
+ * read_ahead_pages_个页面以内时，认为正在顺序扫描，预读之后的read_ahead_pages_个页面；
+ * 已预读而还未访问的页面不足一半时再把预读窗口向后推进
+ * @param {PageId} page_id 未命中的页面
+ */
+void BufferPoolManager::read_ahead(PageId page_id) {
+    if (read_ahead_pages_ == 0) {
+        return;
+    }
+    page_id_t start;
+    page_id_t end;
+    {
+        std::scoped_lock lock{read_ahead_latch_};
+        auto &state = read_ahead_[page_id.fd];
+        if (state.last_page_no != INVALID_PAGE_ID && page_id.page_no > state.last_page_no &&
+            page_id.page_no <= state.last_page_no + read_ahead_pages_) {
+            state.num_sequential++;
+        } else {
+            state.num_sequential = 1;
+            state.window_end = page_id.page_no + 1;
+        }
+        state.last_page_no = page_id.page_no;
+        if (state.num_sequential < READ_AHEAD_TRIGGER ||
+            state.window_end - page_id.page_no - 1 > read_ahead_pages_ / 2) {
+            return;
+        }
+        start = std::max(state.window_end, page_id.page_no + 1);
+        end = std::min(page_id.page_no + 1 + read_ahead_pages_, disk_manager_->get_fd2pageno(page_id.fd));
+        if (start >= end) {
+            return;
+        }
+        state.window_end = end;
+    }
+    disk_manager_->prefetch_pages(page_id.fd, start, end - start);
+    num_prefetched_pages_ += end - start;
+}
+
+/**
+ * @description: 上层（如顺序扫描）告知将从start_page_no开始顺序读取文件，立即预读，不必等待检测到顺序访问
+ * @param {int} fd 文件句柄
+ * @param {page_id_t} start_page_no 将要读取的第一个页面编号
+ */
+void BufferPoolManager::hint_sequential(int fd, page_id_t start_page_no) {
+    if (read_ahead_pages_ == 0) {
+        return;
+    }
+    page_id_t end = std::min(start_page_no + read_ahead_pages_, disk_manager_->get_fd2pageno(fd));
+    {
+        std::scoped_lock lock{read_ahead_latch_};
+        auto &state = read_ahead_[fd];
+        state.last_page_no = start_page_no - 1;
+        state.num_sequential = READ_AHEAD_TRIGGER;
+        state.window_end = std::max(end, start_page_no);
+    }
+    if (start_page_no < end) {
+        disk_manager_->prefetch_pages(fd, start_page_no, end - start_page_no);
+        num_prefetched_pages_ += end - start_page_no;
+    }
+}
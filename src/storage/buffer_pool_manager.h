@@ -12,75 +12,257 @@ See the Mulan PSL v2 for more details. */
 #include <fcntl.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
 #include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include "buffer_access_strategy.h"
 #include "disk_manager.h"
 #include "errors.h"
 #include "page.h"
+#include "page_table.h"
+#include "replacer/array_lru_replacer.h"
+#include "replacer/clock_replacer.h"
 #include "replacer/lru_replacer.h"
 #include "replacer/replacer.h"
+#include "replacer/two_queue_replacer.h"
+
+/**
+ * @description: 缓冲池写回磁盘的页面数统计
+ */
+struct BufferPoolWriteStats {
+    uint64_t background_writes; // 后台写线程写回的页面数
+    uint64_t foreground_writes; // 查询线程淘汰脏页时写回的页面数
+    uint64_t flush_writes;      // flush_page、flush_all_pages、delete_page写回的页面数
+    uint64_t flush_batches;     // flush_all_pages合并连续页面后调用pwritev的次数
+};
 
 class BufferPoolManager {
   private:
+    /**
+     * @description: 缓冲池的一个分片。页面根据PageId的哈希值映射到固定的分片，
+     * 每个分片拥有独立的帧、页表、空闲链表、置换器和锁，不同分片上的操作互不阻塞
+     */
+    struct BufferPoolShard {
+        Page *pages = nullptr; // 分片管理的帧，是pages_中连续的一段
+        size_t size = 0;       // 分片中帧的个数
+        PageTable page_table;               // 页面键到分片内帧号的映射，帧号范围为[0,size)
+        std::list<frame_id_t> free_list;    // 分片内空闲帧编号的链表
+        std::unique_ptr<Replacer> replacer; // 分片的置换策略
+        std::mutex latch;                   // 用于分片内数据结构的并发控制
+        std::vector<std::condition_variable>
+            io_done; // 每一帧一个条件变量，帧的I/O完成时唤醒等待这一帧的线程
+        std::unordered_map<int, std::unordered_set<frame_id_t>>
+            dirty_frames; // 文件句柄到分片内脏帧（包括正在写回的帧）的映射，flush_all_pages只需检查这些帧
+    };
+
+    /**
+     * @description: 一个文件上的顺序预读状态，根据这个文件上连续的未命中判断是否在顺序扫描
+     */
+    struct ReadAheadState {
+        page_id_t last_page_no = INVALID_PAGE_ID; // 上一次未命中的页面编号
+        page_id_t window_end = 0;                 // 已经预读到的页面编号（不含）
+        int num_sequential = 0;                   // 连续顺序未命中的次数
+    };
+
     size_t pool_size_; // buffer_pool中可容纳页面的个数，即帧的个数
     Page *pages_; // buffer_pool中的Page对象数组，在构造空间中申请内存空间，在析构函数中释放，大小为BUFFER_POOL_SIZE
-    std::unordered_map<PageId, frame_id_t, PageIdHash>
-        page_table_; // 帧号和页面号的映射哈希表，用于根据页面的PageId定位该页面的帧编号
-    std::list<frame_id_t> free_list_; // 空闲帧编号的链表
+    std::vector<BufferPoolShard> shards_; // 缓冲池分片，帧按分片平均划分
     DiskManager *disk_manager_;
-    Replacer *replacer_; // buffer_pool的置换策略，当前赛题中为LRU置换策略
-    std::mutex latch_;   // 用于共享数据结构的并发控制
+    int page_size_; // 页面大小，构造时从disk_manager_得到，每一帧的大小
+
+    char *frame_data_ = nullptr; // 所有帧的页面数据，一段按页对齐的连续内存，第i帧的数据位于i*page_size_处
+    size_t frame_data_size_ = 0; // frame_data_映射的字节数
+    bool huge_pages_ = false;    // frame_data_是否使用了大页
+
+    // 后台写线程，提前写回replacer中即将被淘汰的脏页
+    std::thread bg_writer_;
+    std::mutex bg_writer_latch_;
+    std::condition_variable bg_writer_cv_; // 用于通知后台写线程退出
+    bool bg_writer_stop_ = false;
+    std::atomic<size_t> bg_writer_next_shard_{0}; // 下一轮开始检查的分片，使每个分片轮流优先
+    std::unique_ptr<IoContext> bg_writer_io_;     // 后台写线程提交写请求的队列，第一轮时创建
+
+    std::atomic<uint64_t> num_background_writes_{0};
+    std::atomic<uint64_t> num_foreground_writes_{0};
+    std::atomic<uint64_t> num_flush_writes_{0};
+    std::atomic<uint64_t> num_flush_batches_{0};
+
+    // 顺序预读，所有分片共享，只在未命中时访问
+    int read_ahead_pages_ = READ_AHEAD_PAGES; // 每次预读的页面个数，0表示关闭预读
+    std::mutex read_ahead_latch_;
+    std::unordered_map<int, ReadAheadState> read_ahead_; // 文件句柄到预读状态的映射
+    std::atomic<uint64_t> num_prefetched_pages_{0};
 
   public:
-    BufferPoolManager(size_t pool_size, DiskManager *disk_manager)
-        : pool_size_(pool_size), disk_manager_(disk_manager) {
-        // 为buffer pool分配一块连续的内存空间
+    /**
+     * @param {size_t} pool_size 帧的总个数
+     * @param {DiskManager*} disk_manager
+     * @param {size_t} num_shards 分片个数，取值范围为[1,pool_size]，默认不分片
+     * @param {string&} replacer_type 置换策略，见create_replacer，默认为REPLACER_TYPE
+     * @param {bool} huge_pages 帧内存是否尝试使用大页，不可用时退回普通页面
+     */
+    BufferPoolManager(size_t pool_size, DiskManager *disk_manager, size_t num_shards = 1,
+                      const std::string &replacer_type = REPLACER_TYPE, bool huge_pages = false)
+        : pool_size_(pool_size), shards_(std::clamp<size_t>(num_shards, 1, std::max<size_t>(pool_size, 1))),
+          disk_manager_(disk_manager), page_size_(disk_manager->get_page_size()) {
+        // 为buffer pool分配一块连续的内存空间，帧的元数据与页面数据分开存放，页面数据按页对齐，可以直接用于O_DIRECT
+        allocate_frame_data(huge_pages);
         pages_ = new Page[pool_size_];
-        // 可以被Replacer改变
-        if (REPLACER_TYPE == "LRU")
-            replacer_ = new LRUReplacer(pool_size_);
-        else if (REPLACER_TYPE == "CLOCK")
-            replacer_ = new LRUReplacer(pool_size_);
-        else {
-            replacer_ = new LRUReplacer(pool_size_);
-        }
-        // 初始化时，所有的page都在free_list_中
         for (size_t i = 0; i < pool_size_; ++i) {
-            free_list_.emplace_back(static_cast<frame_id_t>(i)); // static_cast转换数据类型
+            pages_[i].data_ = frame_data_ + i * page_size_;
+        }
+        size_t begin = 0;
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            auto &shard = shards_[i];
+            // 前pool_size % num_shards个分片各多分得一帧
+            shard.size = pool_size_ / shards_.size() + (i < pool_size_ % shards_.size() ? 1 : 0);
+            shard.pages = pages_ + begin;
+            shard.io_done = std::vector<std::condition_variable>(shard.size);
+            shard.page_table = PageTable(shard.size);
+            begin += shard.size;
+            // 可以被Replacer改变
+            shard.replacer = create_replacer(replacer_type, shard.size);
+            if (shard.replacer == nullptr) {
+                delete[] pages_;
+                free_frame_data();
+                throw InternalError("BufferPoolManager: unknown replacer type " + replacer_type);
+            }
+            // 初始化时，所有的page都在free_list中
+            for (size_t j = 0; j < shard.size; ++j) {
+                shard.free_list.emplace_back(static_cast<frame_id_t>(j)); // static_cast转换数据类型
+            }
         }
     }
 
     ~BufferPoolManager() {
+        stop_background_writer();
         delete[] pages_;
-        delete replacer_;
+        free_frame_data();
     }
 
     /**
-     * @description: 将目标页面标记为脏页
+     * @description: 根据名称创建置换策略
+     * @return {unique_ptr<Replacer>} 创建的置换器，名称未知时返回nullptr
+     * @param {string&} replacer_type "LRU": 基于std::list的LRU; "LRU_ARRAY": 基于数组侵入式链表的LRU;
+     * "CLOCK": 时钟置换; "2Q": 抗扫描的2Q
+     * @param {size_t} num_frames 置换器管理的帧的个数
+     */
+    static std::unique_ptr<Replacer> create_replacer(const std::string &replacer_type, size_t num_frames) {
+        if (replacer_type == "LRU") {
+            return std::make_unique<LRUReplacer>(num_frames);
+        } else if (replacer_type == "LRU_ARRAY") {
+            return std::make_unique<ArrayLRUReplacer>(num_frames);
+        } else if (replacer_type == "CLOCK") {
+            return std::make_unique<ClockReplacer>(num_frames);
+        } else if (replacer_type == "2Q") {
+            return std::make_unique<TwoQueueReplacer>(num_frames);
+        }
+        return nullptr;
+    }
+
+    /**
+     * @description: 将被pin住的目标页面标记为脏页
      * @param {Page*} page 脏页
      */
-    static void mark_dirty(Page *page) {
-        page->is_dirty_ = true;
+    void mark_dirty(Page *page) {
+        auto &shard = get_shard(page->key_);
+        std::scoped_lock lock{shard.latch};
+        add_dirty_frame(shard, static_cast<frame_id_t>(page - shard.pages));
     }
 
   public:
     Page *fetch_page(PageId page_id);
 
+    Page *fetch_page(PageId page_id, BufferAccessStrategy *strategy);
+
     bool unpin_page(PageId page_id, bool is_dirty);
 
     bool flush_page(PageId page_id);
 
     Page *new_page(PageId *page_id);
 
+    Page *new_page(PageId *page_id, BufferAccessStrategy *strategy);
+
     bool delete_page(PageId page_id);
 
     void flush_all_pages(int fd);
 
+    size_t get_num_shards() const {
+        return shards_.size();
+    }
+
+    size_t get_pool_size() const {
+        return pool_size_;
+    }
+
+    bool is_huge_pages() const {
+        return huge_pages_;
+    }
+
+    void start_background_writer(int delay_ms, size_t max_pages, size_t clean_target);
+
+    void stop_background_writer();
+
+    size_t background_write_round(size_t max_pages, size_t clean_target);
+
+    BufferPoolWriteStats get_write_stats() const {
+        return {num_background_writes_.load(), num_foreground_writes_.load(), num_flush_writes_.load(),
+                num_flush_batches_.load()};
+    }
+
+    /**
+     * @description: 设置每次预读的页面个数，应在缓冲池开始使用之前调用
+     * @param {int} num_pages 预读的页面个数，0表示关闭预读
+     */
+    void set_read_ahead_pages(int num_pages) {
+        read_ahead_pages_ = std::max(num_pages, 0);
+    }
+
+    void hint_sequential(int fd, page_id_t start_page_no);
+
+    uint64_t get_num_prefetched_pages() const {
+        return num_prefetched_pages_.load();
+    }
+
   private:
-    bool find_victim_page(frame_id_t *frame_id);
+    void allocate_frame_data(bool huge_pages);
+
+    void free_frame_data();
+
+    page_key_t get_page_key(const PageId &page_id) const {
+        return make_page_key(disk_manager_->get_file_id(page_id.fd), page_id.page_no);
+    }
+
+    BufferPoolShard &get_shard(page_key_t key);
+
+    bool find_victim_page(BufferPoolShard &shard, std::unique_lock<std::mutex> &lock, frame_id_t *frame_id);
+
+    bool find_victim_page(BufferPoolShard &shard, std::unique_lock<std::mutex> &lock, BufferAccessStrategy *strategy,
+                          frame_id_t *frame_id);
+
+    bool write_back_victim(BufferPoolShard &shard, std::unique_lock<std::mutex> &lock, frame_id_t frame_id);
+
+    void return_victim_page(BufferPoolShard &shard, frame_id_t frame_id);
+
+    void update_page(BufferPoolShard &shard, Page *page, PageId new_page_id, frame_id_t new_frame_id);
+
+    void wait_io(BufferPoolShard &shard, std::unique_lock<std::mutex> &lock, frame_id_t frame_id);
+
+    void add_dirty_frame(BufferPoolShard &shard, frame_id_t frame_id);
+
+    void remove_dirty_frame(BufferPoolShard &shard, frame_id_t frame_id);
+
+    void rebind_page_fd(BufferPoolShard &shard, std::unique_lock<std::mutex> &lock, frame_id_t frame_id, int fd);
 
-    void update_page(Page *page, PageId new_page_id, frame_id_t new_frame_id);
+    void read_ahead(PageId page_id);
 };
\ No newline at end of file
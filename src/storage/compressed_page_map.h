@@ -0,0 +1,168 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "common/config.h"
+
+/**
+ * 压缩文件的磁盘格式：第0个扇区是文件头，之后是若干槽位，每个槽位占连续的整数个扇区，
+ * 以CompressedSlotHdr开头，后面是一个页面压缩后的数据。页面被写回时如果需要的扇区数不变就原地覆盖，
+ * 否则换到同样大小的空闲槽位或文件末尾，旧槽位按扇区数归入空闲列表
+ */
+static constexpr int COMPRESSED_SECTOR_SIZE = 512;
+static constexpr char COMPRESSED_FILE_MAGIC[8] = {'R', 'M', 'D', 'B', 'Z', 'P', 'G', '1'};
+static constexpr uint32_t COMPRESSED_SLOT_MAGIC = 0x5a534c54; // "TLSZ"
+
+/**
+ * @description: 压缩文件的文件头，位于第0个扇区
+ */
+struct CompressedFileHdr {
+    char magic[8];  // COMPRESSED_FILE_MAGIC
+    int page_size;  // 创建文件时的页面大小
+};
+
+/**
+ * @description: 槽位头。释放的槽位把page_no改为INVALID_PAGE_ID，重建页面映射时同一页面以version最大的槽位为准
+ */
+struct CompressedSlotHdr {
+    uint32_t magic;       // COMPRESSED_SLOT_MAGIC
+    page_id_t page_no;    // 槽位中存放的页面，空闲槽位为INVALID_PAGE_ID
+    uint32_t num_sectors; // 槽位占用的扇区数，包括槽位头
+    int32_t data_len;     // 槽位头之后的数据长度，等于页面大小时数据没有压缩
+    uint64_t version;     // 写入的序号，越大越新
+};
+
+/**
+ * @description: 压缩文件在内存中的页面映射：页面编号到槽位的映射，以及按扇区数分类的空闲槽位。
+ * 不加锁，由DiskManager保护
+ */
+class CompressedPageMap {
+  public:
+    struct Slot {
+        int64_t sector = 0;       // 槽位的第一个扇区，0表示页面没有写入过
+        uint32_t num_sectors = 0; // 槽位的扇区数
+    };
+
+    explicit CompressedPageMap(int page_size) : free_slots_(max_sectors(page_size) + 1) {
+    }
+
+    /**
+     * @description: 一个页面最多占用的扇区数，即不压缩时的槽位大小
+     */
+    static uint32_t max_sectors(int page_size) {
+        return (sizeof(CompressedSlotHdr) + page_size + COMPRESSED_SECTOR_SIZE - 1) / COMPRESSED_SECTOR_SIZE;
+    }
+
+    Slot get(page_id_t page_no) const {
+        return static_cast<size_t>(page_no) < slots_.size() ? slots_[page_no] : Slot{};
+    }
+
+    /**
+     * @description: 为页面分配num_sectors个扇区的槽位，优先使用同样大小的空闲槽位，没有时追加到文件末尾
+     * @return {int64_t} 槽位的第一个扇区
+     */
+    int64_t allocate(uint32_t num_sectors) {
+        auto &free_list = free_slots_[num_sectors];
+        if (!free_list.empty()) {
+            int64_t sector = free_list.back();
+            free_list.pop_back();
+            num_free_sectors_ -= num_sectors;
+            return sector;
+        }
+        int64_t sector = end_sector_;
+        end_sector_ += num_sectors;
+        return sector;
+    }
+
+    /**
+     * @description: 把页面映射到新的槽位，返回旧的槽位，调用者在新槽位写入完成之后用release释放旧槽位
+     */
+    Slot set(page_id_t page_no, Slot slot) {
+        if (static_cast<size_t>(page_no) >= slots_.size()) {
+            slots_.resize(page_no + 1);
+        }
+        Slot old = slots_[page_no];
+        stored_sectors_ += static_cast<int64_t>(slot.num_sectors) - old.num_sectors;
+        if (old.sector == 0 && slot.sector != 0) {
+            num_pages_++;
+        } else if (old.sector != 0 && slot.sector == 0) {
+            num_pages_--;
+        }
+        slots_[page_no] = slot;
+        return old;
+    }
+
+    void release(Slot slot) {
+        if (slot.sector != 0) {
+            free_slots_[slot.num_sectors].push_back(slot.sector);
+            num_free_sectors_ += slot.num_sectors;
+        }
+    }
+
+    uint64_t next_version() {
+        return next_version_++;
+    }
+
+    /**
+     * @description: 从磁盘上重建映射时恢复写入序号和文件末尾
+     */
+    void restore(uint64_t version, int64_t end_sector) {
+        next_version_ = std::max(next_version_, version + 1);
+        end_sector_ = std::max(end_sector_, end_sector);
+    }
+
+    const std::vector<Slot> &get_slots() const {
+        return slots_;
+    }
+
+    const std::vector<std::vector<int64_t>> &get_free_slots() const {
+        return free_slots_;
+    }
+
+    int64_t get_end_sector() const {
+        return end_sector_;
+    }
+
+    uint64_t get_next_version() const {
+        return next_version_;
+    }
+
+    /**
+     * @description: 写入过的页面个数
+     */
+    size_t get_num_pages() const {
+        return num_pages_;
+    }
+
+    /**
+     * @description: 页面实际占用的字节数，不包括空闲槽位
+     */
+    int64_t get_stored_bytes() const {
+        return stored_sectors_ * COMPRESSED_SECTOR_SIZE;
+    }
+
+    int64_t get_free_bytes() const {
+        return num_free_sectors_ * COMPRESSED_SECTOR_SIZE;
+    }
+
+  private:
+    std::vector<Slot> slots_;                      // 页面编号到槽位的映射
+    std::vector<std::vector<int64_t>> free_slots_; // 第i项为i个扇区的空闲槽位
+    int64_t end_sector_ = 1;                       // 文件末尾的扇区，第0个扇区是文件头
+    uint64_t next_version_ = 1;                    // 下一次写入的序号
+    size_t num_pages_ = 0;                         // 写入过的页面个数
+    int64_t stored_sectors_ = 0;                   // 页面占用的扇区数
+    int64_t num_free_sectors_ = 0;                 // 空闲槽位的扇区数
+};
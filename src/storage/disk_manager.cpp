@@ -11,11 +11,21 @@ See the Mulan PSL v2 for more details. */
 #include "storage/disk_manager.h"
 
 #include <assert.h>   // for assert
+#include <fcntl.h>    // for posix_fadvise, fallocate, O_DIRECT
+#include <stdlib.h>   // for aligned_alloc
 #include <string.h>   // for memset
 #include <sys/stat.h> // for stat
-#include <unistd.h>   // for lseek
+#include <sys/uio.h>  // for pwritev
+#include <unistd.h>   // for lseek, pread, pwrite
+
+#include <algorithm>
+#include <limits>
+#include <vector>
 
 #include "defs.h"
+#include "storage/page_codec.h"
+
+static_assert(sizeof(off_t) == 8, "file offsets must be 64-bit to address files larger than 2GB");
 
 DiskManager::DiskManager() {
     memset(fd2pageno_, 0, MAX_FD * (sizeof(std::atomic<page_id_t>) / sizeof(char)));
@@ -30,12 +40,20 @@ DiskManager::DiskManager() {
  */
 void DiskManager::write_page(int fd, page_id_t page_no, const char *offset, int num_bytes) {
     // Todo:
-    // 1.lseek()定位到文件头，通过(fd,page_no)可以定位指定页面及其在磁盘文件中的偏移量
-    // 2.调用write()函数
+    // 1.通过(fd,page_no)可以定位指定页面及其在磁盘文件中的偏移量
+    // 2.调用pwrite()函数，缓冲池在锁外并发读写页面，不能使用共享文件偏移量的lseek()+write()
     // 注意write返回值与num_bytes不等时 throw InternalError("DiskManager::write_page Error");
 
-    lseek(fd, page_no * PAGE_SIZE, SEEK_SET);
-    if (write(fd, offset, num_bytes) != num_bytes) {
+    if (compressed_fds_[fd]) {
+        write_compressed_page(fd, page_no, offset, num_bytes);
+        return;
+    }
+    if (!is_direct_aligned(fd, offset, num_bytes)) {
+        write_page_unaligned(fd, page_no, offset, num_bytes);
+        return;
+    }
+    // 页面编号先转换为64位的off_t再乘以页面大小，否则文件超过2GB时偏移量会溢出
+    if (pwrite(fd, offset, num_bytes, static_cast<off_t>(page_no) * page_size_) != num_bytes) {
         throw InternalError("DiskManager::write_page Error");
     }
 }
@@ -49,27 +67,632 @@ void DiskManager::write_page(int fd, page_id_t page_no, const char *offset, int
  */
 void DiskManager::read_page(int fd, page_id_t page_no, char *offset, int num_bytes) {
     // Todo:
-    // 1.lseek()定位到文件头，通过(fd,page_no)可以定位指定页面及其在磁盘文件中的偏移量
-    // 2.调用read()函数
+    // 1.通过(fd,page_no)可以定位指定页面及其在磁盘文件中的偏移量
+    // 2.调用pread()函数，与write_page相同，不能依赖共享的文件偏移量
     // 注意read返回值与num_bytes不等时，throw InternalError("DiskManager::read_page Error");
-    lseek(fd, page_no * PAGE_SIZE, SEEK_SET);
-    if (read(fd, offset, num_bytes) != num_bytes) {
+    if (compressed_fds_[fd]) {
+        read_compressed_page(fd, page_no, offset, num_bytes);
+        return;
+    }
+    if (!is_direct_aligned(fd, offset, num_bytes)) {
+        read_page_unaligned(fd, page_no, offset, num_bytes);
+        return;
+    }
+    if (pread(fd, offset, num_bytes, static_cast<off_t>(page_no) * page_size_) != num_bytes) {
         throw InternalError("DiskManager::read_page Error");
     }
 }
 
 /**
- * @description: 分配一个新的页号
+ * @description: 将连续的num_pages个页面用一次pwritev写入文件，页面数据可以位于不连续的内存中
+ * @param {int} fd 磁盘文件的文件句柄
+ * @param {page_id_t} start_page_no 第一个页面的编号
+ * @param {char*const*} bufs 每个页面的数据，各一个页面大小
+ * @param {int} num_pages 页面个数，不超过IOV_MAX
+ */
+void DiskManager::write_pages(int fd, page_id_t start_page_no, char *const *bufs, int num_pages) {
+    // 压缩文件中连续的页面不在连续的位置上，逐个写入
+    if (compressed_fds_[fd]) {
+        for (int i = 0; i < num_pages; i++) {
+            write_compressed_page(fd, start_page_no + i, bufs[i], page_size_);
+        }
+        return;
+    }
+    std::vector<iovec> iov(num_pages);
+    for (int i = 0; i < num_pages; i++) {
+        iov[i] = {bufs[i], static_cast<size_t>(page_size_)};
+    }
+    off_t offset = static_cast<off_t>(start_page_no) * page_size_;
+    size_t first = 0;
+    while (first < iov.size()) {
+        ssize_t bytes_written = pwritev(fd, iov.data() + first, iov.size() - first, offset);
+        if (bytes_written <= 0) {
+            throw InternalError("DiskManager::write_pages Error");
+        }
+        // 只写入了一部分时跳过已经写完的iovec，从中断处继续
+        offset += bytes_written;
+        while (first < iov.size() && static_cast<size_t>(bytes_written) >= iov[first].iov_len) {
+            bytes_written -= iov[first].iov_len;
+            first++;
+        }
+        if (first < iov.size()) {
+            iov[first].iov_base = static_cast<char *>(iov[first].iov_base) + bytes_written;
+            iov[first].iov_len -= bytes_written;
+        }
+    }
+}
+
+/**
+ * @description: 用O_DIRECT打开的文件要求缓冲区地址和读写长度按块对齐，缓冲池的帧满足这个要求；
+ * 不对齐的读写（如文件头）经过对齐的临时缓冲区。写入不足整页时先读出整页再覆盖前num_bytes个字节，保持页面其余部分不变
+ * @param {int} fd 磁盘文件的文件句柄
+ * @param {page_id_t} page_no 写入目标页面的page_id
+ * @param {char} *offset 要写入磁盘的数据
+ * @param {int} num_bytes 要写入磁盘的数据大小
+ */
+void DiskManager::write_page_unaligned(int fd, page_id_t page_no, const char *offset, int num_bytes) {
+    ssize_t len = (num_bytes + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+    std::unique_ptr<char, decltype(&free)> buf(static_cast<char *>(aligned_alloc(PAGE_SIZE, len)), &free);
+    if (buf == nullptr) {
+        throw UnixError();
+    }
+    if (len != num_bytes) {
+        ssize_t bytes_read = pread(fd, buf.get(), len, static_cast<off_t>(page_no) * page_size_);
+        if (bytes_read < 0) {
+            throw InternalError("DiskManager::write_page Error");
+        }
+        memset(buf.get() + bytes_read, 0, len - bytes_read); // 文件末尾之后的部分
+    }
+    memcpy(buf.get(), offset, num_bytes);
+    if (pwrite(fd, buf.get(), len, static_cast<off_t>(page_no) * page_size_) != len) {
+        throw InternalError("DiskManager::write_page Error");
+    }
+}
+
+/**
+ * @description: 经过对齐的临时缓冲区读取O_DIRECT文件中的数据，见write_page_unaligned
+ * @param {int} fd 磁盘文件的文件句柄
+ * @param {page_id_t} page_no 指定的页面编号
+ * @param {char} *offset 读取的内容写入到offset中
+ * @param {int} num_bytes 读取的数据量大小
+ */
+void DiskManager::read_page_unaligned(int fd, page_id_t page_no, char *offset, int num_bytes) {
+    ssize_t len = (num_bytes + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+    std::unique_ptr<char, decltype(&free)> buf(static_cast<char *>(aligned_alloc(PAGE_SIZE, len)), &free);
+    if (buf == nullptr) {
+        throw UnixError();
+    }
+    if (pread(fd, buf.get(), len, static_cast<off_t>(page_no) * page_size_) < num_bytes) {
+        throw InternalError("DiskManager::read_page Error");
+    }
+    memcpy(offset, buf.get(), num_bytes);
+}
+
+/**
+ * @description: 通知操作系统异步预读文件中连续的若干页面，调用立即返回，之后read_page读取这些页面时不必等待磁盘
+ * @param {int} fd 磁盘文件的文件句柄
+ * @param {page_id_t} start_page_no 预读的第一个页面编号
+ * @param {int} num_pages 预读的页面个数
+ */
+void DiskManager::prefetch_pages(int fd, page_id_t start_page_no, int num_pages) {
+    // O_DIRECT读写不经过操作系统的缓存，预读没有作用；压缩文件中页面的位置与页面编号无关
+    if (direct_fds_[fd] || compressed_fds_[fd]) {
+        return;
+    }
+    // 预读只是建议，失败时不影响之后的read_page，忽略返回值
+    posix_fadvise(fd, static_cast<off_t>(start_page_no) * page_size_, static_cast<off_t>(num_pages) * page_size_,
+                  POSIX_FADV_WILLNEED);
+}
+
+/**
+ * @description: 选择create_io_context使用的异步I/O后端，应在启动时调用
+ * @return {bool} 后端名称合法则返回true
+ * @param {string&} backend "io_uring"或"thread_pool"，内核不支持io_uring时使用thread_pool
+ */
+bool DiskManager::set_io_backend(const std::string &backend) {
+    if (backend == "io_uring") {
+        io_backend_ = IoUringContext::is_supported() ? backend : "thread_pool";
+        return true;
+    } else if (backend == "thread_pool") {
+        io_backend_ = backend;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @description: 用选择的后端创建一个异步I/O队列，每个需要异步I/O的线程各自持有一个
+ * @return {unique_ptr<IoContext>} 创建的队列
+ * @param {unsigned} depth 队列深度
+ */
+std::unique_ptr<IoContext> DiskManager::create_io_context(unsigned depth) {
+    return ::create_io_context(io_backend_, depth, page_size_);
+}
+
+/**
+ * @description: 分配一个新的页号，优先复用文件中已经释放的页面，没有空闲页面时才扩展文件
  * @return {page_id_t} 分配的新页号
  * @param {int} fd 指定文件的文件句柄
  */
 page_id_t DiskManager::allocate_page(int fd) {
+    assert(fd >= 0 && fd < MAX_FD);
+    {
+        std::scoped_lock lock{free_page_map_latch_};
+        if (free_page_maps_[fd] != nullptr) {
+            page_id_t page_no = free_page_maps_[fd]->allocate();
+            if (page_no != INVALID_PAGE_ID) {
+                return page_no;
+            }
+        }
+    }
     // 简单的自增分配策略，指定文件的页面编号加1
+    page_id_t page_no = fd2pageno_[fd]++;
+    if (page_no >= fd2reserved_[fd] && extent_max_pages_ > 0) {
+        reserve_extent(fd, page_no);
+    }
+    return page_no;
+}
+
+/**
+ * @description: 文件扩展到预留空间之外时，用fallocate一次为文件预留一个区段的磁盘块，
+ * 之后写入区段内的新页面只需要更新文件大小，文件系统不必每写一页就分配一次磁盘块，文件在磁盘上也更连续。
+ * 区段大小等于已预留的大小，即文件越大区段越大，限制在[extent_min_pages_, extent_max_pages_]之间。
+ * 使用FALLOC_FL_KEEP_SIZE，文件大小仍然只包含写过的页面。
+ * 预留只是优化，从不抛出异常：空间不足等错误时把区段减半重试，一页也预留不了时本次不预留，
+ * 由写入时逐页扩展，写入本身失败时再报告错误
+ * @param {int} fd 文件句柄
+ * @param {page_id_t} page_no 新分配的页面编号，预留之后需要覆盖它
+ */
+void DiskManager::reserve_extent(int fd, page_id_t page_no) {
+    std::scoped_lock lock{extent_latch_};
+    page_id_t reserved = fd2reserved_[fd];
+    if (page_no < reserved) {
+        return;
+    }
+    reserved = std::max(reserved, page_no);
+    page_id_t extent = std::clamp(reserved, static_cast<page_id_t>(extent_min_pages_), extent_max_pages_);
+    while (fallocate(fd, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(reserved) * page_size_,
+                     static_cast<off_t>(extent) * page_size_) == -1) {
+        if (errno == EOPNOTSUPP) {
+            // 文件系统不支持预留，之后不再尝试，由写入时逐页扩展
+            extent = std::numeric_limits<page_id_t>::max() - reserved;
+            break;
+        }
+        if (errno != EINTR) {
+            extent /= 2;
+        }
+        if (extent == 0) {
+            return;
+        }
+    }
+    fd2reserved_[fd] = reserved + extent;
+}
+
+/**
+ * @description: 释放文件中的一个页面，之后allocate_page会重新分配它。调用者需保证页面已经不在缓冲池中
+ * @param {int} fd 指定文件的文件句柄
+ * @param {page_id_t} page_no 释放的页面编号
+ */
+void DiskManager::deallocate_page(int fd, page_id_t page_no) {
+    assert(fd >= 0 && fd < MAX_FD && page_no >= 0 && page_no < fd2pageno_[fd]);
+    if (compressed_fds_[fd]) {
+        free_compressed_page(fd, page_no);
+    }
+    std::scoped_lock lock{free_page_map_latch_};
+    if (free_page_maps_[fd] == nullptr) {
+        free_page_maps_[fd] = std::make_unique<FreePageMap>();
+    }
+    free_page_maps_[fd]->set_free(page_no);
+}
+
+/**
+ * @description: 重新占用一个已经释放的指定页面，用于回滚删除时把记录插回原来的页面
+ * @return {bool} 页面原来是空闲的则返回true
+ * @param {int} fd 指定文件的文件句柄
+ * @param {page_id_t} page_no 页面编号
+ */
+bool DiskManager::reclaim_page(int fd, page_id_t page_no) {
+    std::scoped_lock lock{free_page_map_latch_};
+    return free_page_maps_[fd] != nullptr && free_page_maps_[fd]->set_used(page_no);
+}
+
+/**
+ * @description: 判断页面是否已经被释放
+ * @param {int} fd 指定文件的文件句柄
+ * @param {page_id_t} page_no 页面编号
+ */
+bool DiskManager::is_page_free(int fd, page_id_t page_no) {
+    std::scoped_lock lock{free_page_map_latch_};
+    return free_page_maps_[fd] != nullptr && free_page_maps_[fd]->is_free(page_no);
+}
+
+/**
+ * @description: 把文件截断到num_pages个页面，截掉的页面从空闲页面位图中删除，之后从num_pages开始分配新页面。
+ * 调用者需保证截掉的页面都已经释放、不在缓冲池中。磁盘上的文件随之缩小，预留的区段也一起归还；
+ * 压缩文件中这些页面的槽位在释放时已经归还，只缩小页面编号
+ * @param {int} fd 指定文件的文件句柄
+ * @param {page_id_t} num_pages 截断后的页面个数
+ */
+void DiskManager::truncate_file(int fd, page_id_t num_pages) {
+    assert(fd >= 0 && fd < MAX_FD && num_pages <= fd2pageno_[fd]);
+    {
+        std::scoped_lock lock{free_page_map_latch_};
+        if (free_page_maps_[fd] != nullptr) {
+            free_page_maps_[fd]->truncate(num_pages);
+        }
+    }
+    fd2pageno_[fd] = num_pages;
+    if (compressed_fds_[fd]) {
+        return;
+    }
+    std::scoped_lock lock{extent_latch_};
+    if (ftruncate(fd, static_cast<off_t>(num_pages) * page_size_) == -1) {
+        throw UnixError();
+    }
+    fd2reserved_[fd] = std::min(fd2reserved_[fd].load(), num_pages);
+}
+
+/**
+ * @description: 把文件已经写入的内容落盘（fsync），之后的截断等操作不会先于这些写入到达磁盘
+ * @param {int} fd 指定文件的文件句柄
+ */
+void DiskManager::sync_file(int fd) {
     assert(fd >= 0 && fd < MAX_FD);
-    return fd2pageno_[fd]++;
+    if (fsync(fd) == -1) {
+        throw UnixError();
+    }
+}
+
+/**
+ * @description: 获得文件的大小和其中空闲页面的个数
+ * @return {FilePageStats} 文件的页面统计
+ * @param {int} fd 指定文件的文件句柄
+ */
+FilePageStats DiskManager::get_page_stats(int fd) {
+    std::scoped_lock lock{free_page_map_latch_};
+    page_id_t num_free = free_page_maps_[fd] == nullptr ? 0 : free_page_maps_[fd]->get_num_free();
+    return FilePageStats{fd2pageno_[fd], num_free};
+}
+
+/**
+ * @description: 打开文件时读入磁盘上的空闲页面位图并删除磁盘上的位图，之后异常退出时位图不存在，
+ * 下次打开时按没有空闲页面处理：上次正常关闭之后重新分配出去的页面不会被当作空闲页面再次分配，
+ * 代价只是异常退出前释放的页面不再被复用。文件没有释放过页面时也不存在位图
+ * @param {int} fd 文件句柄
+ * @param {string&} path 文件路径
+ */
+void DiskManager::load_free_page_map(int fd, const std::string &path) {
+    std::string map_path = get_free_page_map_path(path);
+    if (!is_file(map_path)) {
+        return;
+    }
+    std::vector<uint64_t> words(get_file_size(map_path) / sizeof(uint64_t));
+    std::ifstream ifs(map_path, std::ios::binary);
+    if (!ifs.read(reinterpret_cast<char *>(words.data()), words.size() * sizeof(uint64_t))) {
+        throw InternalError("DiskManager: failed to read free page map " + map_path);
+    }
+    unlink(map_path.c_str());
+    std::scoped_lock lock{free_page_map_latch_};
+    free_page_maps_[fd] = std::make_unique<FreePageMap>(std::move(words));
+}
+
+/**
+ * @description: 关闭文件时把空闲页面位图写回磁盘，没有空闲页面时删除磁盘上的位图
+ * @param {int} fd 文件句柄
+ * @param {string&} path 文件路径
+ */
+void DiskManager::save_free_page_map(int fd, const std::string &path) {
+    std::unique_ptr<FreePageMap> map;
+    {
+        std::scoped_lock lock{free_page_map_latch_};
+        map = std::move(free_page_maps_[fd]);
+    }
+    if (map == nullptr) {
+        return;
+    }
+    std::string map_path = get_free_page_map_path(path);
+    if (map->get_num_free() == 0) {
+        unlink(map_path.c_str());
+        return;
+    }
+    auto &words = map->get_words();
+    std::ofstream ofs(map_path, std::ios::binary | std::ios::trunc);
+    if (!ofs.write(reinterpret_cast<const char *>(words.data()), words.size() * sizeof(uint64_t))) {
+        throw InternalError("DiskManager: failed to write free page map " + map_path);
+    }
+}
+
+/**
+ * @description: 判断文件是否以压缩文件的文件头开始
+ * @param {string&} path 文件路径
+ */
+bool DiskManager::is_compressed_path(const std::string &path) {
+    char magic[sizeof(COMPRESSED_FILE_MAGIC)];
+    std::ifstream ifs(path, std::ios::binary);
+    return ifs.read(magic, sizeof(magic)) && memcmp(magic, COMPRESSED_FILE_MAGIC, sizeof(magic)) == 0;
+}
+
+/**
+ * @description: 把槽位头改为空闲，重建页面映射时不会再从这个槽位找回原来的页面
+ * @param {int} fd 磁盘文件的文件句柄
+ * @param {CompressedPageMap::Slot} slot 槽位
+ * @param {uint64_t} version 写入的序号
+ */
+static void write_free_slot_hdr(int fd, CompressedPageMap::Slot slot, uint64_t version) {
+    CompressedSlotHdr hdr{COMPRESSED_SLOT_MAGIC, INVALID_PAGE_ID, slot.num_sectors, 0, version};
+    if (pwrite(fd, &hdr, sizeof(hdr), slot.sector * COMPRESSED_SECTOR_SIZE) != sizeof(hdr)) {
+        throw InternalError("DiskManager::write_page Error");
+    }
+}
+
+/**
+ * @description: 压缩之后写入页面。页面被压缩到若干扇区，扇区数不变时原地覆盖原来的槽位，
+ * 否则写入新的槽位，写入完成之后才把旧槽位标记为空闲并释放，写入中途崩溃时旧槽位仍然有效。
+ * 压缩后不比原始数据小的页面原样存放
+ * @param {int} fd 磁盘文件的文件句柄
+ * @param {page_id_t} page_no 写入目标页面的page_id
+ * @param {char} *offset 要写入磁盘的数据
+ * @param {int} num_bytes 要写入磁盘的数据大小，不足整页时只覆盖页面的前num_bytes个字节
+ */
+void DiskManager::write_compressed_page(int fd, page_id_t page_no, const char *offset, int num_bytes) {
+    std::vector<char> page;
+    if (num_bytes < page_size_) {
+        page.resize(page_size_);
+        read_compressed_page(fd, page_no, page.data(), page_size_);
+        memcpy(page.data(), offset, num_bytes);
+        offset = page.data();
+    }
+    uint32_t max_sectors = CompressedPageMap::max_sectors(page_size_);
+    std::vector<char> buf(static_cast<size_t>(max_sectors) * COMPRESSED_SECTOR_SIZE, 0);
+    auto hdr = reinterpret_cast<CompressedSlotHdr *>(buf.data());
+    char *data = buf.data() + sizeof(CompressedSlotHdr);
+    hdr->data_len = page_compress(offset, page_size_, data, page_size_ - 1);
+    if (hdr->data_len == 0) {
+        hdr->data_len = page_size_;
+        memcpy(data, offset, page_size_);
+    }
+    hdr->magic = COMPRESSED_SLOT_MAGIC;
+    hdr->page_no = page_no;
+    hdr->num_sectors =
+        (sizeof(CompressedSlotHdr) + hdr->data_len + COMPRESSED_SECTOR_SIZE - 1) / COMPRESSED_SECTOR_SIZE;
+
+    // 总是写入新分配的槽位，写入成功之后才把页面映射过去，旧槽位在此之前保持完整可读
+    CompressedPageMap::Slot slot;
+    uint64_t free_version = 0;
+    {
+        std::scoped_lock lock{compressed_map_latch_};
+        auto &map = compressed_maps_[fd];
+        slot.num_sectors = hdr->num_sectors;
+        slot.sector = map->allocate(slot.num_sectors);
+        hdr->version = map->next_version();
+        free_version = map->next_version();
+    }
+    ssize_t len = static_cast<ssize_t>(slot.num_sectors) * COMPRESSED_SECTOR_SIZE;
+    if (pwrite(fd, buf.data(), len, slot.sector * COMPRESSED_SECTOR_SIZE) != len) {
+        // 映射没有改变，只需归还新分配的扇区
+        std::scoped_lock lock{compressed_map_latch_};
+        compressed_maps_[fd]->release(slot);
+        throw InternalError("DiskManager::write_page Error");
+    }
+    CompressedPageMap::Slot old;
+    {
+        std::scoped_lock lock{compressed_map_latch_};
+        old = compressed_maps_[fd]->set(page_no, slot);
+    }
+    if (old.sector != 0) {
+        write_free_slot_hdr(fd, old, free_version);
+        std::scoped_lock lock{compressed_map_latch_};
+        compressed_maps_[fd]->release(old);
+    }
+}
+
+/**
+ * @description: 读取压缩文件中的页面并解压，没有写入过的页面读出全0
+ * @param {int} fd 磁盘文件的文件句柄
+ * @param {page_id_t} page_no 指定的页面编号
+ * @param {char} *offset 读取的内容写入到offset中
+ * @param {int} num_bytes 读取的数据量大小
+ */
+void DiskManager::read_compressed_page(int fd, page_id_t page_no, char *offset, int num_bytes) {
+    CompressedPageMap::Slot slot;
+    {
+        std::scoped_lock lock{compressed_map_latch_};
+        slot = compressed_maps_[fd]->get(page_no);
+    }
+    if (slot.sector == 0) {
+        memset(offset, 0, num_bytes);
+        return;
+    }
+    ssize_t len = static_cast<ssize_t>(slot.num_sectors) * COMPRESSED_SECTOR_SIZE;
+    std::vector<char> buf(len);
+    if (pread(fd, buf.data(), len, slot.sector * COMPRESSED_SECTOR_SIZE) != len) {
+        throw InternalError("DiskManager::read_page Error");
+    }
+    auto hdr = reinterpret_cast<const CompressedSlotHdr *>(buf.data());
+    const char *data = buf.data() + sizeof(CompressedSlotHdr);
+    if (hdr->magic != COMPRESSED_SLOT_MAGIC || hdr->page_no != page_no || hdr->data_len <= 0 ||
+        hdr->data_len > len - static_cast<ssize_t>(sizeof(CompressedSlotHdr))) {
+        throw InternalError("DiskManager::read_page Error");
+    }
+    if (hdr->data_len == page_size_) {
+        memcpy(offset, data, num_bytes);
+        return;
+    }
+    // 只读取页面的一部分时先解压到临时缓冲区
+    std::vector<char> page;
+    char *dst = offset;
+    if (num_bytes < page_size_) {
+        page.resize(page_size_);
+        dst = page.data();
+    }
+    if (!page_decompress(data, hdr->data_len, dst, page_size_)) {
+        throw InternalError("DiskManager::read_page Error");
+    }
+    if (dst != offset) {
+        memcpy(offset, dst, num_bytes);
+    }
 }
 
-void DiskManager::deallocate_page(__attribute__((unused)) page_id_t page_id) {
+/**
+ * @description: 释放页面占用的槽位，并在磁盘上把槽位标记为空闲，重建页面映射时不会再找回这个页面
+ * @param {int} fd 磁盘文件的文件句柄
+ * @param {page_id_t} page_no 释放的页面编号
+ */
+void DiskManager::free_compressed_page(int fd, page_id_t page_no) {
+    CompressedPageMap::Slot slot;
+    uint64_t version;
+    {
+        std::scoped_lock lock{compressed_map_latch_};
+        slot = compressed_maps_[fd]->set(page_no, CompressedPageMap::Slot{});
+        version = compressed_maps_[fd]->next_version();
+    }
+    if (slot.sector == 0) {
+        return;
+    }
+    write_free_slot_hdr(fd, slot, version);
+    std::scoped_lock lock{compressed_map_latch_};
+    compressed_maps_[fd]->release(slot);
+}
+
+/**
+ * @description: 获得压缩文件中页面实际占用的空间
+ * @return {bool} fd是压缩文件则返回true
+ * @param {int} fd 文件句柄
+ * @param {CompressedFileStats*} stats 存放统计结果
+ */
+bool DiskManager::get_compressed_stats(int fd, CompressedFileStats *stats) {
+    if (!compressed_fds_[fd]) {
+        return false;
+    }
+    std::scoped_lock lock{compressed_map_latch_};
+    auto &map = compressed_maps_[fd];
+    *stats = CompressedFileStats{map->get_num_pages(), map->get_stored_bytes(), map->get_free_bytes()};
+    return true;
+}
+
+/**
+ * @description: 打开压缩文件时读入页面映射。映射文件读入之后即被删除，关闭文件时再写回，
+ * 所以没有正常关闭的文件下次打开时不存在映射文件，改为扫描文件中的槽位重建
+ * @param {int} fd 文件句柄
+ * @param {string&} path 文件路径
+ */
+void DiskManager::load_compressed_page_map(int fd, const std::string &path) {
+    CompressedFileHdr file_hdr;
+    if (pread(fd, &file_hdr, sizeof(file_hdr), 0) != sizeof(file_hdr)) {
+        throw UnixError();
+    }
+    if (file_hdr.page_size != page_size_) {
+        throw InternalError("DiskManager: page size of compressed file " + path + " is " +
+                            std::to_string(file_hdr.page_size) + ", expected " + std::to_string(page_size_));
+    }
+    auto map = std::make_unique<CompressedPageMap>(page_size_);
+    std::string map_path = get_compressed_page_map_path(path);
+    if (is_file(map_path)) {
+        // 映射文件：end_sector, next_version, 槽位个数, 空闲槽位个数, 各页面的槽位, 空闲槽位
+        std::ifstream ifs(map_path, std::ios::binary);
+        int64_t end_sector;
+        uint64_t next_version, num_slots, num_free;
+        ifs.read(reinterpret_cast<char *>(&end_sector), sizeof(end_sector));
+        ifs.read(reinterpret_cast<char *>(&next_version), sizeof(next_version));
+        ifs.read(reinterpret_cast<char *>(&num_slots), sizeof(num_slots));
+        ifs.read(reinterpret_cast<char *>(&num_free), sizeof(num_free));
+        std::vector<CompressedPageMap::Slot> slots(ifs ? num_slots + num_free : 0);
+        if (!ifs || !ifs.read(reinterpret_cast<char *>(slots.data()), slots.size() * sizeof(slots[0]))) {
+            throw InternalError("DiskManager: failed to read compressed page map " + map_path);
+        }
+        for (uint64_t i = 0; i < num_slots; i++) {
+            if (slots[i].sector != 0) {
+                map->set(static_cast<page_id_t>(i), slots[i]);
+            }
+        }
+        for (uint64_t i = num_slots; i < slots.size(); i++) {
+            map->release(slots[i]);
+        }
+        map->restore(next_version - 1, end_sector);
+        unlink(map_path.c_str());
+    } else {
+        rebuild_compressed_page_map(fd, path, map.get());
+    }
+    std::scoped_lock lock{compressed_map_latch_};
+    compressed_maps_[fd] = std::move(map);
+    compressed_fds_[fd] = true;
+}
+
+/**
+ * @description: 从第1个扇区开始依次读取槽位头重建页面映射。同一页面有多个槽位时（换槽位写入之后没来得及释放旧槽位）
+ * 以version最大的为准，其余的和标记为空闲的槽位一起归入空闲列表；槽位头无效的扇区（写入槽位时崩溃）跳过
+ * @param {int} fd 文件句柄
+ * @param {string&} path 文件路径
+ * @param {CompressedPageMap*} map 重建的页面映射
+ */
+void DiskManager::rebuild_compressed_page_map(int fd, const std::string &path, CompressedPageMap *map) {
+    int64_t end_sector = get_file_size(path) / COMPRESSED_SECTOR_SIZE;
+    uint32_t max_sectors = CompressedPageMap::max_sectors(page_size_);
+    std::vector<uint64_t> versions; // 每个页面当前槽位的version
+    uint64_t max_version = 0;
+    int64_t sector = 1;
+    while (sector < end_sector) {
+        CompressedSlotHdr hdr;
+        if (pread(fd, &hdr, sizeof(hdr), sector * COMPRESSED_SECTOR_SIZE) != sizeof(hdr)) {
+            throw UnixError();
+        }
+        if (hdr.magic != COMPRESSED_SLOT_MAGIC || hdr.num_sectors == 0 || hdr.num_sectors > max_sectors ||
+            sector + hdr.num_sectors > end_sector) {
+            sector++;
+            continue;
+        }
+        CompressedPageMap::Slot slot{sector, hdr.num_sectors};
+        max_version = std::max(max_version, hdr.version);
+        if (hdr.page_no < 0) {
+            map->release(slot);
+        } else {
+            if (static_cast<size_t>(hdr.page_no) >= versions.size()) {
+                versions.resize(hdr.page_no + 1, 0);
+            }
+            if (hdr.version > versions[hdr.page_no]) {
+                versions[hdr.page_no] = hdr.version;
+                map->release(map->set(hdr.page_no, slot));
+            } else {
+                map->release(slot);
+            }
+        }
+        sector += hdr.num_sectors;
+    }
+    map->restore(max_version, end_sector);
+}
+
+/**
+ * @description: 关闭压缩文件时把页面映射写入映射文件
+ * @param {int} fd 文件句柄
+ * @param {string&} path 文件路径
+ */
+void DiskManager::save_compressed_page_map(int fd, const std::string &path) {
+    std::unique_ptr<CompressedPageMap> map;
+    {
+        std::scoped_lock lock{compressed_map_latch_};
+        map = std::move(compressed_maps_[fd]);
+        compressed_fds_[fd] = false;
+    }
+    std::vector<CompressedPageMap::Slot> slots = map->get_slots();
+    uint64_t num_slots = slots.size();
+    auto &free_slots = map->get_free_slots();
+    for (uint32_t num_sectors = 0; num_sectors < free_slots.size(); num_sectors++) {
+        for (int64_t sector : free_slots[num_sectors]) {
+            slots.push_back(CompressedPageMap::Slot{sector, num_sectors});
+        }
+    }
+    int64_t end_sector = map->get_end_sector();
+    uint64_t next_version = map->get_next_version();
+    uint64_t num_free = slots.size() - num_slots;
+    std::string map_path = get_compressed_page_map_path(path);
+    std::ofstream ofs(map_path, std::ios::binary | std::ios::trunc);
+    ofs.write(reinterpret_cast<const char *>(&end_sector), sizeof(end_sector));
+    ofs.write(reinterpret_cast<const char *>(&next_version), sizeof(next_version));
+    ofs.write(reinterpret_cast<const char *>(&num_slots), sizeof(num_slots));
+    ofs.write(reinterpret_cast<const char *>(&num_free), sizeof(num_free));
+    if (!ofs.write(reinterpret_cast<const char *>(slots.data()), slots.size() * sizeof(slots[0]))) {
+        throw InternalError("DiskManager: failed to write compressed page map " + map_path);
+    }
 }
 
 bool DiskManager::is_dir(const std::string &path) {
@@ -108,17 +731,39 @@ bool DiskManager::is_file(const std::string &path) {
  * @return {*}
  * @param {string} &path
  */
-void DiskManager::create_file(const std::string &path) {
+void DiskManager::create_file(const std::string &path, bool compressed) {
     // Todo:
     // 调用open()函数，使用O_CREAT模式
     // 注意不能重复创建相同文件
-    int fd = open(path.c_str(), O_CREAT | O_EXCL, 0640);
+    int fd = open(path.c_str(), compressed ? O_CREAT | O_EXCL | O_WRONLY : O_CREAT | O_EXCL, 0640);
     if (fd == -1) {
         throw FileExistsError(path);
     }
+    if (compressed) {
+        // 压缩文件以文件头开始，open_file据此识别文件的格式
+        char buf[COMPRESSED_SECTOR_SIZE] = {};
+        CompressedFileHdr hdr;
+        memcpy(hdr.magic, COMPRESSED_FILE_MAGIC, sizeof(hdr.magic));
+        hdr.page_size = page_size_;
+        memcpy(buf, &hdr, sizeof(hdr));
+        if (pwrite(fd, buf, sizeof(buf), 0) != sizeof(buf)) {
+            close(fd);
+            throw UnixError();
+        }
+    }
     close(fd);
 }
 
+/**
+ * @description: 解析出文件的绝对路径，用于文件编号，相对路径依赖于当前所在的数据库目录
+ * @return {string} 绝对路径，无法解析时返回原路径
+ * @param {string} &path 文件所在路径
+ */
+std::string DiskManager::get_absolute_path(const std::string &path) {
+    std::unique_ptr<char, decltype(&free)> resolved(realpath(path.c_str(), nullptr), &free);
+    return resolved != nullptr ? std::string(resolved.get()) : path;
+}
+
 /**
  * @description: 删除指定路径的文件
  * @param {string} &path 文件所在路径
@@ -134,11 +779,17 @@ void DiskManager::destroy_file(const std::string &path) {
     //  It's better to ask for forgiveness than permission
     //  先判断文件是否存在再删除，并发条件下容易出错
 
+    // 删除之后无法再解析路径，先取得文件编号使用的绝对路径
+    std::string absolute_path = get_absolute_path(path);
     //  先清空errno，再判断是否为ENOENT(No such file or directory)
     errno = 0;
     if (unlink(path.c_str()) == -1 && errno == ENOENT) {
         throw FileNotFoundError(path);
     }
+    // 之后在同一路径上创建的文件是另一个文件，使用新的文件编号，也不继承原文件的空闲页面
+    path2file_id_.erase(absolute_path);
+    unlink(get_free_page_map_path(path).c_str());
+    unlink(get_compressed_page_map_path(path).c_str());
 }
 
 /**
@@ -154,12 +805,38 @@ int DiskManager::open_file(const std::string &path) {
         throw FileNotFoundError(path);
     }
     if (path2fd_.find(path) == path2fd_.end()) {
-        int fd = open(path.c_str(), O_RDWR);
+        // 日志文件按字节追加和读取，压缩文件中的槽位按扇区对齐，都不能使用O_DIRECT
+        bool compressed = path != LOG_FILE_NAME && is_compressed_path(path);
+        bool direct = direct_io_ && path != LOG_FILE_NAME && !compressed;
+        int fd = open(path.c_str(), direct ? O_RDWR | O_DIRECT : O_RDWR);
+        if (fd == -1 && direct && errno == EINVAL) {
+            // 文件系统不支持O_DIRECT，退回经过操作系统缓存的读写
+            direct = false;
+            fd = open(path.c_str(), O_RDWR);
+        }
         if (fd == -1) {
             throw UnixError();
         }
         path2fd_[path] = fd;
         fd2path_[fd] = path;
+        direct_fds_[fd] = direct;
+        // 同一文件关闭后重新打开时沿用原来的文件编号，缓冲池中留下的页面仍然可以命中。
+        // 按绝对路径区分文件，不同数据库目录下的同名表是不同的文件
+        std::string absolute_path = get_absolute_path(path);
+        auto it = path2file_id_.find(absolute_path);
+        if (it == path2file_id_.end()) {
+            it = path2file_id_.emplace(absolute_path, next_file_id_++).first;
+        }
+        fd2file_id_[fd] = it->second;
+        fd2reserved_[fd] = get_file_size(path) / page_size_;
+        if (compressed) {
+            // 压缩文件追加写入槽位，不按页面编号预留区段
+            fd2reserved_[fd] = std::numeric_limits<page_id_t>::max();
+            load_compressed_page_map(fd, path);
+        }
+        if (path != LOG_FILE_NAME) {
+            load_free_page_map(fd, path);
+        }
     }
     return path2fd_[path];
 }
@@ -173,7 +850,14 @@ void DiskManager::close_file(int fd) {
     // 调用close()函数
     // 注意不能关闭未打开的文件，并且需要更新文件打开列表
     if (fd2path_.find(fd) != fd2path_.end()) {
+        save_free_page_map(fd, fd2path_[fd]);
+        if (compressed_fds_[fd]) {
+            save_compressed_page_map(fd, fd2path_[fd]);
+        }
         close(fd);
+        direct_fds_[fd] = false;
+        fd2file_id_[fd] = 0;
+        fd2reserved_[fd] = 0;
         std::string path = fd2path_[fd];
         fd2path_.erase(fd2path_.find(fd));
         path2fd_.erase(path2fd_.find(path));
@@ -182,10 +866,10 @@ void DiskManager::close_file(int fd) {
 
 /**
  * @description: 获得文件的大小
- * @return {int} 文件的大小
+ * @return {off_t} 文件的大小，文件不存在时返回-1
  * @param {string} &file_name 文件名
  */
-int DiskManager::get_file_size(const std::string &file_name) {
+off_t DiskManager::get_file_size(const std::string &file_name) {
     struct stat stat_buf;
     int rc = stat(file_name.c_str(), &stat_buf);
     return rc == 0 ? stat_buf.st_size : -1;
@@ -220,23 +904,23 @@ int DiskManager::get_file_fd(const std::string &file_name) {
  * @return {int} 返回读取的数据量，若为-1说明读取数据的起始位置超过了文件大小
  * @param {char} *log_data 读取内容到log_data中
  * @param {int} size 读取的数据量大小
- * @param {int} offset 读取的内容在文件中的位置
+ * @param {off_t} offset 读取的内容在文件中的位置
  */
-int DiskManager::read_log(char *log_data, int size, int offset) {
+int DiskManager::read_log(char *log_data, int size, off_t offset) {
     // read log file from the previous end
     if (log_fd_ == -1) {
         log_fd_ = open_file(LOG_FILE_NAME);
     }
-    int file_size = get_file_size(LOG_FILE_NAME);
+    off_t file_size = get_file_size(LOG_FILE_NAME);
     if (offset > file_size) {
         return -1;
     }
 
-    size = std::min(size, file_size - offset);
+    size = static_cast<int>(std::min<off_t>(size, file_size - offset));
     if (size == 0)
         return 0;
-    lseek(log_fd_, offset, SEEK_SET);
-    ssize_t bytes_read = read(log_fd_, log_data, size);
+    // pread不改变文件偏移量，不影响write_log的追加
+    ssize_t bytes_read = pread(log_fd_, log_data, size, offset);
     assert(bytes_read == size);
     return bytes_read;
 }
@@ -14,14 +14,37 @@ See the Mulan PSL v2 for more details. */
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <atomic>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 
 #include "common/config.h"
+#include "compressed_page_map.h"
 #include "errors.h"
+#include "free_page_map.h"
+#include "io_context.h"
+
+/**
+ * @description: 文件的页面统计，num_pages - num_free_pages即仍在使用的页面个数
+ */
+struct FilePageStats {
+    page_id_t num_pages;      // 文件中分配过的页面个数，即以页面计的文件大小
+    page_id_t num_free_pages; // 已经释放、等待重新分配的页面个数
+};
+
+/**
+ * @description: 压缩文件的空间统计
+ */
+struct CompressedFileStats {
+    size_t num_pages;     // 写入过的页面个数
+    int64_t stored_bytes; // 页面压缩后占用的字节数，包括槽位头和扇区对齐
+    int64_t free_bytes;   // 空闲槽位的字节数，之后写回的页面会复用它们
+};
 
 /**
  * @description: DiskManager的作用主要是根据上层的需要对磁盘文件进行操作
@@ -36,9 +59,114 @@ class DiskManager {
 
     void read_page(int fd, page_id_t page_no, char *offset, int num_bytes);
 
+    void write_pages(int fd, page_id_t start_page_no, char *const *bufs, int num_pages);
+
+    void prefetch_pages(int fd, page_id_t start_page_no, int num_pages);
+
+    bool set_io_backend(const std::string &backend);
+
+    /**
+     * @description: 获得异步I/O实际使用的后端，设置为io_uring而内核不支持时为thread_pool
+     */
+    const std::string &get_io_backend() const {
+        return io_backend_;
+    }
+
+    /**
+     * @description: 设置之后打开的表文件和索引文件是否使用O_DIRECT，使缓冲池成为唯一的缓存，应在启动时调用
+     * @param {bool} direct_io 是否使用O_DIRECT
+     */
+    void set_direct_io(bool direct_io) {
+        direct_io_ = direct_io;
+    }
+
+    bool is_direct_io() const {
+        return direct_io_;
+    }
+
+    /**
+     * @description: 文件是否以O_DIRECT打开，文件系统不支持O_DIRECT时即使设置了direct_io也为false
+     * @param {int} fd 文件句柄
+     */
+    bool is_direct_file(int fd) const {
+        return direct_fds_[fd];
+    }
+
+    /**
+     * @description: 设置数据库的页面大小，应在打开任何表文件和索引文件之前调用，之后页面编号按这个大小换算文件偏移量
+     * @param {int} page_size 页面大小，必须满足is_valid_page_size
+     */
+    void set_page_size(int page_size) {
+        if (!is_valid_page_size(page_size)) {
+            throw InternalError("DiskManager: invalid page size " + std::to_string(page_size));
+        }
+        page_size_ = page_size;
+    }
+
+    int get_page_size() const {
+        return page_size_;
+    }
+
+    /**
+     * @description: 页面大小是否合法：PAGE_SIZE到MAX_PAGE_SIZE之间的2的幂，从而总是O_DIRECT对齐单位的整数倍
+     */
+    static bool is_valid_page_size(int page_size) {
+        return page_size >= PAGE_SIZE && page_size <= MAX_PAGE_SIZE && (page_size & (page_size - 1)) == 0;
+    }
+
+    /**
+     * @description: 设置扩展文件时预留的区段大小，应在启动时调用。区段从min_pages开始，随文件增大翻倍，最大为max_pages
+     * @param {int} min_pages 最小的区段页面个数
+     * @param {int} max_pages 最大的区段页面个数，为0时不预留，每次分配页面只扩展一页
+     */
+    void set_extent_size(int min_pages, int max_pages) {
+        extent_min_pages_ = std::min(min_pages, max_pages);
+        extent_max_pages_ = max_pages;
+    }
+
+    /**
+     * @description: 获得文件在磁盘上已经预留空间的页面个数，分配的页面编号小于它时不需要文件系统再分配磁盘块
+     * @param {int} fd 文件句柄
+     */
+    page_id_t get_reserved_pages(int fd) const {
+        return fd2reserved_[fd];
+    }
+
+    /**
+     * @description: 文件是否以压缩格式存放页面，见create_file
+     * @param {int} fd 文件句柄
+     */
+    bool is_compressed_file(int fd) const {
+        return compressed_fds_[fd];
+    }
+
+    bool get_compressed_stats(int fd, CompressedFileStats *stats);
+
+    /**
+     * @description: 获得文件的编号。fd在文件关闭后会被复用，而文件编号按路径分配，同一路径的文件重新打开后编号不变，
+     * 文件被删除后再创建则分配新的编号，缓冲池用它区分先后使用同一个fd的不同文件
+     * @return {uint32_t} 文件编号，fd没有通过open_file打开时为0
+     * @param {int} fd 文件句柄
+     */
+    uint32_t get_file_id(int fd) const {
+        return fd >= 0 && fd < MAX_FD ? fd2file_id_[fd].load() : 0;
+    }
+
+    std::unique_ptr<IoContext> create_io_context(unsigned depth = IO_QUEUE_DEPTH);
+
     page_id_t allocate_page(int fd);
 
-    void deallocate_page(page_id_t page_id);
+    void deallocate_page(int fd, page_id_t page_no);
+
+    bool reclaim_page(int fd, page_id_t page_no);
+
+    bool is_page_free(int fd, page_id_t page_no);
+
+    void truncate_file(int fd, page_id_t num_pages);
+
+    void sync_file(int fd);
+
+    FilePageStats get_page_stats(int fd);
 
     /*目录操作*/
     bool is_dir(const std::string &path);
@@ -50,7 +178,7 @@ class DiskManager {
     /*文件操作*/
     bool is_file(const std::string &path);
 
-    void create_file(const std::string &path);
+    void create_file(const std::string &path, bool compressed = false);
 
     void destroy_file(const std::string &path);
 
@@ -58,14 +186,14 @@ class DiskManager {
 
     void close_file(int fd);
 
-    int get_file_size(const std::string &file_name);
+    off_t get_file_size(const std::string &file_name);
 
     std::string get_file_name(int fd);
 
     int get_file_fd(const std::string &file_name);
 
     /*日志操作*/
-    int read_log(char *log_data, int size, int offset);
+    int read_log(char *log_data, int size, off_t offset);
 
     void write_log(char *log_data, int size);
 
@@ -98,10 +226,74 @@ class DiskManager {
     static constexpr int MAX_FD = 8192;
 
   private:
+    /**
+     * @description: O_DIRECT文件的读写是否满足对齐要求，其他文件总是返回true
+     */
+    bool is_direct_aligned(int fd, const char *buf, int num_bytes) const {
+        return !direct_fds_[fd] || (reinterpret_cast<uintptr_t>(buf) % PAGE_SIZE == 0 && num_bytes % PAGE_SIZE == 0);
+    }
+
+    void write_page_unaligned(int fd, page_id_t page_no, const char *offset, int num_bytes);
+
+    void read_page_unaligned(int fd, page_id_t page_no, char *offset, int num_bytes);
+
+    static std::string get_absolute_path(const std::string &path);
+
+    static std::string get_free_page_map_path(const std::string &path) {
+        return path + FREE_PAGE_MAP_SUFFIX;
+    }
+
+    void load_free_page_map(int fd, const std::string &path);
+
+    void save_free_page_map(int fd, const std::string &path);
+
+    void reserve_extent(int fd, page_id_t page_no);
+
+    static std::string get_compressed_page_map_path(const std::string &path) {
+        return path + COMPRESSED_PAGE_MAP_SUFFIX;
+    }
+
+    static bool is_compressed_path(const std::string &path);
+
+    void write_compressed_page(int fd, page_id_t page_no, const char *offset, int num_bytes);
+
+    void read_compressed_page(int fd, page_id_t page_no, char *offset, int num_bytes);
+
+    void free_compressed_page(int fd, page_id_t page_no);
+
+    void load_compressed_page_map(int fd, const std::string &path);
+
+    void rebuild_compressed_page_map(int fd, const std::string &path, CompressedPageMap *map);
+
+    void save_compressed_page_map(int fd, const std::string &path);
+
     // 文件打开列表，用于记录文件是否被打开
     std::unordered_map<std::string, int> path2fd_; //<Page文件磁盘路径,Page fd>哈希表
     std::unordered_map<int, std::string> fd2path_; //<Page fd,Page文件磁盘路径>哈希表
+    std::unordered_map<std::string, uint32_t> path2file_id_; //<Page文件绝对路径,文件编号>哈希表，文件删除前一直保留
 
     int log_fd_ = -1; // WAL日志文件的文件句柄，默认为-1，代表未打开日志文件
     std::atomic<page_id_t> fd2pageno_[MAX_FD]{}; // 文件中已经分配的页面个数，初始值为0
+
+    // 每个打开的文件已经释放的页面，只有释放过页面或者磁盘上有空闲页面位图的文件才创建，关闭文件时写回磁盘
+    std::unique_ptr<FreePageMap> free_page_maps_[MAX_FD];
+    std::mutex free_page_map_latch_; // 保护free_page_maps_，分配和释放页面时加锁
+
+    int page_size_ = PAGE_SIZE; // 数据库的页面大小，表文件和索引文件中的页面都是这个大小
+
+    int extent_min_pages_ = EXTENT_MIN_PAGES;      // 最小的区段页面个数
+    int extent_max_pages_ = EXTENT_MAX_PAGES;      // 最大的区段页面个数，0表示不预留
+    std::atomic<page_id_t> fd2reserved_[MAX_FD]{}; // 文件中已经预留磁盘空间的页面个数
+    std::mutex extent_latch_;                      // 串行化预留区段的fallocate
+
+    // 压缩文件的页面映射，打开时从磁盘上的映射文件读入（没有时扫描文件重建），关闭时写回
+    std::unique_ptr<CompressedPageMap> compressed_maps_[MAX_FD];
+    std::atomic<bool> compressed_fds_[MAX_FD]{}; // 以压缩格式存放页面的文件
+    std::mutex compressed_map_latch_;            // 保护compressed_maps_中的映射
+
+    std::string io_backend_ = IO_BACKEND;        // create_io_context使用的异步I/O后端
+    bool direct_io_ = false;                     // 表文件和索引文件是否使用O_DIRECT打开
+    std::atomic<bool> direct_fds_[MAX_FD]{};     // 以O_DIRECT打开的文件
+    std::atomic<uint32_t> fd2file_id_[MAX_FD]{}; // 文件句柄到文件编号的映射，0表示没有打开
+    std::atomic<uint32_t> next_file_id_{1};      // 下一个分配的文件编号
 };
\ No newline at end of file
@@ -0,0 +1,128 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+
+/**
+ * @description: 一个文件的空闲页面位图，第i位为1表示第i页已经被释放、可以重新分配。
+ * 位图按64位字存放，分配时从记录的最小非零字开始用ctz找到最小的空闲页，优先复用文件前部的页面
+ */
+class FreePageMap {
+  public:
+    FreePageMap() = default;
+
+    /**
+     * @param {vector<uint64_t>} words 从磁盘读出的位图
+     */
+    explicit FreePageMap(std::vector<uint64_t> words) : words_(std::move(words)) {
+        for (uint64_t word : words_) {
+            num_free_ += __builtin_popcountll(word);
+        }
+    }
+
+    bool is_free(page_id_t page_no) const {
+        size_t i = static_cast<size_t>(page_no) / WORD_BITS;
+        return i < words_.size() && (words_[i] >> (page_no % WORD_BITS) & 1) != 0;
+    }
+
+    /**
+     * @description: 把页面标记为空闲
+     * @return {bool} 页面原来不是空闲的则返回true
+     * @param {page_id_t} page_no 页面编号
+     */
+    bool set_free(page_id_t page_no) {
+        size_t i = static_cast<size_t>(page_no) / WORD_BITS;
+        if (i >= words_.size()) {
+            words_.resize(i + 1, 0);
+        }
+        uint64_t bit = static_cast<uint64_t>(1) << (page_no % WORD_BITS);
+        if ((words_[i] & bit) != 0) {
+            return false;
+        }
+        words_[i] |= bit;
+        num_free_++;
+        first_word_ = std::min(first_word_, i);
+        return true;
+    }
+
+    /**
+     * @description: 把空闲页面重新标记为已使用
+     * @return {bool} 页面原来是空闲的则返回true
+     * @param {page_id_t} page_no 页面编号
+     */
+    bool set_used(page_id_t page_no) {
+        if (!is_free(page_no)) {
+            return false;
+        }
+        words_[page_no / WORD_BITS] &= ~(static_cast<uint64_t>(1) << (page_no % WORD_BITS));
+        num_free_--;
+        return true;
+    }
+
+    /**
+     * @description: 取出编号最小的空闲页面
+     * @return {page_id_t} 空闲页面的编号，没有空闲页面时返回INVALID_PAGE_ID
+     */
+    page_id_t allocate() {
+        if (num_free_ == 0) {
+            return INVALID_PAGE_ID;
+        }
+        while (words_[first_word_] == 0) {
+            first_word_++;
+        }
+        uint64_t &word = words_[first_word_];
+        int bit = __builtin_ctzll(word);
+        word &= word - 1;
+        num_free_--;
+        return static_cast<page_id_t>(first_word_ * WORD_BITS + bit);
+    }
+
+    /**
+     * @description: 文件截断到num_pages个页面时删除编号不小于num_pages的页面
+     * @param {page_id_t} num_pages 截断后的页面个数
+     */
+    void truncate(page_id_t num_pages) {
+        size_t num_words = (static_cast<size_t>(num_pages) + WORD_BITS - 1) / WORD_BITS;
+        if (num_words > words_.size()) {
+            return;
+        }
+        words_.resize(num_words);
+        if (num_pages % WORD_BITS != 0) {
+            words_.back() &= (static_cast<uint64_t>(1) << (num_pages % WORD_BITS)) - 1;
+        }
+        num_free_ = 0;
+        for (uint64_t word : words_) {
+            num_free_ += __builtin_popcountll(word);
+        }
+        first_word_ = std::min(first_word_, words_.size());
+    }
+
+    size_t get_num_free() const {
+        return num_free_;
+    }
+
+    const std::vector<uint64_t> &get_words() const {
+        return words_;
+    }
+
+  private:
+    static constexpr size_t WORD_BITS = 64;
+
+    std::vector<uint64_t> words_; // 空闲页面位图
+    size_t num_free_ = 0;         // 位图中1的个数
+    size_t first_word_ = 0;       // 第一个可能非零的字，之前的字全为0
+};
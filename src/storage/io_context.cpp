@@ -0,0 +1,261 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "storage/io_context.h"
+
+#include <errno.h>       // for errno
+#include <string.h>      // for memset
+#include <sys/mman.h>    // for mmap, munmap
+#include <sys/syscall.h> // for SYS_io_uring_setup, SYS_io_uring_enter
+#include <unistd.h>      // for pread, pwrite, syscall
+
+#include <algorithm>
+
+#include "errors.h"
+
+// glibc没有提供io_uring的系统调用封装，直接使用syscall
+static int io_uring_setup(unsigned entries, io_uring_params *params) {
+    return static_cast<int>(syscall(SYS_io_uring_setup, entries, params));
+}
+
+static int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(syscall(SYS_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+/**
+ * @description: 创建io_uring实例并映射提交队列和完成队列，失败时抛出UnixError
+ * @param {unsigned} depth 队列深度
+ */
+IoUringContext::IoUringContext(unsigned depth) : IoContext(depth) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring_fd_ = io_uring_setup(depth, &params);
+    if (ring_fd_ < 0) {
+        throw UnixError();
+    }
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    // 内核支持IORING_FEAT_SINGLE_MMAP时两个队列共用一次映射
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                    IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+        sq_ring_ = nullptr;
+        close(ring_fd_);
+        throw UnixError();
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cq_ring_ = sq_ring_;
+    } else {
+        cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                        IORING_OFF_CQ_RING);
+    }
+    sqes_ = static_cast<io_uring_sqe *>(mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                             ring_fd_, IORING_OFF_SQES));
+    if (cq_ring_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+        int err = errno;
+        if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+            munmap(cq_ring_, cq_ring_size_);
+        }
+        if (sqes_ != MAP_FAILED) {
+            munmap(sqes_, sqes_size_);
+        }
+        munmap(sq_ring_, sq_ring_size_);
+        close(ring_fd_);
+        errno = err;
+        throw UnixError();
+    }
+    char *sq = static_cast<char *>(sq_ring_);
+    sq_head_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    char *cq = static_cast<char *>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+}
+
+IoUringContext::~IoUringContext() {
+    // 关闭前收取所有进行中的请求，内核不会再写调用者的缓冲区
+    std::vector<IoRequest *> requests(depth_);
+    while (num_in_flight_ > 0) {
+        wait(requests.data(), requests.size(), num_in_flight_);
+    }
+    munmap(sqes_, sqes_size_);
+    if (cq_ring_ != sq_ring_) {
+        munmap(cq_ring_, cq_ring_size_);
+    }
+    munmap(sq_ring_, sq_ring_size_);
+    close(ring_fd_);
+}
+
+/**
+ * @description: 当前内核是否支持io_uring（可能被内核版本、seccomp或kernel.io_uring_disabled禁用）
+ */
+bool IoUringContext::is_supported() {
+    static const bool supported = [] {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        int ring_fd = io_uring_setup(1, &params);
+        if (ring_fd < 0) {
+            return false;
+        }
+        close(ring_fd);
+        // submit使用的IORING_OP_READ/IORING_OP_WRITE需要5.6以上的内核，此版本同时引入了IORING_FEAT_RW_CUR_POS
+        return (params.features & IORING_FEAT_RW_CUR_POS) != 0;
+    }();
+    return supported;
+}
+
+void IoUringContext::submit(IoRequest *const *requests, size_t num) {
+    if (num_in_flight_ + num > depth_) {
+        throw InternalError("IoUringContext::submit: too many requests in flight");
+    }
+    unsigned tail = *sq_tail_;
+    for (size_t i = 0; i < num; i++) {
+        unsigned index = tail & *sq_mask_;
+        io_uring_sqe *sqe = &sqes_[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = requests[i]->op == IoOpType::READ ? IORING_OP_READ : IORING_OP_WRITE;
+        sqe->fd = requests[i]->fd;
+        sqe->off = static_cast<uint64_t>(requests[i]->page_no) * page_size_;
+        sqe->addr = reinterpret_cast<uint64_t>(requests[i]->buf);
+        sqe->len = requests[i]->num_bytes;
+        sqe->user_data = reinterpret_cast<uint64_t>(requests[i]);
+        sq_array_[index] = index;
+        tail++;
+    }
+    // 填好提交队列项之后才能让内核看到新的tail
+    __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+    size_t num_submitted = 0;
+    while (num_submitted < num) {
+        int ret = io_uring_enter(ring_fd_, num - num_submitted, 0, 0);
+        if (ret < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                continue;
+            }
+            // 已经提交的请求仍在进行中，之后的wait会收取它们；未提交的队列项从提交队列中撤回
+            num_in_flight_ += num_submitted;
+            __atomic_store_n(sq_tail_, tail - static_cast<unsigned>(num - num_submitted), __ATOMIC_RELEASE);
+            throw UnixError();
+        }
+        num_submitted += ret;
+    }
+    num_in_flight_ += num;
+}
+
+size_t IoUringContext::wait(IoRequest **requests, size_t max_num, size_t min_num) {
+    min_num = std::min({min_num, max_num, num_in_flight_});
+    size_t num = 0;
+    while (true) {
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        while (head != tail && num < max_num) {
+            io_uring_cqe *cqe = &cqes_[head & *cq_mask_];
+            IoRequest *request = reinterpret_cast<IoRequest *>(cqe->user_data);
+            request->result = cqe->res;
+            requests[num++] = request;
+            head++;
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        if (num >= min_num) {
+            break;
+        }
+        if (io_uring_enter(ring_fd_, 0, min_num - num, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+            throw UnixError();
+        }
+    }
+    num_in_flight_ -= num;
+    return num;
+}
+
+/**
+ * @description: 创建num_threads个工作线程
+ * @param {unsigned} depth 队列深度
+ * @param {unsigned} num_threads 工作线程的个数，超过队列深度的线程没有意义
+ */
+ThreadPoolIoContext::ThreadPoolIoContext(unsigned depth, unsigned num_threads) : IoContext(depth) {
+    num_threads = std::clamp(num_threads, 1u, std::max(depth, 1u));
+    for (unsigned i = 0; i < num_threads; i++) {
+        workers_.emplace_back([this]() {
+            std::unique_lock lock{latch_};
+            while (true) {
+                submitted_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+                if (pending_.empty()) {
+                    return;
+                }
+                IoRequest *request = pending_.front();
+                pending_.pop_front();
+                lock.unlock();
+                off_t offset = static_cast<off_t>(request->page_no) * page_size_;
+                ssize_t ret = request->op == IoOpType::READ
+                                  ? pread(request->fd, request->buf, request->num_bytes, offset)
+                                  : pwrite(request->fd, request->buf, request->num_bytes, offset);
+                request->result = ret < 0 ? -errno : static_cast<int>(ret);
+                lock.lock();
+                completed_requests_.push_back(request);
+                completed_.notify_all();
+            }
+        });
+    }
+}
+
+ThreadPoolIoContext::~ThreadPoolIoContext() {
+    {
+        // 工作线程处理完已提交的请求后退出
+        std::scoped_lock lock{latch_};
+        stop_ = true;
+    }
+    submitted_.notify_all();
+    for (auto &worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPoolIoContext::submit(IoRequest *const *requests, size_t num) {
+    if (num_in_flight_ + num > depth_) {
+        throw InternalError("ThreadPoolIoContext::submit: too many requests in flight");
+    }
+    {
+        std::scoped_lock lock{latch_};
+        pending_.insert(pending_.end(), requests, requests + num);
+    }
+    submitted_.notify_all();
+    num_in_flight_ += num;
+}
+
+size_t ThreadPoolIoContext::wait(IoRequest **requests, size_t max_num, size_t min_num) {
+    min_num = std::min({min_num, max_num, num_in_flight_});
+    std::unique_lock lock{latch_};
+    completed_.wait(lock, [this, min_num] { return completed_requests_.size() >= min_num; });
+    size_t num = std::min(max_num, completed_requests_.size());
+    std::copy_n(completed_requests_.begin(), num, requests);
+    completed_requests_.erase(completed_requests_.begin(), completed_requests_.begin() + num);
+    num_in_flight_ -= num;
+    return num;
+}
+
+std::unique_ptr<IoContext> create_io_context(const std::string &backend, unsigned depth, int page_size) {
+    std::unique_ptr<IoContext> io;
+    if (backend == "io_uring" && IoUringContext::is_supported()) {
+        io = std::make_unique<IoUringContext>(depth);
+    } else if (backend == "io_uring" || backend == "thread_pool") {
+        io = std::make_unique<ThreadPoolIoContext>(depth, IO_THREADS);
+    }
+    if (io != nullptr) {
+        io->set_page_size(page_size);
+    }
+    return io;
+}
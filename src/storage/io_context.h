@@ -0,0 +1,163 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <linux/io_uring.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/config.h"
+
+enum class IoOpType { READ, WRITE };
+
+/**
+ * @description: 一个异步读写页面的请求，由调用者分配，在完成之前不能释放
+ */
+struct IoRequest {
+    IoOpType op;       // 读或写
+    int fd;            // 文件句柄
+    page_id_t page_no; // 读写的页面编号
+    char *buf;         // 读入的目标或写出的数据
+    int num_bytes;     // 读写的字节数
+    void *user_data;   // 调用者的上下文，完成时原样返回
+    int result = 0;    // 完成后为实际读写的字节数，出错时为-errno
+};
+
+/**
+ * @description: 异步I/O的提交/完成队列。调用者一次提交多个请求，之后再收取已完成的请求，
+ * 从而让同时在进行中的I/O达到队列深度。一个IoContext只能由一个线程使用，需要并发的调用者各自创建IoContext
+ */
+class IoContext {
+  public:
+    explicit IoContext(unsigned depth) : depth_(depth) {
+    }
+
+    virtual ~IoContext() = default;
+
+    /**
+     * @description: 提交num个请求，立即返回
+     * @param {IoRequest**} requests 请求数组
+     * @param {size_t} num 请求的个数，加上进行中的请求不能超过队列深度，否则抛出InternalError
+     */
+    virtual void submit(IoRequest *const *requests, size_t num) = 0;
+
+    /**
+     * @description: 收取已完成的请求，至少收取min_num个才返回
+     * @return {size_t} 收取的请求个数
+     * @param {IoRequest**} requests 存放已完成的请求
+     * @param {size_t} max_num 最多收取的个数
+     * @param {size_t} min_num 至少收取的个数，不能超过进行中的请求个数，为0时不等待
+     */
+    virtual size_t wait(IoRequest **requests, size_t max_num, size_t min_num) = 0;
+
+    virtual std::string get_backend() const = 0;
+
+    unsigned get_depth() const {
+        return depth_;
+    }
+
+    size_t get_num_in_flight() const {
+        return num_in_flight_;
+    }
+
+    /**
+     * @description: 设置页面大小，请求的文件偏移量为page_no乘以页面大小，应在提交请求之前调用
+     */
+    void set_page_size(int page_size) {
+        page_size_ = page_size;
+    }
+
+  protected:
+    unsigned depth_;            // 队列深度，即最多同时进行的请求个数
+    size_t num_in_flight_ = 0;  // 已提交而还未收取的请求个数
+    int page_size_ = PAGE_SIZE; // 页面大小
+};
+
+/**
+ * @description: 基于io_uring的IoContext，请求直接提交给内核，不需要额外的线程
+ */
+class IoUringContext : public IoContext {
+  public:
+    explicit IoUringContext(unsigned depth);
+
+    ~IoUringContext() override;
+
+    void submit(IoRequest *const *requests, size_t num) override;
+
+    size_t wait(IoRequest **requests, size_t max_num, size_t min_num) override;
+
+    std::string get_backend() const override {
+        return "io_uring";
+    }
+
+    static bool is_supported();
+
+  private:
+    int ring_fd_ = -1;
+    // 提交队列
+    void *sq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    unsigned *sq_head_;
+    unsigned *sq_tail_;
+    unsigned *sq_mask_;
+    unsigned *sq_array_;
+    io_uring_sqe *sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+    // 完成队列
+    void *cq_ring_ = nullptr;
+    size_t cq_ring_size_ = 0;
+    unsigned *cq_head_;
+    unsigned *cq_tail_;
+    unsigned *cq_mask_;
+    io_uring_cqe *cqes_;
+};
+
+/**
+ * @description: 不支持io_uring时使用的IoContext，由私有的线程池调用pread/pwrite完成请求
+ */
+class ThreadPoolIoContext : public IoContext {
+  public:
+    ThreadPoolIoContext(unsigned depth, unsigned num_threads);
+
+    ~ThreadPoolIoContext() override;
+
+    void submit(IoRequest *const *requests, size_t num) override;
+
+    size_t wait(IoRequest **requests, size_t max_num, size_t min_num) override;
+
+    std::string get_backend() const override {
+        return "thread_pool";
+    }
+
+  private:
+    std::vector<std::thread> workers_;
+    std::mutex latch_;
+    std::condition_variable submitted_; // 有新的请求或需要退出时唤醒工作线程
+    std::condition_variable completed_; // 有请求完成时唤醒wait
+    std::deque<IoRequest *> pending_;   // 还未开始的请求
+    std::deque<IoRequest *> completed_requests_;
+    bool stop_ = false;
+};
+
+/**
+ * @description: 根据名称创建IoContext
+ * @return {unique_ptr<IoContext>} 创建的IoContext，名称未知时返回nullptr
+ * @param {string&} backend "io_uring"或"thread_pool"，内核不支持io_uring时使用thread_pool
+ * @param {unsigned} depth 队列深度
+ * @param {int} page_size 页面大小
+ */
+std::unique_ptr<IoContext> create_io_context(const std::string &backend, unsigned depth, int page_size = PAGE_SIZE);
@@ -33,34 +33,66 @@ struct PageId {
     }
 
     inline int64_t Get() const {
-        return (static_cast<int64_t>(fd << 16) | page_no);
+        return static_cast<int64_t>((static_cast<uint64_t>(static_cast<uint32_t>(fd)) << 32) |
+                                    static_cast<uint32_t>(page_no));
     }
 };
 
+/**
+ * @description: 缓冲池页表的键，高32位是按文件路径分配的文件编号（见DiskManager::get_file_id），低32位是页面编号。
+ * 文件编号不像fd那样在文件关闭后被复用，因此关闭文件后留在缓冲池中的页面不会被之后打开的其他文件误命中
+ */
+using page_key_t = uint64_t;
+
+inline page_key_t make_page_key(uint32_t file_id, page_id_t page_no) {
+    return (static_cast<page_key_t>(file_id) << 32) | static_cast<uint32_t>(page_no);
+}
+
+/**
+ * @description: 64位整数的混合哈希（splitmix64的终结函数），键的每一位都会影响结果的所有位，
+ * 连续的页面编号和不同文件的相同页面编号都能均匀分布
+ */
+inline size_t hash_page_key(page_key_t key) {
+    key ^= key >> 30;
+    key *= 0xBF58476D1CE4E5B9ULL;
+    key ^= key >> 27;
+    key *= 0x94D049BB133111EBULL;
+    key ^= key >> 31;
+    return static_cast<size_t>(key);
+}
+
 // PageId的自定义哈希算法, 用于构建unordered_map<PageId, frame_id_t, PageIdHash>
 struct PageIdHash {
     size_t operator()(const PageId &x) const {
-        return (x.fd << 16) | x.page_no;
+        return hash_page_key(static_cast<page_key_t>(x.Get()));
     }
 };
 
 template <> struct std::hash<PageId> {
     size_t operator()(const PageId &obj) const {
-        return std::hash<int64_t>()(obj.Get());
+        return PageIdHash()(obj);
     }
 };
 
+/**
+ * @description: 帧的I/O状态，缓冲池在不持有分片锁的情况下读写磁盘时使用
+ */
+enum class FrameIoState {
+    READY = 0,    // 帧中的数据有效，没有进行中的I/O
+    LOADING,      // 正在从磁盘读入页面，数据尚不可用
+    WRITING_BACK, // 正在将脏页写回磁盘，数据仍然有效
+};
+
 /**
  * @description: Page类声明, Page是RMDB数据块的单位、是负责数据操作Record模块的操作对象，
- * Page对象在磁盘上有文件存储, 若在Buffer中则有帧偏移, 并非特指Buffer或Disk上的数据
+ * Page对象在磁盘上有文件存储, 若在Buffer中则有帧偏移, 并非特指Buffer或Disk上的数据。
+ * Page只保存帧的元数据，页面数据位于缓冲池按页对齐的连续内存中，由data_指向
  */
 class Page {
     friend class BufferPoolManager;
 
   public:
-    Page() {
-        reset_memory();
-    }
+    Page() = default;
 
     ~Page() = default;
 
@@ -93,21 +125,27 @@ class Page {
     }
 
   private:
-    void reset_memory() {
-        memset(data_, OFFSET_PAGE_START, PAGE_SIZE);
-    } // 将data_的PAGE_SIZE个字节填充为0
+    void reset_memory(int page_size) {
+        memset(data_, OFFSET_PAGE_START, page_size);
+    } // 将data_的page_size个字节填充为0
 
     /** page的唯一标识符 */
     PageId id_;
 
+    /** 页面在页表中的键，id_.fd对应的文件关闭后仍然能找到页表中的旧页面 */
+    page_key_t key_ = 0;
+
     /** The actual data that is stored within a page.
-     *  该页面在bufferPool中的偏移地址
+     *  该页面在bufferPool中的偏移地址，指向缓冲池的帧内存中按页面大小划分的一段，由缓冲池在构造时设置
      */
-    char data_[PAGE_SIZE] = {};
+    char *data_ = nullptr;
 
     /** 脏页判断 */
     bool is_dirty_ = false;
 
     /** The pin count of this page. */
     int pin_count_ = 0;
+
+    /** 帧的I/O状态，由所在分片的latch保护 */
+    FrameIoState io_state_ = FrameIoState::READY;
 };
\ No newline at end of file
@@ -0,0 +1,192 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "storage/page_codec.h"
+
+#include <cstdint>
+#include <cstring>
+
+static constexpr int MIN_MATCH = 4;       // 最短的匹配长度
+static constexpr int MAX_OFFSET = 65535;  // 匹配距离用2字节存放
+static constexpr int HASH_BITS = 12;      // 哈希表4096项
+static constexpr int LAST_LITERALS = 5;   // 结尾的若干字节总是作为字面量，匹配不会越过数据末尾
+static constexpr int RUN_MASK = 15;       // token中长度字段的最大值，之后是扩展长度
+
+static inline uint32_t read32(const char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t hash4(uint32_t v) {
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/**
+ * @description: 写入超过RUN_MASK的长度的扩展字节
+ * @return {char*} 写入之后的位置，空间不足时返回nullptr
+ */
+static char *write_length(char *op, const char *op_end, int len) {
+    for (; len >= 255; len -= 255) {
+        if (op >= op_end) {
+            return nullptr;
+        }
+        *op++ = static_cast<char>(255);
+    }
+    if (op >= op_end) {
+        return nullptr;
+    }
+    *op++ = static_cast<char>(len);
+    return op;
+}
+
+/**
+ * @description: 写入一个序列：字面量，以及匹配距离和匹配长度（match_len为0表示最后一个序列，只有字面量）
+ * @return {char*} 写入之后的位置，空间不足时返回nullptr
+ */
+static char *write_sequence(char *op, const char *op_end, const char *literals, int lit_len, int offset,
+                            int match_len) {
+    if (op >= op_end) {
+        return nullptr;
+    }
+    char *token = op++;
+    int lit_code = lit_len < RUN_MASK ? lit_len : RUN_MASK;
+    int match_code = 0;
+    if (match_len > 0) {
+        match_code = match_len - MIN_MATCH < RUN_MASK ? match_len - MIN_MATCH : RUN_MASK;
+    }
+    *token = static_cast<char>(lit_code << 4 | match_code);
+    if (lit_code == RUN_MASK && (op = write_length(op, op_end, lit_len - RUN_MASK)) == nullptr) {
+        return nullptr;
+    }
+    if (op_end - op < lit_len) {
+        return nullptr;
+    }
+    memcpy(op, literals, lit_len);
+    op += lit_len;
+    if (match_len == 0) {
+        return op;
+    }
+    if (op_end - op < 2) {
+        return nullptr;
+    }
+    *op++ = static_cast<char>(offset & 0xff);
+    *op++ = static_cast<char>(offset >> 8);
+    if (match_code == RUN_MASK) {
+        op = write_length(op, op_end, match_len - MIN_MATCH - RUN_MASK);
+    }
+    return op;
+}
+
+int page_compress(const char *src, int src_len, char *dst, int dst_capacity) {
+    // 哈希表记录最近一次出现每个4字节序列的位置，页面不超过64KB，用16位存放
+    uint16_t table[1 << HASH_BITS];
+    memset(table, 0, sizeof(table));
+    const char *ip = src;
+    const char *anchor = src; // 还没有输出的字面量的起点
+    const char *src_end = src + src_len;
+    const char *match_limit = src_end - LAST_LITERALS;
+    char *op = dst;
+    const char *op_end = dst + dst_capacity;
+
+    if (src_len > MIN_MATCH + LAST_LITERALS) {
+        ip++;
+        while (ip + MIN_MATCH <= match_limit) {
+            uint32_t h = hash4(read32(ip));
+            const char *ref = src + table[h];
+            table[h] = static_cast<uint16_t>(ip - src);
+            if (ref >= ip || ip - ref > MAX_OFFSET || read32(ref) != read32(ip)) {
+                ip++;
+                continue;
+            }
+            // 向后延伸匹配，再向前合并与字面量相同的字节
+            int match_len = MIN_MATCH;
+            while (ip + match_len < match_limit && ref[match_len] == ip[match_len]) {
+                match_len++;
+            }
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+                match_len++;
+            }
+            op = write_sequence(op, op_end, anchor, static_cast<int>(ip - anchor), static_cast<int>(ip - ref),
+                                match_len);
+            if (op == nullptr) {
+                return 0;
+            }
+            ip += match_len;
+            anchor = ip;
+            // 匹配的末尾也加入哈希表，使连续的重复数据能接上
+            if (ip - 2 > src) {
+                table[hash4(read32(ip - 2))] = static_cast<uint16_t>(ip - 2 - src);
+            }
+        }
+    }
+    op = write_sequence(op, op_end, anchor, static_cast<int>(src_end - anchor), 0, 0);
+    return op == nullptr ? 0 : static_cast<int>(op - dst);
+}
+
+/**
+ * @description: 读取token之后的扩展长度
+ * @return {bool} 数据没有越界则返回true
+ */
+static bool read_length(const unsigned char *&ip, const unsigned char *ip_end, int *len) {
+    unsigned char b;
+    do {
+        if (ip >= ip_end) {
+            return false;
+        }
+        b = *ip++;
+        *len += b;
+    } while (b == 255);
+    return true;
+}
+
+bool page_decompress(const char *src, int src_len, char *dst, int dst_len) {
+    auto ip = reinterpret_cast<const unsigned char *>(src);
+    const unsigned char *ip_end = ip + src_len;
+    char *op = dst;
+    char *op_end = dst + dst_len;
+    while (ip < ip_end) {
+        unsigned char token = *ip++;
+        int lit_len = token >> 4;
+        if (lit_len == RUN_MASK && !read_length(ip, ip_end, &lit_len)) {
+            return false;
+        }
+        if (ip_end - ip < lit_len || op_end - op < lit_len) {
+            return false;
+        }
+        memcpy(op, ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+        if (ip == ip_end) {
+            break; // 最后一个序列
+        }
+        if (ip_end - ip < 2) {
+            return false;
+        }
+        int offset = ip[0] | ip[1] << 8;
+        ip += 2;
+        int match_len = (token & RUN_MASK) + MIN_MATCH;
+        if ((token & RUN_MASK) == RUN_MASK && !read_length(ip, ip_end, &match_len)) {
+            return false;
+        }
+        if (offset == 0 || offset > op - dst || op_end - op < match_len) {
+            return false;
+        }
+        // 匹配可能与要写入的区域重叠，逐字节复制
+        const char *ref = op - offset;
+        for (int i = 0; i < match_len; i++) {
+            op[i] = ref[i];
+        }
+        op += match_len;
+    }
+    return op == op_end;
+}
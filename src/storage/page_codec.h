@@ -0,0 +1,39 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+/**
+ * 页面压缩使用的LZ4风格的字节级LZ77编码，不依赖外部库。
+ * 压缩结果由若干序列组成，每个序列为：
+ *   token(1字节，高4位为字面量长度，低4位为匹配长度-4，取15时后面跟着若干字节的扩展长度，每字节最多255)
+ *   字面量 | 匹配距离(2字节小端) | 匹配长度的扩展字节
+ * 最后一个序列只有字面量。匹配可以与自身重叠，所以一长串相同的字节（如字符串列填充的'\0'）只需要几个字节
+ */
+
+/**
+ * @description: 压缩src中的src_len个字节
+ * @return {int} 压缩后的字节数，结果超过dst_capacity时返回0，调用者应改为存放原始数据
+ * @param {char*} src 原始数据，长度不超过65535
+ * @param {int} src_len 原始数据的字节数
+ * @param {char*} dst 存放压缩结果
+ * @param {int} dst_capacity dst的大小
+ */
+int page_compress(const char *src, int src_len, char *dst, int dst_capacity);
+
+/**
+ * @description: 解压page_compress的结果
+ * @return {bool} 数据完整且解压后恰好为dst_len个字节时返回true
+ * @param {char*} src 压缩数据
+ * @param {int} src_len 压缩数据的字节数
+ * @param {char*} dst 存放解压结果
+ * @param {int} dst_len 原始数据的字节数
+ */
+bool page_decompress(const char *src, int src_len, char *dst, int dst_len);
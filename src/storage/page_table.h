@@ -0,0 +1,115 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <vector>
+
+#include "page.h"
+
+/**
+ * @description: 缓冲池分片的页表，页面键（见make_page_key）到帧号的映射。
+ * 采用线性探测的开放寻址哈希表，槽位连续存放在一个数组中，容量在构造时按分片的帧数确定，之后不再扩容：
+ * 表中的页面数不超过帧数，装载因子始终不超过1/2。删除时把后面的元素前移（backward shift），不留墓碑
+ */
+class PageTable {
+  public:
+    PageTable() = default;
+
+    /**
+     * @param {size_t} max_size 表中最多同时存放的页面数，即分片的帧数
+     */
+    explicit PageTable(size_t max_size) {
+        size_t capacity = 8;
+        while (capacity < max_size * 2) {
+            capacity <<= 1;
+        }
+        slots_.assign(capacity, Slot{EMPTY_KEY, INVALID_FRAME_ID});
+        mask_ = capacity - 1;
+    }
+
+    /**
+     * @description: 查找页面所在的帧
+     * @return {frame_id_t} 页面所在的帧号，不在表中时返回INVALID_FRAME_ID
+     * @param {page_key_t} key 页面键
+     */
+    frame_id_t find(page_key_t key) const {
+        for (size_t i = home(key);; i = (i + 1) & mask_) {
+            if (slots_[i].key == key) {
+                return slots_[i].frame_id;
+            }
+            if (slots_[i].key == EMPTY_KEY) {
+                return INVALID_FRAME_ID;
+            }
+        }
+    }
+
+    /**
+     * @description: 插入或更新页面所在的帧
+     * @param {page_key_t} key 页面键
+     * @param {frame_id_t} frame_id 帧号
+     */
+    void insert(page_key_t key, frame_id_t frame_id) {
+        size_t i = home(key);
+        while (slots_[i].key != EMPTY_KEY && slots_[i].key != key) {
+            i = (i + 1) & mask_;
+        }
+        if (slots_[i].key == EMPTY_KEY) {
+            size_++;
+        }
+        slots_[i] = Slot{key, frame_id};
+    }
+
+    /**
+     * @description: 删除页面
+     * @return {bool} 页面在表中则返回true
+     * @param {page_key_t} key 页面键
+     */
+    bool erase(page_key_t key) {
+        size_t i = home(key);
+        while (slots_[i].key != key) {
+            if (slots_[i].key == EMPTY_KEY) {
+                return false;
+            }
+            i = (i + 1) & mask_;
+        }
+        // 把探测链上后面的元素前移填补空位，只移动起始位置不在(i,j]之间的元素，否则会越过自己的起始位置
+        for (size_t j = (i + 1) & mask_; slots_[j].key != EMPTY_KEY; j = (j + 1) & mask_) {
+            size_t k = home(slots_[j].key);
+            if (((j - k) & mask_) >= ((j - i) & mask_)) {
+                slots_[i] = slots_[j];
+                i = j;
+            }
+        }
+        slots_[i] = Slot{EMPTY_KEY, INVALID_FRAME_ID};
+        size_--;
+        return true;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+  private:
+    static constexpr page_key_t EMPTY_KEY = ~static_cast<page_key_t>(0); // 空槽位，页面键的文件编号不会全为1
+
+    struct Slot {
+        page_key_t key;
+        frame_id_t frame_id;
+    };
+
+    size_t home(page_key_t key) const {
+        return hash_page_key(key) & mask_;
+    }
+
+    std::vector<Slot> slots_;
+    size_t mask_ = 0;
+    size_t size_ = 0;
+};
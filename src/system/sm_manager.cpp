@@ -13,11 +13,13 @@ See the Mulan PSL v2 for more details. */
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <chrono>
 #include <fstream>
 
 #include "index/ix.h"
 #include "record/rm.h"
 #include "record_printer.h"
+#include "transaction/transaction_manager.h"
 
 /**
  * @description: 判断是否为一个文件夹
@@ -48,6 +50,7 @@ void SmManager::create_db(const std::string &db_name) {
     //创建系统目录
     DbMeta *new_db = new DbMeta();
     new_db->name_ = db_name;
+    new_db->page_size_ = disk_manager_->get_page_size();
 
     // 注意，此处ofstream会在当前目录创建(如果没有此文件先创建)和打开一个名为DB_META_NAME的文件
     std::ofstream ofs(DB_META_NAME);
@@ -80,6 +83,21 @@ void SmManager::drop_db(const std::string &db_name) {
     }
 }
 
+/**
+ * @description: 读取已有数据库的页面大小，需要在构建缓冲池之前确定页面大小时调用
+ * @return {int} 数据库的页面大小
+ * @param {string&} db_name 数据库名称
+ */
+int SmManager::read_page_size(const std::string &db_name) {
+    std::ifstream ifs(db_name + "/" + DB_META_NAME);
+    if (!ifs) {
+        throw FileNotFoundError(db_name + "/" + DB_META_NAME);
+    }
+    DbMeta db;
+    ifs >> db;
+    return db.page_size_;
+}
+
 /**
  * @description: 打开数据库，找到数据库对应的文件夹，并加载数据库元数据和相关文件
  * @param {string&} db_name 数据库名称，与文件夹同名
@@ -90,6 +108,12 @@ void SmManager::open_db(const std::string &db_name) {
     }
     std::ifstream ifs(DB_META_NAME);
     ifs >> db_;
+    // 表文件和索引文件中的页面偏移量和结点容量都依赖页面大小，必须与创建数据库时相同
+    if (db_.page_size_ != disk_manager_->get_page_size()) {
+        throw InternalError("SmManager::open_db: database " + db_name + " uses " + std::to_string(db_.page_size_) +
+                            "-byte pages, but the disk manager uses " +
+                            std::to_string(disk_manager_->get_page_size()));
+    }
     for (auto &[table_name, table_meta] : db_.tabs_) {
         fhs_[table_name] = rm_manager_->open_file(table_name);
     }
@@ -166,15 +190,29 @@ void SmManager::desc_table(const std::string &tab_name, Context *context) {
  * @param {string&} tab_name 表的名称
  * @param {vector<ColDef>&} col_defs 表的字段
  * @param {Context*} context
+ * @param {bool} pax 是否按列划分页面（PAX），PAX表中不能有VARCHAR字段和字典编码字段
  */
-void SmManager::create_table(const std::string &tab_name, const std::vector<ColDef> &col_defs, Context *context) {
+void SmManager::create_table(const std::string &tab_name, const std::vector<ColDef> &col_defs, Context *context,
+                             bool pax) {
     if (db_.is_table(tab_name)) {
         throw TableExistsError(tab_name);
     }
+    auto is_dictionary = [](const ColDef &col_def) { return col_def.dictionary; };
+    if (pax && std::any_of(col_defs.begin(), col_defs.end(), is_dictionary)) {
+        throw InternalError("Dictionary columns are not supported in PAX tables");
+    }
+    // PAX页面中每列是定长的数组，不能存放变长字段
+    auto is_varlen = [](const ColDef &col_def) { return col_def.varlen; };
+    if (pax && std::any_of(col_defs.begin(), col_defs.end(), is_varlen)) {
+        throw InternalError("VARCHAR columns are not supported in PAX tables");
+    }
     // Create table meta
     int curr_offset = 0;
     TabMeta tab;
     tab.name = tab_name;
+    std::vector<RmColumn> var_cols;  // VARCHAR字段在记录中的位置，其他部分仍然是定长的
+    std::vector<RmColumn> pax_cols;  // PAX表的各列
+    std::vector<RmColumn> dict_cols; // 字典编码字段，VARCHAR字段也可以字典编码，此时不再按变长存放
     for (auto &col_def : col_defs) {
         ColMeta col = {.tab_name = tab_name,
                        .name = col_def.name,
@@ -183,12 +221,19 @@ void SmManager::create_table(const std::string &tab_name, const std::vector<ColD
                        .len = col_def.len,
                        .offset = curr_offset,
                        .index = false};
+        if (pax) {
+            pax_cols.push_back(RmColumn{curr_offset, col_def.len});
+        } else if (col_def.dictionary) {
+            dict_cols.push_back(RmColumn{curr_offset, col_def.len});
+        } else if (col_def.varlen) {
+            var_cols.push_back(RmColumn{curr_offset, col_def.len});
+        }
         curr_offset += col_def.len;
         tab.cols.push_back(col);
     }
     // Create & open record file
     int record_size = curr_offset; // record_size就是col meta所占的大小（表的元数据也是以记录的形式进行存储的）
-    rm_manager_->create_file(tab_name, record_size);
+    rm_manager_->create_file(tab_name, record_size, var_cols, pax_cols, dict_cols);
     db_.tabs_[tab_name] = tab;
     // fhs_[tab_name] = rm_manager_->open_file(tab_name);
     fhs_.emplace(tab_name, rm_manager_->open_file(tab_name));
@@ -248,12 +293,12 @@ void SmManager::create_index(const std::string &tab_name, const std::vector<std:
     bool delete_flag = false;
 
     for (; !rm_scan.is_end(); rm_scan.next()) {
-        auto record = file_handler->get_record(rm_scan.rid(), context);
+        const char *record = rm_scan.record();
 
         auto projected_record = std::make_unique<RmRecord>(index_meta.col_tot_len);
         size_t offset = 0;
         for (const auto &col : cols) {
-            memcpy(projected_record->data + offset, record->data + col.offset, col.len);
+            memcpy(projected_record->data + offset, record + col.offset, col.len);
             offset += col.len;
         }
 
@@ -353,4 +398,118 @@ void SmManager::drop_index(const std::string &tab_name, const std::vector<ColMet
     for (auto &col : cols)
         col_names.emplace_back(col.name);
     drop_index(tab_name, col_names, context);
-}
\ No newline at end of file
+}
+/**
+ * @description: 整理表（VACUUM）：把稀疏页面中的记录移到前面的页面中，释放并截掉空出的页面，
+ * 表上每个索引中移动过的记录改为指向新的记录号，截断文件之前索引落盘。
+ * 调用者需排他持有ddl_latch_，并保证没有未提交的事务修改过这张表（见TransactionManager::has_uncommitted_writes）
+ * @param {string&} tab_name 表名称
+ * @param {Context*} context 为nullptr时不加锁
+ * @return {RmCompactStats} 整理的结果
+ */
+RmCompactStats SmManager::vacuum_table(const std::string &tab_name, Context *context) {
+    auto it = fhs_.find(tab_name);
+    if (it == fhs_.end()) {
+        throw TableNotFoundError(tab_name);
+    }
+    RmFileHandle *fh = it->second.get();
+    Transaction *txn = context == nullptr ? nullptr : context->txn_;
+    if (context != nullptr && context->lock_mgr_ != nullptr) {
+        context->lock_mgr_->lock_exclusive_on_table(txn, fh->GetFd());
+    }
+    TabMeta &tab = db_.get_table(tab_name);
+    std::vector<IxIndexHandle *> ihs;
+    for (auto &index : tab.indexes) {
+        ihs.push_back(ihs_.at(ix_manager_->get_index_name(tab_name, index.cols)).get());
+    }
+    std::vector<char> key;
+    return fh->compact([&](const Rid &, const Rid &new_rid, const char *record) {
+        for (size_t i = 0; i < tab.indexes.size(); i++) {
+            auto &index = tab.indexes[i];
+            key.resize(index.col_tot_len);
+            size_t offset = 0;
+            for (auto &col : index.cols) {
+                memcpy(key.data() + offset, record + col.offset, col.len);
+                offset += col.len;
+            }
+            // 索引是唯一索引，按键删除旧的记录号
+            ihs[i]->delete_entry(key.data(), txn);
+            ihs[i]->insert_entry(key.data(), new_rid, txn);
+        }
+    }, [&]() {
+        for (auto ih : ihs) {
+            ix_manager_->sync_index(ih);
+        }
+    });
+}
+
+/**
+ * @description: 启动后台整理线程，每隔delay_ms检查一次所有的表，见auto_vacuum_round
+ * @param {TransactionManager*} txn_mgr 用于跳过有未提交修改的表，以及加表锁
+ * @param {int} delay_ms 两轮之间的间隔
+ * @param {double} min_free_ratio 空闲空间比例不小于它的表才整理
+ */
+void SmManager::start_auto_vacuum(TransactionManager *txn_mgr, int delay_ms, double min_free_ratio) {
+    stop_auto_vacuum();
+    auto_vacuum_stop_ = false;
+    auto_vacuum_ = std::thread([this, txn_mgr, delay_ms, min_free_ratio]() {
+        std::unique_lock lock{auto_vacuum_latch_};
+        while (!auto_vacuum_cv_.wait_for(lock, std::chrono::milliseconds(delay_ms),
+                                         [this] { return auto_vacuum_stop_; })) {
+            lock.unlock();
+            try {
+                auto_vacuum_round(txn_mgr, min_free_ratio);
+            } catch (RMDBError &e) {
+                std::cerr << "auto vacuum: " << e.what() << std::endl;
+            }
+            lock.lock();
+        }
+    });
+}
+
+/**
+ * @description: 停止后台整理线程，等待正在进行的一轮结束
+ */
+void SmManager::stop_auto_vacuum() {
+    if (!auto_vacuum_.joinable()) {
+        return;
+    }
+    {
+        std::scoped_lock lock{auto_vacuum_latch_};
+        auto_vacuum_stop_ = true;
+    }
+    auto_vacuum_cv_.notify_all();
+    auto_vacuum_.join();
+}
+
+/**
+ * @description: 后台整理的一轮：整理空闲空间比例不小于min_free_ratio的表，小于AUTOVACUUM_MIN_PAGES页的表跳过。
+ * 整理期间排他持有ddl_latch_，其他会话的语句等到这一轮结束再执行；有未提交的事务修改过的表也跳过，
+ * 这些事务回滚时要按原来的记录号恢复记录。每张表在一个单独的事务中加表的排他锁，整理完立即释放
+ * @param {TransactionManager*} txn_mgr 为nullptr时不检查未提交的事务，也不加表锁
+ * @param {double} min_free_ratio 空闲空间比例的阈值
+ * @return {int} 本轮整理的表的个数
+ */
+int SmManager::auto_vacuum_round(TransactionManager *txn_mgr, double min_free_ratio) {
+    std::scoped_lock ddl_lock{ddl_latch_};
+    LockManager *lock_mgr = txn_mgr == nullptr ? nullptr : txn_mgr->get_lock_manager();
+    int num_vacuumed = 0;
+    for (auto &[tab_name, fh] : fhs_) {
+        if (fh->get_file_hdr().num_pages - 1 < AUTOVACUUM_MIN_PAGES || fh->get_free_ratio() < min_free_ratio) {
+            continue;
+        }
+        if (txn_mgr != nullptr && txn_mgr->has_uncommitted_writes(tab_name)) {
+            continue;
+        }
+        Transaction txn(INVALID_TXN_ID);
+        Context context(lock_mgr, nullptr, &txn);
+        vacuum_table(tab_name, &context);
+        if (lock_mgr != nullptr) {
+            for (auto lock_data_id : *txn.get_lock_set()) {
+                lock_mgr->unlock(&txn, lock_data_id);
+            }
+        }
+        num_vacuumed++;
+    }
+    return num_vacuumed;
+}
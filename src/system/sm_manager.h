@@ -10,6 +10,11 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include <condition_variable>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
 #include "common/context.h"
 #include "index/ix.h"
 #include "record/rm_file_handle.h"
@@ -17,11 +22,14 @@ See the Mulan PSL v2 for more details. */
 #include "sm_meta.h"
 
 class Context;
+class TransactionManager;
 
 struct ColDef {
-    std::string name; // Column name
-    ColType type;     // Type of column
-    int len;          // Length of column
+    std::string name;        // Column name
+    ColType type;            // Type of column
+    int len;                 // Length of column
+    bool varlen = false;     // 是否为变长字段（VARCHAR），在表文件中只存放实际长度
+    bool dictionary = false; // 是否为字典编码字段（WITH (dictionary = 列名)），在表文件中只存放编号
 };
 
 /* 系统管理器，负责元数据管理和DDL语句的执行 */
@@ -32,12 +40,19 @@ class SmManager {
         fhs_; // file name -> record file handle, 当前数据库中每张表的数据文件
     std::unordered_map<std::string, std::unique_ptr<IxIndexHandle>>
         ihs_; // file name -> index file handle, 当前数据库中每个索引的文件
+    // DDL语句和表的整理排他持有，其他语句从生成执行器到提交共享持有，整理时没有语句在读写表，也没有表或索引被创建、删除
+    std::shared_mutex ddl_latch_;
   private:
     DiskManager *disk_manager_;
     BufferPoolManager *buffer_pool_manager_;
     RmManager *rm_manager_;
     IxManager *ix_manager_;
 
+    std::thread auto_vacuum_;                // 后台整理线程
+    std::mutex auto_vacuum_latch_;           // 保护auto_vacuum_stop_
+    std::condition_variable auto_vacuum_cv_; // 用于通知后台整理线程退出
+    bool auto_vacuum_stop_ = false;
+
   public:
     SmManager(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, RmManager *rm_manager,
               IxManager *ix_manager)
@@ -46,6 +61,7 @@ class SmManager {
     }
 
     ~SmManager() {
+        stop_auto_vacuum();
     }
 
     BufferPoolManager *get_bpm() {
@@ -64,6 +80,8 @@ class SmManager {
 
     void create_db(const std::string &db_name);
 
+    static int read_page_size(const std::string &db_name);
+
     void drop_db(const std::string &db_name);
 
     void open_db(const std::string &db_name);
@@ -76,7 +94,8 @@ class SmManager {
 
     void desc_table(const std::string &tab_name, Context *context);
 
-    void create_table(const std::string &tab_name, const std::vector<ColDef> &col_defs, Context *context);
+    void create_table(const std::string &tab_name, const std::vector<ColDef> &col_defs, Context *context,
+                      bool pax = false);
 
     void drop_table(const std::string &tab_name, Context *context);
 
@@ -87,4 +106,12 @@ class SmManager {
     void drop_index(const std::string &tab_name, const std::vector<ColMeta> &col_names, Context *context);
 
     void show_index(const std::string &tab_name, Context *context);
+
+    RmCompactStats vacuum_table(const std::string &tab_name, Context *context);
+
+    void start_auto_vacuum(TransactionManager *txn_mgr, int delay_ms, double min_free_ratio);
+
+    void stop_auto_vacuum();
+
+    int auto_vacuum_round(TransactionManager *txn_mgr, double min_free_ratio);
 };
\ No newline at end of file
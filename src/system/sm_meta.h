@@ -179,11 +179,16 @@ class DbMeta {
 
   private:
     std::string name_;                    // 数据库名称
+    int page_size_ = PAGE_SIZE;           // 数据库的页面大小，创建数据库时确定，之后不能改变
     std::map<std::string, TabMeta> tabs_; // 数据库中包含的表
 
   public:
     // DbMeta(std::string name) : name_(name) {}
 
+    int get_page_size() const {
+        return page_size_;
+    }
+
     /* 判断数据库中是否存在指定名称的表 */
     bool is_table(const std::string &tab_name) const {
         return tabs_.find(tab_name) != tabs_.end();
@@ -205,7 +210,7 @@ class DbMeta {
 
     // 重载操作符 <<
     friend std::ostream &operator<<(std::ostream &os, const DbMeta &db_meta) {
-        os << db_meta.name_ << '\n' << db_meta.tabs_.size() << '\n';
+        os << db_meta.name_ << '\n' << "page_size " << db_meta.page_size_ << '\n' << db_meta.tabs_.size() << '\n';
         for (auto &entry : db_meta.tabs_) {
             os << entry.second << '\n';
         }
@@ -213,8 +218,13 @@ class DbMeta {
     }
 
     friend std::istream &operator>>(std::istream &is, DbMeta &db_meta) {
-        size_t n;
-        is >> db_meta.name_ >> n;
+        std::string token;
+        is >> db_meta.name_ >> token;
+        // 没有记录页面大小的db.meta由默认页面大小的版本创建，第二项直接是表的个数
+        if (token == "page_size") {
+            is >> db_meta.page_size_ >> token;
+        }
+        size_t n = std::stoul(token);
         for (size_t i = 0; i < n; i++) {
             TabMeta tab;
             is >> tab;
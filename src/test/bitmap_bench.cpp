@@ -0,0 +1,136 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+// 页面bitmap查找测试：比较逐位查找、64位字查找和AVX2查找，每页记录数从几个到上万个（页面大小与记录大小的组合）。
+// insert: 页面从空插入到满，每次用first_bit(false)找第一个空闲槽位；
+// scan: 用next_bit(true)遍历页面中的全部记录，记录占一半或1%的槽位
+// 用法: bitmap_bench [num_rounds]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "record/bitmap.h"
+
+static constexpr int RM_FILE_HDR_SIZE = 20; // sizeof(RmFileHdr)
+
+enum class Impl { NAIVE, WORD, AVX2 };
+
+/**
+ * @description: 修改前的逐位查找
+ */
+static int naive_next_bit(bool bit, const char *bm, int max_n, int curr) {
+    for (int i = curr + 1; i < max_n; i++) {
+        if (Bitmap::is_set(bm, i) == bit) {
+            return i;
+        }
+    }
+    return max_n;
+}
+
+static int next_bit(Impl impl, bool bit, const char *bm, int max_n, int curr) {
+    if (impl == Impl::NAIVE) {
+        return naive_next_bit(bit, bm, max_n, curr);
+    }
+    return Bitmap::next_bit(bit, bm, max_n, curr, impl == Impl::AVX2);
+}
+
+/**
+ * @description: 把页面从空插入到满
+ * @return {double} 每次插入查找空闲槽位的纳秒数
+ */
+static double run_insert(Impl impl, int num_slots, int num_rounds) {
+    std::vector<char> bm((num_slots + BITMAP_WIDTH - 1) / BITMAP_WIDTH);
+    long checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < num_rounds; round++) {
+        Bitmap::init(bm.data(), bm.size());
+        for (int i = 0; i < num_slots; i++) {
+            int slot_no = next_bit(impl, false, bm.data(), num_slots, -1);
+            Bitmap::set(bm.data(), slot_no);
+            checksum += slot_no;
+        }
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    if (checksum != static_cast<long>(num_rounds) * num_slots * (num_slots - 1) / 2) {
+        fprintf(stderr, "wrong result\n");
+        exit(1);
+    }
+    return elapsed.count() / (static_cast<double>(num_rounds) * num_slots);
+}
+
+/**
+ * @description: 遍历页面中的全部记录，每1000个槽位中有per_mille个记录
+ * @return {double} 遍历一个页面的纳秒数
+ */
+static double run_scan(Impl impl, int num_slots, int per_mille, int num_rounds) {
+    std::vector<char> bm((num_slots + BITMAP_WIDTH - 1) / BITMAP_WIDTH, 0);
+    std::mt19937 rng(0);
+    int num_set = 0;
+    for (int i = 0; i < num_slots; i++) {
+        if (static_cast<int>(rng() % 1000) < per_mille) {
+            Bitmap::set(bm.data(), i);
+            num_set++;
+        }
+    }
+    long num_found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < num_rounds; round++) {
+        for (int slot_no = next_bit(impl, true, bm.data(), num_slots, -1); slot_no < num_slots;
+             slot_no = next_bit(impl, true, bm.data(), num_slots, slot_no)) {
+            num_found++;
+        }
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    if (num_found != static_cast<long>(num_rounds) * num_set) {
+        fprintf(stderr, "wrong result\n");
+        exit(1);
+    }
+    return elapsed.count() / num_rounds;
+}
+
+int main(int argc, char **argv) {
+    int num_rounds = argc > 1 ? atoi(argv[1]) : 20;
+    bool avx2 = Bitmap::has_avx2();
+    printf("%9s %8s %8s %12s %12s %12s %12s %12s %12s %12s %12s %12s\n", "page_size", "rec_size", "slots",
+           "ins_naive", "ins_word", "ins_avx2", "scan50_naive", "scan50_word", "scan50_avx2", "scan1_naive",
+           "scan1_word", "scan1_avx2");
+    for (int page_size : {4096, 32768}) {
+        for (int record_size : {512, 64, 8, 1}) {
+            // 与RmManager::create_file相同的每页记录数
+            int num_slots = (BITMAP_WIDTH * (page_size - 1 - RM_FILE_HDR_SIZE) + 1) / (1 + record_size * BITMAP_WIDTH);
+            // 槽位越多每轮越慢，插入的次数与槽位数成正比，每次查找的开销也与槽位数成正比
+            int rounds = std::max(1, num_rounds * 4096 / num_slots);
+            printf("%9d %8d %8d", page_size, record_size, num_slots);
+            for (Impl impl : {Impl::NAIVE, Impl::WORD, Impl::AVX2}) {
+                if (impl == Impl::AVX2 && !avx2) {
+                    printf(" %12s", "-");
+                    continue;
+                }
+                printf(" %12.1f", run_insert(impl, num_slots, impl == Impl::NAIVE ? rounds : rounds * 10));
+            }
+            for (int per_mille : {500, 10}) {
+                for (Impl impl : {Impl::NAIVE, Impl::WORD, Impl::AVX2}) {
+                    if (impl == Impl::AVX2 && !avx2) {
+                        printf(" %12s", "-");
+                        continue;
+                    }
+                    printf(" %12.1f", run_scan(impl, num_slots, per_mille, num_rounds * 100));
+                }
+            }
+            printf("\n");
+        }
+    }
+    printf("insert: ns per free slot lookup; scan: ns per page\n");
+    return 0;
+}
@@ -0,0 +1,107 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+// 缓冲池吞吐量测试：多个线程随机fetch_page/unpin_page，比较不同分片个数下吞吐量随线程数的变化
+// 用法: buffer_pool_bench [max_threads] [milliseconds_per_run]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "storage/buffer_pool_manager.h"
+
+static const std::string BENCH_DB_NAME = "BufferPoolBench_db";
+static const std::string BENCH_FILE_NAME = "bench";
+static constexpr int NUM_PAGES = 8192;    // 工作集大小，全部可以放入缓冲池，测试的是命中路径的开销
+static constexpr size_t POOL_SIZE = 16384; // 缓冲池帧的个数
+
+/**
+ * @description: 在num_shards个分片的缓冲池上用num_threads个线程随机访问页面
+ * @return {double} 每秒完成的fetch_page+unpin_page次数
+ */
+static double run(DiskManager *disk_manager, int fd, size_t num_shards, int num_threads, int millis) {
+    BufferPoolManager bpm(POOL_SIZE, disk_manager, num_shards);
+    // 预热，将工作集全部读入缓冲池
+    for (int i = 0; i < NUM_PAGES; i++) {
+        bpm.fetch_page(PageId{fd, i});
+        bpm.unpin_page(PageId{fd, i}, false);
+    }
+
+    std::atomic<bool> stop{false};
+    std::vector<uint64_t> ops(num_threads, 0);
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < num_threads; tid++) {
+        threads.emplace_back([&, tid]() {
+            std::mt19937 rng(tid);
+            std::uniform_int_distribution<int> dist(0, NUM_PAGES - 1);
+            uint64_t cnt = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                PageId page_id{fd, dist(rng)};
+                Page *page = bpm.fetch_page(page_id);
+                if (page != nullptr) {
+                    bpm.unpin_page(page_id, false);
+                }
+                cnt++;
+            }
+            ops[tid] = cnt;
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(millis));
+    stop = true;
+    uint64_t total = 0;
+    for (int tid = 0; tid < num_threads; tid++) {
+        threads[tid].join();
+        total += ops[tid];
+    }
+    return total * 1000.0 / millis;
+}
+
+int main(int argc, char **argv) {
+    int max_threads = argc > 1 ? atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+    int millis = argc > 2 ? atoi(argv[2]) : 1000;
+    max_threads = std::max(max_threads, 1);
+
+    DiskManager disk_manager;
+    if (!disk_manager.is_dir(BENCH_DB_NAME)) {
+        disk_manager.create_dir(BENCH_DB_NAME);
+    }
+    if (chdir(BENCH_DB_NAME.c_str()) < 0) {
+        throw UnixError();
+    }
+    if (disk_manager.is_file(BENCH_FILE_NAME)) {
+        disk_manager.destroy_file(BENCH_FILE_NAME);
+    }
+    disk_manager.create_file(BENCH_FILE_NAME);
+    int fd = disk_manager.open_file(BENCH_FILE_NAME);
+    char buf[PAGE_SIZE] = {};
+    for (int i = 0; i < NUM_PAGES; i++) {
+        disk_manager.write_page(fd, i, buf, PAGE_SIZE);
+    }
+    disk_manager.set_fd2pageno(fd, NUM_PAGES);
+
+    printf("%8s %8s %16s\n", "shards", "threads", "ops/s");
+    for (size_t num_shards : {1, 4, 16, 64}) {
+        for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+            double throughput = run(&disk_manager, fd, num_shards, num_threads, millis);
+            printf("%8zu %8d %16.0f\n", num_shards, num_threads, throughput);
+        }
+    }
+
+    disk_manager.close_file(fd);
+    disk_manager.destroy_file(BENCH_FILE_NAME);
+    if (chdir("..") < 0) {
+        throw UnixError();
+    }
+    return 0;
+}
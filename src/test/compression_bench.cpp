@@ -0,0 +1,121 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+// 页面压缩测试：分别以普通格式和压缩格式建表，插入相同的记录，比较文件在磁盘上占用的空间，以及冷缓存下全表扫描的时间。
+// 记录的前若干字节随机，其余为0，类似于定长字符串列中较短的值；扫描前用POSIX_FADV_DONTNEED丢弃文件在操作系统中的缓存，
+// 并使用新的缓冲池
+// 用法: compression_bench [num_records] [record_size] [value_len]
+
+#include <sys/stat.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "record/rm.h"
+#include "storage/buffer_pool_manager.h"
+
+static const std::string BENCH_DB_NAME = "CompressionBench_db";
+static const std::string BENCH_FILE_NAME = "bench";
+static constexpr size_t BENCH_POOL_SIZE = 1024;
+
+/**
+ * @description: 文件的大小，测试时不预留区段，即文件在磁盘上占用的空间
+ */
+static off_t file_size(const std::string &path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        throw UnixError();
+    }
+    return st.st_size;
+}
+
+/**
+ * @description: 建表并插入num_records条记录，之后冷缓存扫描全表
+ * @param {bool} compress 是否以压缩格式建表
+ */
+static void run(bool compress, int num_records, int record_size, int value_len) {
+    DiskManager disk_manager;
+    disk_manager.set_extent_size(EXTENT_MIN_PAGES, 0); // 不预留区段，文件大小只包含写入的数据
+    if (disk_manager.is_file(BENCH_FILE_NAME)) {
+        disk_manager.destroy_file(BENCH_FILE_NAME);
+    }
+    std::chrono::duration<double> load_time;
+    {
+        BufferPoolManager buffer_pool_manager(BENCH_POOL_SIZE, &disk_manager);
+        RmManager rm_manager(&disk_manager, &buffer_pool_manager);
+        rm_manager.set_compress_files(compress);
+        rm_manager.create_file(BENCH_FILE_NAME, record_size);
+        auto file_handle = rm_manager.open_file(BENCH_FILE_NAME);
+        std::mt19937 rng(0);
+        std::vector<char> record(record_size, 0);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < num_records; i++) {
+            for (int j = 0; j < value_len; j++) {
+                record[j] = static_cast<char>('a' + rng() % 26);
+            }
+            file_handle->insert_record(record.data(), nullptr);
+        }
+        rm_manager.close_file(file_handle.get());
+        load_time = std::chrono::steady_clock::now() - start;
+    }
+
+    BufferPoolManager buffer_pool_manager(BENCH_POOL_SIZE, &disk_manager);
+    RmManager rm_manager(&disk_manager, &buffer_pool_manager);
+    auto file_handle = rm_manager.open_file(BENCH_FILE_NAME);
+    int fd = file_handle->GetFd();
+    fsync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    auto start = std::chrono::steady_clock::now();
+    int num_scanned = 0;
+    for (RmScan scan(file_handle.get()); !scan.is_end(); scan.next()) {
+        num_scanned += scan.record()[0] != 0;
+    }
+    std::chrono::duration<double> scan_time = std::chrono::steady_clock::now() - start;
+    if (num_scanned != num_records) {
+        throw InternalError("compression_bench: scanned " + std::to_string(num_scanned) + " records");
+    }
+    int num_pages = disk_manager.get_fd2pageno(fd);
+    rm_manager.close_file(file_handle.get());
+    off_t num_bytes = file_size(BENCH_FILE_NAME);
+
+    printf("%12s %10d %14.1f %14.1f %12.3f %12.3f\n", compress ? "compressed" : "plain", num_pages,
+           static_cast<double>(num_pages) * disk_manager.get_page_size() / (1024 * 1024),
+           static_cast<double>(num_bytes) / (1024 * 1024), load_time.count(), scan_time.count());
+    disk_manager.destroy_file(BENCH_FILE_NAME);
+}
+
+int main(int argc, char **argv) {
+    int num_records = argc > 1 ? atoi(argv[1]) : 1000000;
+    int record_size = argc > 2 ? atoi(argv[2]) : 128;
+    int value_len = argc > 3 ? atoi(argv[3]) : 16;
+    if (value_len < 1 || value_len > record_size) {
+        fprintf(stderr, "value_len must be in [1, record_size]\n");
+        return 1;
+    }
+
+    DiskManager disk_manager;
+    if (!disk_manager.is_dir(BENCH_DB_NAME)) {
+        disk_manager.create_dir(BENCH_DB_NAME);
+    }
+    if (chdir(BENCH_DB_NAME.c_str()) < 0) {
+        throw UnixError();
+    }
+    printf("%d records of %d bytes, %d random bytes each\n", num_records, record_size, value_len);
+    printf("%12s %10s %14s %14s %12s %12s\n", "format", "pages", "pages_MB", "file_MB", "load_s", "cold_scan_s");
+    run(false, num_records, record_size, value_len);
+    run(true, num_records, record_size, value_len);
+    if (chdir("..") < 0) {
+        throw UnixError();
+    }
+    return 0;
+}
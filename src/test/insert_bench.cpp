@@ -0,0 +1,114 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+// 并发插入测试：多个线程同时向同一个表文件插入记录，比较不同线程数下的吞吐量。
+// 每个线程插入自己独占的页面，只有页面满了之后从空闲空间映射中独占下一个页面时才与其他线程竞争。
+// row: 逐条调用insert_record；batch: 每batch_size条记录调用一次insert_records，使用BULK_WRITE策略
+// 用法: insert_bench [num_records] [record_size] [max_threads] [batch_size]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "record/rm.h"
+#include "storage/buffer_pool_manager.h"
+
+static const std::string BENCH_DB_NAME = "InsertBench_db";
+static const std::string BENCH_FILE_NAME = "bench";
+static constexpr size_t BENCH_POOL_SIZE = 4096;
+
+/**
+ * @description: num_threads个线程共插入num_records条记录
+ * @param {int} batch_size 为0时逐条插入
+ * @return {double} 每秒插入的记录数
+ */
+static double run(int num_threads, int num_records, int record_size, int batch_size) {
+    DiskManager disk_manager;
+    if (disk_manager.is_file(BENCH_FILE_NAME)) {
+        disk_manager.destroy_file(BENCH_FILE_NAME);
+    }
+    BufferPoolManager buffer_pool_manager(BENCH_POOL_SIZE, &disk_manager);
+    RmManager rm_manager(&disk_manager, &buffer_pool_manager);
+    rm_manager.create_file(BENCH_FILE_NAME, record_size);
+    auto file_handle = rm_manager.open_file(BENCH_FILE_NAME);
+
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&, t]() {
+            if (batch_size == 0) {
+                std::vector<char> record(record_size, static_cast<char>('a' + t));
+                for (int i = t; i < num_records; i += num_threads) {
+                    memcpy(record.data(), &i, sizeof(i));
+                    file_handle->insert_record(record.data(), nullptr);
+                }
+                return;
+            }
+            BufferAccessStrategy strategy(BufferAccessStrategy::Type::BULK_WRITE);
+            std::vector<char> records(static_cast<size_t>(batch_size) * record_size, static_cast<char>('a' + t));
+            std::vector<const char *> bufs;
+            for (int i = t; i < num_records; i += num_threads) {
+                char *record = records.data() + bufs.size() * record_size;
+                memcpy(record, &i, sizeof(i));
+                bufs.push_back(record);
+                if (static_cast<int>(bufs.size()) == batch_size || i + num_threads >= num_records) {
+                    file_handle->insert_records(bufs, nullptr, &strategy);
+                    bufs.clear();
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    int num_scanned = 0;
+    for (RmScan scan(file_handle.get()); !scan.is_end(); scan.next()) {
+        num_scanned++;
+    }
+    if (num_scanned != num_records) {
+        throw InternalError("insert_bench: scanned " + std::to_string(num_scanned) + " records");
+    }
+    rm_manager.close_file(file_handle.get());
+    rm_manager.destroy_file(BENCH_FILE_NAME);
+    return num_records / elapsed.count();
+}
+
+int main(int argc, char **argv) {
+    int num_records = argc > 1 ? atoi(argv[1]) : 1000000;
+    int record_size = argc > 2 ? atoi(argv[2]) : 64;
+    int max_threads = argc > 3 ? atoi(argv[3]) : 8;
+    int batch_size = argc > 4 ? atoi(argv[4]) : 1000;
+
+    DiskManager disk_manager;
+    if (!disk_manager.is_dir(BENCH_DB_NAME)) {
+        disk_manager.create_dir(BENCH_DB_NAME);
+    }
+    if (chdir(BENCH_DB_NAME.c_str()) < 0) {
+        throw UnixError();
+    }
+    printf("%d records of %d bytes, batches of %d, %u hardware threads\n", num_records, record_size, batch_size,
+           std::thread::hardware_concurrency());
+    printf("%8s %14s %14s\n", "threads", "row_per_s", "batch_per_s");
+    for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+        double row = run(num_threads, num_records, record_size, 0);
+        double batch = run(num_threads, num_records, record_size, batch_size);
+        printf("%8d %14.0f %14.0f\n", num_threads, row, batch);
+    }
+    if (chdir("..") < 0) {
+        throw UnixError();
+    }
+    return 0;
+}
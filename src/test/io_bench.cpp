@@ -0,0 +1,156 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+// 磁盘I/O吞吐量测试：随机读取页面，比较同步read_page与不同异步后端在不同队列深度和页面大小下的IOPS和带宽
+// 不同页面大小使用相同大小的文件；每次运行前用POSIX_FADV_DONTNEED丢弃文件在操作系统中的缓存，使读请求尽量落到磁盘上
+// 用法: io_bench [num_4k_pages] [num_reads]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "storage/disk_manager.h"
+
+static const std::string BENCH_DB_NAME = "IoBench_db";
+static const std::string BENCH_FILE_NAME = "bench";
+
+/**
+ * @description: 生成num_reads个随机页面编号，每种方式读取相同的页面序列
+ */
+static std::vector<page_id_t> random_pages(int num_pages, int num_reads) {
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<page_id_t> dist(0, num_pages - 1);
+    std::vector<page_id_t> pages(num_reads);
+    for (auto &page_no : pages) {
+        page_no = dist(rng);
+    }
+    return pages;
+}
+
+/**
+ * @description: 逐个同步读取页面
+ * @return {double} 每秒读取的页面数
+ */
+static double run_sync(DiskManager *disk_manager, int fd, const std::vector<page_id_t> &pages) {
+    int page_size = disk_manager->get_page_size();
+    std::vector<char> buf(page_size);
+    auto start = std::chrono::steady_clock::now();
+    for (page_id_t page_no : pages) {
+        disk_manager->read_page(fd, page_no, buf.data(), page_size);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return pages.size() / elapsed.count();
+}
+
+/**
+ * @description: 通过IoContext读取页面，始终保持depth个请求在进行中
+ * @return {double} 每秒读取的页面数
+ */
+static double run_async(IoContext *io, int fd, int page_size, const std::vector<page_id_t> &pages) {
+    unsigned depth = io->get_depth();
+    std::vector<char> bufs(static_cast<size_t>(depth) * page_size);
+    std::vector<IoRequest> requests(depth);
+    std::vector<IoRequest *> free_requests;
+    for (unsigned i = 0; i < depth; i++) {
+        requests[i].buf = bufs.data() + static_cast<size_t>(i) * page_size;
+        free_requests.push_back(&requests[i]);
+    }
+    std::vector<IoRequest *> completed(depth);
+    size_t next = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (next < pages.size() || io->get_num_in_flight() > 0) {
+        size_t num_free = free_requests.size();
+        size_t num_submit = 0;
+        while (num_submit < num_free && next < pages.size()) {
+            IoRequest *request = free_requests[num_free - 1 - num_submit];
+            request->op = IoOpType::READ;
+            request->fd = fd;
+            request->page_no = pages[next++];
+            request->num_bytes = page_size;
+            num_submit++;
+        }
+        io->submit(free_requests.data() + num_free - num_submit, num_submit);
+        free_requests.resize(num_free - num_submit);
+        size_t num_done = io->wait(completed.data(), completed.size(), 1);
+        for (size_t i = 0; i < num_done; i++) {
+            if (completed[i]->result != page_size) {
+                throw InternalError("io_bench: read failed");
+            }
+            free_requests.push_back(completed[i]);
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return pages.size() / elapsed.count();
+}
+
+/**
+ * @description: 用page_size大小的页面写入num_bytes字节的测试文件，然后比较各种读取方式
+ */
+static void run_page_size(int page_size, size_t num_bytes, int num_reads) {
+    DiskManager disk_manager;
+    disk_manager.set_page_size(page_size);
+    if (disk_manager.is_file(BENCH_FILE_NAME)) {
+        disk_manager.destroy_file(BENCH_FILE_NAME);
+    }
+    disk_manager.create_file(BENCH_FILE_NAME);
+    int fd = disk_manager.open_file(BENCH_FILE_NAME);
+    int num_pages = static_cast<int>(num_bytes / page_size);
+    std::vector<char> buf(page_size);
+    for (int i = 0; i < num_pages; i++) {
+        disk_manager.write_page(fd, i, buf.data(), page_size);
+    }
+    fsync(fd);
+    auto pages = random_pages(num_pages, num_reads);
+    auto drop_cache = [&]() { posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED); };
+    auto print = [&](const std::string &backend, unsigned depth, double reads_per_sec) {
+        printf("%10d %12s %8u %16.0f %12.1f\n", page_size, backend.c_str(), depth, reads_per_sec,
+               reads_per_sec * page_size / (1024 * 1024));
+    };
+
+    drop_cache();
+    print("sync", 1, run_sync(&disk_manager, fd, pages));
+    for (const std::string backend : {"io_uring", "thread_pool"}) {
+        if (backend == "io_uring" && !IoUringContext::is_supported()) {
+            printf("%10d %12s %8s %16s %12s\n", page_size, backend.c_str(), "-", "unsupported", "-");
+            continue;
+        }
+        for (unsigned depth : {1, 4, 16, 64}) {
+            auto io = create_io_context(backend, depth, page_size);
+            drop_cache();
+            print(backend, depth, run_async(io.get(), fd, page_size, pages));
+        }
+    }
+
+    disk_manager.close_file(fd);
+    disk_manager.destroy_file(BENCH_FILE_NAME);
+}
+
+int main(int argc, char **argv) {
+    int num_4k_pages = argc > 1 ? atoi(argv[1]) : 65536;
+    int num_reads = argc > 2 ? atoi(argv[2]) : 20000;
+
+    DiskManager disk_manager;
+    if (!disk_manager.is_dir(BENCH_DB_NAME)) {
+        disk_manager.create_dir(BENCH_DB_NAME);
+    }
+    if (chdir(BENCH_DB_NAME.c_str()) < 0) {
+        throw UnixError();
+    }
+    printf("%10s %12s %8s %16s %12s\n", "page_size", "backend", "depth", "reads/s", "MB/s");
+    for (int page_size = PAGE_SIZE; page_size <= MAX_PAGE_SIZE; page_size *= 2) {
+        run_page_size(page_size, static_cast<size_t>(num_4k_pages) * PAGE_SIZE, num_reads);
+    }
+    if (chdir("..") < 0) {
+        throw UnixError();
+    }
+    return 0;
+}
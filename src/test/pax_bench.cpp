@@ -0,0 +1,135 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+// PAX测试：TPC-C的order_line表分别按行和按PAX建表，插入相同的记录，计算SUM(ol_quantity)和SUM(ol_amount)。
+// 每种格式分别用逐行的RmScan和按列的RmColumnScan扫描，比较每秒处理的记录数；扫描前先完整扫描一遍，测量的是热缓存
+// 用法: pax_bench [num_records] [num_rounds]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "record/rm.h"
+#include "storage/buffer_pool_manager.h"
+
+static const std::string BENCH_DB_NAME = "PaxBench_db";
+static const std::string BENCH_FILE_NAME = "bench";
+static constexpr size_t BENCH_POOL_SIZE = 16384;
+
+// ol_o_id, ol_d_id, ol_w_id, ol_number, ol_i_id, ol_supply_w_id, ol_delivery_d, ol_quantity, ol_amount, ol_dist_info
+static const std::vector<RmColumn> ORDER_LINE_COLS = {{0, 4},  {4, 4},  {8, 4},  {12, 4}, {16, 4},
+                                                      {20, 4}, {24, 19}, {43, 4}, {47, 4}, {51, 24}};
+static constexpr int RECORD_SIZE = 75;
+static const RmColumn OL_QUANTITY = ORDER_LINE_COLS[7];
+static const RmColumn OL_AMOUNT = ORDER_LINE_COLS[8];
+
+struct Sums {
+    long quantity = 0;
+    double amount = 0;
+};
+
+static Sums sum_rows(const RmFileHandle *file_handle) {
+    Sums sums;
+    for (RmScan scan(file_handle); !scan.is_end(); scan.next()) {
+        int quantity;
+        float amount;
+        memcpy(&quantity, scan.record() + OL_QUANTITY.offset, sizeof(quantity));
+        memcpy(&amount, scan.record() + OL_AMOUNT.offset, sizeof(amount));
+        sums.quantity += quantity;
+        sums.amount += amount;
+    }
+    return sums;
+}
+
+static Sums sum_columns(const RmFileHandle *file_handle) {
+    Sums sums;
+    RmColumnScan scan(file_handle, {OL_QUANTITY, OL_AMOUNT});
+    while (scan.next_batch()) {
+        auto quantities = reinterpret_cast<const int *>(scan.get_column(0));
+        auto amounts = reinterpret_cast<const float *>(scan.get_column(1));
+        long quantity = 0;
+        double amount = 0;
+        for (int i = 0; i < scan.get_num_rows(); i++) {
+            quantity += quantities[i];
+            amount += amounts[i];
+        }
+        sums.quantity += quantity;
+        sums.amount += amount;
+    }
+    return sums;
+}
+
+/**
+ * @description: 建表并插入num_records条记录，之后用两种扫描各计算num_rounds次
+ * @param {bool} pax 是否以PAX格式建表
+ */
+static void run(bool pax, int num_records, int num_rounds) {
+    DiskManager disk_manager;
+    if (disk_manager.is_file(BENCH_FILE_NAME)) {
+        disk_manager.destroy_file(BENCH_FILE_NAME);
+    }
+    BufferPoolManager buffer_pool_manager(BENCH_POOL_SIZE, &disk_manager);
+    RmManager rm_manager(&disk_manager, &buffer_pool_manager);
+    rm_manager.create_file(BENCH_FILE_NAME, RECORD_SIZE, {}, pax ? ORDER_LINE_COLS : std::vector<RmColumn>());
+    auto file_handle = rm_manager.open_file(BENCH_FILE_NAME);
+
+    std::mt19937 rng(0);
+    std::vector<char> record(RECORD_SIZE);
+    for (int i = 0; i < num_records; i++) {
+        for (auto &c : record) {
+            c = static_cast<char>('a' + rng() % 26);
+        }
+        int quantity = static_cast<int>(rng() % 10) + 1;
+        float amount = static_cast<float>(rng() % 1000000) / 100;
+        memcpy(record.data() + OL_QUANTITY.offset, &quantity, sizeof(quantity));
+        memcpy(record.data() + OL_AMOUNT.offset, &amount, sizeof(amount));
+        file_handle->insert_record(record.data(), nullptr);
+    }
+
+    Sums expected = sum_rows(file_handle.get());
+    for (bool columns : {false, true}) {
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < num_rounds; round++) {
+            Sums sums = columns ? sum_columns(file_handle.get()) : sum_rows(file_handle.get());
+            if (sums.quantity != expected.quantity) {
+                throw InternalError("pax_bench: wrong sum");
+            }
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        printf("%8s %12s %10d %12.1f\n", pax ? "pax" : "row", columns ? "RmColumnScan" : "RmScan",
+               file_handle->get_file_hdr().num_pages - 1,
+               static_cast<double>(num_records) * num_rounds / elapsed.count() / 1e6);
+    }
+    rm_manager.close_file(file_handle.get());
+    rm_manager.destroy_file(BENCH_FILE_NAME);
+}
+
+int main(int argc, char **argv) {
+    int num_records = argc > 1 ? atoi(argv[1]) : 1000000;
+    int num_rounds = argc > 2 ? atoi(argv[2]) : 10;
+
+    DiskManager disk_manager;
+    if (!disk_manager.is_dir(BENCH_DB_NAME)) {
+        disk_manager.create_dir(BENCH_DB_NAME);
+    }
+    if (chdir(BENCH_DB_NAME.c_str()) < 0) {
+        throw UnixError();
+    }
+    printf("%d order_line records of %d bytes, SUM of 2 columns\n", num_records, RECORD_SIZE);
+    printf("%8s %12s %10s %12s\n", "layout", "scan", "pages", "Mrows/s");
+    run(false, num_records, num_rounds);
+    run(true, num_records, num_rounds);
+    if (chdir("..") < 0) {
+        throw UnixError();
+    }
+    return 0;
+}
@@ -0,0 +1,169 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+// 置换策略测试：
+// 1. 比较各个Replacer在64K帧下victim/pin/unpin的单次操作耗时
+// 2. 模拟缓冲池，比较各个Replacer在全表扫描与点查询混合负载下的命中率
+// 用法: replacer_bench [num_ops]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "storage/buffer_pool_manager.h"
+
+static constexpr size_t NUM_FRAMES = 65536; // 与BUFFER_POOL_SIZE相同
+
+// 混合负载的参数
+static constexpr int SIM_FRAMES = 4096;             // 模拟的缓冲池帧数
+static constexpr int SIM_HOT_PAGES = 2048;          // 点查询访问的热页面：B+树内部节点和小表
+static constexpr int SIM_TABLE_PAGES = 65536;       // 被全表扫描的大表
+static constexpr int SIM_RECORDS_PER_PAGE = 20;     // 扫描每条记录时fetch两次页面(RmScan::next和get_record)
+static constexpr int SIM_SCAN_PAGES_PER_LOOKUP = 2; // 每扫描两个页面穿插一次点查询
+
+/**
+ * @description: 与BufferPoolManager相同方式使用Replacer的页面缓存模拟器，只统计命中次数，不读写数据
+ */
+class CacheSimulator {
+  public:
+    CacheSimulator(const char *type, int num_frames)
+        : replacer_(BufferPoolManager::create_replacer(type, num_frames)), frame2page_(num_frames, -1) {
+        for (int i = 0; i < num_frames; i++) {
+            free_list_.push_back(i);
+        }
+    }
+
+    /**
+     * @description: 模拟一次fetch_page+unpin_page
+     * @return {bool} 是否命中
+     */
+    bool access(int page_no) {
+        frame_id_t frame_id;
+        bool hit = false;
+        auto it = page_table_.find(page_no);
+        if (it != page_table_.end()) {
+            frame_id = it->second;
+            hit = true;
+        } else {
+            if (!free_list_.empty()) {
+                frame_id = free_list_.back();
+                free_list_.pop_back();
+            } else {
+                replacer_->victim(&frame_id);
+                page_table_.erase(frame2page_[frame_id]);
+            }
+            frame2page_[frame_id] = page_no;
+            page_table_[page_no] = frame_id;
+        }
+        replacer_->pin(frame_id);
+        replacer_->unpin(frame_id);
+        return hit;
+    }
+
+  private:
+    std::unique_ptr<Replacer> replacer_;
+    std::vector<int> frame2page_;
+    std::vector<frame_id_t> free_list_;
+    std::unordered_map<int, frame_id_t> page_table_;
+};
+
+/**
+ * @description: 先只做点查询预热，再在一次全表扫描期间穿插点查询
+ * @param {double*} lookup_hit_ratio 扫描期间点查询的命中率
+ * @param {double*} total_hit_ratio 扫描期间所有页面访问的命中率
+ */
+static void simulate(const char *type, double *lookup_hit_ratio, double *total_hit_ratio) {
+    CacheSimulator sim(type, SIM_FRAMES);
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<int> hot_dist(0, SIM_HOT_PAGES - 1);
+    // 热页面的页号在大表之后
+    for (int i = 0; i < SIM_HOT_PAGES * 16; i++) {
+        sim.access(SIM_TABLE_PAGES + hot_dist(rng));
+    }
+
+    uint64_t lookups = 0, lookup_hits = 0, accesses = 0, hits = 0;
+    for (int page_no = 0; page_no < SIM_TABLE_PAGES; page_no++) {
+        for (int i = 0; i < SIM_RECORDS_PER_PAGE * 2; i++) {
+            hits += sim.access(page_no);
+            accesses++;
+        }
+        if (page_no % SIM_SCAN_PAGES_PER_LOOKUP == 0) {
+            bool hit = sim.access(SIM_TABLE_PAGES + hot_dist(rng));
+            lookup_hits += hit;
+            lookups++;
+            hits += hit;
+            accesses++;
+        }
+    }
+    *lookup_hit_ratio = 100.0 * lookup_hits / lookups;
+    *total_hit_ratio = 100.0 * hits / accesses;
+}
+
+/**
+ * @description: 执行op共n次，返回每次操作的平均纳秒数
+ */
+template <typename Op>
+static double measure(size_t n, Op op) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n; i++) {
+        op(i);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / n;
+}
+
+int main(int argc, char **argv) {
+    size_t num_ops = argc > 1 ? strtoull(argv[1], nullptr, 10) : 4000000;
+
+    // 预先生成随机帧序列，避免随机数生成计入耗时
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<frame_id_t> dist(0, NUM_FRAMES - 1);
+    std::vector<frame_id_t> random_frames(num_ops);
+    for (auto &frame_id : random_frames) {
+        frame_id = dist(rng);
+    }
+
+    printf("%-10s %14s %14s %14s %14s\n", "replacer", "unpin(ns)", "hit(ns)", "miss(ns)", "victim(ns)");
+    for (const char *type : {"LRU", "LRU_ARRAY", "CLOCK", "2Q"}) {
+        auto replacer = BufferPoolManager::create_replacer(type, NUM_FRAMES);
+        // 所有帧依次变为可淘汰
+        double unpin_ns = measure(NUM_FRAMES, [&](size_t i) { replacer->unpin(static_cast<frame_id_t>(i)); });
+        // 命中路径：fetch_page固定页面，unpin_page后重新放回replacer
+        double hit_ns = measure(num_ops, [&](size_t i) {
+            replacer->pin(random_frames[i]);
+            replacer->unpin(random_frames[i]);
+        });
+        // 未命中路径：淘汰一帧，读入新页面后再放回replacer
+        double miss_ns = measure(num_ops, [&](size_t) {
+            frame_id_t frame_id;
+            replacer->victim(&frame_id);
+            replacer->unpin(frame_id);
+        });
+        // 清空replacer
+        double victim_ns = measure(NUM_FRAMES, [&](size_t) {
+            frame_id_t frame_id;
+            replacer->victim(&frame_id);
+        });
+        printf("%-10s %14.1f %14.1f %14.1f %14.1f\n", type, unpin_ns, hit_ns, miss_ns, victim_ns);
+    }
+
+    printf("\nscan of %d pages + point lookups on %d hot pages, %d frames\n", SIM_TABLE_PAGES, SIM_HOT_PAGES,
+           SIM_FRAMES);
+    printf("%-10s %14s %14s\n", "replacer", "lookup hit(%)", "total hit(%)");
+    for (const char *type : {"LRU", "LRU_ARRAY", "CLOCK", "2Q"}) {
+        double lookup_hit_ratio, total_hit_ratio;
+        simulate(type, &lookup_hit_ratio, &total_hit_ratio);
+        printf("%-10s %14.2f %14.2f\n", type, lookup_hit_ratio, total_hit_ratio);
+    }
+    return 0;
+}
@@ -0,0 +1,169 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+// 变长记录测试：TPC-C的customer和stock表分别以CHAR和VARCHAR存放可变长度的字符串列，插入相同的记录，
+// 比较表文件的页面个数，以及装载和全表扫描的时间。列宽与比赛负载的建表语句相同，字符串的实际长度按TPC-C规范
+// 在[最小长度, 列宽]中均匀分布（c_data按规范的300~500字符等比缩小到列宽50）
+// 用法: varlen_bench [num_warehouses]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "record/rm.h"
+#include "storage/buffer_pool_manager.h"
+
+static const std::string BENCH_DB_NAME = "VarlenBench_db";
+static const std::string BENCH_FILE_NAME = "bench";
+static constexpr size_t BENCH_POOL_SIZE = 4096;
+
+/* 列的宽度和实际长度的范围，min_len等于len的列是定长的 */
+struct BenchCol {
+    const char *name;
+    int len;     // 列宽
+    int min_len; // 字符串的最小长度
+    bool str;    // 是否为字符串，否则是INT、FLOAT
+};
+
+struct BenchTable {
+    const char *name;
+    int rows_per_warehouse;
+    std::vector<BenchCol> cols;
+};
+
+static const std::vector<BenchTable> BENCH_TABLES = {
+    {"customer",
+     30000,
+     {
+         {"c_id", 4, 4, false},
+         {"c_d_id", 4, 4, false},
+         {"c_w_id", 4, 4, false},
+         {"c_first", 16, 8, true},
+         {"c_middle", 2, 2, true},
+         {"c_last", 16, 9, true},
+         {"c_street_1", 20, 10, true},
+         {"c_street_2", 20, 10, true},
+         {"c_city", 20, 10, true},
+         {"c_state", 2, 2, true},
+         {"c_zip", 9, 9, true},
+         {"c_phone", 16, 16, true},
+         {"c_since", 19, 19, true},
+         {"c_credit", 2, 2, true},
+         {"c_credit_lim", 4, 4, false},
+         {"c_discount", 4, 4, false},
+         {"c_balance", 4, 4, false},
+         {"c_ytd_payment", 4, 4, false},
+         {"c_payment_cnt", 4, 4, false},
+         {"c_delivery_cnt", 4, 4, false},
+         {"c_data", 50, 30, true},
+     }},
+    {"stock",
+     100000,
+     {
+         {"s_i_id", 4, 4, false},
+         {"s_w_id", 4, 4, false},
+         {"s_quantity", 4, 4, false},
+         {"s_dist_01", 24, 24, true},
+         {"s_dist_02", 24, 24, true},
+         {"s_dist_03", 24, 24, true},
+         {"s_dist_04", 24, 24, true},
+         {"s_dist_05", 24, 24, true},
+         {"s_dist_06", 24, 24, true},
+         {"s_dist_07", 24, 24, true},
+         {"s_dist_08", 24, 24, true},
+         {"s_dist_09", 24, 24, true},
+         {"s_dist_10", 24, 24, true},
+         {"s_ytd", 4, 4, false},
+         {"s_order_cnt", 4, 4, false},
+         {"s_remote_cnt", 4, 4, false},
+         {"s_data", 50, 26, true},
+     }},
+};
+
+/**
+ * @description: 建表并插入num_records条记录，之后扫描全表
+ * @param {bool} varlen 长度可变的字符串列是否存放为VARCHAR
+ */
+static void run(const BenchTable &table, bool varlen, int num_records) {
+    int record_size = 0;
+    std::vector<RmColumn> var_cols;
+    for (auto &col : table.cols) {
+        if (varlen && col.str && col.min_len < col.len) {
+            var_cols.push_back(RmColumn{record_size, col.len});
+        }
+        record_size += col.len;
+    }
+
+    DiskManager disk_manager;
+    if (disk_manager.is_file(BENCH_FILE_NAME)) {
+        disk_manager.destroy_file(BENCH_FILE_NAME);
+    }
+    BufferPoolManager buffer_pool_manager(BENCH_POOL_SIZE, &disk_manager);
+    RmManager rm_manager(&disk_manager, &buffer_pool_manager);
+    rm_manager.create_file(BENCH_FILE_NAME, record_size, var_cols);
+    auto file_handle = rm_manager.open_file(BENCH_FILE_NAME);
+
+    std::mt19937 rng(0);
+    std::vector<char> record(record_size);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_records; i++) {
+        char *p = record.data();
+        for (auto &col : table.cols) {
+            int len = col.str ? col.min_len + static_cast<int>(rng() % (col.len - col.min_len + 1)) : col.len;
+            for (int j = 0; j < col.len; j++) {
+                p[j] = j >= len ? '\0' : col.str ? static_cast<char>('a' + rng() % 26) : static_cast<char>(rng());
+            }
+            p += col.len;
+        }
+        file_handle->insert_record(record.data(), nullptr);
+    }
+    std::chrono::duration<double> load_time = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    int num_scanned = 0;
+    for (RmScan scan(file_handle.get()); !scan.is_end(); scan.next()) {
+        num_scanned++;
+    }
+    std::chrono::duration<double> scan_time = std::chrono::steady_clock::now() - start;
+    if (num_scanned != num_records) {
+        throw InternalError("varlen_bench: scanned " + std::to_string(num_scanned) + " records");
+    }
+    int num_pages = file_handle->get_file_hdr().num_pages - 1;
+
+    printf("%10s %8s %8d %10d %10.1f %10.3f %10.3f\n", table.name, varlen ? "VARCHAR" : "CHAR", record_size,
+           num_pages, static_cast<double>(num_records) / num_pages, load_time.count(), scan_time.count());
+    rm_manager.close_file(file_handle.get());
+    rm_manager.destroy_file(BENCH_FILE_NAME);
+}
+
+int main(int argc, char **argv) {
+    int num_warehouses = argc > 1 ? atoi(argv[1]) : 1;
+
+    DiskManager disk_manager;
+    if (!disk_manager.is_dir(BENCH_DB_NAME)) {
+        disk_manager.create_dir(BENCH_DB_NAME);
+    }
+    if (chdir(BENCH_DB_NAME.c_str()) < 0) {
+        throw UnixError();
+    }
+    printf("%d warehouse(s), page size %d\n", num_warehouses, disk_manager.get_page_size());
+    printf("%10s %8s %8s %10s %10s %10s %10s\n", "table", "strings", "rec_size", "pages", "rows/page", "load_s",
+           "scan_s");
+    for (auto &table : BENCH_TABLES) {
+        run(table, false, table.rows_per_warehouse * num_warehouses);
+        run(table, true, table.rows_per_warehouse * num_warehouses);
+    }
+    if (chdir("..") < 0) {
+        throw UnixError();
+    }
+    return 0;
+}
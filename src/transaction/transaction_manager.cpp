@@ -118,6 +118,17 @@ void TransactionManager::commit(Transaction *txn, LogManager *log_manager) {
         //         }
         //     }
         // }
+
+        // 删除记录时为了能够回滚没有释放变空的页面（见RmFileHandle::delete_record），提交后再释放
+        for (auto write_record : *(txn->get_write_set())) {
+            if (write_record->GetWriteType() != WType::DELETE_TUPLE) {
+                continue;
+            }
+            auto it = sm_manager_->fhs_.find(write_record->GetTableName());
+            if (it != sm_manager_->fhs_.end()) {
+                it->second->release_deleted_page(write_record->GetRid().page_no);
+            }
+        }
     }
 
     // 2. 释放所有锁
@@ -249,4 +260,25 @@ void TransactionManager::abort(Transaction *txn, LogManager *log_manager) {
 
     // 5. 更新事务状态
     txn->set_state(TransactionState::ABORTED);
-}
\ No newline at end of file
+}
+
+/**
+ * @description: 是否有还没有提交或回滚的事务修改过这张表。整理表会移动记录，而回滚按原来的记录号恢复记录，
+ * 所以这样的表不能整理。调用者需排他持有SmManager::ddl_latch_，此时其他事务的写集合和状态不会变化
+ * @return {bool} 有这样的事务时返回true
+ * @param {string&} tab_name 表名称
+ */
+bool TransactionManager::has_uncommitted_writes(const std::string &tab_name) {
+    std::scoped_lock lock{latch_};
+    for (auto &[txn_id, txn] : txn_map) {
+        if (txn->get_state() == TransactionState::COMMITTED || txn->get_state() == TransactionState::ABORTED) {
+            continue;
+        }
+        for (auto write_record : *txn->get_write_set()) {
+            if (write_record->GetTableName() == tab_name) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
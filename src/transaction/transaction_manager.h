@@ -38,6 +38,8 @@ class TransactionManager {
 
     void abort(Transaction *txn, LogManager *log_manager);
 
+    bool has_uncommitted_writes(const std::string &tab_name);
+
     ConcurrencyMode get_concurrency_mode() {
         return concurrency_mode_;
     }
@@ -13,8 +13,11 @@ See the Mulan PSL v2 for more details. */
 #define private public
 
 #include "execution/external_merge_sort.h"
+#include "index/ix.h"
 #include "record/rm.h"
 #include "storage/buffer_pool_manager.h"
+#include "system/sm.h"
+#include "transaction/transaction_manager.h"
 
 #undef private
 
@@ -23,16 +26,24 @@ See the Mulan PSL v2 for more details. */
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <fstream>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <random>
 #include <set>
+#include <sstream>
 #include <string>
 #include <thread> // NOLINT
 #include <unordered_map>
 #include <vector>
 
+#include "replacer/array_lru_replacer.h"
+#include "replacer/clock_replacer.h"
 #include "replacer/lru_replacer.h"
+#include "replacer/two_queue_replacer.h"
 #include "storage/disk_manager.h"
+#include "storage/page_codec.h"
 #include "gtest/gtest.h"
 
 const std::string TEST_DB_NAME = "BufferPoolManagerTest_db"; // 以数据库名作为根目录
@@ -137,6 +148,7 @@ void check_equal(const RmFileHandle *file_handle,
         assert(mock.count(scan.rid()) > 0);
         auto rec = file_handle->get_record(scan.rid(), nullptr);
         assert(memcmp(rec->data, mock.at(scan.rid()).c_str(), file_handle->file_hdr_.record_size) == 0);
+        assert(memcmp(scan.record(), rec->data, file_handle->file_hdr_.record_size) == 0);
         num_records++;
     }
     assert(
@@ -146,11 +158,132 @@ void check_equal(const RmFileHandle *file_handle,
     assert(num_records == mock.size());
 }
 
+// 空闲空间映射中每个页面的空闲槽位个数与页头一致，释放的页面不在映射中
+void check_free_space_map(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager,
+                          RmFileHandle *file_handle) {
+    auto &fsm = file_handle->get_free_space_map();
+    for (int page_no = 1; page_no < file_handle->file_hdr_.num_pages; page_no++) {
+        if (disk_manager->is_page_free(file_handle->GetFd(), page_no)) {
+            EXPECT_EQ(RmFreeSpaceMap::NOT_TRACKED, fsm.get_num_free(page_no));
+            continue;
+        }
+        auto page_handle = file_handle->fetch_page_handle(page_no);
+        EXPECT_EQ(file_handle->get_num_free(page_handle), fsm.get_num_free(page_no));
+        buffer_pool_manager->unpin_page(page_handle.page->get_page_id(), false);
+    }
+}
+
 // std::cout can call this, for example: std::cout << rid
 std::ostream &operator<<(std::ostream &os, const Rid &rid) {
     return os << '(' << rid.page_no << ", " << rid.slot_no << ')';
 }
 
+TEST(ArrayLRUReplacerTest, SampleTest) {
+    // 与LRUReplacerTest相同的场景，两者的淘汰顺序应当一致
+    ArrayLRUReplacer lru_replacer(7);
+
+    lru_replacer.unpin(1);
+    lru_replacer.unpin(2);
+    lru_replacer.unpin(3);
+    lru_replacer.unpin(4);
+    lru_replacer.unpin(5);
+    lru_replacer.unpin(6);
+    lru_replacer.unpin(1);
+    EXPECT_EQ(6, lru_replacer.Size());
+
+    int value;
+    lru_replacer.victim(&value);
+    EXPECT_EQ(1, value);
+    lru_replacer.victim(&value);
+    EXPECT_EQ(2, value);
+    lru_replacer.victim(&value);
+    EXPECT_EQ(3, value);
+
+    lru_replacer.pin(3);
+    lru_replacer.pin(4);
+    EXPECT_EQ(2, lru_replacer.Size());
+
+    lru_replacer.unpin(4);
+
+    lru_replacer.victim(&value);
+    EXPECT_EQ(5, value);
+    lru_replacer.victim(&value);
+    EXPECT_EQ(6, value);
+    lru_replacer.victim(&value);
+    EXPECT_EQ(4, value);
+    EXPECT_EQ(0, lru_replacer.Size());
+    EXPECT_FALSE(lru_replacer.victim(&value));
+}
+
+TEST(ClockReplacerTest, SampleTest) {
+    ClockReplacer clock_replacer(7);
+
+    // Scenario: unpin six elements, all of them have the reference bit set.
+    clock_replacer.unpin(1);
+    clock_replacer.unpin(2);
+    clock_replacer.unpin(3);
+    clock_replacer.unpin(4);
+    clock_replacer.unpin(5);
+    clock_replacer.unpin(6);
+    clock_replacer.unpin(1);
+    EXPECT_EQ(6, clock_replacer.Size());
+
+    // Scenario: the first sweep clears every reference bit, then frames are evicted in clock order.
+    int value;
+    clock_replacer.victim(&value);
+    EXPECT_EQ(1, value);
+    clock_replacer.victim(&value);
+    EXPECT_EQ(2, value);
+
+    // Scenario: frame 3 is accessed again, so the hand skips it once.
+    clock_replacer.pin(3);
+    clock_replacer.unpin(3);
+    clock_replacer.pin(4);
+    EXPECT_EQ(3, clock_replacer.Size());
+    clock_replacer.victim(&value);
+    EXPECT_EQ(5, value);
+    clock_replacer.victim(&value);
+    EXPECT_EQ(6, value);
+    clock_replacer.victim(&value);
+    EXPECT_EQ(3, value);
+    EXPECT_EQ(0, clock_replacer.Size());
+    EXPECT_FALSE(clock_replacer.victim(&value));
+}
+
+TEST(TwoQueueReplacerTest, SampleTest) {
+    // 8帧：冷队列目标为2帧，相关访问间隔为2次unpin
+    TwoQueueReplacer replacer(8);
+
+    // Scenario: unpin four elements, all of them enter the cold queue.
+    replacer.unpin(0);
+    replacer.unpin(1);
+    replacer.unpin(2);
+    replacer.unpin(3);
+    EXPECT_EQ(4, replacer.Size());
+
+    // Scenario: frame 0 is accessed again long after its first access and becomes hot,
+    // frame 3 is accessed again right away (correlated reference) and stays cold.
+    replacer.pin(0);
+    replacer.unpin(0);
+    replacer.pin(3);
+    replacer.unpin(3);
+    EXPECT_EQ(4, replacer.Size());
+
+    // Scenario: cold frames are evicted first while the cold queue is at its target size.
+    int value;
+    replacer.victim(&value);
+    EXPECT_EQ(1, value);
+    replacer.victim(&value);
+    EXPECT_EQ(2, value);
+    // the cold queue is below its target, so the hot frame goes next
+    replacer.victim(&value);
+    EXPECT_EQ(0, value);
+    replacer.victim(&value);
+    EXPECT_EQ(3, value);
+    EXPECT_EQ(0, replacer.Size());
+    EXPECT_FALSE(replacer.victim(&value));
+}
+
 /** 注意：每个测试点只测试了单个文件！
  * 对于每个测试点，先创建和进入目录TEST_DB_NAME
  * 然后在此目录下创建和打开文件TEST_FILE_NAME_BIG，记录其文件描述符fd */
@@ -316,6 +449,8 @@ TEST_F(BufferPoolManagerTest, SampleTest) {
     for (size_t i = buffer_pool_size; i < buffer_pool_size * 2; ++i) {
         EXPECT_EQ(nullptr, bpm->new_page(&page_id_temp));
     }
+    // The page numbers taken by the failed calls are given back and reused.
+    EXPECT_EQ(1, disk_manager->get_page_stats(fd).num_free_pages);
 
     // Scenario: After unpinning pages {0, 1, 2, 3, 4} and pinning another 4 new pages,
     // there would still be one cache frame left for reading page 0.
@@ -341,6 +476,435 @@ TEST_F(BufferPoolManagerTest, SampleTest) {
  * 对于每个测试点，先创建和进入目录TEST_DB_NAME
  * 然后在此目录下创建和打开文件TEST_FILE_NAME_CCUR，记录其文件描述符fd */
 
+TEST_F(BufferPoolManagerTest, AccessStrategyTest) {
+    const size_t buffer_pool_size = 64;
+    const int num_hot_pages = 32;
+    const int num_pages = 400;
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager);
+    int fd = BufferPoolManagerTest::fd_;
+
+    for (int i = 0; i < num_pages; i++) {
+        PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+        auto page = bpm->new_page(&page_id);
+        ASSERT_NE(nullptr, page);
+        EXPECT_EQ(i, page_id.page_no);
+        strcpy(page->get_data(), std::to_string(i).c_str()); // NOLINT
+        EXPECT_EQ(1, bpm->unpin_page(page_id, true));
+    }
+    // 最后创建的页面还在缓冲池中，作为热页面
+    const int first_hot_page = num_pages - num_hot_pages;
+    for (int i = first_hot_page; i < num_pages; i++) {
+        ASSERT_NE(nullptr, bpm->fetch_page({fd, i}));
+        EXPECT_EQ(1, bpm->unpin_page({fd, i}, false));
+    }
+
+    // Scenario: a bulk scan of the pages that are not in the buffer pool reads every page correctly...
+    const int num_scan_pages = num_pages - buffer_pool_size;
+    BufferAccessStrategy strategy(BufferAccessStrategy::Type::BULK_READ, 4);
+    for (int i = 0; i < num_scan_pages; i++) {
+        auto page = bpm->fetch_page({fd, i}, &strategy);
+        ASSERT_NE(nullptr, page);
+        EXPECT_EQ(0, std::strcmp(std::to_string(i).c_str(), page->get_data()));
+        EXPECT_EQ(1, bpm->unpin_page({fd, i}, false));
+    }
+    // ...only the first round of the ring is taken from the shared replacer...
+    EXPECT_EQ(num_scan_pages - 4, strategy.get_num_reused());
+    // ...and the hot pages are still in the buffer pool.
+    for (int i = first_hot_page; i < num_pages; i++) {
+        EXPECT_NE(INVALID_FRAME_ID, bpm->shards_[0].page_table.find(bpm->get_page_key(PageId{fd, i})));
+    }
+
+    // Scenario: under 2Q, a ring frame reused for a new page does not carry the old page's history,
+    // so a scan with a ring larger than the correlated period leaves the hot queue as it was.
+    bpm->flush_all_pages(fd);
+    bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager, 1, "2Q");
+    auto replacer = static_cast<TwoQueueReplacer *>(bpm->shards_[0].replacer.get());
+    // 热页面在相隔超过相关访问间隔之后再次被访问
+    for (int round = 0; round < 2; round++) {
+        for (int i = first_hot_page; i < num_pages; i++) {
+            ASSERT_NE(nullptr, bpm->fetch_page({fd, i}));
+            EXPECT_EQ(1, bpm->unpin_page({fd, i}, false));
+        }
+    }
+    auto hot_pages = [&]() {
+        std::set<page_id_t> pages;
+        for (size_t frame_id = 0; frame_id < buffer_pool_size; frame_id++) {
+            if (replacer->hot_[frame_id]) {
+                pages.insert(bpm->shards_[0].pages[frame_id].get_page_id().page_no);
+            }
+        }
+        return pages;
+    };
+    auto hot_before = hot_pages();
+    EXPECT_EQ(static_cast<size_t>(num_hot_pages), hot_before.size());
+    BufferAccessStrategy big_ring(BufferAccessStrategy::Type::BULK_READ, buffer_pool_size / 2);
+    for (int i = 0; i < num_scan_pages; i++) {
+        ASSERT_NE(nullptr, bpm->fetch_page({fd, i}, &big_ring));
+        EXPECT_EQ(1, bpm->unpin_page({fd, i}, false));
+    }
+    EXPECT_GT(big_ring.get_num_reused(), 0u);
+    EXPECT_EQ(hot_before, hot_pages());
+}
+
+TEST_F(BufferPoolManagerTest, BackgroundWriterTest) {
+    const size_t buffer_pool_size = 32;
+    const int clean_target = 16;
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager);
+    int fd = BufferPoolManagerTest::fd_;
+
+    // Scenario: fill the buffer pool with dirty pages.
+    for (size_t i = 0; i < buffer_pool_size; i++) {
+        PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+        auto page = bpm->new_page(&page_id);
+        ASSERT_NE(nullptr, page);
+        strcpy(page->get_data(), std::to_string(page_id.page_no).c_str()); // NOLINT
+        EXPECT_EQ(1, bpm->unpin_page(page_id, true));
+    }
+
+    // Scenario: one round cleans the frames that the replacer evicts next, within the page budget.
+    EXPECT_EQ(4, bpm->background_write_round(4, clean_target));
+    EXPECT_EQ(clean_target - 4, bpm->background_write_round(100, clean_target));
+    EXPECT_EQ(0, bpm->background_write_round(100, clean_target));
+    EXPECT_EQ(clean_target, bpm->get_write_stats().background_writes);
+
+    // Scenario: evicting the cleaned frames does not write in the foreground.
+    for (int i = 0; i < clean_target; i++) {
+        PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+        ASSERT_NE(nullptr, bpm->new_page(&page_id));
+        EXPECT_EQ(1, bpm->unpin_page(page_id, false));
+    }
+    EXPECT_EQ(0, bpm->get_write_stats().foreground_writes);
+
+    // Scenario: the pages written by the background writer are read back correctly.
+    for (int i = 0; i < clean_target; i++) {
+        auto page = bpm->fetch_page({fd, i});
+        ASSERT_NE(nullptr, page);
+        EXPECT_EQ(0, std::strcmp(std::to_string(i).c_str(), page->get_data()));
+        EXPECT_EQ(1, bpm->unpin_page({fd, i}, false));
+    }
+    EXPECT_EQ(clean_target, bpm->get_write_stats().background_writes);
+    EXPECT_EQ(clean_target, bpm->get_write_stats().foreground_writes);
+}
+
+TEST_F(BufferPoolManagerTest, ReadAheadTest) {
+    const size_t buffer_pool_size = 64;
+    const int num_pages = 256;
+    const int read_ahead_pages = 16;
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    int fd = BufferPoolManagerTest::fd_;
+    char buf[PAGE_SIZE] = {};
+    for (int i = 0; i < num_pages; i++) {
+        disk_manager->write_page(fd, i, buf, PAGE_SIZE);
+    }
+    disk_manager->set_fd2pageno(fd, num_pages);
+    auto scan = [&](BufferPoolManager *bpm, int start_page_no) {
+        for (int i = start_page_no; i < num_pages; i++) {
+            ASSERT_NE(nullptr, bpm->fetch_page({fd, i}));
+            EXPECT_EQ(1, bpm->unpin_page({fd, i}, false));
+        }
+    };
+
+    // Scenario: scattered misses do not trigger read-ahead.
+    auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager);
+    bpm->set_read_ahead_pages(read_ahead_pages);
+    for (int i = 0; i < 32; i++) {
+        PageId page_id = {fd, i * 37 % num_pages};
+        ASSERT_NE(nullptr, bpm->fetch_page(page_id));
+        EXPECT_EQ(1, bpm->unpin_page(page_id, false));
+    }
+    EXPECT_EQ(0, bpm->get_num_prefetched_pages());
+
+    // Scenario: a sequential scan is detected after READ_AHEAD_TRIGGER misses, then later pages are prefetched once.
+    bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager);
+    bpm->set_read_ahead_pages(read_ahead_pages);
+    scan(bpm.get(), 0);
+    EXPECT_EQ(num_pages - READ_AHEAD_TRIGGER, bpm->get_num_prefetched_pages());
+
+    // Scenario: a hint from the scan prefetches the first window right away.
+    bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager);
+    bpm->set_read_ahead_pages(read_ahead_pages);
+    bpm->hint_sequential(fd, 1);
+    EXPECT_EQ(read_ahead_pages, bpm->get_num_prefetched_pages());
+    scan(bpm.get(), 1);
+    EXPECT_EQ(num_pages - 1, bpm->get_num_prefetched_pages());
+
+    // Scenario: read-ahead can be turned off.
+    bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager);
+    bpm->set_read_ahead_pages(0);
+    bpm->hint_sequential(fd, 1);
+    scan(bpm.get(), 0);
+    EXPECT_EQ(0, bpm->get_num_prefetched_pages());
+}
+
+TEST_F(BufferPoolManagerTest, FlushAllPagesTest) {
+    const size_t buffer_pool_size = 128;
+    const int num_pages = 64;
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager, 4);
+    int fd = BufferPoolManagerTest::fd_;
+
+    // Scenario: new pages are dirty even if never modified, and consecutive pages are written in one batch.
+    for (int i = 0; i < num_pages; i++) {
+        PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+        auto page = bpm->new_page(&page_id);
+        ASSERT_NE(nullptr, page);
+        EXPECT_EQ(i, page_id.page_no);
+        EXPECT_EQ(1, bpm->unpin_page(page_id, false));
+    }
+    bpm->flush_all_pages(fd);
+    EXPECT_EQ(num_pages, bpm->get_write_stats().flush_writes);
+    EXPECT_EQ(1, bpm->get_write_stats().flush_batches);
+    for (auto &shard : bpm->shards_) {
+        EXPECT_TRUE(shard.dirty_frames.empty());
+    }
+
+    // Scenario: only dirty pages are written, and pages that are not adjacent are separate batches.
+    for (int i = 0; i < num_pages; i += 2) {
+        auto page = bpm->fetch_page({fd, i});
+        ASSERT_NE(nullptr, page);
+        snprintf(page->get_data(), PAGE_SIZE, "page %d", i);
+        EXPECT_EQ(1, bpm->unpin_page({fd, i}, true));
+    }
+    bpm->flush_all_pages(fd);
+    EXPECT_EQ(num_pages + num_pages / 2, bpm->get_write_stats().flush_writes);
+    EXPECT_EQ(1 + num_pages / 2, bpm->get_write_stats().flush_batches);
+
+    // Scenario: flushing a clean file writes nothing.
+    bpm->flush_all_pages(fd);
+    EXPECT_EQ(num_pages + num_pages / 2, bpm->get_write_stats().flush_writes);
+
+    // Scenario: the flushed pages are on disk.
+    bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager, 4);
+    for (int i = 0; i < num_pages; i++) {
+        auto page = bpm->fetch_page({fd, i});
+        ASSERT_NE(nullptr, page);
+        EXPECT_EQ(i % 2 == 0 ? "page " + std::to_string(i) : "", std::string(page->get_data()));
+        EXPECT_EQ(1, bpm->unpin_page({fd, i}, false));
+    }
+}
+
+TEST_F(BufferPoolManagerTest, IoContextTest) {
+    const unsigned depth = 8;
+    const int num_pages = 64;
+    int fd = BufferPoolManagerTest::fd_;
+    EXPECT_EQ(nullptr, create_io_context("unknown", depth));
+
+    for (const std::string backend : {"io_uring", "thread_pool"}) {
+        auto io = create_io_context(backend, depth);
+        ASSERT_NE(nullptr, io);
+        std::vector<char> data(num_pages * PAGE_SIZE);
+        std::vector<IoRequest> requests(num_pages);
+        std::vector<IoRequest *> completed(depth);
+        // Runs all requests, keeping up to depth of them in flight.
+        auto run = [&](IoOpType op) {
+            int next = 0;
+            while (next < num_pages || io->get_num_in_flight() > 0) {
+                while (next < num_pages && io->get_num_in_flight() < depth) {
+                    requests[next] = {op, fd, next, data.data() + next * PAGE_SIZE, PAGE_SIZE, nullptr};
+                    IoRequest *request = &requests[next++];
+                    io->submit(&request, 1);
+                }
+                size_t num = io->wait(completed.data(), completed.size(), 1);
+                for (size_t i = 0; i < num; i++) {
+                    EXPECT_EQ(PAGE_SIZE, completed[i]->result);
+                }
+            }
+        };
+
+        // Scenario: pages written through the context are read back through it.
+        for (int i = 0; i < num_pages; i++) {
+            snprintf(data.data() + i * PAGE_SIZE, PAGE_SIZE, "%s page %d", backend.c_str(), i);
+        }
+        run(IoOpType::WRITE);
+        std::fill(data.begin(), data.end(), 0);
+        run(IoOpType::READ);
+        for (int i = 0; i < num_pages; i++) {
+            EXPECT_EQ(backend + " page " + std::to_string(i), data.data() + i * PAGE_SIZE);
+        }
+
+        // Scenario: more requests than the queue depth are rejected.
+        std::vector<IoRequest *> too_many(depth + 1, &requests[0]);
+        EXPECT_THROW(io->submit(too_many.data(), too_many.size()), InternalError);
+        EXPECT_EQ(0, io->get_num_in_flight());
+
+        // Scenario: an I/O error is reported in the result.
+        IoRequest bad_request = {IoOpType::READ, -1, 0, data.data(), PAGE_SIZE, nullptr};
+        IoRequest *request = &bad_request;
+        io->submit(&request, 1);
+        ASSERT_EQ(1, io->wait(completed.data(), completed.size(), 1));
+        EXPECT_EQ(&bad_request, completed[0]);
+        EXPECT_EQ(-EBADF, bad_request.result);
+    }
+}
+
+TEST(PageTableTest, SampleTest) {
+    const size_t max_size = 64;
+    PageTable page_table(max_size);
+    std::unordered_map<page_key_t, frame_id_t> expected;
+    std::mt19937 rng(0);
+
+    // Scenario: random inserts and erases agree with unordered_map; keys of different files with the same
+    // page number and page numbers beyond 16 bits are all distinct.
+    for (int round = 0; round < 10000; round++) {
+        page_key_t key = make_page_key(rng() % 4 + 1, static_cast<page_id_t>(rng() % 8 * 65536 + rng() % 16));
+        if (expected.size() < max_size && rng() % 2 == 0) {
+            frame_id_t frame_id = static_cast<frame_id_t>(rng() % max_size);
+            page_table.insert(key, frame_id);
+            expected[key] = frame_id;
+        } else {
+            EXPECT_EQ(expected.erase(key) > 0, page_table.erase(key));
+        }
+        ASSERT_EQ(expected.size(), page_table.size());
+    }
+    for (uint32_t file_id = 1; file_id <= 4; file_id++) {
+        for (page_id_t page_no = 0; page_no < 8 * 65536; page_no += 65536) {
+            for (int i = 0; i < 16; i++) {
+                page_key_t key = make_page_key(file_id, page_no + i);
+                auto it = expected.find(key);
+                EXPECT_EQ(it == expected.end() ? INVALID_FRAME_ID : it->second, page_table.find(key));
+            }
+        }
+    }
+}
+
+TEST_F(BufferPoolManagerTest, FileIdTest) {
+    const std::string other_file_name = "basic_other";
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    auto bpm = std::make_unique<BufferPoolManager>(16, disk_manager);
+    int fd = BufferPoolManagerTest::fd_;
+    uint32_t file_id = disk_manager->get_file_id(fd);
+    EXPECT_NE(0, file_id);
+
+    PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+    auto page = bpm->new_page(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->get_data(), PAGE_SIZE, "basic");
+    bpm->unpin_page(page_id, true);
+    bpm->flush_all_pages(fd);
+
+    // Scenario: a file reopened by path keeps its id, so its pages left in the buffer pool are still hit.
+    disk_manager->close_file(fd);
+    EXPECT_EQ(0, disk_manager->get_file_id(fd));
+    fd = disk_manager->open_file(TEST_FILE_NAME);
+    EXPECT_EQ(file_id, disk_manager->get_file_id(fd));
+    EXPECT_EQ(page, bpm->fetch_page({fd, 0}));
+    bpm->unpin_page({fd, 0}, false);
+
+    // Scenario: when the reopened file gets another fd, the hit moves the frame to that fd, so writeback follows it.
+    disk_manager->close_file(fd);
+    int placeholder_fd = dup(STDERR_FILENO); // 占住原来的fd
+    fd = disk_manager->open_file(TEST_FILE_NAME);
+    EXPECT_NE(placeholder_fd, fd);
+    EXPECT_EQ(page, bpm->fetch_page({fd, 0}));
+    EXPECT_EQ(fd, page->get_page_id().fd);
+    snprintf(page->get_data(), PAGE_SIZE, "rebound");
+    bpm->unpin_page({fd, 0}, true);
+    bpm->flush_all_pages(fd);
+    char buf[PAGE_SIZE];
+    disk_manager->read_page(fd, 0, buf, PAGE_SIZE);
+    EXPECT_STREQ("rebound", buf);
+
+    // Scenario: another file that reuses the fd of a closed file does not hit the pages of the closed file.
+    disk_manager->close_file(fd);
+    if (disk_manager->is_file(other_file_name)) {
+        disk_manager->destroy_file(other_file_name);
+    }
+    disk_manager->create_file(other_file_name);
+    int other_fd = disk_manager->open_file(other_file_name);
+    EXPECT_EQ(fd, other_fd);
+    EXPECT_NE(file_id, disk_manager->get_file_id(other_fd));
+    disk_manager->set_fd2pageno(other_fd, 0);
+    PageId other_page_id = {.fd = other_fd, .page_no = INVALID_PAGE_ID};
+    auto other_page = bpm->new_page(&other_page_id);
+    ASSERT_NE(nullptr, other_page);
+    EXPECT_EQ(0, other_page_id.page_no);
+    EXPECT_NE(page, other_page);
+    EXPECT_EQ(std::string(), other_page->get_data());
+    bpm->unpin_page(other_page_id, false);
+    bpm->flush_all_pages(other_fd);
+    disk_manager->close_file(other_fd);
+    disk_manager->destroy_file(other_file_name);
+    close(placeholder_fd);
+
+    // Scenario: a file with the same relative path in another database directory is a different file.
+    const std::string other_dir = "basic_other_dir";
+    if (!disk_manager->is_dir(other_dir)) {
+        disk_manager->create_dir(other_dir);
+    }
+    ASSERT_EQ(0, chdir(other_dir.c_str()));
+    if (!disk_manager->is_file(TEST_FILE_NAME)) {
+        disk_manager->create_file(TEST_FILE_NAME);
+    }
+    other_fd = disk_manager->open_file(TEST_FILE_NAME);
+    EXPECT_NE(file_id, disk_manager->get_file_id(other_fd));
+    disk_manager->close_file(other_fd);
+    disk_manager->destroy_file(TEST_FILE_NAME);
+    ASSERT_EQ(0, chdir(".."));
+    disk_manager->destroy_dir(other_dir);
+
+    // Scenario: a file recreated at a destroyed path gets a new id.
+    disk_manager->destroy_file(TEST_FILE_NAME);
+    disk_manager->create_file(TEST_FILE_NAME);
+    BufferPoolManagerTest::fd_ = disk_manager->open_file(TEST_FILE_NAME);
+    EXPECT_NE(file_id, disk_manager->get_file_id(BufferPoolManagerTest::fd_));
+}
+
+TEST_F(BufferPoolManagerTest, LargeFileTest) {
+    const off_t four_gb = 4LL * 1024 * 1024 * 1024;
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    int fd = BufferPoolManagerTest::fd_;
+    // page numbers at the 2GB mark and past the 4GB mark, the file is sparse
+    const std::vector<page_id_t> page_nos = {0, static_cast<page_id_t>(2LL * 1024 * 1024 * 1024 / PAGE_SIZE),
+                                             static_cast<page_id_t>(four_gb / PAGE_SIZE) + 1};
+    char buf[PAGE_SIZE];
+
+    // Scenario: pages past the 4GB mark are written and read back at the right offsets.
+    for (page_id_t page_no : page_nos) {
+        memset(buf, 0, PAGE_SIZE);
+        snprintf(buf, PAGE_SIZE, "page %d", page_no);
+        disk_manager->write_page(fd, page_no, buf, PAGE_SIZE);
+    }
+    EXPECT_EQ((static_cast<off_t>(page_nos.back()) + 1) * PAGE_SIZE, disk_manager->get_file_size(TEST_FILE_NAME));
+    for (page_id_t page_no : page_nos) {
+        disk_manager->read_page(fd, page_no, buf, PAGE_SIZE);
+        EXPECT_EQ("page " + std::to_string(page_no), buf);
+    }
+
+    // Scenario: the same pages are fetched through the buffer pool.
+    auto bpm = std::make_unique<BufferPoolManager>(4, disk_manager);
+    for (page_id_t page_no : page_nos) {
+        auto page = bpm->fetch_page({fd, page_no});
+        ASSERT_NE(nullptr, page);
+        EXPECT_EQ("page " + std::to_string(page_no), page->get_data());
+        bpm->unpin_page({fd, page_no}, false);
+    }
+
+    // Scenario: the log is read at an offset past the 4GB mark.
+    if (disk_manager->is_file(LOG_FILE_NAME)) {
+        disk_manager->destroy_file(LOG_FILE_NAME);
+    }
+    disk_manager->create_file(LOG_FILE_NAME);
+    ASSERT_EQ(0, truncate(LOG_FILE_NAME.c_str(), four_gb));
+    char log_data[] = "log record past 4GB";
+    disk_manager->write_log(log_data, sizeof(log_data));
+    EXPECT_EQ(four_gb + static_cast<off_t>(sizeof(log_data)), disk_manager->get_file_size(LOG_FILE_NAME));
+    char log_buf[sizeof(log_data) * 2] = {};
+    EXPECT_EQ(sizeof(log_data), disk_manager->read_log(log_buf, sizeof(log_buf), four_gb));
+    EXPECT_STREQ(log_data, log_buf);
+    disk_manager->close_file(disk_manager->GetLogFd());
+    disk_manager->SetLogFd(-1);
+    disk_manager->destroy_file(LOG_FILE_NAME);
+
+    // do not leave a 4GB (sparse) test file behind
+    disk_manager->close_file(fd);
+    disk_manager->destroy_file(TEST_FILE_NAME);
+    disk_manager->create_file(TEST_FILE_NAME);
+    BufferPoolManagerTest::fd_ = disk_manager->open_file(TEST_FILE_NAME);
+}
+
+
 // Add by jiawen
 class BufferPoolManagerConcurrencyTest : public ::testing::Test {
   public:
@@ -434,6 +998,101 @@ TEST_F(BufferPoolManagerConcurrencyTest, ConcurrencyTest) {
     } // end loop run=[0,num_runs)
 }
 
+TEST_F(BufferPoolManagerConcurrencyTest, ShardedConcurrencyTest) {
+    const int num_threads = 8;
+    const int num_runs = 20;
+    const size_t num_shards = 4;
+
+    // get fd
+    int fd = BufferPoolManagerConcurrencyTest::fd_;
+
+    for (int run = 0; run < num_runs; run++) {
+        // 每个分片64帧，足够容纳所有线程同时pin住的页面
+        auto disk_manager = BufferPoolManagerConcurrencyTest::disk_manager_.get();
+        auto bpm = std::make_unique<BufferPoolManager>(256, disk_manager, num_shards);
+        ASSERT_EQ(num_shards, bpm->get_num_shards());
+
+        std::vector<std::thread> threads;
+        for (int tid = 0; tid < num_threads; tid++) {
+            threads.emplace_back([&bpm, fd]() { // NOLINT
+                PageId temp_page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+                std::vector<PageId> page_ids;
+                for (int i = 0; i < 5; i++) {
+                    auto new_page = bpm->new_page(&temp_page_id);
+                    ASSERT_NE(nullptr, new_page);
+                    strcpy(new_page->get_data(), std::to_string(temp_page_id.page_no).c_str()); // NOLINT
+                    page_ids.push_back(temp_page_id);
+                }
+                for (auto &page_id : page_ids) {
+                    EXPECT_EQ(1, bpm->unpin_page(page_id, true));
+                }
+                for (int r = 0; r < 10; r++) {
+                    for (auto &page_id : page_ids) {
+                        auto page = bpm->fetch_page(page_id);
+                        ASSERT_NE(nullptr, page);
+                        EXPECT_EQ(0, std::strcmp(std::to_string(page_id.page_no).c_str(), page->get_data()));
+                        EXPECT_EQ(1, bpm->unpin_page(page_id, false));
+                    }
+                }
+                for (auto &page_id : page_ids) {
+                    EXPECT_EQ(1, bpm->delete_page(page_id));
+                }
+            });
+        }
+
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+}
+
+TEST_F(BufferPoolManagerConcurrencyTest, EvictionIoConcurrencyTest) {
+    const int num_threads = 8;
+    const int num_pages = 64;
+    const int num_fetches = 2000;
+
+    // get fd
+    int fd = BufferPoolManagerConcurrencyTest::fd_;
+    auto disk_manager = BufferPoolManagerConcurrencyTest::disk_manager_.get();
+    // 每个分片16帧，远小于工作集，不断有页面在锁外被写回和读入
+    auto bpm = std::make_unique<BufferPoolManager>(32, disk_manager, 2);
+    // 后台写线程同时写回即将被淘汰的脏页
+    bpm->start_background_writer(1, 8, 16);
+
+    std::vector<PageId> page_ids;
+    for (int i = 0; i < num_pages; i++) {
+        PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+        auto page = bpm->new_page(&page_id);
+        ASSERT_NE(nullptr, page);
+        strcpy(page->get_data(), std::to_string(page_id.page_no).c_str()); // NOLINT
+        EXPECT_EQ(1, bpm->unpin_page(page_id, true));
+        page_ids.push_back(page_id);
+    }
+
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < num_threads; tid++) {
+        threads.emplace_back([&bpm, &page_ids, tid]() { // NOLINT
+            std::mt19937 rng(tid);
+            std::uniform_int_distribution<int> dist(0, num_pages - 1);
+            for (int i = 0; i < num_fetches; i++) {
+                // 所有线程访问同一组冷页面，同一页面的并发请求只能读入一次
+                auto &page_id = page_ids[dist(rng)];
+                auto page = bpm->fetch_page(page_id);
+                ASSERT_NE(nullptr, page);
+                EXPECT_EQ(0, std::strcmp(std::to_string(page_id.page_no).c_str(), page->get_data()));
+                EXPECT_EQ(1, bpm->unpin_page(page_id, i % 3 == 0));
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    for (auto &page_id : page_ids) {
+        EXPECT_EQ(1, bpm->delete_page(page_id));
+    }
+}
+
 // TODO: fix detected memory leaks found by Google Test
 TEST(StorageTest, SimpleTest) {
     srand((unsigned)time(nullptr));
@@ -671,6 +1330,1936 @@ TEST(RecordManagerTest, SimpleTest) {
     rm_manager->destroy_file(filename);
 }
 
+TEST(RecordManagerTest, DirectIoTest) {
+    srand((unsigned)time(nullptr));
+
+    const size_t buffer_pool_size = 64;
+    auto disk_manager = std::make_unique<DiskManager>();
+    disk_manager->set_direct_io(true);
+    auto buffer_pool_manager =
+        std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get(), 4, REPLACER_TYPE, true);
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    // Scenario: frame data is page aligned and separate from the frame metadata.
+    for (size_t i = 0; i < buffer_pool_size; i++) {
+        char *data = buffer_pool_manager->pages_[i].get_data();
+        EXPECT_EQ(0, reinterpret_cast<uintptr_t>(data) % PAGE_SIZE);
+        EXPECT_EQ(buffer_pool_manager->pages_[0].get_data() + i * PAGE_SIZE, data);
+    }
+
+    std::string filename = "direct.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    int record_size = 256; // 每页十几条记录，插入的记录占用的页面远多于缓冲池的帧
+    rm_manager->create_file(filename, record_size);
+    auto file_handle = rm_manager->open_file(filename);
+    EXPECT_TRUE(disk_manager->is_direct_file(file_handle->GetFd()));
+
+    // Scenario: records survive eviction and reopening when every page I/O bypasses the page cache.
+    std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> mock;
+    char write_buf[PAGE_SIZE];
+    for (int i = 0; i < 5000; i++) {
+        rand_buf(record_size, write_buf);
+        Rid rid = file_handle->insert_record(write_buf, nullptr);
+        mock[rid] = std::string(write_buf, record_size);
+    }
+    EXPECT_GT(file_handle->file_hdr_.num_pages, static_cast<int>(buffer_pool_size));
+    check_equal(file_handle.get(), mock);
+    rm_manager->close_file(file_handle.get());
+    file_handle = rm_manager->open_file(filename);
+    EXPECT_EQ(record_size, file_handle->file_hdr_.record_size);
+    check_equal(file_handle.get(), mock);
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+}
+
+TEST(RecordManagerTest, ScanTest) {
+    const size_t buffer_pool_size = 64;
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+    std::string filename = "scan.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    int record_size = 100;
+    rm_manager->create_file(filename, record_size);
+    auto file_handle = rm_manager->open_file(filename);
+    auto num_pinned = [&]() {
+        int num = 0;
+        for (size_t i = 0; i < buffer_pool_size; i++) {
+            num += buffer_pool_manager->pages_[i].pin_count_;
+        }
+        return num;
+    };
+
+    std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> mock;
+    char write_buf[PAGE_SIZE];
+    for (int i = 0; i < 3000; i++) {
+        rand_buf(record_size, write_buf);
+        Rid rid = file_handle->insert_record(write_buf, nullptr);
+        mock[rid] = std::string(write_buf, record_size);
+    }
+    // 删光第2页，并在其余页面中留下空洞
+    for (auto it = mock.begin(); it != mock.end();) {
+        if (it->first.page_no == 2 || rand() % 3 == 0) {
+            file_handle->delete_record(it->first, nullptr);
+            it = mock.erase(it);
+        } else {
+            it++;
+        }
+    }
+
+    // Scenario: the scan keeps exactly the current page pinned and hands out records in place inside that frame.
+    size_t num_records = 0;
+    Rid prev{-1, -1};
+    {
+        RmScan scan(file_handle.get());
+        for (; !scan.is_end(); scan.next()) {
+            Rid rid = scan.rid();
+            ASSERT_TRUE(prev.page_no < rid.page_no || (prev.page_no == rid.page_no && prev.slot_no < rid.slot_no));
+            ASSERT_EQ(mock.at(rid), std::string(scan.record(), record_size));
+            ASSERT_EQ(1, num_pinned());
+            Page *page = buffer_pool_manager->fetch_page({file_handle->GetFd(), rid.page_no});
+            EXPECT_GE(scan.record(), page->get_data());
+            EXPECT_LT(scan.record(), page->get_data() + PAGE_SIZE);
+            buffer_pool_manager->unpin_page(page->get_page_id(), false);
+            prev = rid;
+            num_records++;
+        }
+        EXPECT_EQ(mock.size(), num_records);
+        EXPECT_EQ(0, num_pinned());
+    }
+
+    // Scenario: abandoning a scan midway releases its page.
+    {
+        RmScan scan(file_handle.get());
+        scan.next();
+        EXPECT_EQ(1, num_pinned());
+    }
+    EXPECT_EQ(0, num_pinned());
+
+    // Scenario: deleting every record of the page under the scan keeps the pinned page valid until the scan leaves it.
+    {
+        RmScan scan(file_handle.get());
+        page_id_t page_no = scan.rid().page_no;
+        for (auto it = mock.begin(); it != mock.end();) {
+            if (it->first.page_no == page_no) {
+                file_handle->delete_record(it->first, nullptr);
+                it = mock.erase(it);
+            } else {
+                it++;
+            }
+        }
+        EXPECT_FALSE(disk_manager->is_page_free(file_handle->GetFd(), page_no));
+        num_records = 0;
+        for (scan.next(); !scan.is_end(); scan.next()) {
+            ASSERT_NE(page_no, scan.rid().page_no);
+            num_records++;
+        }
+        EXPECT_EQ(mock.size(), num_records);
+    }
+    check_equal(file_handle.get(), mock);
+    EXPECT_EQ(0, num_pinned());
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+}
+
+TEST(BitmapTest, SampleTest) {
+    // 逐位查找的参考实现
+    auto naive_next_bit = [](bool bit, const char *bm, int max_n, int curr) {
+        for (int i = curr + 1; i < max_n; i++) {
+            if (Bitmap::is_set(bm, i) == bit) {
+                return i;
+            }
+        }
+        return max_n;
+    };
+    std::mt19937 rng(7);
+    std::vector<char> bm;
+
+    // Scenario: word-parallel search and count agree with bit-by-bit search for any size, density and start position,
+    // with and without AVX2.
+    for (int round = 0; round < 300; round++) {
+        int max_n = 1 + rng() % 3000;
+        int num_bytes = (max_n + BITMAP_WIDTH - 1) / BITMAP_WIDTH;
+        bm.assign(num_bytes, 0);
+        // 稀疏、稠密以及成段的0和1，覆盖AVX2跳过整段的情况
+        unsigned density = rng() % 5;
+        int num_set = 0;
+        for (int i = 0; i < max_n; i++) {
+            bool set = density == 0 ? rng() % 500 == 0 : density == 4 ? rng() % 500 != 0 : rng() % 4 < density;
+            if (set) {
+                Bitmap::set(bm.data(), i);
+                num_set++;
+            }
+        }
+        ASSERT_EQ(num_set, Bitmap::count(bm.data(), max_n));
+        for (bool bit : {false, true}) {
+            for (int curr = -1; curr < max_n; curr += 1 + rng() % 16) {
+                int expected = naive_next_bit(bit, bm.data(), max_n, curr);
+                ASSERT_EQ(expected, Bitmap::next_bit(bit, bm.data(), max_n, curr, false));
+                ASSERT_EQ(expected, Bitmap::next_bit(bit, bm.data(), max_n, curr));
+            }
+        }
+    }
+
+    // Scenario: bits past max_n in the last byte are never reported.
+    char full[2] = {static_cast<char>(0xff), static_cast<char>(0xff)};
+    EXPECT_EQ(10, Bitmap::first_bit(false, full, 10));
+    EXPECT_EQ(10, Bitmap::count(full, 10));
+    char empty[2] = {0, 0x20};
+    EXPECT_EQ(10, Bitmap::first_bit(true, empty, 10));
+    EXPECT_EQ(0, Bitmap::count(empty, 10));
+    EXPECT_EQ(10, Bitmap::next_bit(true, full, 10, 9));
+}
+
+TEST(FreePageMapTest, SampleTest) {
+    FreePageMap map;
+    EXPECT_EQ(INVALID_PAGE_ID, map.allocate());
+
+    // Scenario: freed pages are handed out again lowest first, across word boundaries.
+    for (page_id_t page_no : {200, 3, 64, 65, 3}) {
+        map.set_free(page_no);
+    }
+    EXPECT_EQ(4u, map.get_num_free());
+    EXPECT_TRUE(map.is_free(64));
+    EXPECT_FALSE(map.is_free(4));
+    EXPECT_FALSE(map.is_free(100000));
+    EXPECT_EQ(3, map.allocate());
+    EXPECT_TRUE(map.set_used(65));
+    EXPECT_FALSE(map.set_used(65));
+    EXPECT_EQ(64, map.allocate());
+    map.set_free(1);
+    EXPECT_EQ(1, map.allocate());
+    EXPECT_EQ(200, map.allocate());
+    EXPECT_EQ(INVALID_PAGE_ID, map.allocate());
+    EXPECT_EQ(0u, map.get_num_free());
+
+    // Scenario: a map rebuilt from its words has the same free pages.
+    map.set_free(7);
+    map.set_free(130);
+    FreePageMap copy(map.get_words());
+    EXPECT_EQ(2u, copy.get_num_free());
+    EXPECT_EQ(7, copy.allocate());
+    EXPECT_EQ(130, copy.allocate());
+
+    // Scenario: truncating drops the free pages past the new end of the file.
+    for (page_id_t page_no : {5, 70, 71, 140}) {
+        map.set_free(page_no);
+    }
+    map.truncate(71);
+    EXPECT_EQ(3u, map.get_num_free());
+    EXPECT_FALSE(map.is_free(71));
+    EXPECT_FALSE(map.is_free(140));
+    EXPECT_EQ(5, map.allocate());
+    EXPECT_EQ(7, map.allocate());
+    EXPECT_EQ(70, map.allocate());
+    EXPECT_EQ(INVALID_PAGE_ID, map.allocate());
+}
+
+TEST(RmFreeSpaceMapTest, SampleTest) {
+    RmFreeSpaceMap fsm(100);
+    EXPECT_EQ(INVALID_PAGE_ID, fsm.find_page());
+    EXPECT_EQ(RmFreeSpaceMap::NOT_TRACKED, fsm.get_num_free(5));
+
+    // Scenario: pages with fewer free slots are chosen first, and the k-th candidate goes to the k-th inserter.
+    fsm.update(1, 100);
+    fsm.update(2, 3);
+    fsm.update(3, 50);
+    fsm.update(4, 0);
+    EXPECT_EQ(3u, fsm.get_num_candidates());
+    EXPECT_EQ(2, fsm.find_page());
+    EXPECT_EQ(3, fsm.find_page(1));
+    EXPECT_EQ(1, fsm.find_page(2));
+    EXPECT_EQ(INVALID_PAGE_ID, fsm.find_page(3));
+    EXPECT_EQ(0, fsm.get_num_free(4));
+
+    // Scenario: a page that fills up or is freed leaves the candidates, and other pages keep their buckets.
+    fsm.update(2, 0);
+    fsm.update(3, RmFreeSpaceMap::NOT_TRACKED);
+    EXPECT_EQ(1u, fsm.get_num_candidates());
+    EXPECT_EQ(1, fsm.find_page());
+    EXPECT_EQ(RmFreeSpaceMap::NOT_TRACKED, fsm.get_num_free(3));
+    fsm.update(4, 1);
+    fsm.update(1, 99);
+    EXPECT_EQ(4, fsm.find_page());
+    EXPECT_EQ(1, fsm.find_page(1));
+
+    // Scenario: the saved counts cover every page, untracked ones included.
+    std::vector<int> counts = fsm.get_free_counts();
+    ASSERT_EQ(5u, counts.size());
+    EXPECT_EQ(RmFreeSpaceMap::NOT_TRACKED, counts[0]);
+    EXPECT_EQ(99, counts[1]);
+    EXPECT_EQ(0, counts[2]);
+    EXPECT_EQ(RmFreeSpaceMap::NOT_TRACKED, counts[3]);
+    EXPECT_EQ(1, counts[4]);
+
+    // Scenario: a claimed page leaves the candidates, cannot be removed, and returns to its bucket on release.
+    EXPECT_EQ(4, fsm.claim_page());
+    EXPECT_EQ(1, fsm.claim_page());
+    EXPECT_EQ(INVALID_PAGE_ID, fsm.claim_page());
+    fsm.update(4, 60);
+    EXPECT_EQ(0u, fsm.get_num_candidates());
+    EXPECT_EQ(60, fsm.get_num_free(4));
+    EXPECT_FALSE(fsm.try_remove(4));
+    fsm.claim(6, 100);
+    EXPECT_EQ(INVALID_PAGE_ID, fsm.find_page());
+    fsm.release(4);
+    fsm.release(6);
+    EXPECT_EQ(4, fsm.find_page());
+    EXPECT_EQ(6, fsm.find_page(1));
+    EXPECT_TRUE(fsm.try_remove(4));
+    EXPECT_EQ(RmFreeSpaceMap::NOT_TRACKED, fsm.get_num_free(4));
+    EXPECT_EQ(6, fsm.claim_page());
+
+    // Scenario: a claim that needs more space skips pages that are too full, even within the same bucket.
+    fsm.update(7, 20);
+    fsm.update(8, 24);
+    fsm.update(9, 90);
+    EXPECT_EQ(8, fsm.claim_page(22));
+    EXPECT_EQ(9, fsm.claim_page(22));
+    EXPECT_EQ(INVALID_PAGE_ID, fsm.claim_page(22));
+    EXPECT_EQ(7, fsm.claim_page());
+}
+
+TEST(RmSlottedPageTest, SampleTest) {
+    constexpr int area_size = 256;
+    std::vector<char> area(area_size);
+    RmSlottedPage page(area.data(), area_size);
+    page.init();
+    int capacity = RmSlottedPage::get_capacity(area_size);
+    EXPECT_EQ(capacity, page.get_free_space());
+
+    auto check = [&](int slot_no, const std::string &data) {
+        ASSERT_TRUE(page.is_used(slot_no));
+        EXPECT_EQ(data, std::string(page.get_data(slot_no), page.get_len(slot_no)));
+    };
+
+    // Scenario: tuples of different lengths get consecutive slots and use exactly their length plus a slot.
+    std::vector<std::string> tuples = {std::string(10, 'a'), std::string(40, 'b'), std::string(25, 'c')};
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(i, page.insert(RM_TUPLE_NORMAL, tuples[i].data(), tuples[i].size()));
+    }
+    EXPECT_EQ(capacity - 75 - 3 * RmSlottedPage::get_space_needed(0), page.get_free_space());
+    for (int i = 0; i < 3; i++) {
+        check(i, tuples[i]);
+    }
+
+    // Scenario: an erased slot is reused, and space freed in the middle is found by compacting the page.
+    page.erase(1);
+    EXPECT_FALSE(page.is_used(1));
+    std::string big(page.get_free_space() - 1, 'd');
+    EXPECT_EQ(1, page.insert(RM_TUPLE_NORMAL, big.data(), big.size()));
+    EXPECT_EQ(0, page.get_free_space());
+    check(0, tuples[0]);
+    check(1, big);
+    check(2, tuples[2]);
+    EXPECT_EQ(-1, page.insert(RM_TUPLE_NORMAL, "x", 1));
+
+    // Scenario: shrinking updates in place, growing moves the tuple, and an update that does not fit changes nothing.
+    EXPECT_TRUE(page.update(1, RM_TUPLE_FORWARD, "12345678", 8));
+    EXPECT_EQ(RM_TUPLE_FORWARD, page.get_kind(1));
+    check(1, "12345678");
+    int free_space = page.get_free_space();
+    std::string grown(30, 'e');
+    EXPECT_TRUE(page.update(0, RM_TUPLE_MOVED, grown.data(), grown.size()));
+    EXPECT_EQ(RM_TUPLE_MOVED, page.get_kind(0));
+    EXPECT_EQ(free_space - 20, page.get_free_space());
+    std::string huge(page.get_free_space() + 27, 'f');
+    EXPECT_FALSE(page.update(2, RM_TUPLE_NORMAL, huge.data(), huge.size()));
+    check(0, grown);
+    check(1, "12345678");
+    check(2, tuples[2]);
+
+    // Scenario: inserting at a slot past the directory extends it, and trailing empty slots are trimmed on erase.
+    EXPECT_TRUE(page.insert_at(5, RM_TUPLE_NORMAL, "yz", 2));
+    EXPECT_EQ(6, page.get_num_slots());
+    EXPECT_FALSE(page.is_used(3));
+    EXPECT_EQ(3, page.insert(RM_TUPLE_NORMAL, "w", 1));
+    page.erase(5);
+    EXPECT_EQ(4, page.get_num_slots());
+    for (int i = 3; i >= 0; i--) {
+        page.erase(i);
+    }
+    EXPECT_EQ(0, page.get_num_slots());
+    EXPECT_EQ(capacity, page.get_free_space());
+
+    // Scenario: the codec keeps fixed bytes and strips trailing zeros of variable columns, and decodes back exactly.
+    RmRecordLayout layout{};
+    layout.num_var_cols = 2;
+    layout.var_cols[0] = RmColumn{4, 20};
+    layout.var_cols[1] = RmColumn{30, 10};
+    RmRecordCodec codec(layout, 40, nullptr);
+    std::vector<char> record(40, 0);
+    memcpy(record.data(), "\1\0\2\0", 4);
+    memcpy(record.data() + 4, "hello", 5);
+    memcpy(record.data() + 24, "fixed\0", 6);
+    memcpy(record.data() + 30, "0123456789", 10);
+    std::vector<char> encoded(codec.get_max_len());
+    EXPECT_EQ(4 + 2 + 5 + 6 + 2 + 10, codec.encode(record.data(), encoded.data()));
+    std::vector<char> decoded(40, 'z');
+    codec.decode(encoded.data(), decoded.data());
+    EXPECT_EQ(record, decoded);
+}
+
+TEST(StorageTest, FreePageMapTest) {
+    auto disk_manager = std::make_unique<DiskManager>();
+    std::string filename = "free_pages.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    disk_manager->create_file(filename);
+    int fd = disk_manager->open_file(filename);
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(i, disk_manager->allocate_page(fd));
+    }
+
+    // Scenario: deallocated pages are reused before the file grows.
+    disk_manager->deallocate_page(fd, 7);
+    disk_manager->deallocate_page(fd, 2);
+    EXPECT_TRUE(disk_manager->is_page_free(fd, 2));
+    FilePageStats stats = disk_manager->get_page_stats(fd);
+    EXPECT_EQ(10, stats.num_pages);
+    EXPECT_EQ(2, stats.num_free_pages);
+    EXPECT_EQ(2, disk_manager->allocate_page(fd));
+    EXPECT_FALSE(disk_manager->is_page_free(fd, 2));
+
+    // Scenario: the free pages survive closing and reopening the file.
+    std::string map_path = filename + FREE_PAGE_MAP_SUFFIX;
+    disk_manager->close_file(fd);
+    EXPECT_TRUE(disk_manager->is_file(map_path));
+    fd = disk_manager->open_file(filename);
+    disk_manager->set_fd2pageno(fd, 10);
+    EXPECT_TRUE(disk_manager->is_page_free(fd, 7));
+    EXPECT_TRUE(disk_manager->reclaim_page(fd, 7));
+    EXPECT_FALSE(disk_manager->reclaim_page(fd, 7));
+    EXPECT_EQ(10, disk_manager->allocate_page(fd));
+    EXPECT_EQ(0, disk_manager->get_page_stats(fd).num_free_pages);
+
+    // Scenario: a file without free pages leaves no sidecar behind, and destroying the file removes it.
+    disk_manager->close_file(fd);
+    EXPECT_FALSE(disk_manager->is_file(map_path));
+    fd = disk_manager->open_file(filename);
+    disk_manager->deallocate_page(fd, 1);
+    disk_manager->close_file(fd);
+    EXPECT_TRUE(disk_manager->is_file(map_path));
+    disk_manager->destroy_file(filename);
+    EXPECT_FALSE(disk_manager->is_file(map_path));
+
+    // Scenario: the map is consumed on open, so after a crash (file never closed) a page that was
+    // reused since the last clean close is not handed out again.
+    disk_manager->create_file(filename);
+    fd = disk_manager->open_file(filename);
+    disk_manager->set_fd2pageno(fd, 0);
+    char buf[PAGE_SIZE];
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(i, disk_manager->allocate_page(fd));
+        memset(buf, i, PAGE_SIZE);
+        disk_manager->write_page(fd, i, buf, PAGE_SIZE);
+    }
+    disk_manager->deallocate_page(fd, 3);
+    disk_manager->deallocate_page(fd, 5);
+    disk_manager->close_file(fd);
+    fd = disk_manager->open_file(filename);
+    disk_manager->set_fd2pageno(fd, 10);
+    EXPECT_FALSE(disk_manager->is_file(map_path));
+    EXPECT_EQ(3, disk_manager->allocate_page(fd));
+    memset(buf, 'L', PAGE_SIZE);
+    disk_manager->write_page(fd, 3, buf, PAGE_SIZE);
+
+    auto recovered = std::make_unique<DiskManager>();
+    int recovered_fd = recovered->open_file(filename);
+    recovered->set_fd2pageno(recovered_fd, 10);
+    for (page_id_t page_no = 0; page_no < 10; page_no++) {
+        EXPECT_FALSE(recovered->is_page_free(recovered_fd, page_no));
+    }
+    EXPECT_EQ(10, recovered->allocate_page(recovered_fd));
+    recovered->read_page(recovered_fd, 3, buf, PAGE_SIZE);
+    EXPECT_EQ('L', buf[0]);
+    recovered->close_file(recovered_fd);
+    disk_manager->close_file(fd);
+    disk_manager->destroy_file(filename);
+}
+
+TEST(StorageTest, ExtentTest) {
+    auto disk_manager = std::make_unique<DiskManager>();
+    disk_manager->set_extent_size(4, 16);
+    std::string filename = "extent.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    disk_manager->create_file(filename);
+    int fd = disk_manager->open_file(filename);
+    auto disk_pages = [&]() {
+        struct stat st;
+        fstat(fd, &st);
+        return static_cast<page_id_t>(st.st_blocks * 512 / PAGE_SIZE);
+    };
+
+    // Scenario: extents double with the file up to the maximum, and the reserved blocks do not change the file size.
+    std::vector<page_id_t> reserved;
+    for (int i = 0; i < 64; i++) {
+        EXPECT_EQ(i, disk_manager->allocate_page(fd));
+        if (reserved.empty() || reserved.back() != disk_manager->get_reserved_pages(fd)) {
+            reserved.push_back(disk_manager->get_reserved_pages(fd));
+        }
+    }
+    EXPECT_EQ((std::vector<page_id_t>{4, 8, 16, 32, 48, 64}), reserved);
+    EXPECT_EQ(0, disk_manager->get_file_size(filename));
+    EXPECT_GE(disk_pages(), 64);
+
+    // Scenario: pages written inside the reserved extents read back, and reopening resumes from the file size.
+    char buf[PAGE_SIZE];
+    for (int i = 0; i < 64; i++) {
+        memset(buf, i, PAGE_SIZE);
+        disk_manager->write_page(fd, i, buf, PAGE_SIZE);
+    }
+    EXPECT_EQ(64 * PAGE_SIZE, disk_manager->get_file_size(filename));
+    disk_manager->read_page(fd, 37, buf, PAGE_SIZE);
+    EXPECT_EQ(37, buf[PAGE_SIZE - 1]);
+    disk_manager->close_file(fd);
+    fd = disk_manager->open_file(filename);
+    EXPECT_EQ(64, disk_manager->get_reserved_pages(fd));
+
+    // Scenario: a failing fallocate only skips the reservation; the pages are still handed out in order, without holes.
+    disk_manager->set_fd2pageno(fd, 64);
+    int rw_fd = dup(fd);
+    int ro_fd = open(filename.c_str(), O_RDONLY);
+    ASSERT_GE(ro_fd, 0);
+    ASSERT_EQ(fd, dup2(ro_fd, fd));
+    EXPECT_EQ(64, disk_manager->allocate_page(fd));
+    EXPECT_EQ(65, disk_manager->allocate_page(fd));
+    EXPECT_EQ(64, disk_manager->get_reserved_pages(fd));
+    ASSERT_EQ(fd, dup2(rw_fd, fd));
+    close(ro_fd);
+    close(rw_fd);
+    for (int i = 64; i < 66; i++) {
+        memset(buf, i, PAGE_SIZE);
+        disk_manager->write_page(fd, i, buf, PAGE_SIZE);
+    }
+    EXPECT_EQ(66 * PAGE_SIZE, disk_manager->get_file_size(filename));
+
+    // Scenario: a maximum of 0 grows the file one page at a time.
+    disk_manager->set_extent_size(4, 0);
+    disk_manager->set_fd2pageno(fd, 66);
+    EXPECT_EQ(66, disk_manager->allocate_page(fd));
+    EXPECT_EQ(64, disk_manager->get_reserved_pages(fd));
+    disk_manager->close_file(fd);
+    disk_manager->destroy_file(filename);
+}
+
+TEST(RecordManagerTest, PageReuseTest) {
+    srand((unsigned)time(nullptr));
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(256, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    std::string filename = "page_reuse.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    int record_size = 256;
+    rm_manager->create_file(filename, record_size);
+    auto file_handle = rm_manager->open_file(filename);
+
+    std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> mock;
+    std::vector<Rid> rids;
+    char write_buf[PAGE_SIZE];
+    auto insert = [&](int num) {
+        for (int i = 0; i < num; i++) {
+            rand_buf(record_size, write_buf);
+            Rid rid = file_handle->insert_record(write_buf, nullptr);
+            mock[rid] = std::string(write_buf, record_size);
+            rids.push_back(rid);
+        }
+    };
+    // 按插入顺序删除最早的num条记录，前面的页面会整页变空
+    auto erase_oldest = [&](int num) {
+        for (int i = 0; i < num; i++) {
+            file_handle->delete_record(rids[i], nullptr);
+            mock.erase(rids[i]);
+        }
+        rids.erase(rids.begin(), rids.begin() + num);
+    };
+
+    // Scenario: pages emptied by FIFO deletes are freed, and later inserts fill them instead of growing the file.
+    insert(3000);
+    int num_pages = file_handle->file_hdr_.num_pages;
+    erase_oldest(2000);
+    int num_free = disk_manager->get_page_stats(file_handle->GetFd()).num_free_pages;
+    EXPECT_GT(num_free, num_pages / 2);
+    check_equal(file_handle.get(), mock);
+    insert(2000);
+    EXPECT_EQ(num_pages, file_handle->file_hdr_.num_pages);
+    EXPECT_LT(disk_manager->get_page_stats(file_handle->GetFd()).num_free_pages, num_free);
+    check_equal(file_handle.get(), mock);
+
+    // Scenario: the free pages are still reused after the file is closed and reopened.
+    erase_oldest(2000);
+    rm_manager->close_file(file_handle.get());
+    file_handle = rm_manager->open_file(filename);
+    EXPECT_GT(disk_manager->get_page_stats(file_handle->GetFd()).num_free_pages, num_pages / 2);
+    check_equal(file_handle.get(), mock);
+    insert(2000);
+    EXPECT_EQ(num_pages, file_handle->file_hdr_.num_pages);
+    check_equal(file_handle.get(), mock);
+
+    // Scenario: a page emptied inside a transaction is kept until commit, so a rollback puts the rows back in place.
+    Transaction txn(0);
+    txn.set_txn_mode(true);
+    Context context(nullptr, nullptr, &txn);
+    page_id_t page_no = rids.front().page_no;
+    std::vector<std::pair<Rid, std::string>> deleted;
+    for (auto &[rid, record] : mock) {
+        if (rid.page_no == page_no) {
+            deleted.emplace_back(rid, record);
+        }
+    }
+    for (auto &[rid, record] : deleted) {
+        file_handle->delete_record(rid, &context);
+        mock.erase(rid);
+    }
+    EXPECT_FALSE(disk_manager->is_page_free(file_handle->GetFd(), page_no));
+    for (auto &[rid, record] : deleted) {
+        file_handle->insert_record(rid, record.data());
+        mock[rid] = record;
+    }
+    check_equal(file_handle.get(), mock);
+    for (auto &[rid, record] : deleted) {
+        file_handle->delete_record(rid, &context);
+        mock.erase(rid);
+    }
+    file_handle->release_deleted_page(page_no);
+    EXPECT_TRUE(disk_manager->is_page_free(file_handle->GetFd(), page_no));
+    check_equal(file_handle.get(), mock);
+
+    // Scenario: putting a row back into a slot that another row took since the delete fails instead of overwriting it.
+    Rid rid = rids.back();
+    std::string old_record = mock[rid];
+    file_handle->delete_record(rid, nullptr);
+    rand_buf(record_size, write_buf);
+    file_handle->insert_record(rid, write_buf);
+    mock[rid] = std::string(write_buf, record_size);
+    EXPECT_THROW(file_handle->insert_record(rid, old_record.data()), InternalError);
+    check_equal(file_handle.get(), mock);
+
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+}
+
+TEST(RecordManagerTest, FreeSpaceMapTest) {
+    srand((unsigned)time(nullptr));
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(256, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    std::string filename = "free_space_map.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    int record_size = 128;
+    rm_manager->create_file(filename, record_size);
+    auto file_handle = rm_manager->open_file(filename);
+    std::string map_path = filename + FREE_SPACE_MAP_SUFFIX;
+
+    std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> mock;
+    std::vector<Rid> rids;
+    char write_buf[PAGE_SIZE];
+    auto check_fsm = [&]() { check_free_space_map(disk_manager.get(), buffer_pool_manager.get(), file_handle.get()); };
+
+    // Scenario: random inserts and deletes keep the map in step with the page headers.
+    for (int i = 0; i < 5000; i++) {
+        if (rids.empty() || rand() % 3 != 0) {
+            rand_buf(record_size, write_buf);
+            Rid rid = file_handle->insert_record(write_buf, nullptr);
+            mock[rid] = std::string(write_buf, record_size);
+            rids.push_back(rid);
+        } else {
+            size_t pos = rand() % rids.size();
+            file_handle->delete_record(rids[pos], nullptr);
+            mock.erase(rids[pos]);
+            rids[pos] = rids.back();
+            rids.pop_back();
+        }
+    }
+    check_fsm();
+    check_equal(file_handle.get(), mock);
+
+    // Scenario: deleting scattered records leaves free slots that later inserts fill without growing the file.
+    int num_pages = file_handle->file_hdr_.num_pages;
+    int num_deleted = 0;
+    for (size_t pos = 0; pos < rids.size(); pos += 2) {
+        file_handle->delete_record(rids[pos], nullptr);
+        mock.erase(rids[pos]);
+        num_deleted++;
+    }
+    for (int i = 0; i < num_deleted; i++) {
+        rand_buf(record_size, write_buf);
+        mock[file_handle->insert_record(write_buf, nullptr)] = std::string(write_buf, record_size);
+    }
+    EXPECT_EQ(num_pages, file_handle->file_hdr_.num_pages);
+    check_fsm();
+    check_equal(file_handle.get(), mock);
+
+    // Scenario: the map is saved on close, read back and removed on open, and rebuilt when it is missing.
+    rm_manager->close_file(file_handle.get());
+    EXPECT_TRUE(disk_manager->is_file(map_path));
+    file_handle = rm_manager->open_file(filename);
+    EXPECT_FALSE(disk_manager->is_file(map_path));
+    check_fsm();
+    rm_manager->close_file(file_handle.get());
+    unlink(map_path.c_str());
+    file_handle = rm_manager->open_file(filename);
+    check_fsm();
+    check_equal(file_handle.get(), mock);
+
+    // Scenario: record counts too low in page headers (older files never counted rolled-back deletes) are
+    // recomputed from the bitmaps when the map is rebuilt, so scans do not skip those pages.
+    for (page_id_t page_no = 1; page_no < file_handle->file_hdr_.num_pages; page_no++) {
+        if (disk_manager->is_page_free(file_handle->GetFd(), page_no)) {
+            continue;
+        }
+        auto page_handle = file_handle->fetch_page_handle(page_no);
+        page_handle.page_hdr->num_records = page_no % 2 == 0 ? 0 : page_handle.page_hdr->num_records / 2;
+        buffer_pool_manager->unpin_page(page_handle.page->get_page_id(), true);
+    }
+    rm_manager->close_file(file_handle.get());
+    unlink(map_path.c_str());
+    file_handle = rm_manager->open_file(filename);
+    check_fsm();
+    check_equal(file_handle.get(), mock);
+
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+    EXPECT_FALSE(disk_manager->is_file(map_path));
+}
+
+TEST(RecordManagerTest, ConcurrentInsertTest) {
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(256, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    std::string filename = "concurrent_insert.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    int record_size = 64;
+    rm_manager->create_file(filename, record_size);
+    auto file_handle = rm_manager->open_file(filename);
+
+    // Scenario: sessions insert and delete concurrently, each filling its own pages; no record is lost or shared.
+    const int num_threads = 8;
+    const int num_inserts = 3000;
+    std::vector<std::vector<std::pair<Rid, std::string>>> results(num_threads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&, t]() {
+            std::mt19937 rng(t);
+            std::vector<std::pair<Rid, std::string>> &records = results[t];
+            std::string buf(record_size, 0);
+            for (int i = 0; i < num_inserts; i++) {
+                for (auto &ch : buf) {
+                    ch = static_cast<char>(rng());
+                }
+                records.emplace_back(file_handle->insert_record(buf.data(), nullptr), buf);
+                if (rng() % 4 == 0) {
+                    size_t pos = rng() % records.size();
+                    file_handle->delete_record(records[pos].first, nullptr);
+                    records[pos] = records.back();
+                    records.pop_back();
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> mock;
+    for (auto &records : results) {
+        for (auto &[rid, buf] : records) {
+            EXPECT_EQ(0u, mock.count(rid));
+            mock[rid] = buf;
+        }
+    }
+    check_equal(file_handle.get(), mock);
+    check_free_space_map(disk_manager.get(), buffer_pool_manager.get(), file_handle.get());
+
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+}
+
+TEST(RecordManagerTest, BulkInsertTest) {
+    srand((unsigned)time(nullptr));
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(256, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    std::string filename = "bulk_insert.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    int record_size = 100;
+    rm_manager->create_file(filename, record_size);
+    auto file_handle = rm_manager->open_file(filename);
+    int num_slot = file_handle->file_hdr_.num_records_per_page;
+
+    std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> mock;
+    std::vector<Rid> rids;
+    BufferAccessStrategy strategy(BufferAccessStrategy::Type::BULK_WRITE);
+    auto insert_batch = [&](int num) {
+        std::vector<std::string> records(num);
+        std::vector<const char *> bufs;
+        for (auto &record : records) {
+            record.resize(record_size);
+            rand_buf(record_size, record.data());
+            bufs.push_back(record.data());
+        }
+        std::vector<Rid> batch_rids = file_handle->insert_records(bufs, nullptr, &strategy);
+        ASSERT_EQ(bufs.size(), batch_rids.size());
+        for (int i = 0; i < num; i++) {
+            EXPECT_EQ(0u, mock.count(batch_rids[i]));
+            mock[batch_rids[i]] = records[i];
+            rids.push_back(batch_rids[i]);
+        }
+    };
+
+    // Scenario: batches of any size fill pages densely, spanning page boundaries.
+    for (int num : {1, 37, num_slot, 3 * num_slot + 5, 0, 2000}) {
+        insert_batch(num);
+    }
+    int num_records = static_cast<int>(mock.size());
+    EXPECT_EQ(1 + (num_records + num_slot - 1) / num_slot, file_handle->file_hdr_.num_pages);
+    check_equal(file_handle.get(), mock);
+    check_free_space_map(disk_manager.get(), buffer_pool_manager.get(), file_handle.get());
+
+    // Scenario: a batch fills the holes left by deletes before growing the file.
+    int num_pages = file_handle->file_hdr_.num_pages;
+    int num_deleted = 0;
+    for (size_t pos = 0; pos < rids.size(); pos += 3) {
+        file_handle->delete_record(rids[pos], nullptr);
+        mock.erase(rids[pos]);
+        num_deleted++;
+    }
+    insert_batch(num_deleted);
+    EXPECT_EQ(num_pages, file_handle->file_hdr_.num_pages);
+    check_equal(file_handle.get(), mock);
+    check_free_space_map(disk_manager.get(), buffer_pool_manager.get(), file_handle.get());
+
+    // Scenario: single-row inserts and batches can be mixed.
+    std::string record(record_size, 'x');
+    mock[file_handle->insert_record(record.data(), nullptr)] = record;
+    insert_batch(500);
+    check_equal(file_handle.get(), mock);
+
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+}
+
+TEST(RecordManagerTest, VarlenTest) {
+    srand((unsigned)time(nullptr));
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(256, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    std::string filename = "varlen.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    // int | VARCHAR(100) | CHAR(16) | VARCHAR(180)
+    int record_size = 300;
+    std::vector<RmColumn> var_cols = {{4, 100}, {120, 180}};
+    EXPECT_THROW(rm_manager->create_file(filename, RM_MAX_VAR_RECORD_SIZE + 1, var_cols), InvalidRecordSizeError);
+    rm_manager->create_file(filename, record_size, var_cols);
+    auto file_handle = rm_manager->open_file(filename);
+    ASSERT_TRUE(file_handle->is_slotted());
+
+    // max_fill为每个变长字段实际长度的上限（占最大长度的比例）
+    auto rand_record = [&](double max_fill) {
+        std::string record(record_size, '\0');
+        rand_buf(record_size, record.data());
+        for (auto &col : var_cols) {
+            int len = rand() % (static_cast<int>(col.len * max_fill) + 1);
+            for (int i = 0; i < col.len; i++) {
+                record[col.offset + i] = i < len ? static_cast<char>('a' + rand() % 26) : '\0';
+            }
+        }
+        return record;
+    };
+    auto count_moved = [&]() {
+        int num_moved = 0;
+        for (int page_no = 1; page_no < file_handle->file_hdr_.num_pages; page_no++) {
+            if (disk_manager->is_page_free(file_handle->GetFd(), page_no)) {
+                continue;
+            }
+            auto page_handle = file_handle->fetch_page_handle(page_no);
+            auto page = file_handle->get_slotted_page(page_handle);
+            for (int slot_no = 0; slot_no < page.get_num_slots(); slot_no++) {
+                num_moved += page.is_used(slot_no) && page.get_kind(slot_no) == RM_TUPLE_MOVED;
+            }
+            buffer_pool_manager->unpin_page(page_handle.page->get_page_id(), false);
+        }
+        return num_moved;
+    };
+    auto check_all = [&](const std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> &mock) {
+        check_equal(file_handle.get(), mock);
+        check_free_space_map(disk_manager.get(), buffer_pool_manager.get(), file_handle.get());
+    };
+
+    std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> mock;
+    std::vector<Rid> rids;
+
+    // Scenario: random inserts, updates and deletes of variable-length rows read back in the expanded layout.
+    for (int i = 0; i < 5000; i++) {
+        int op = rand() % 4;
+        if (rids.empty() || op < 2) {
+            std::string record = rand_record(1.0);
+            Rid rid = file_handle->insert_record(record.data(), nullptr);
+            ASSERT_EQ(0u, mock.count(rid));
+            mock[rid] = record;
+            rids.push_back(rid);
+        } else {
+            size_t pos = rand() % rids.size();
+            Rid rid = rids[pos];
+            if (op == 2) {
+                std::string record = rand_record(1.0);
+                file_handle->update_record(rid, record.data(), nullptr);
+                mock[rid] = record;
+            } else {
+                file_handle->delete_record(rid, nullptr);
+                mock.erase(rid);
+                rids[pos] = rids.back();
+                rids.pop_back();
+            }
+        }
+    }
+    check_all(mock);
+
+    // Scenario: short rows pack many to a page; growing them keeps their rids through forwarding.
+    for (Rid rid : rids) {
+        file_handle->delete_record(rid, nullptr);
+    }
+    mock.clear();
+    rids.clear();
+    for (int i = 0; i < 600; i++) {
+        std::string record = rand_record(0.05);
+        Rid rid = file_handle->insert_record(record.data(), nullptr);
+        mock[rid] = record;
+        rids.push_back(rid);
+    }
+    std::set<page_id_t> short_pages;
+    for (Rid rid : rids) {
+        short_pages.insert(rid.page_no);
+    }
+    EXPECT_LT(short_pages.size(), 600u / (PAGE_SIZE / record_size) / 2);
+    for (Rid rid : rids) {
+        std::string record = rand_record(1.0);
+        memset(record.data() + 4, 'g', 100);
+        file_handle->update_record(rid, record.data(), nullptr);
+        mock[rid] = record;
+    }
+    EXPECT_GT(count_moved(), 0);
+    check_all(mock);
+
+    // Scenario: moving a forwarded row again, or shrinking it back home, leaves no stale moved tuples.
+    // A home page may still be full of other rows' moved tuples on the first pass, but not on the second.
+    for (size_t i = 0; i < rids.size(); i++) {
+        std::string record = rand_record(i % 2 == 0 ? 0.0 : 1.0);
+        file_handle->update_record(rids[i], record.data(), nullptr);
+        mock[rids[i]] = record;
+    }
+    check_all(mock);
+    for (int pass = 0; pass < 2; pass++) {
+        for (Rid rid : rids) {
+            std::string record = rand_record(0.0);
+            file_handle->update_record(rid, record.data(), nullptr);
+            mock[rid] = record;
+        }
+    }
+    EXPECT_EQ(0, count_moved());
+    check_all(mock);
+
+    // Scenario: rolling back deletes restores rows at their rids, even on a page freed after it became empty.
+    // 被插入目标占用的页面删空后不会释放，换一个不是插入目标的页面
+    std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> deleted;
+    auto is_insert_target = [&](page_id_t page_no) {
+        return std::any_of(file_handle->insert_targets_.begin(), file_handle->insert_targets_.end(),
+                           [&](auto &target) { return target.page_no == page_no; });
+    };
+    page_id_t victim = rids[0].page_no;
+    for (size_t i = 1; i < rids.size() && is_insert_target(victim); i++) {
+        victim = rids[i].page_no;
+    }
+    ASSERT_FALSE(is_insert_target(victim));
+    for (Rid rid : rids) {
+        if (rid.page_no == victim || rand() % 4 == 0) {
+            deleted[rid] = mock[rid];
+            file_handle->delete_record(rid, nullptr);
+            mock.erase(rid);
+        }
+    }
+    EXPECT_TRUE(disk_manager->is_page_free(file_handle->GetFd(), victim));
+    for (auto &[rid, record] : deleted) {
+        file_handle->insert_record(rid, record.data());
+        mock[rid] = record;
+    }
+    check_all(mock);
+
+    // Scenario: bulk inserts pack variable-length rows like single inserts, and everything survives a reopen.
+    std::vector<std::string> records;
+    for (int i = 0; i < 1000; i++) {
+        records.push_back(rand_record(1.0));
+    }
+    std::vector<const char *> bufs;
+    for (auto &record : records) {
+        bufs.push_back(record.data());
+    }
+    std::vector<Rid> batch_rids = file_handle->insert_records(bufs, nullptr);
+    ASSERT_EQ(records.size(), batch_rids.size());
+    for (size_t i = 0; i < records.size(); i++) {
+        ASSERT_EQ(0u, mock.count(batch_rids[i]));
+        mock[batch_rids[i]] = records[i];
+    }
+    check_all(mock);
+    rm_manager->close_file(file_handle.get());
+    file_handle = rm_manager->open_file(filename);
+    ASSERT_TRUE(file_handle->is_slotted());
+    check_all(mock);
+
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+
+    // Scenario: a table file from before the record layout existed holds only the 20-byte file header;
+    // it opens as a fixed-length file and takes rows.
+    std::string legacy_filename = "varlen_legacy.txt";
+    if (disk_manager->is_file(legacy_filename)) {
+        rm_manager->destroy_file(legacy_filename);
+    }
+    int legacy_record_size = 16;
+    rm_manager->create_file(legacy_filename, legacy_record_size);
+    ASSERT_EQ(0, truncate(legacy_filename.c_str(), sizeof(RmFileHdr)));
+    file_handle = rm_manager->open_file(legacy_filename);
+    EXPECT_FALSE(file_handle->is_slotted());
+    EXPECT_FALSE(file_handle->is_pax());
+    EXPECT_EQ(1, file_handle->get_file_hdr().num_pages);
+    std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> legacy_mock;
+    for (int i = 0; i < 100; i++) {
+        std::string record(legacy_record_size, '\0');
+        rand_buf(legacy_record_size, record.data());
+        legacy_mock[file_handle->insert_record(record.data(), nullptr)] = record;
+    }
+    check_equal(file_handle.get(), legacy_mock);
+    rm_manager->close_file(file_handle.get());
+    file_handle = rm_manager->open_file(legacy_filename);
+    check_equal(file_handle.get(), legacy_mock);
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(legacy_filename);
+}
+
+TEST(RecordManagerTest, PaxTest) {
+    srand((unsigned)time(nullptr));
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(256, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    // int | CHAR(8) | CHAR(20)
+    int record_size = 32;
+    std::vector<RmColumn> cols = {{0, 4}, {4, 8}, {12, 20}};
+    EXPECT_THROW(rm_manager->create_file("pax.txt", record_size, {}, {{0, 4}, {8, 24}}), InternalError);
+
+    for (bool pax : {true, false}) {
+        std::string filename = pax ? "pax.txt" : "pax_row.txt";
+        if (disk_manager->is_file(filename)) {
+            disk_manager->destroy_file(filename);
+        }
+        rm_manager->create_file(filename, record_size, {}, pax ? cols : std::vector<RmColumn>());
+        auto file_handle = rm_manager->open_file(filename);
+        ASSERT_EQ(pax, file_handle->is_pax());
+        int num_slot = file_handle->file_hdr_.num_records_per_page;
+
+        std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> mock;
+        std::vector<Rid> rids;
+        char write_buf[PAGE_SIZE];
+
+        // Scenario: a full page is returned in place, column by column, without copying.
+        for (int i = 0; i < num_slot; i++) {
+            rand_buf(record_size, write_buf);
+            Rid rid = file_handle->insert_record(write_buf, nullptr);
+            mock[rid] = std::string(write_buf, record_size);
+            rids.push_back(rid);
+        }
+        if (pax) {
+            RmColumnScan scan(file_handle.get(), {cols[2], cols[0]});
+            ASSERT_TRUE(scan.next_batch());
+            EXPECT_EQ(num_slot, scan.get_num_rows());
+            auto page_handle = file_handle->fetch_page_handle(rids[0].page_no);
+            EXPECT_EQ(page_handle.get_minipage(cols[2]), scan.get_column(0));
+            EXPECT_EQ(page_handle.get_minipage(cols[0]), scan.get_column(1));
+            buffer_pool_manager->unpin_page(page_handle.page->get_page_id(), false);
+            EXPECT_FALSE(scan.next_batch());
+            EXPECT_THROW(RmColumnScan(file_handle.get(), {{4, 4}}), InternalError);
+        }
+
+        // Scenario: random inserts, updates and deletes through the row API read back the same in either layout.
+        for (int i = 0; i < 5000; i++) {
+            int op = rand() % 4;
+            rand_buf(record_size, write_buf);
+            if (rids.empty() || op < 2) {
+                Rid rid = file_handle->insert_record(write_buf, nullptr);
+                mock[rid] = std::string(write_buf, record_size);
+                rids.push_back(rid);
+            } else {
+                size_t pos = rand() % rids.size();
+                if (op == 2) {
+                    file_handle->update_record(rids[pos], write_buf, nullptr);
+                    mock[rids[pos]] = std::string(write_buf, record_size);
+                } else {
+                    file_handle->delete_record(rids[pos], nullptr);
+                    mock.erase(rids[pos]);
+                    rids[pos] = rids.back();
+                    rids.pop_back();
+                }
+            }
+        }
+        check_equal(file_handle.get(), mock);
+
+        // Scenario: the column scan returns every live row once, with the requested columns as dense arrays.
+        size_t num_rows = 0;
+        for (RmColumnScan scan(file_handle.get(), {cols[1], cols[0]}); scan.next_batch();) {
+            ASSERT_GT(scan.get_num_rows(), 0);
+            for (int row = 0; row < scan.get_num_rows(); row++) {
+                auto &record = mock.at(scan.get_rid(row));
+                EXPECT_EQ(0, memcmp(scan.get_column(0) + row * 8, record.data() + 4, 8));
+                EXPECT_EQ(0, memcmp(scan.get_column(1) + row * 4, record.data(), 4));
+            }
+            num_rows += scan.get_num_rows();
+        }
+        EXPECT_EQ(mock.size(), num_rows);
+
+        rm_manager->close_file(file_handle.get());
+        rm_manager->destroy_file(filename);
+    }
+}
+
+TEST(RecordManagerTest, DictionaryTest) {
+    srand((unsigned)time(nullptr));
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(256, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    // int | CHAR(2) dictionary | VARCHAR(20) | CHAR(2) dictionary
+    std::string filename = "dict.txt";
+    int record_size = 28;
+    std::vector<RmColumn> var_cols = {{6, 20}};
+    std::vector<RmColumn> dict_cols = {{4, 2}, {26, 2}};
+    if (disk_manager->is_file(filename)) {
+        rm_manager->destroy_file(filename);
+    }
+    EXPECT_THROW(rm_manager->create_file(filename, record_size, {{4, 4}}, {}, dict_cols), InternalError);
+    EXPECT_THROW(rm_manager->create_file(filename, record_size, {}, {{0, 4}, {4, 24}}, dict_cols), InternalError);
+    rm_manager->create_file(filename, record_size, var_cols, {}, dict_cols);
+    auto file_handle = rm_manager->open_file(filename);
+    ASSERT_TRUE(file_handle->is_slotted());
+    EXPECT_EQ(0, file_handle->get_dict_col_no(4));
+    EXPECT_EQ(1, file_handle->get_dict_col_no(26));
+    EXPECT_EQ(-1, file_handle->get_dict_col_no(6));
+
+    std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> mock;
+    std::vector<Rid> rids;
+    char write_buf[PAGE_SIZE];
+    auto make_record = [&](int i, int var_len) {
+        memset(write_buf, 0, record_size);
+        memcpy(write_buf, &i, sizeof(i));
+        write_buf[4] = static_cast<char>('A' + i % 50 / 10);
+        write_buf[5] = static_cast<char>('0' + i % 10);
+        for (int j = 0; j < var_len; j++) {
+            write_buf[6 + j] = static_cast<char>('a' + rand() % 26);
+        }
+        memcpy(write_buf + 26, i % 3 == 0 ? "BC" : "GC", 2);
+    };
+    // A filtered scan returns exactly the rows whose column compares as the filter says.
+    auto check_filter = [&](RmCodeFilter filter, const char *value) {
+        auto &col = dict_cols[filter.dict_col_no];
+        size_t expected = 0;
+        for (auto &[rid, record] : mock) {
+            expected += (memcmp(record.data() + col.offset, value, col.len) == 0) == filter.equal;
+        }
+        size_t num_found = 0;
+        for (RmScan scan(file_handle.get(), {filter}); !scan.is_end(); scan.next()) {
+            EXPECT_EQ((memcmp(scan.record() + col.offset, value, col.len) == 0), filter.equal);
+            EXPECT_EQ(0, memcmp(scan.record(), mock.at(scan.rid()).data(), record_size));
+            num_found++;
+        }
+        EXPECT_EQ(expected, num_found);
+    };
+
+    // Scenario: rows round-trip through codes, and each column numbers its own distinct values.
+    for (int i = 0; i < 2000; i++) {
+        make_record(i, rand() % 4);
+        Rid rid = file_handle->insert_record(write_buf, nullptr);
+        mock[rid] = std::string(write_buf, record_size);
+        rids.push_back(rid);
+    }
+    check_equal(file_handle.get(), mock);
+    const RmDictionary *dict = file_handle->get_dictionary();
+    EXPECT_EQ(50, dict->get_num_codes(0));
+    EXPECT_EQ(2, dict->get_num_codes(1));
+    EXPECT_EQ(0, dict->lookup(1, "BC", 2));
+    EXPECT_EQ(RmDictionary::NOT_FOUND, dict->lookup(1, "XX", 2));
+
+    // Scenario: code filters return the same rows as comparing the strings, including forwarded rows.
+    for (int i = 0; i < 300; i++) {
+        size_t pos = rand() % rids.size();
+        make_record(i, 20);
+        file_handle->update_record(rids[pos], write_buf, nullptr);
+        mock[rids[pos]] = std::string(write_buf, record_size);
+    }
+    check_filter(RmCodeFilter{0, dict->lookup(0, "C7", 2), true}, "C7");
+    check_filter(RmCodeFilter{1, dict->lookup(1, "GC", 2), false}, "GC");
+    check_filter(RmCodeFilter{0, RmDictionary::NOT_FOUND, true}, "ZZ");
+    check_filter(RmCodeFilter{0, RmDictionary::NOT_FOUND, false}, "ZZ");
+
+    // Scenario: the dictionary survives reopening, and a torn entry at its tail is dropped.
+    rm_manager->close_file(file_handle.get());
+    std::string dict_path = filename + DICTIONARY_SUFFIX;
+    off_t dict_size = disk_manager->get_file_size(dict_path);
+    {
+        std::ofstream ofs(dict_path, std::ios::binary | std::ios::app);
+        ofs.write("\1\0\7", 3);
+    }
+    file_handle = rm_manager->open_file(filename);
+    EXPECT_EQ(dict_size, disk_manager->get_file_size(dict_path));
+    check_equal(file_handle.get(), mock);
+    dict = file_handle->get_dictionary();
+    EXPECT_EQ(0, dict->lookup(1, "BC", 2));
+    make_record(7, 3);
+    memcpy(write_buf + 26, "AA", 2);
+    Rid rid = file_handle->insert_record(write_buf, nullptr);
+    mock[rid] = std::string(write_buf, record_size);
+    EXPECT_EQ(2, dict->lookup(1, "AA", 2));
+    check_filter(RmCodeFilter{1, 2, true}, "AA");
+
+    // Scenario: readers decode every published code while a writer keeps appending values to the same column.
+    {
+        RmDictionary concurrent_dict("dict_concurrent.dict", 1);
+        int num_values = 3000;
+        std::atomic<bool> done{false};
+        auto reader = [&]() {
+            char out[8];
+            while (!done) {
+                int num_codes = concurrent_dict.get_num_codes(0);
+                for (int code = 0; code < num_codes; code++) {
+                    concurrent_dict.decode(0, static_cast<uint16_t>(code), out, sizeof(out));
+                    ASSERT_EQ(std::to_string(code), std::string(out));
+                }
+            }
+        };
+        std::vector<std::thread> readers;
+        for (int i = 0; i < 3; i++) {
+            readers.emplace_back(reader);
+        }
+        for (int i = 0; i < num_values; i++) {
+            std::string value = std::to_string(i);
+            EXPECT_EQ(i, concurrent_dict.get_or_add(0, value.data(), static_cast<int>(value.size())));
+        }
+        done = true;
+        for (auto &thread : readers) {
+            thread.join();
+        }
+        EXPECT_EQ(num_values, concurrent_dict.get_num_codes(0));
+    }
+    unlink("dict_concurrent.dict");
+
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+    EXPECT_FALSE(disk_manager->is_file(dict_path));
+}
+
+TEST(RecordManagerTest, VacuumTest) {
+    srand((unsigned)time(nullptr));
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(256, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    using Mock = std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t>;
+    // 随机删除keep_one_in中的其余记录后整理，按回调给出的新位置更新mock并检查文件变小
+    auto vacuum = [&](const std::string &filename, int record_size, const std::vector<RmColumn> &var_cols,
+                      const std::function<std::string()> &make_record, int num_records, int keep_one_in) {
+        if (disk_manager->is_file(filename)) {
+            disk_manager->destroy_file(filename);
+        }
+        rm_manager->create_file(filename, record_size, var_cols);
+        auto file_handle = rm_manager->open_file(filename);
+        Mock mock;
+        std::vector<Rid> rids;
+        for (int i = 0; i < num_records; i++) {
+            std::string record = make_record();
+            Rid rid = file_handle->insert_record(record.data(), nullptr);
+            mock[rid] = record;
+            rids.push_back(rid);
+        }
+        // 变长记录变长后被转发到其他页面，整理时作为普通记录移动
+        if (file_handle->is_slotted()) {
+            for (size_t i = 0; i < rids.size(); i += 7) {
+                std::string record = make_record();
+                file_handle->update_record(rids[i], record.data(), nullptr);
+                mock[rids[i]] = record;
+            }
+        }
+        for (Rid rid : rids) {
+            if (rand() % keep_one_in != 0) {
+                file_handle->delete_record(rid, nullptr);
+                mock.erase(rid);
+            }
+        }
+        double free_ratio = file_handle->get_free_ratio();
+        EXPECT_GT(free_ratio, 0.5);
+
+        Mock moved;
+        auto stats = file_handle->compact([&](const Rid &old_rid, const Rid &new_rid, const char *record) {
+            ASSERT_EQ(1u, mock.count(old_rid));
+            ASSERT_EQ(0, memcmp(mock[old_rid].data(), record, record_size));
+            moved[new_rid] = mock[old_rid];
+            mock.erase(old_rid);
+        });
+        for (auto &[rid, record] : moved) {
+            ASSERT_EQ(0u, mock.count(rid));
+            mock[rid] = record;
+        }
+        EXPECT_EQ(static_cast<int>(moved.size()), stats.num_moved);
+        EXPECT_GT(stats.num_moved, 0);
+        EXPECT_LT(stats.new_num_pages, stats.old_num_pages / 2);
+        EXPECT_EQ(stats.new_num_pages, file_handle->file_hdr_.num_pages);
+        EXPECT_EQ(static_cast<off_t>(stats.new_num_pages) * PAGE_SIZE, disk_manager->get_file_size(filename));
+        EXPECT_LT(file_handle->get_free_ratio(), free_ratio);
+        check_equal(file_handle.get(), mock);
+        check_free_space_map(disk_manager.get(), buffer_pool_manager.get(), file_handle.get());
+
+        // Scenario: the shrunk file reopens intact and keeps growing from its new end.
+        rm_manager->close_file(file_handle.get());
+        file_handle = rm_manager->open_file(filename);
+        EXPECT_EQ(stats.new_num_pages, file_handle->file_hdr_.num_pages);
+        check_equal(file_handle.get(), mock);
+        for (int i = 0; i < num_records / 2; i++) {
+            std::string record = make_record();
+            mock[file_handle->insert_record(record.data(), nullptr)] = record;
+        }
+        check_equal(file_handle.get(), mock);
+        check_free_space_map(disk_manager.get(), buffer_pool_manager.get(), file_handle.get());
+
+        rm_manager->close_file(file_handle.get());
+        rm_manager->destroy_file(filename);
+    };
+
+    // Scenario: a fixed-length file with scattered live records is packed into its first pages.
+    int record_size = 256;
+    vacuum("vacuum_fixed.txt", record_size, {}, [&]() {
+        std::string record(record_size, '\0');
+        rand_buf(record_size, record.data());
+        return record;
+    }, 3000, 5);
+
+    // Scenario: a slotted file, including forwarded records, is packed the same way.
+    int var_record_size = 300;
+    std::vector<RmColumn> var_cols = {{4, 100}, {120, 180}};
+    vacuum("vacuum_varlen.txt", var_record_size, var_cols, [&]() {
+        std::string record(var_record_size, '\0');
+        rand_buf(var_record_size, record.data());
+        for (auto &col : var_cols) {
+            int len = rand() % (col.len + 1);
+            for (int i = 0; i < col.len; i++) {
+                record[col.offset + i] = i < len ? static_cast<char>('a' + rand() % 26) : '\0';
+            }
+        }
+        return record;
+    }, 3000, 5);
+}
+
+TEST(SystemManagerTest, PaxTableTest) {
+    const std::string db_name = "sm_pax_db";
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(256, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto ix_manager = std::make_unique<IxManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto sm_manager =
+        std::make_unique<SmManager>(disk_manager.get(), buffer_pool_manager.get(), rm_manager.get(), ix_manager.get());
+    if (sm_manager->is_dir(db_name)) {
+        sm_manager->drop_db(db_name);
+    }
+    sm_manager->create_db(db_name);
+    sm_manager->open_db(db_name);
+
+    Transaction txn(0);
+    Context context(nullptr, nullptr, &txn);
+    // Scenario: PAX columns are fixed-size arrays, so VARCHAR and dictionary columns are rejected up front.
+    EXPECT_THROW(sm_manager->create_table("t_varchar", {{"a", TYPE_INT, 4}, {"b", TYPE_STRING, 16, true}}, &context,
+                                          true),
+                 InternalError);
+    EXPECT_THROW(sm_manager->create_table("t_dict", {{"a", TYPE_INT, 4}, {"b", TYPE_STRING, 16, false, true}},
+                                          &context, true),
+                 InternalError);
+    EXPECT_FALSE(sm_manager->db_.is_table("t_varchar"));
+    EXPECT_FALSE(sm_manager->db_.is_table("t_dict"));
+
+    // Scenario: a PAX table with fixed-size columns is created and read back column by column.
+    sm_manager->create_table("t_pax", {{"a", TYPE_INT, 4}, {"b", TYPE_FLOAT, 4}, {"c", TYPE_STRING, 8}}, &context,
+                             true);
+    RmFileHandle *fh = sm_manager->fhs_.at("t_pax").get();
+    ASSERT_TRUE(fh->is_pax());
+    int num_records = 1000;
+    char record[16] = {};
+    for (int i = 0; i < num_records; i++) {
+        float b = i * 0.5f;
+        memcpy(record, &i, sizeof(int));
+        memcpy(record + 4, &b, sizeof(float));
+        fh->insert_record(record, nullptr);
+    }
+    int count = 0;
+    long long sum = 0;
+    for (RmColumnScan scan(fh, {{0, 4}}); scan.next_batch();) {
+        for (int i = 0; i < scan.get_num_rows(); i++) {
+            sum += *reinterpret_cast<const int *>(scan.get_column(0) + i * 4);
+        }
+        count += scan.get_num_rows();
+    }
+    EXPECT_EQ(num_records, count);
+    EXPECT_EQ(1LL * num_records * (num_records - 1) / 2, sum);
+
+    for (auto &[tab_name, fh] : sm_manager->fhs_) {
+        rm_manager->close_file(fh.get());
+    }
+    sm_manager->fhs_.clear();
+    if (chdir("..") < 0) {
+        throw UnixError();
+    }
+    sm_manager->drop_db(db_name);
+}
+
+TEST(SystemManagerTest, VacuumIndexTest) {
+    srand((unsigned)time(nullptr));
+
+    const std::string db_name = "sm_vacuum_db";
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(256, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto ix_manager = std::make_unique<IxManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto sm_manager =
+        std::make_unique<SmManager>(disk_manager.get(), buffer_pool_manager.get(), rm_manager.get(), ix_manager.get());
+    if (sm_manager->is_dir(db_name)) {
+        sm_manager->drop_db(db_name);
+    }
+    sm_manager->create_db(db_name);
+    sm_manager->open_db(db_name);
+    LockManager lock_manager;
+    TransactionManager txn_manager(&lock_manager, sm_manager.get());
+
+    Transaction txn(0);
+    Context context(nullptr, nullptr, &txn);
+    // id INT | payload CHAR(200)，id上有唯一索引
+    int record_size = 204;
+    sm_manager->create_table("t_vacuum", {{"id", TYPE_INT, 4}, {"payload", TYPE_STRING, 200}}, &context);
+    sm_manager->create_index("t_vacuum", {"id"}, &context);
+    RmFileHandle *fh = sm_manager->fhs_.at("t_vacuum").get();
+    IxIndexHandle *ih = sm_manager->ihs_.at(ix_manager->get_index_name("t_vacuum", {"id"})).get();
+
+    std::map<int, std::pair<Rid, std::string>> rows; // id -> (记录号, 记录)
+    int num_records = 3000;
+    std::string record(record_size, '\0');
+    for (int id = 0; id < num_records; id++) {
+        memcpy(record.data(), &id, sizeof(int));
+        rand_buf(record_size - 4, record.data() + 4);
+        Rid rid = fh->insert_record(record.data(), nullptr);
+        ih->insert_entry(record.data(), rid, nullptr);
+        rows[id] = {rid, record};
+    }
+    for (int id = 0; id < num_records; id++) {
+        if (rand() % 5 != 0) {
+            fh->delete_record(rows[id].first, nullptr);
+            ih->delete_entry(reinterpret_cast<const char *>(&id), nullptr);
+            rows.erase(id);
+        }
+    }
+    page_id_t old_num_pages = fh->get_file_hdr().num_pages;
+
+    // Scenario: background vacuum skips a table that an open transaction has written, and packs it once that commits.
+    Transaction pending(1000);
+    txn_manager.begin(&pending, nullptr);
+    WriteRecord write_record(WType::DELETE_TUPLE, "t_vacuum", rows.begin()->second.first);
+    pending.append_write_record(&write_record);
+    EXPECT_TRUE(txn_manager.has_uncommitted_writes("t_vacuum"));
+    EXPECT_EQ(0, sm_manager->auto_vacuum_round(&txn_manager, 0.5));
+    EXPECT_EQ(old_num_pages, fh->get_file_hdr().num_pages);
+    pending.set_state(TransactionState::COMMITTED);
+    EXPECT_FALSE(txn_manager.has_uncommitted_writes("t_vacuum"));
+    EXPECT_EQ(1, sm_manager->auto_vacuum_round(&txn_manager, 0.5));
+    EXPECT_LT(fh->get_file_hdr().num_pages, old_num_pages / 2);
+    pending.get_write_set()->clear();
+    TransactionManager::txn_map.erase(pending.get_transaction_id());
+
+    // Scenario: every surviving key is found through the index at its new rid, and deleted keys stay gone.
+    int num_moved = 0;
+    for (auto &[id, row] : rows) {
+        std::vector<Rid> rids;
+        ASSERT_TRUE(ih->get_value(reinterpret_cast<const char *>(&id), &rids, nullptr));
+        ASSERT_EQ(1u, rids.size());
+        ASSERT_LT(rids[0].page_no, fh->get_file_hdr().num_pages);
+        EXPECT_EQ(0, memcmp(fh->get_record(rids[0], nullptr)->data, row.second.data(), record_size));
+        num_moved += rids[0] == row.first ? 0 : 1;
+    }
+    EXPECT_GT(num_moved, 0);
+    for (int id = 0; id < num_records; id++) {
+        std::vector<Rid> rids;
+        EXPECT_EQ(rows.count(id) == 1, ih->get_value(reinterpret_cast<const char *>(&id), &rids, nullptr));
+    }
+
+    // Scenario: the moved rows and index entries reached disk before the truncate, without closing anything.
+    auto check_on_disk = [&](int fd, page_id_t num_pages) {
+        std::vector<char> buf(PAGE_SIZE);
+        for (page_id_t page_no = 1; page_no < num_pages; page_no++) {
+            if (disk_manager->is_page_free(fd, page_no)) {
+                continue;
+            }
+            Page *page = buffer_pool_manager->fetch_page(PageId{fd, page_no});
+            disk_manager->read_page(fd, page_no, buf.data(), PAGE_SIZE);
+            EXPECT_EQ(0, memcmp(page->get_data(), buf.data(), PAGE_SIZE));
+            buffer_pool_manager->unpin_page(page->get_page_id(), false);
+        }
+    };
+    check_on_disk(fh->GetFd(), fh->get_file_hdr().num_pages);
+    check_on_disk(ih->get_fd(), ih->get_page_cnt());
+
+    // Scenario: the packed table and its index read back the same after reopening the database.
+    for (auto &[tab_name, fh] : sm_manager->fhs_) {
+        rm_manager->close_file(fh.get());
+    }
+    for (auto &[index_name, ih] : sm_manager->ihs_) {
+        ix_manager->close_index(ih.get());
+    }
+    sm_manager->fhs_.clear();
+    sm_manager->ihs_.clear();
+    if (chdir("..") < 0) {
+        throw UnixError();
+    }
+    sm_manager->open_db(db_name);
+    fh = sm_manager->fhs_.at("t_vacuum").get();
+    ih = sm_manager->ihs_.at(ix_manager->get_index_name("t_vacuum", {"id"})).get();
+    for (auto &[id, row] : rows) {
+        std::vector<Rid> rids;
+        ASSERT_TRUE(ih->get_value(reinterpret_cast<const char *>(&id), &rids, nullptr));
+        EXPECT_EQ(0, memcmp(fh->get_record(rids[0], nullptr)->data, row.second.data(), record_size));
+    }
+
+    for (auto &[tab_name, fh] : sm_manager->fhs_) {
+        rm_manager->close_file(fh.get());
+    }
+    for (auto &[index_name, ih] : sm_manager->ihs_) {
+        ix_manager->close_index(ih.get());
+    }
+    sm_manager->fhs_.clear();
+    sm_manager->ihs_.clear();
+    if (chdir("..") < 0) {
+        throw UnixError();
+    }
+    sm_manager->drop_db(db_name);
+}
+
+TEST(IndexTest, PageReuseTest) {
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(256, disk_manager.get());
+    auto ix_manager = std::make_unique<IxManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    std::string filename = "page_reuse";
+    ColMeta col;
+    col.tab_name = filename;
+    col.name = "k";
+    col.type = TYPE_INT;
+    col.len = sizeof(int);
+    col.offset = 0;
+    std::vector<ColMeta> index_cols{col};
+    if (ix_manager->exists(filename, index_cols)) {
+        ix_manager->destroy_index(filename, index_cols);
+    }
+    ix_manager->create_index(filename, index_cols);
+    auto ih = ix_manager->open_index(filename, index_cols);
+    int fd = ih->fd_;
+
+    auto insert = [&](int lo, int hi) {
+        for (int key = lo; key < hi; key++) {
+            ih->insert_entry(reinterpret_cast<const char *>(&key), Rid{key, key}, nullptr);
+        }
+    };
+    auto check = [&](int lo, int hi, bool expect) {
+        for (int key = lo; key < hi; key++) {
+            std::vector<Rid> result;
+            bool found = ih->get_value(reinterpret_cast<const char *>(&key), &result, nullptr);
+            ASSERT_EQ(expect, found) << "key " << key;
+            if (found) {
+                ASSERT_EQ(key, result[0].page_no);
+            }
+        }
+    };
+
+    // Scenario: nodes emptied by merges are freed, and inserting the same number of keys again reuses them.
+    constexpr int num_keys = 50000;
+    insert(0, num_keys);
+    page_id_t num_pages = disk_manager->get_page_stats(fd).num_pages;
+    for (int key = 0; key < num_keys; key++) {
+        if (key % 100 != 0) {
+            ih->delete_entry(reinterpret_cast<const char *>(&key), nullptr);
+        }
+    }
+    EXPECT_GT(disk_manager->get_page_stats(fd).num_free_pages, num_pages / 2);
+    for (int key = 0; key < num_keys; key += 100) {
+        check(key, key + 1, true);
+        check(key + 1, key + 100, false);
+    }
+    insert(num_keys, 2 * num_keys - num_keys / 100);
+    EXPECT_LE(disk_manager->get_page_stats(fd).num_pages, num_pages + num_pages / 10);
+    check(num_keys, 2 * num_keys - num_keys / 100, true);
+
+    // Scenario: the leaf chain stays in key order after the merges.
+    int prev = -1;
+    int num_scanned = 0;
+    for (IxScan scan(ih.get(), ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager.get()); !scan.is_end();
+         scan.next()) {
+        Rid rid = scan.rid();
+        EXPECT_LT(prev, rid.page_no);
+        prev = rid.page_no;
+        num_scanned++;
+    }
+    EXPECT_EQ(num_keys / 100 + num_keys - num_keys / 100, num_scanned);
+
+    ix_manager->close_index(ih.get());
+    ix_manager->destroy_index(filename, index_cols);
+}
+
+TEST(StorageTest, PageSizeTest) {
+    // Scenario: every layer works with each supported page size, and larger pages hold more records and keys.
+    int prev_records_per_page = 0;
+    int prev_btree_order = 0;
+    for (int page_size = PAGE_SIZE; page_size <= MAX_PAGE_SIZE; page_size *= 2) {
+        auto disk_manager = std::make_unique<DiskManager>();
+        disk_manager->set_page_size(page_size);
+        auto buffer_pool_manager = std::make_unique<BufferPoolManager>(64, disk_manager.get());
+        auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+        auto ix_manager = std::make_unique<IxManager>(disk_manager.get(), buffer_pool_manager.get());
+        EXPECT_EQ(buffer_pool_manager->pages_[0].get_data() + page_size, buffer_pool_manager->pages_[1].get_data());
+
+        std::string filename = "page_size.txt";
+        if (disk_manager->is_file(filename)) {
+            disk_manager->destroy_file(filename);
+        }
+        int record_size = 200;
+        rm_manager->create_file(filename, record_size);
+        auto file_handle = rm_manager->open_file(filename);
+        const RmFileHdr &file_hdr = file_handle->file_hdr_;
+        EXPECT_GT(file_hdr.num_records_per_page, prev_records_per_page);
+        EXPECT_LE(static_cast<int>(sizeof(RmPageHdr)) + file_hdr.bitmap_size +
+                      file_hdr.num_records_per_page * record_size,
+                  page_size);
+        prev_records_per_page = file_hdr.num_records_per_page;
+
+        std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> mock;
+        char write_buf[MAX_PAGE_SIZE];
+        for (int i = 0; i < 3000; i++) {
+            rand_buf(record_size, write_buf);
+            Rid rid = file_handle->insert_record(write_buf, nullptr);
+            mock[rid] = std::string(write_buf, record_size);
+        }
+        for (auto it = mock.begin(); it != mock.end();) {
+            if (rand() % 3 == 0) {
+                file_handle->delete_record(it->first, nullptr);
+                it = mock.erase(it);
+            } else {
+                it++;
+            }
+        }
+        check_equal(file_handle.get(), mock);
+        rm_manager->close_file(file_handle.get());
+        file_handle = rm_manager->open_file(filename);
+        check_equal(file_handle.get(), mock);
+        EXPECT_EQ(static_cast<off_t>(file_handle->file_hdr_.num_pages) * page_size,
+                  disk_manager->get_file_size(filename));
+        rm_manager->close_file(file_handle.get());
+        rm_manager->destroy_file(filename);
+
+        ColMeta col;
+        col.tab_name = filename;
+        col.name = "k";
+        col.type = TYPE_INT;
+        col.len = sizeof(int);
+        col.offset = 0;
+        std::vector<ColMeta> index_cols{col};
+        if (ix_manager->exists(filename, index_cols)) {
+            ix_manager->destroy_index(filename, index_cols);
+        }
+        ix_manager->create_index(filename, index_cols);
+        auto ih = ix_manager->open_index(filename, index_cols);
+        EXPECT_GT(ih->file_hdr_->btree_order_, prev_btree_order);
+        prev_btree_order = ih->file_hdr_->btree_order_;
+        constexpr int num_keys = 20000;
+        for (int key = 0; key < num_keys; key++) {
+            ih->insert_entry(reinterpret_cast<const char *>(&key), Rid{key, 0}, nullptr);
+        }
+        for (int key = 0; key < num_keys; key += 2) {
+            ih->delete_entry(reinterpret_cast<const char *>(&key), nullptr);
+        }
+        ix_manager->close_index(ih.get());
+        ih = ix_manager->open_index(filename, index_cols);
+        for (int key = 0; key < num_keys; key++) {
+            std::vector<Rid> result;
+            ASSERT_EQ(key % 2 == 1, ih->get_value(reinterpret_cast<const char *>(&key), &result, nullptr));
+        }
+        ix_manager->close_index(ih.get());
+        ix_manager->destroy_index(filename, index_cols);
+    }
+
+    // Scenario: db.meta records the page size, and a db.meta without it reads back the default page size.
+    DbMeta db;
+    db.name_ = "page_size_db";
+    db.page_size_ = 16384;
+    std::stringstream ss;
+    ss << db;
+    DbMeta read_db;
+    ss >> read_db;
+    EXPECT_EQ(16384, read_db.get_page_size());
+    std::stringstream old_ss("old_db\n0\n");
+    DbMeta old_db;
+    old_ss >> old_db;
+    EXPECT_EQ("old_db", old_db.name_);
+    EXPECT_EQ(PAGE_SIZE, old_db.get_page_size());
+
+    EXPECT_FALSE(DiskManager::is_valid_page_size(2048));
+    EXPECT_FALSE(DiskManager::is_valid_page_size(12288));
+    EXPECT_FALSE(DiskManager::is_valid_page_size(2 * MAX_PAGE_SIZE));
+    EXPECT_THROW(DiskManager().set_page_size(12288), InternalError);
+}
+
+TEST(PageCodecTest, SampleTest) {
+    std::mt19937 rng(42);
+    std::vector<char> page(PAGE_SIZE);
+    std::vector<char> compressed(PAGE_SIZE);
+    std::vector<char> restored(PAGE_SIZE);
+
+    // Scenario: a page of short records padded with zeros compresses well and decompresses to the same bytes.
+    memset(page.data(), 0, PAGE_SIZE);
+    for (int off = 0; off + 64 <= PAGE_SIZE; off += 64) {
+        for (int i = 0; i < 8; i++) {
+            page[off + i] = static_cast<char>(rng());
+        }
+    }
+    int len = page_compress(page.data(), PAGE_SIZE, compressed.data(), PAGE_SIZE - 1);
+    EXPECT_GT(len, 0);
+    EXPECT_LT(len, PAGE_SIZE / 4);
+    ASSERT_TRUE(page_decompress(compressed.data(), len, restored.data(), PAGE_SIZE));
+    EXPECT_EQ(page, restored);
+
+    // Scenario: an all-zero page and long runs mixed with random bytes round-trip too.
+    for (int round = 0; round < 100; round++) {
+        memset(page.data(), round == 0 ? 0 : static_cast<char>(rng()), PAGE_SIZE);
+        int num_random = round == 0 ? 0 : static_cast<int>(rng() % 64);
+        for (int i = 0; i < num_random; i++) {
+            int off = rng() % PAGE_SIZE;
+            int n = std::min(static_cast<int>(rng() % 300), PAGE_SIZE - off);
+            for (int j = 0; j < n; j++) {
+                page[off + j] = static_cast<char>(rng());
+            }
+        }
+        len = page_compress(page.data(), PAGE_SIZE, compressed.data(), PAGE_SIZE - 1);
+        ASSERT_GT(len, 0);
+        ASSERT_TRUE(page_decompress(compressed.data(), len, restored.data(), PAGE_SIZE));
+        ASSERT_EQ(page, restored);
+    }
+
+    // Scenario: random bytes do not fit in less than a page, so the caller stores them raw.
+    for (auto &c : page) {
+        c = static_cast<char>(rng());
+    }
+    EXPECT_EQ(0, page_compress(page.data(), PAGE_SIZE, compressed.data(), PAGE_SIZE - 1));
+
+    // Scenario: truncated or corrupted input is rejected instead of overrunning the output.
+    memset(page.data(), 'a', PAGE_SIZE);
+    len = page_compress(page.data(), PAGE_SIZE, compressed.data(), PAGE_SIZE - 1);
+    ASSERT_GT(len, 2);
+    EXPECT_FALSE(page_decompress(compressed.data(), len - 1, restored.data(), PAGE_SIZE));
+    EXPECT_FALSE(page_decompress(compressed.data(), len, restored.data(), PAGE_SIZE - 1));
+    compressed[2] = static_cast<char>(0xff); // 匹配距离指向输出之前
+    compressed[3] = static_cast<char>(0xff);
+    EXPECT_FALSE(page_decompress(compressed.data(), len, restored.data(), PAGE_SIZE));
+}
+
+TEST(StorageTest, CompressedFileTest) {
+    auto disk_manager = std::make_unique<DiskManager>();
+    std::string filename = "compressed.txt";
+    std::string map_path = filename + COMPRESSED_PAGE_MAP_SUFFIX;
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    disk_manager->create_file(filename, true);
+    int fd = disk_manager->open_file(filename);
+    EXPECT_TRUE(disk_manager->is_compressed_file(fd));
+
+    // Scenario: pages written with compressible and random contents read back unchanged, unwritten pages read as zeros.
+    constexpr int num_pages = 64;
+    std::vector<std::vector<char>> mock(num_pages, std::vector<char>(PAGE_SIZE));
+    auto write_page = [&](page_id_t page_no, bool compressible) {
+        auto &buf = mock[page_no];
+        if (compressible) {
+            memset(buf.data(), 0, PAGE_SIZE);
+            rand_buf(100, buf.data() + rand() % (PAGE_SIZE - 100));
+        } else {
+            rand_buf(PAGE_SIZE, buf.data());
+        }
+        disk_manager->write_page(fd, page_no, buf.data(), PAGE_SIZE);
+    };
+    auto check_pages = [&]() {
+        std::vector<char> buf(PAGE_SIZE);
+        for (page_id_t page_no = 0; page_no < num_pages; page_no++) {
+            disk_manager->read_page(fd, page_no, buf.data(), PAGE_SIZE);
+            ASSERT_EQ(mock[page_no], buf) << "page " << page_no;
+        }
+    };
+    for (page_id_t page_no = 0; page_no < num_pages; page_no++) {
+        EXPECT_EQ(page_no, disk_manager->allocate_page(fd));
+        if (page_no % 8 != 0) {
+            write_page(page_no, page_no % 4 != 0);
+        }
+    }
+    check_pages();
+    CompressedFileStats stats;
+    ASSERT_TRUE(disk_manager->get_compressed_stats(fd, &stats));
+    EXPECT_EQ(static_cast<size_t>(num_pages - num_pages / 8), stats.num_pages);
+    EXPECT_LT(stats.stored_bytes, static_cast<int64_t>(num_pages) * PAGE_SIZE / 2);
+
+    // Scenario: rewriting pages with a different compressed size moves them and reuses the freed slots.
+    for (int round = 0; round < 200; round++) {
+        write_page(rand() % num_pages, rand() % 2 == 0);
+    }
+    char hdr[16];
+    rand_buf(sizeof(hdr), hdr);
+    memcpy(mock[3].data(), hdr, sizeof(hdr));
+    disk_manager->write_page(fd, 3, hdr, sizeof(hdr));
+    char partial[16];
+    disk_manager->read_page(fd, 5, partial, sizeof(partial));
+    EXPECT_EQ(0, memcmp(mock[5].data(), partial, sizeof(partial)));
+    check_pages();
+
+    // Scenario: a failed rewrite leaves the page mapped to its old slot with the old contents.
+    write_page(5, true);
+    ASSERT_TRUE(disk_manager->get_compressed_stats(fd, &stats));
+    int rw_fd = dup(fd);
+    int ro_fd = open(filename.c_str(), O_RDONLY);
+    ASSERT_GE(rw_fd, 0);
+    ASSERT_GE(ro_fd, 0);
+    ASSERT_EQ(fd, dup2(ro_fd, fd));
+    std::vector<char> rejected(PAGE_SIZE);
+    rand_buf(PAGE_SIZE, rejected.data());
+    EXPECT_THROW(disk_manager->write_page(fd, 5, rejected.data(), PAGE_SIZE), InternalError);
+    ASSERT_EQ(fd, dup2(rw_fd, fd));
+    close(ro_fd);
+    close(rw_fd);
+    CompressedFileStats failed;
+    ASSERT_TRUE(disk_manager->get_compressed_stats(fd, &failed));
+    EXPECT_EQ(stats.num_pages, failed.num_pages);
+    EXPECT_EQ(stats.stored_bytes, failed.stored_bytes);
+    check_pages();
+    write_page(5, false);
+    check_pages();
+
+    // Scenario: a deallocated page reads as zeros and stays gone after the page map is rebuilt.
+    disk_manager->deallocate_page(fd, 9);
+    memset(mock[9].data(), 0, PAGE_SIZE);
+    check_pages();
+
+    // Scenario: the page map is restored from its sidecar on a clean reopen.
+    ASSERT_TRUE(disk_manager->get_compressed_stats(fd, &stats));
+    disk_manager->close_file(fd);
+    EXPECT_FALSE(disk_manager->is_compressed_file(fd));
+    EXPECT_TRUE(disk_manager->is_file(map_path));
+    fd = disk_manager->open_file(filename);
+    EXPECT_FALSE(disk_manager->is_file(map_path));
+    CompressedFileStats reopened;
+    ASSERT_TRUE(disk_manager->get_compressed_stats(fd, &reopened));
+    EXPECT_EQ(stats.num_pages, reopened.num_pages);
+    EXPECT_EQ(stats.stored_bytes, reopened.stored_bytes);
+    EXPECT_EQ(stats.free_bytes, reopened.free_bytes);
+    check_pages();
+
+    // Scenario: without the sidecar, as after a crash, scanning the slot headers rebuilds the same map.
+    disk_manager->close_file(fd);
+    unlink(map_path.c_str());
+    fd = disk_manager->open_file(filename);
+    ASSERT_TRUE(disk_manager->get_compressed_stats(fd, &reopened));
+    EXPECT_EQ(stats.num_pages, reopened.num_pages);
+    EXPECT_EQ(stats.stored_bytes, reopened.stored_bytes);
+    EXPECT_EQ(stats.free_bytes, reopened.free_bytes);
+    check_pages();
+    write_page(9, true);
+    check_pages();
+
+    // Scenario: a file created with another page size is refused instead of being misread.
+    disk_manager->close_file(fd);
+    auto other = std::make_unique<DiskManager>();
+    other->set_page_size(2 * PAGE_SIZE);
+    EXPECT_THROW(other->open_file(filename), InternalError);
+    disk_manager->destroy_file(filename);
+    EXPECT_FALSE(disk_manager->is_file(map_path));
+}
+
+TEST(RecordManagerTest, CompressedFileTest) {
+    const size_t buffer_pool_size = 64;
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+    rm_manager->set_compress_files(true);
+
+    std::string filename = "compressed_table.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    int record_size = 128; // 记录的前16个字节随机，其余为0，类似于填充的字符串列
+    rm_manager->create_file(filename, record_size);
+    auto file_handle = rm_manager->open_file(filename);
+    EXPECT_TRUE(disk_manager->is_compressed_file(file_handle->GetFd()));
+
+    // Scenario: records survive eviction, background writes and reopening, and the file is much smaller than its pages.
+    buffer_pool_manager->start_background_writer(1, 16, 16);
+    std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> mock;
+    char write_buf[PAGE_SIZE] = {};
+    for (int i = 0; i < 10000; i++) {
+        rand_buf(16, write_buf);
+        Rid rid = file_handle->insert_record(write_buf, nullptr);
+        mock[rid] = std::string(write_buf, record_size);
+    }
+    for (auto it = mock.begin(); it != mock.end();) {
+        if (rand() % 4 == 0) {
+            file_handle->delete_record(it->first, nullptr);
+            it = mock.erase(it);
+        } else {
+            it++;
+        }
+    }
+    EXPECT_GT(file_handle->file_hdr_.num_pages, static_cast<int>(buffer_pool_size));
+    check_equal(file_handle.get(), mock);
+    buffer_pool_manager->stop_background_writer();
+    rm_manager->close_file(file_handle.get());
+    file_handle = rm_manager->open_file(filename);
+    EXPECT_EQ(record_size, file_handle->file_hdr_.record_size);
+    check_equal(file_handle.get(), mock);
+    EXPECT_LT(disk_manager->get_file_size(filename),
+              static_cast<off_t>(file_handle->file_hdr_.num_pages) * PAGE_SIZE / 2);
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+}
+
 class ExternalMergeSortTest : public ::testing::Test {
   public:
     void SetUp() override {